@@ -60,6 +60,25 @@ for ((i = 1; i <= $bkpt_count; i++)); do
     fi
 done
 
-# Pass and wait
 wait $PID
+
+# A breakpoint amid a hot block, at switch_context+56 between the stores and
+# the loads of the registers, is removed after the first stop. The block runs
+# millions of times afterwards, so it has to stay intact for the JIT compiler.
+outfile=/tmp/rv32emu-gdbstub-coro.$PID
+build/rv32emu -g build/coro.elf > ${outfile} &
+PID=$!
+OPTS="-ex 'file build/coro.elf' "
+OPTS+="-ex 'target remote :1234' "
+OPTS+="-ex 'break *0x104b8' "
+OPTS+="-ex 'continue' "
+OPTS+="-ex 'delete' "
+OPTS+="-ex 'continue' "
+eval "${GDB} --batch ${OPTS}" > ${tmpfile}
+wait $PID
+if ! grep -q "^3000000 context switches" ${outfile}; then
+    exit 1 # Fail
+fi
+
+# Pass
 exit 0
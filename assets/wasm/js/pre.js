@@ -1,9 +1,14 @@
-Module['noInitialRun'] = true;
-Module['onRuntimeInitialized'] = function(target_elf) {
-    if(target_elf === undefined){
-      console.warn("target elf executable is undefined");
-      return;
-    }
+/* Under node, e.g., make check-wasm, run the ELF given on the command line
+ * as the native build does. The page picks one instead, see index.html.
+ */
+if (typeof process !== 'object' || typeof process.versions?.node !== 'string') {
+  Module['noInitialRun'] = true;
+  Module['onRuntimeInitialized'] = function(target_elf) {
+      if(target_elf === undefined){
+        console.warn("target elf executable is undefined");
+        return;
+      }
 
-    callMain([target_elf]);
-};
+      callMain([target_elf]);
+  };
+}
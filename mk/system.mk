@@ -37,6 +37,7 @@ DEV_OBJS := $(patsubst $(DEV_SRC)/%.c, $(DEV_OUT)/%.o, $(wildcard $(DEV_SRC)/*.c
 deps := $(DEV_OBJS:%.o=%.o.d)
 
 OBJS_EXT += system.o
+OBJS_EXT += bootprof.o
 OBJS_EXT += dtc/libfdt/fdt.o dtc/libfdt/fdt_ro.o dtc/libfdt/fdt_rw.o dtc/libfdt/fdt_wip.o
 
 # system target execution by using default dependencies
@@ -46,4 +47,15 @@ system_deps += artifact $(BUILD_DTB) $(BUILD_DTB2C) $(BIN)
 system: $(system_deps)
 	$(system_action)
 
+# Boot to the login prompt and report where the time goes, timing every
+# initcall if the System.map of the kernel is around.
+BOOT_PROFILE_OUTPUT ?= boot_profile.csv
+BOOT_PROFILE_MAP ?= $(wildcard $(OUT)/$(LINUX_IMAGE_DIR)/System.map)
+BOOT_PROFILE_OPTS := $(BOOT_PROFILE_OUTPUT),exit
+ifneq ($(BOOT_PROFILE_MAP),)
+BOOT_PROFILE_OPTS := $(BOOT_PROFILE_OPTS),map=$(BOOT_PROFILE_MAP)
+endif
+boot-profile: $(system_deps)
+	$(BIN) -k $(OUT)/$(LINUX_IMAGE_DIR)/Image -i $(OUT)/$(LINUX_IMAGE_DIR)/rootfs.cpio -L $(BOOT_PROFILE_OPTS)
+
 endif
@@ -113,3 +113,42 @@ $(PATH_TEST_OUTDIR)/%.o: $(PATH_TEST_SRCDIR)/%.c
 	$(VECHO) "  CC\t$@\n"
 	$(Q)mkdir -p $(dir $@)
 	$(Q)$(CC) -o $@ $(CFLAGS) -I./src -c -MMD -MF $@.d $<
+
+# Micro-benchmarks, not part of 'make tests'
+MICROBENCH_SRCDIR := tests/microbench
+MICROBENCH_OUTDIR := $(OUT)/microbench
+MICROBENCH_TARGET := $(MICROBENCH_OUTDIR)/microbench
+MICROBENCH_ELF ?= build/readelf.elf
+
+MICROBENCH_OBJS := $(MICROBENCH_OUTDIR)/microbench.o \
+		   $(addprefix $(OUT)/, cache.o mpool.o map.o utils.o decode.o elf.o io.o)
+deps += $(MICROBENCH_OUTDIR)/microbench.o.d
+
+# count the heap allocations of the code under test where the linker can
+MICROBENCH_LDFLAGS := -lm
+ifeq ($(UNAME_S),Linux)
+MICROBENCH_CFLAGS := -DHAVE_MALLOC_WRAP=1
+MICROBENCH_LDFLAGS += $(foreach f,malloc calloc realloc free,-Wl,--wrap=$(f))
+endif
+
+microbench: $(MICROBENCH_TARGET)
+	$(Q)$(MICROBENCH_TARGET) $(MICROBENCH_ARGS) $(if $(MICROBENCH_TRACE),-t $(MICROBENCH_TRACE),$(MICROBENCH_ELF))
+
+$(MICROBENCH_TARGET): $(MICROBENCH_OBJS)
+	$(VECHO) "  CC\t$@\n"
+	$(Q)$(CC) $^ -o $@ $(LDFLAGS) $(MICROBENCH_LDFLAGS)
+
+$(MICROBENCH_OUTDIR)/%.o: $(MICROBENCH_SRCDIR)/%.c
+	$(VECHO) "  CC\t$@\n"
+	$(Q)mkdir -p $(dir $@)
+	$(Q)$(CC) -o $@ $(CFLAGS) $(MICROBENCH_CFLAGS) -I./src -c -MMD -MF $@.d $<
+
+# records the traces replayed with 'make microbench MICROBENCH_TRACE=<prefix>'
+ifeq ($(call has, PLUGIN), 1)
+microbench: $(MICROBENCH_OUTDIR)/trace.so
+
+$(MICROBENCH_OUTDIR)/trace.so: $(MICROBENCH_SRCDIR)/trace.c src/rv32emu_plugin.h
+	$(VECHO) "  CC\t$@\n"
+	$(Q)mkdir -p $(dir $@)
+	$(Q)$(CC) -o $@ $(CFLAGS) -fPIC -shared $<
+endif
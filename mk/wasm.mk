@@ -13,14 +13,25 @@ WEB_FILES := $(BIN).js \
 ifeq ("$(CC_IS_EMCC)", "1")
 BIN := $(BIN).js
 
-# TCO
+# TCO, which the threaded interpreter does without
+ifeq ($(call has, THREADED_CODE), 0)
 CFLAGS += -mtail-call
+endif
+
+# Run main(), and thus the emulation loop, in a worker of its own instead of
+# the main thread of the browser. With threads enabled the heap, guest memory
+# included, is a SharedArrayBuffer, so the main thread is left to present the
+# canvas and take the input, which the SDL port exchanges with the worker
+# through the proxying queues of emscripten. The page stops the worker with
+# indirect_rv_halt(), which only uses atomics and never blocks the main thread.
+CFLAGS_emcc += -pthread -sPROXY_TO_PTHREAD
+LDFLAGS += -pthread
 
 # Build emscripten-port SDL
 ifeq ($(call has, SDL), 1)
-CFLAGS_emcc += -sUSE_SDL=2 -sSDL2_MIXER_FORMATS=wav,mid -sUSE_SDL_MIXER=2
+CFLAGS_emcc += -sUSE_SDL=2 -sSDL2_MIXER_FORMATS=wav,mid -sUSE_SDL_MIXER=2 \
+	       -sOFFSCREENCANVAS_SUPPORT
 OBJS_EXT += syscall_sdl.o
-LDFLAGS += -pthread
 endif
 
 # More build flags
@@ -28,7 +39,7 @@ CFLAGS_emcc += -sINITIAL_MEMORY=2GB \
 	       -sALLOW_MEMORY_GROWTH \
 	       -s"EXPORTED_FUNCTIONS=$(EXPORTED_FUNCS)" \
 	       -sSTACK_SIZE=4MB \
-	       -sPTHREAD_POOL_SIZE=navigator.hardwareConcurrency \
+	       -sPTHREAD_POOL_SIZE='(typeof navigator=="object"?navigator.hardwareConcurrency:4)' \
 	       --embed-file build/jit-bf.elf@/jit-bf.elf \
 	       --embed-file build/coro.elf@/coro.elf \
 	       --embed-file build/fibonacci.elf@/fibonacci.elf \
@@ -115,6 +126,20 @@ else
 endif
 endif
 
+# node hosts the same worker and shared memory setup as the browser, so the
+# ELF files embedded above can be checked headless
+NODE ?= node
+
+check-wasm: $(BIN)
+	$(Q)$(PRINTF) "Running hello.elf under $(NODE) ... "; \
+	if [ "$$(LC_ALL=C $(NODE) $(BIN) /hello.elf | $(LOG_FILTER) | uniq)" = \
+	     "$(EXPECTED_hello)" ]; then \
+	    $(call notice, [OK]); \
+	else \
+	    $(PRINTF) "Failed.\n"; \
+	    exit 1; \
+	fi
+
 # used to serve wasm locally
 DEMO_IP := 127.0.0.1
 DEMO_PORT := 8000
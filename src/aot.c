@@ -0,0 +1,454 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <spawn.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "aot.h"
+#include "elf.h"
+#include "jit.h"
+#include "riscv_private.h"
+
+/* Layout of the table, in 32-bit words:
+ *   abi, number of regions,
+ *   then for every region:
+ *     pc, number of ranges, checksum (low word first),
+ *     then the start and the end of every range of guest code.
+ */
+#define AOT_TABLE "rv32emu_aot_table"
+#define AOT_FUNC "rv32emu_aot_%08" PRIx32
+#define AOT_VERSION 1
+
+/* a region stays within the capacity of the block set of the tier-2 compiler
+ */
+#define AOT_MAX_REGION 1024
+
+extern char **environ;
+
+/* a block the discovery reached */
+typedef struct {
+    uint32_t pc;
+    block_t *block; /**< NULL if the code there cannot be decoded */
+    bool entry;     /**< the emulator may dispatch to it */
+    uint32_t mark;  /**< the last region it was added to, from 1 */
+} node_t;
+
+typedef struct {
+    riscv_t *rv;
+    elf_t *elf;
+    map_t index; /**< pc -> position in nodes */
+    node_t *nodes;
+    uint32_t n_nodes, cap_nodes;
+    uint32_t *table; /**< the table being built */
+    uint32_t n_words, cap_words;
+} discovery_t;
+
+struct aot {
+    void *handle;
+    map_t regions; /**< pc -> region_t */
+    uint32_t n_attached, n_stale;
+};
+
+typedef struct {
+    const uint32_t *desc; /**< the region in the table */
+    exec_t2c_func_t func;
+} region_t;
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+
+/* what the code compiled ahead of time assumes of this build */
+static uint32_t aot_abi(void)
+{
+    const uint64_t layout[] = {
+        AOT_VERSION,
+        sizeof(riscv_t),
+        offsetof(riscv_t, X),
+        offsetof(riscv_t, PC),
+        offsetof(riscv_t, io),
+        offsetof(riscv_t, data),
+        offsetof(riscv_t, jit_cache),
+        offsetof(riscv_t, hpm_events),
+        offsetof(vm_attr_t, mem),
+        offsetof(memory_t, mem_base),
+        N_JIT_CACHE_ENTRIES,
+        RV32_HAS(EXT_M),
+        RV32_HAS(EXT_A),
+        RV32_HAS(EXT_F),
+        RV32_HAS(EXT_C),
+    };
+    return (uint32_t) fnv1a(FNV_OFFSET, layout, sizeof(layout));
+}
+
+/* checksum of the guest code in the @n_ranges ranges of @ranges */
+static uint64_t checksum(riscv_t *rv, const uint32_t *ranges, uint32_t n_ranges)
+{
+    const memory_t *mem = PRIV(rv)->mem;
+    uint64_t hash = FNV_OFFSET;
+    for (uint32_t i = 0; i < n_ranges; i++) {
+        const uint32_t start = ranges[2 * i], end = ranges[2 * i + 1];
+        if (end > mem->mem_size || start > end)
+            return 0;
+        hash = fnv1a(hash, mem->mem_base + start, end - start);
+    }
+    return hash;
+}
+
+static void put_word(discovery_t *d, uint32_t word)
+{
+    if (d->n_words == d->cap_words) {
+        d->cap_words = d->cap_words ? 2 * d->cap_words : 1024;
+        d->table = realloc(d->table, d->cap_words * sizeof(uint32_t));
+        assert(d->table);
+    }
+    d->table[d->n_words++] = word;
+}
+
+static node_t *node_of(discovery_t *d, uint32_t pc)
+{
+    map_iter_t it;
+    map_find(d->index, &it, &pc);
+    return map_at_end(d->index, &it) ? NULL
+                                     : &d->nodes[map_iter_value(&it, uint32_t)];
+}
+
+/* queue the code at @pc, which the emulator may dispatch to if @entry */
+static void visit(discovery_t *d, uint32_t pc, bool entry)
+{
+    if (pc & (RV32_HAS(EXT_C) ? 1 : 3) || !elf_is_executable(d->elf, pc))
+        return;
+
+    node_t *node = node_of(d, pc);
+    if (node) {
+        node->entry |= entry;
+        return;
+    }
+    if (d->n_nodes == d->cap_nodes) {
+        d->cap_nodes = d->cap_nodes ? 2 * d->cap_nodes : 1024;
+        d->nodes = realloc(d->nodes, d->cap_nodes * sizeof(node_t));
+        assert(d->nodes);
+    }
+    map_insert(d->index, &pc, &d->n_nodes);
+    d->nodes[d->n_nodes++] = (node_t){.pc = pc, .entry = entry};
+}
+
+/* queue the successors of @block, leaving a call to the dispatcher */
+static void visit_successors(discovery_t *d, const block_t *block)
+{
+    const rv_insn_t *ir = block->ir_tail;
+    /* the dispatcher runs what follows a block the compiler cannot handle */
+    const bool resume = !block->translatable;
+
+    switch (ir->opcode) {
+    case rv_insn_jal:
+        if (ir->rd) {
+            visit(d, ir->pc + ir->imm, true);
+            visit(d, block->pc_end, true);
+        } else {
+            visit(d, ir->pc + ir->imm, resume);
+        }
+        break;
+    case rv_insn_jalr:
+        if (ir->rd)
+            visit(d, block->pc_end, true);
+        break;
+    case rv_insn_beq:
+    case rv_insn_bne:
+    case rv_insn_blt:
+    case rv_insn_bge:
+    case rv_insn_bltu:
+    case rv_insn_bgeu:
+#if RV32_HAS(EXT_C)
+    case rv_insn_cbeqz:
+    case rv_insn_cbnez:
+#endif
+        visit(d, ir->pc + ir->imm, resume);
+        visit(d, block->pc_end, resume);
+        break;
+#if RV32_HAS(EXT_C)
+    case rv_insn_cjal:
+        visit(d, ir->pc + ir->imm, true);
+        visit(d, block->pc_end, true);
+        break;
+    case rv_insn_cj:
+        visit(d, ir->pc + ir->imm, resume);
+        break;
+    case rv_insn_cjalr:
+        visit(d, block->pc_end, true);
+        break;
+    case rv_insn_cjr:
+        break;
+#endif
+#if RV32_HAS(Zcmp)
+    case rv_insn_cmpopretz:
+    case rv_insn_cmpopret:
+        break;
+#endif
+    default: /* system calls and the like resume at the next instruction */
+        visit(d, block->pc_end, true);
+        break;
+    }
+}
+
+static rv_insn_t *head_of(discovery_t *d, uint32_t pc)
+{
+    const node_t *node = node_of(d, pc);
+    return node && node->block && node->block->translatable
+               ? node->block->ir_head
+               : NULL;
+}
+
+/* chain the branches within a function, as the emulator would */
+static void chain(discovery_t *d, const block_t *block)
+{
+    rv_insn_t *ir = block->ir_tail;
+
+    switch (ir->opcode) {
+    case rv_insn_beq:
+    case rv_insn_bne:
+    case rv_insn_blt:
+    case rv_insn_bge:
+    case rv_insn_bltu:
+    case rv_insn_bgeu:
+#if RV32_HAS(EXT_C)
+    case rv_insn_cbeqz:
+    case rv_insn_cbnez:
+#endif
+        ir->branch_taken = head_of(d, ir->pc + ir->imm);
+        ir->branch_untaken = head_of(d, block->pc_end);
+        break;
+    case rv_insn_jal:
+        if (!ir->rd)
+            ir->branch_taken = head_of(d, ir->pc + ir->imm);
+        break;
+#if RV32_HAS(EXT_C)
+    case rv_insn_cj:
+        ir->branch_taken = head_of(d, ir->pc + ir->imm);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+/* Append the region starting at @node to the table, or return false if it
+ * grows too large. The region is what the tier-2 compiler traces from its
+ * first block through the chained branches.
+ */
+static bool add_region(discovery_t *d, node_t *node, uint32_t mark)
+{
+    const block_t *region[AOT_MAX_REGION];
+    uint32_t n = 0;
+    region[n++] = node->block;
+    node->mark = mark;
+    for (uint32_t i = 0; i < n; i++) {
+        const rv_insn_t *ir = region[i]->ir_tail;
+        const rv_insn_t *next[] = {ir->branch_taken, ir->branch_untaken};
+        for (int j = 0; j < 2; j++) {
+            if (!next[j])
+                continue;
+            node_t *target = node_of(d, next[j]->pc);
+            if (target->mark == mark)
+                continue;
+            if (n == AOT_MAX_REGION)
+                return false;
+            target->mark = mark;
+            region[n++] = target->block;
+        }
+    }
+
+    put_word(d, node->pc);
+    put_word(d, n);
+    const uint32_t sum = d->n_words;
+    put_word(d, 0);
+    put_word(d, 0);
+    for (uint32_t i = 0; i < n; i++) {
+        put_word(d, region[i]->pc_start);
+        put_word(d, region[i]->pc_end);
+    }
+    const uint64_t hash = checksum(d->rv, d->table + sum + 2, n);
+    d->table[sum] = hash;
+    d->table[sum + 1] = hash >> 32;
+    return true;
+}
+
+/* link the object file @obj into the shared object @path */
+static bool link_shared(const char *obj, const char *path)
+{
+    char *argv[] = {"cc", "-shared", "-o", (char *) path, (char *) obj, NULL};
+    pid_t pid;
+    int status;
+    if (posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ) ||
+        waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status)) {
+        rv_log_error("Failed to link %s with cc", path);
+        return false;
+    }
+    return true;
+}
+
+bool aot_compile(riscv_t *rv, const char *path)
+{
+    vm_attr_t *attr = PRIV(rv);
+    discovery_t d = {.rv = rv};
+    d.elf = elf_new();
+    assert(d.elf);
+    if (!elf_open(d.elf, attr->data.user.elf_program)) {
+        elf_delete(d.elf);
+        return false;
+    }
+    d.index = map_init(uint32_t, uint32_t, map_cmp_uint);
+
+    visit(&d, get_elf_header(d.elf)->e_entry, true);
+    const uint32_t n_funcs = elf_get_functions(d.elf, NULL, 0);
+    uint32_t *funcs = malloc((n_funcs + 1) * sizeof(uint32_t));
+    assert(funcs);
+    elf_get_functions(d.elf, funcs, n_funcs);
+    for (uint32_t i = 0; i < n_funcs; i++)
+        visit(&d, funcs[i], true);
+    free(funcs);
+
+    /* translate everything reachable, then chain the branches */
+    for (uint32_t i = 0; i < d.n_nodes; i++) {
+        block_t *block = rv_translate_block(rv, d.nodes[i].pc);
+        d.nodes[i].block = block;
+        if (block)
+            visit_successors(&d, block);
+    }
+    for (uint32_t i = 0; i < d.n_nodes; i++) {
+        if (d.nodes[i].block && d.nodes[i].block->translatable)
+            chain(&d, d.nodes[i].block);
+    }
+
+    void *module = t2c_aot_create();
+    put_word(&d, aot_abi());
+    put_word(&d, 0);
+    uint32_t n_regions = 0, n_large = 0;
+    for (uint32_t i = 0; i < d.n_nodes; i++) {
+        node_t *node = &d.nodes[i];
+        if (!node->entry || !node->block || !node->block->translatable)
+            continue;
+        if (!add_region(&d, node, i + 1)) {
+            n_large++;
+            continue;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), AOT_FUNC, node->pc);
+        t2c_aot_add(module, rv, node->block, name);
+        n_regions++;
+    }
+    d.table[1] = n_regions;
+
+    char *obj = malloc(strlen(path) + 3);
+    assert(obj);
+    sprintf(obj, "%s.o", path);
+    bool ok = t2c_aot_emit(module, AOT_TABLE, d.table, d.n_words, obj) &&
+              link_shared(obj, path);
+    unlink(obj);
+    free(obj);
+    if (ok)
+        rv_log_info("AOT: %" PRIu32 " regions of %" PRIu32
+                    " blocks compiled into %s, %" PRIu32 " too large",
+                    n_regions, d.n_nodes, path, n_large);
+
+    for (uint32_t i = 0; i < d.n_nodes; i++) {
+        if (d.nodes[i].block)
+            rv_free_block(rv, d.nodes[i].block);
+    }
+    free(d.nodes);
+    free(d.table);
+    map_delete(d.index);
+    elf_delete(d.elf);
+    return ok;
+}
+
+aot_t *aot_load(riscv_t *rv, const char *path)
+{
+    if (PRIV(rv)->engine != RV_ENGINE_T2C) {
+        rv_log_error("Code compiled ahead of time runs on the t2c engine");
+        return NULL;
+    }
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        rv_log_error("Cannot load %s: %s", path, dlerror());
+        return NULL;
+    }
+    const uint32_t *table = dlsym(handle, AOT_TABLE);
+    if (!table || table[0] != aot_abi()) {
+        rv_log_error("%s is not compiled for this build of rv32emu", path);
+        dlclose(handle);
+        return NULL;
+    }
+
+    aot_t *aot = calloc(1, sizeof(aot_t));
+    assert(aot);
+    aot->handle = handle;
+    aot->regions = map_init(uint32_t, region_t, map_cmp_uint);
+    const uint32_t *desc = table + 2;
+    for (uint32_t i = 0; i < table[1]; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), AOT_FUNC, desc[0]);
+        region_t region = {
+            .desc = desc,
+            .func = (exec_t2c_func_t) dlsym(handle, name),
+        };
+        if (region.func)
+            map_insert(aot->regions, (void *) &desc[0], &region);
+        desc += 4 + 2 * desc[1];
+    }
+    rv_log_info("AOT: %" PRIu32 " regions loaded from %s", table[1], path);
+    return aot;
+}
+
+void aot_attach(riscv_t *rv, block_t *block)
+{
+    aot_t *aot = rv->aot;
+    map_iter_t it;
+    map_find(aot->regions, &it, &block->pc_start);
+    if (map_at_end(aot->regions, &it))
+        return;
+
+    const region_t *region = &map_iter_value(&it, region_t);
+    const uint32_t *desc = region->desc;
+    const uint64_t sum = desc[2] | (uint64_t) desc[3] << 32;
+    if (checksum(rv, desc + 4, desc[1]) != sum) {
+        aot->n_stale++;
+        return;
+    }
+
+    block->func = region->func;
+    block->hot2 = true;
+    block->compiled = true;
+    jit_cache_update(rv->jit_cache, block->pc_start, block->func);
+    aot->n_attached++;
+}
+
+void aot_delete(aot_t *aot)
+{
+    if (!aot)
+        return;
+
+    rv_log_info("AOT: %" PRIu32 " regions taken, %" PRIu32
+                " left as the code changed",
+                aot->n_attached, aot->n_stale);
+    map_delete(aot->regions);
+    dlclose(aot->handle);
+    free(aot);
+}
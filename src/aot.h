@@ -0,0 +1,51 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "riscv.h"
+
+/* Ahead-of-time compilation of user-mode programs.
+ *
+ * The code of the loaded program is discovered from its entry point and its
+ * function symbols, following the direct branches and calls, and resuming
+ * after the calls and the system calls. Every place the emulator dispatches
+ * to, i.e., a function, a return site or the continuation of a block the
+ * tier-2 compiler cannot handle, starts a region: the blocks reachable from
+ * there without a call, lowered by the tier-2 compiler into one function of
+ * a shared object. The shared object carries a table of the regions, each
+ * with the guest address it starts at and a checksum of the code it covers.
+ *
+ * At run time, a block translated at the start of a region takes its native
+ * code, in place of profiling and compiling it, provided the guest code still
+ * matches the checksum. Anything else, e.g., code the discovery missed, code
+ * generated or modified at run time, or blocks with probes, runs on the
+ * usual tiers.
+ */
+
+typedef struct aot aot_t;
+struct block;
+
+/**
+ * aot_compile - compile the code of the loaded program into a shared object
+ * @rv: a pointer points to the RISC-V emulator
+ * @path: the shared object to write
+ */
+bool aot_compile(riscv_t *rv, const char *path);
+
+/**
+ * aot_load - load the shared object written by aot_compile
+ * @rv: a pointer points to the RISC-V emulator
+ * @path: the shared object
+ */
+aot_t *aot_load(riscv_t *rv, const char *path);
+
+/* take the native code of the region @block starts, if it is still valid */
+void aot_attach(riscv_t *rv, struct block *block);
+
+/* report the regions taken and unload */
+void aot_delete(aot_t *aot);
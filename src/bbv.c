@@ -0,0 +1,186 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bbv.h"
+#include "map.h"
+#include "riscv_private.h"
+
+struct bbv {
+    FILE *out;
+    char *out_file_path;
+    uint64_t interval;    /**< instructions per interval */
+    uint64_t insns;       /**< instructions in the current interval */
+    uint64_t total_insns; /**< instructions of all complete intervals */
+    uint64_t n_intervals; /**< number of complete intervals */
+    int64_t stop, checkpoint;
+
+    map_t ids;         /**< block start address -> block identifier */
+    uint32_t n_ids;    /**< number of assigned identifiers */
+    uint32_t cap;      /**< capacity of @counts and @touched */
+    uint64_t *counts;  /**< per-block instructions of the current interval */
+    uint32_t *touched; /**< blocks executed in the current interval */
+    uint32_t n_touched;
+};
+
+bbv_t *bbv_create(const char *out_file_path,
+                  uint64_t interval,
+                  int64_t stop,
+                  int64_t checkpoint)
+{
+    assert(out_file_path && interval);
+
+    bbv_t *bbv = calloc(1, sizeof(bbv_t));
+    assert(bbv);
+
+    bbv->out = fopen(out_file_path, "w");
+    if (!bbv->out) {
+        rv_log_error("Cannot open BBV output file: %s", out_file_path);
+        free(bbv);
+        return NULL;
+    }
+    bbv->out_file_path = strdup(out_file_path);
+    assert(bbv->out_file_path);
+    bbv->interval = interval;
+    bbv->stop = stop;
+    bbv->checkpoint = checkpoint;
+    bbv->ids = map_init(uint32_t, uint32_t, map_cmp_uint);
+    assert(bbv->ids);
+    return bbv;
+}
+
+uint32_t bbv_block_id(bbv_t *bbv, uint32_t pc)
+{
+    map_iter_t it;
+    map_find(bbv->ids, &it, &pc);
+    if (!map_at_end(bbv->ids, &it))
+        return map_iter_value(&it, uint32_t);
+
+    /* identifier 0 is reserved since SimPoint counts blocks from 1 */
+    uint32_t id = ++bbv->n_ids;
+    if (id >= bbv->cap) {
+        uint32_t cap = bbv->cap ? bbv->cap << 1 : 1024;
+        bbv->counts = realloc(bbv->counts, cap * sizeof(uint64_t));
+        bbv->touched = realloc(bbv->touched, cap * sizeof(uint32_t));
+        assert(bbv->counts && bbv->touched);
+        memset(&bbv->counts[bbv->cap], 0,
+               (cap - bbv->cap) * sizeof(uint64_t));
+        bbv->cap = cap;
+    }
+    map_insert(bbv->ids, &pc, &id);
+    return id;
+}
+
+/* write the current interval as a single '.bb' line and start a new one */
+static void bbv_flush(bbv_t *bbv)
+{
+    if (!bbv->insns)
+        return;
+
+    fprintf(bbv->out, "T");
+    for (uint32_t i = 0; i < bbv->n_touched; i++) {
+        uint32_t id = bbv->touched[i];
+        fprintf(bbv->out, ":%" PRIu32 ":%" PRIu64 " ", id, bbv->counts[id]);
+        bbv->counts[id] = 0;
+    }
+    fprintf(bbv->out, "\n");
+
+    bbv->n_touched = 0;
+    bbv->total_insns += bbv->insns;
+    bbv->insns = 0;
+    bbv->n_intervals++;
+}
+
+/* Dump the architectural state at the beginning of an interval, so that a
+ * detailed simulator can start from it. Two files are produced next to the
+ * '.bb' output: '<output>.<interval>.regs' with the registers in JSON and
+ * '<output>.<interval>.mem' with the raw guest memory image.
+ */
+static void bbv_write_checkpoint(riscv_t *rv, bbv_t *bbv, uint32_t pc)
+{
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s.%" PRIu64 ".regs", bbv->out_file_path,
+             bbv->n_intervals);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        rv_log_error("Cannot open checkpoint file: %s", path);
+        return;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"interval\": %" PRIu64 ",\n", bbv->n_intervals);
+    fprintf(f, "  \"icount\": %" PRIu64 ",\n", bbv->total_insns);
+    fprintf(f, "  \"pc\": %u,\n", pc);
+    for (unsigned i = 0; i < N_RV_REGS; i++) {
+        char *comma = i < N_RV_REGS - 1 ? "," : "";
+        fprintf(f, "  \"x%d\": %u%s\n", i, rv->X[i], comma);
+    }
+    fprintf(f, "}\n");
+    fclose(f);
+
+    snprintf(path, sizeof(path), "%s.%" PRIu64 ".mem", bbv->out_file_path,
+             bbv->n_intervals);
+    f = fopen(path, "wb");
+    if (!f) {
+        rv_log_error("Cannot open checkpoint file: %s", path);
+        return;
+    }
+    const memory_t *mem = PRIV(rv)->mem;
+    if (fwrite(mem->mem_base, 1, mem->mem_size, f) != mem->mem_size)
+        rv_log_error("Failed to write checkpoint file: %s", path);
+    fclose(f);
+
+    rv_log_info("Checkpoint of interval %" PRIu64 " written at PC %#x",
+                bbv->n_intervals, pc);
+}
+
+bool bbv_account(riscv_t *rv, uint32_t id, uint32_t n_insn, uint32_t pc)
+{
+    bbv_t *bbv = rv->bbv;
+
+    if (bbv->insns >= bbv->interval)
+        bbv_flush(bbv);
+
+    /* the first block of an interval */
+    if (!bbv->insns) {
+        if ((int64_t) bbv->n_intervals == bbv->checkpoint)
+            bbv_write_checkpoint(rv, bbv, pc);
+        if ((int64_t) bbv->n_intervals == bbv->stop) {
+            rv_log_info("Stop at interval %" PRIu64 " (PC %#x)",
+                        bbv->n_intervals, pc);
+            rv->PC = pc;
+            rv_halt(rv);
+            return false;
+        }
+    }
+
+    if (!bbv->counts[id])
+        bbv->touched[bbv->n_touched++] = id;
+    bbv->counts[id] += n_insn;
+    bbv->insns += n_insn;
+    return true;
+}
+
+void bbv_delete(bbv_t *bbv)
+{
+    if (!bbv)
+        return;
+
+    /* the last interval is usually shorter than the others */
+    bbv_flush(bbv);
+
+    fclose(bbv->out);
+    map_delete(bbv->ids);
+    free(bbv->counts);
+    free(bbv->touched);
+    free(bbv->out_file_path);
+    free(bbv);
+}
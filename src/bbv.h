@@ -0,0 +1,67 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "riscv.h"
+
+/* Basic-block vector (BBV) profiling for SimPoint-style sampled simulation.
+ *
+ * Execution is split into intervals of a fixed number of guest instructions.
+ * For every interval, the number of instructions executed by each basic block
+ * is accumulated and written in the SimPoint '.bb' format:
+ *
+ *   T:<block id>:<instructions> :<block id>:<instructions> ...
+ *
+ * Block identifiers start at 1 and are assigned to the start address of a
+ * block on its first translation, hence a block which is evicted and later
+ * translated again keeps its identifier.
+ *
+ * Instructions are charged to a block on entry, which means an interval
+ * boundary is always placed between two blocks. This makes the interval
+ * boundaries identical no matter which execution tier runs the block.
+ */
+
+typedef struct bbv bbv_t;
+
+/**
+ * bbv_create - create a BBV profiler
+ * @out_file_path: path of the '.bb' output file
+ * @interval: number of instructions per interval
+ * @stop: halt the emulation once @stop intervals are complete (-1: never)
+ * @checkpoint: write a checkpoint once @checkpoint intervals are complete
+ *              (-1: never)
+ */
+bbv_t *bbv_create(const char *out_file_path,
+                  uint64_t interval,
+                  int64_t stop,
+                  int64_t checkpoint);
+
+/**
+ * bbv_block_id - get the identifier of the block starting at @pc
+ * @bbv: a pointer points to the BBV profiler
+ * @pc: start address of the block
+ */
+uint32_t bbv_block_id(bbv_t *bbv, uint32_t pc);
+
+/**
+ * bbv_account - charge the instructions of a block which is about to run
+ * @rv: a pointer points to the RISC-V emulator
+ * @id: identifier of the block returned by bbv_block_id
+ * @n_insn: number of guest instructions in the block
+ * @pc: start address of the block
+ *
+ * Return false if the emulation has to stop before the block runs.
+ */
+bool bbv_account(riscv_t *rv, uint32_t id, uint32_t n_insn, uint32_t pc);
+
+/**
+ * bbv_delete - flush the pending interval and release the BBV profiler
+ * @bbv: a pointer points to the BBV profiler
+ */
+void bbv_delete(bbv_t *bbv);
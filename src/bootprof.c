@@ -0,0 +1,288 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bootprof.h"
+#include "riscv_private.h"
+
+static const char *phase_names[] = {
+    [BOOTPROF_ENTRY] = "entry",       [BOOTPROF_MMU] = "mmu",
+    [BOOTPROF_INITCALL] = "initcall", [BOOTPROF_EXEC] = "exec",
+    [BOOTPROF_USER] = "user",         [BOOTPROF_PROMPT] = "prompt",
+};
+
+typedef struct {
+    uint32_t addr;
+    char *name;
+} symbol_t;
+
+/* the counters when a phase begins */
+typedef struct {
+    uint32_t phase;
+    const char *symbol;
+    uint64_t time_ns, insn, mmu_walks, traps, virtio_reqs;
+} mark_t;
+
+struct bootprof {
+    riscv_t *rv;
+    FILE *out;
+    bool halt, done;
+    uint32_t seen; /**< bitmap of the phases which began already */
+
+    symbol_t *symbols; /**< text symbols, sorted by address */
+    uint32_t n_symbols;
+    uint32_t initcall_addr, exec_addr; /**< 0 if unknown */
+
+    char *prompt;
+    uint32_t prompt_len, matched;
+
+    mark_t *marks;
+    uint32_t n_marks, cap_marks;
+};
+
+static uint64_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int symbol_cmp(const void *a, const void *b)
+{
+    const uint32_t x = ((const symbol_t *) a)->addr;
+    const uint32_t y = ((const symbol_t *) b)->addr;
+    return (x > y) - (x < y);
+}
+
+static const char *symbol_find(const bootprof_t *prof, uint32_t addr)
+{
+    const symbol_t key = {.addr = addr};
+    const symbol_t *sym = bsearch(&key, prof->symbols, prof->n_symbols,
+                                  sizeof(symbol_t), symbol_cmp);
+    return sym ? sym->name : NULL;
+}
+
+static uint32_t symbol_addr(const bootprof_t *prof, const char *name)
+{
+    for (uint32_t i = 0; i < prof->n_symbols; i++) {
+        if (!strcmp(prof->symbols[i].name, name))
+            return prof->symbols[i].addr;
+    }
+    return 0;
+}
+
+/* read the text symbols out of System.map, made of "<addr> <type> <name>" */
+static bool load_symbols(bootprof_t *prof, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        rv_log_error("Cannot open kernel symbol map: %s", path);
+        return false;
+    }
+
+    char line[512], name[256], type;
+    uint32_t addr, cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%" SCNx32 " %c %255s", &addr, &type, name) != 3)
+            continue;
+        if (type != 'T' && type != 't')
+            continue;
+        if (prof->n_symbols == cap) {
+            cap = cap ? 2 * cap : 4096;
+            prof->symbols = realloc(prof->symbols, cap * sizeof(symbol_t));
+            assert(prof->symbols);
+        }
+        prof->symbols[prof->n_symbols].addr = addr;
+        prof->symbols[prof->n_symbols++].name = strdup(name);
+    }
+    fclose(f);
+    qsort(prof->symbols, prof->n_symbols, sizeof(symbol_t), symbol_cmp);
+
+    prof->initcall_addr = symbol_addr(prof, "do_one_initcall");
+    prof->exec_addr = symbol_addr(prof, "run_init_process");
+    if (!prof->initcall_addr)
+        rv_log_warn("do_one_initcall is not in %s, initcalls are not timed",
+                    path);
+    return true;
+}
+
+static void write_phases(bootprof_t *prof, bool prompted)
+{
+    fprintf(prof->out,
+            "phase,symbol,start_s,wall_ms,insn,mmu_walks,traps,virtio_reqs\n");
+
+    double initcall_ms = 0;
+    uint32_t n_initcalls = 0;
+    for (uint32_t i = 0; i + 1 < prof->n_marks; i++) {
+        const mark_t *m = &prof->marks[i], *next = &prof->marks[i + 1];
+        const double ms = (next->time_ns - m->time_ns) / 1e6;
+        fprintf(prof->out,
+                "%s,%s,%.6f,%.3f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                "\n",
+                phase_names[m->phase], m->symbol ? m->symbol : "",
+                (m->time_ns - prof->marks[0].time_ns) / 1e9, ms,
+                next->insn - m->insn, next->mmu_walks - m->mmu_walks,
+                next->traps - m->traps, next->virtio_reqs - m->virtio_reqs);
+        if (m->phase == BOOTPROF_INITCALL) {
+            initcall_ms += ms;
+            n_initcalls++;
+        }
+    }
+    fflush(prof->out);
+
+    const mark_t *first = &prof->marks[0];
+    const mark_t *last = &prof->marks[prof->n_marks - 1];
+    rv_log_info("Boot: %s after %.3f s and %" PRIu64
+                " instructions, %u initcalls took %.3f ms",
+                prompted ? "prompt" : "exit",
+                (last->time_ns - first->time_ns) / 1e9,
+                last->insn - first->insn, n_initcalls, initcall_ms);
+}
+
+bootprof_t *bootprof_create(riscv_t *rv,
+                            const char *out_file_path,
+                            const char *map_file_path,
+                            const char *prompt,
+                            bool halt)
+{
+    assert(out_file_path && prompt && *prompt);
+
+    bootprof_t *prof = calloc(1, sizeof(bootprof_t));
+    assert(prof);
+    prof->rv = rv;
+    prof->halt = halt;
+    prof->prompt = strdup(prompt);
+    prof->prompt_len = strlen(prompt);
+
+    if (map_file_path && !load_symbols(prof, map_file_path)) {
+        bootprof_delete(prof);
+        return NULL;
+    }
+    prof->out = fopen(out_file_path, "w");
+    if (!prof->out) {
+        rv_log_error("Cannot open boot profile output file: %s",
+                     out_file_path);
+        bootprof_delete(prof);
+        return NULL;
+    }
+
+    rv->bootprof = prof;
+    bootprof_mark(rv, BOOTPROF_ENTRY, NULL, rv->csr_cycle);
+    return prof;
+}
+
+/* take a snapshot of the counters as @phase begins */
+static void add_mark(bootprof_t *prof,
+                     uint32_t phase,
+                     const char *symbol,
+                     uint64_t cycle)
+{
+    riscv_t *rv = prof->rv;
+    if (prof->n_marks == prof->cap_marks) {
+        prof->cap_marks = prof->cap_marks ? 2 * prof->cap_marks : 256;
+        prof->marks =
+            realloc(prof->marks, prof->cap_marks * sizeof(*prof->marks));
+        assert(prof->marks);
+    }
+    mark_t *m = &prof->marks[prof->n_marks++];
+    m->phase = phase;
+    m->symbol = symbol;
+    m->time_ns = clock_ns();
+    /* the JIT compilers leave csr_cycle alone and count on their own */
+    m->insn = cycle + rv->hpm_events[RV_HPM_T1_INSN] +
+              rv->hpm_events[RV_HPM_T2_INSN];
+    m->mmu_walks = rv->hpm_events[RV_HPM_MMU_WALK];
+    m->traps = rv->hpm_events[RV_HPM_TRAP];
+#if !RV32_HAS(ELF_LOADER)
+    const virtio_blk_state_t *vblk = PRIV(rv)->vblk;
+    m->virtio_reqs = vblk ? vblk->n_requests : 0;
+#endif
+}
+
+void bootprof_mark(riscv_t *rv,
+                   uint32_t phase,
+                   const char *symbol,
+                   uint64_t cycle)
+{
+    bootprof_t *prof = rv->bootprof;
+    if (prof->done)
+        return;
+    if (phase != BOOTPROF_INITCALL) {
+        if (prof->seen & (1U << phase))
+            return;
+        prof->seen |= 1U << phase;
+    }
+
+    add_mark(prof, phase, symbol, cycle);
+    if (phase == BOOTPROF_PROMPT) {
+        write_phases(prof, true);
+        prof->done = true;
+        if (prof->halt)
+            rv_halt(rv);
+    }
+}
+
+bool bootprof_watched(const bootprof_t *prof, uint32_t pc)
+{
+    return pc && (pc == prof->initcall_addr || pc == prof->exec_addr);
+}
+
+void bootprof_block(riscv_t *rv, uint32_t pc, uint64_t cycle)
+{
+    bootprof_t *prof = rv->bootprof;
+    if (pc == prof->initcall_addr) {
+        /* the initcall is the only argument of do_one_initcall */
+        const char *sym = symbol_find(prof, rv->X[rv_reg_a0]);
+        bootprof_mark(rv, BOOTPROF_INITCALL, sym ? sym : "?", cycle);
+    } else if (pc == prof->exec_addr) {
+        bootprof_mark(rv, BOOTPROF_EXEC, NULL, cycle);
+    }
+}
+
+#if !RV32_HAS(ELF_LOADER)
+void bootprof_uart(riscv_t *rv, uint32_t addr, uint32_t value)
+{
+    bootprof_t *prof = rv->bootprof;
+    if (prof->done || addr != U8250_THR_RBR_DLL ||
+        (PRIV(rv)->uart->lcr & (1 << 7))) /* DLAB */
+        return;
+
+    /* the prompt never starts with a repeated prefix in practice, so a
+     * mismatch restarts the match at the current character
+     */
+    if ((char) value != prof->prompt[prof->matched])
+        prof->matched = 0;
+    if ((char) value == prof->prompt[prof->matched] &&
+        ++prof->matched == prof->prompt_len)
+        bootprof_mark(rv, BOOTPROF_PROMPT, NULL, rv->csr_cycle);
+}
+#endif
+
+void bootprof_delete(bootprof_t *prof)
+{
+    if (!prof)
+        return;
+
+    if (prof->out) {
+        if (!prof->done) {
+            /* the prompt never showed up, so the last phase ends here */
+            add_mark(prof, BOOTPROF_PROMPT, NULL, prof->rv->csr_cycle);
+            write_phases(prof, false);
+        }
+        fclose(prof->out);
+    }
+    for (uint32_t i = 0; i < prof->n_symbols; i++)
+        free(prof->symbols[i].name);
+    free(prof->symbols);
+    free(prof->marks);
+    free(prof->prompt);
+    free(prof);
+}
@@ -0,0 +1,80 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "riscv.h"
+
+/* Linux boot-time profiling.
+ *
+ * The boot is split into phases at events observed by the emulator: the
+ * kernel entry, the point where relocate_enable_mmu turns on the MMU, every
+ * call to do_one_initcall, the first call to run_init_process, the first
+ * return to user mode, and the first appearance of a prompt on the UART.
+ * For each phase, the host wall time, the guest instructions, page-table
+ * walks, traps and virtio-blk requests it took are written as CSV once the
+ * prompt shows up, or when the emulator exits if it never does.
+ *
+ * The initcall and init exec events need the kernel symbols, which are read
+ * from a System.map file. The entry of each watched function gets a block
+ * probe, so blocks elsewhere run unmodified.
+ */
+
+enum {
+    BOOTPROF_ENTRY,    /* kernel entry, with the MMU off */
+    BOOTPROF_MMU,      /* relocate_enable_mmu has turned on the MMU */
+    BOOTPROF_INITCALL, /* do_one_initcall, named after the initcall */
+    BOOTPROF_EXEC,     /* run_init_process */
+    BOOTPROF_USER,     /* the first return to user mode */
+    BOOTPROF_PROMPT,   /* the prompt has been printed, end of the boot */
+};
+
+typedef struct bootprof bootprof_t;
+
+/**
+ * bootprof_create - start profiling the boot at the kernel entry
+ * @rv: a pointer points to the RISC-V emulator
+ * @out_file_path: path of the CSV output file
+ * @map_file_path: path of the System.map of the kernel, or NULL
+ * @prompt: UART output which marks the end of the boot
+ * @halt: halt the emulator once the prompt shows up
+ */
+bootprof_t *bootprof_create(riscv_t *rv,
+                            const char *out_file_path,
+                            const char *map_file_path,
+                            const char *prompt,
+                            bool halt);
+
+/**
+ * bootprof_mark - end the current phase and begin another
+ * @rv: a pointer points to the RISC-V emulator
+ * @phase: one of BOOTPROF_*
+ * @symbol: the initcall for BOOTPROF_INITCALL, otherwise NULL
+ * @cycle: instructions retired by the interpreter so far
+ *
+ * All phases but BOOTPROF_INITCALL begin at most once.
+ */
+void bootprof_mark(riscv_t *rv,
+                   uint32_t phase,
+                   const char *symbol,
+                   uint64_t cycle);
+
+/* whether the block starting at @pc needs a probe calling bootprof_block */
+bool bootprof_watched(const bootprof_t *prof, uint32_t pc);
+
+/* a watched block at @pc is about to run */
+void bootprof_block(riscv_t *rv, uint32_t pc, uint64_t cycle);
+
+/* the guest has written @value to the UART register at offset @addr */
+void bootprof_uart(riscv_t *rv, uint32_t addr, uint32_t value);
+
+/**
+ * bootprof_delete - write the phases if not done yet and release the profiler
+ * @prof: a pointer points to the boot profiler
+ */
+void bootprof_delete(bootprof_t *prof);
@@ -22,7 +22,8 @@ breakpoint_map_t breakpoint_map_new()
 
 bool breakpoint_map_insert(breakpoint_map_t map, riscv_word_t addr)
 {
-    breakpoint_t bp = (breakpoint_t){.addr = addr, .orig_insn = 0};
+    breakpoint_t bp =
+        (breakpoint_t){.addr = addr, .orig_insn = 0, .enabled = true};
     map_iter_t it;
     map_find(map, &it, &addr);
     /* breakpoints are not expected to be set at duplicate addresses */
@@ -49,7 +50,8 @@ breakpoint_t *breakpoint_map_find(breakpoint_map_t map, riscv_word_t addr)
     if (!breakpoint_map_find_it(map, addr, &it))
         return NULL;
 
-    return (breakpoint_t *) map_iter_value(&it, breakpoint_t *);
+    /* the node holds the breakpoint itself rather than a pointer to it */
+    return (breakpoint_t *) it.node->data;
 }
 
 bool breakpoint_map_del(breakpoint_map_t map, riscv_word_t addr)
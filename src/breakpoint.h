@@ -11,6 +11,11 @@
 typedef struct {
     riscv_word_t addr;
     uint32_t orig_insn;
+    /* A removed breakpoint is kept, but disabled, as the blocks translated
+     * meanwhile still probe it, so that setting it again needs no
+     * retranslation. GDB removes and sets the breakpoints at every stop.
+     */
+    bool enabled;
 } breakpoint_t;
 
 typedef map_t breakpoint_map_t;
@@ -20,3 +25,25 @@ bool breakpoint_map_insert(breakpoint_map_t map, riscv_word_t addr);
 breakpoint_t *breakpoint_map_find(breakpoint_map_t map, riscv_word_t addr);
 bool breakpoint_map_del(breakpoint_map_t map, riscv_word_t addr);
 void breakpoint_map_destroy(breakpoint_map_t map);
+
+/* GDB data watchpoints, which the probes in front of the loads and the stores
+ * check. The Z2 to Z4 packets do not pass the length of the watched range
+ * down to the target, thus a watchpoint covers the word at its address, and
+ * accesses to the bytes next to a narrower variable stop as well. The stop
+ * reply is a plain SIGTRAP, without the watch:addr stop reason.
+ */
+#define MAX_WATCHPOINTS 16
+#define WATCHPOINT_LEN 4
+
+/* the types of the Z and z packets, following BP_SOFTWARE */
+enum {
+    HW_BREAKPOINT = 1,
+    WATCH_WRITE = 2,
+    WATCH_READ = 3,
+    WATCH_ACCESS = 4,
+};
+
+typedef struct {
+    riscv_word_t addr;
+    bool read, write; /* the accesses triggering the watchpoint */
+} watchpoint_t;
@@ -318,6 +318,17 @@ void *cache_put(cache_t *cache, uint32_t key, void *value)
 
 void cache_free(cache_t *cache)
 {
+    /* release both the live entries and the history of evicted ones */
+    struct list_head *lists[] = {&cache->list, &cache->ghost_list};
+    for (size_t i = 0; i < ARRAY_SIZE(lists); i++) {
+        cache_entry_t *entry, *safe;
+#ifdef __HAVE_TYPEOF
+        list_for_each_entry_safe (entry, safe, lists[i], list)
+#else
+        list_for_each_entry_safe (entry, safe, lists[i], list, cache_entry_t)
+#endif
+            free(entry);
+    }
     free(cache->map.ht_list_head);
     free(cache);
 }
@@ -346,6 +357,11 @@ uint32_t cache_freq(const struct cache *cache, uint32_t key)
 }
 
 #if RV32_HAS(JIT)
+bool cache_full(const struct cache *cache)
+{
+    return cache->size == cache->capacity;
+}
+
 bool cache_hot(const struct cache *cache, uint32_t key)
 {
     if (unlikely(!cache->capacity))
@@ -49,6 +49,13 @@ void *cache_put(struct cache *cache, uint32_t key, void *value);
 void cache_free(struct cache *cache);
 
 #if RV32_HAS(JIT)
+/**
+ * cache_full - check whether a new entry would replace the least recently used
+ * one
+ * @cache: a pointer points to target cache
+ */
+bool cache_full(const struct cache *cache);
+
 /**
  * cache_hot - check whether the frequency of the cache entry exceeds the
  * threshold or not
@@ -0,0 +1,689 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coverage.h"
+#include "elf.h"
+#include "map.h"
+#include "utils.h"
+
+typedef struct {
+    uint32_t start, end;
+} range_t;
+
+struct coverage {
+    char *out_file_path;
+    uint8_t format;
+    elf_t *elf;
+    char *elf_path;
+
+    map_t blocks;    /**< block start address -> index in @ranges */
+    range_t *ranges; /**< recorded blocks, in translation order */
+    uint32_t n_ranges, cap;
+};
+
+coverage_t *coverage_create(const char *out_file_path,
+                            uint8_t format,
+                            const char *elf_path)
+{
+    assert(out_file_path && elf_path);
+
+    coverage_t *cov = calloc(1, sizeof(coverage_t));
+    assert(cov);
+
+    cov->elf = elf_new();
+    assert(cov->elf);
+    if (!elf_open(cov->elf, elf_path)) {
+        rv_log_error("Cannot open %s for coverage", elf_path);
+        elf_delete(cov->elf);
+        free(cov);
+        return NULL;
+    }
+    cov->elf_path = realpath(elf_path, NULL);
+    if (!cov->elf_path)
+        cov->elf_path = strdup(elf_path);
+    cov->out_file_path = strdup(out_file_path);
+    assert(cov->elf_path && cov->out_file_path);
+    cov->format = format;
+    cov->blocks = map_init(uint32_t, uint32_t, map_cmp_uint);
+    assert(cov->blocks);
+    return cov;
+}
+
+void coverage_record(coverage_t *cov, uint32_t pc_start, uint32_t pc_end)
+{
+    map_iter_t it;
+    map_find(cov->blocks, &it, &pc_start);
+    if (!map_at_end(cov->blocks, &it)) {
+        /* the block may end elsewhere once it is translated again */
+        range_t *range = &cov->ranges[map_iter_value(&it, uint32_t)];
+        if (pc_end > range->end)
+            range->end = pc_end;
+        return;
+    }
+
+    if (cov->n_ranges == cov->cap) {
+        cov->cap = cov->cap ? cov->cap << 1 : 1024;
+        cov->ranges = realloc(cov->ranges, cov->cap * sizeof(range_t));
+        assert(cov->ranges);
+    }
+    cov->ranges[cov->n_ranges] = (range_t){pc_start, pc_end};
+    map_insert(cov->blocks, &pc_start, &cov->n_ranges);
+    cov->n_ranges++;
+}
+
+/* Write a drcov log, version 2, where the program is the only module and
+ * the blocks are stored as offsets from its lowest loadable address.
+ */
+static void coverage_write_drcov(coverage_t *cov, FILE *f)
+{
+    uint32_t base = 0, end = 0;
+    elf_get_load_range(cov->elf, &base, &end);
+    const struct Elf32_Ehdr *hdr = get_elf_header(cov->elf);
+
+    fprintf(f, "DRCOV VERSION: 2\n");
+    fprintf(f, "DRCOV FLAVOR: rv32emu\n");
+    fprintf(f, "Module Table: version 2, count 1\n");
+    fprintf(f, "Columns: id, base, end, entry, checksum, timestamp, path\n");
+    fprintf(f, " 0, 0x%08x, 0x%08x, 0x%08x, 0x00000000, 0x00000000, %s\n",
+            base, end, hdr->e_entry, cov->elf_path);
+
+    /* blocks out of the program, if any, cannot be expressed */
+    uint32_t n_bbs = 0;
+    for (uint32_t i = 0; i < cov->n_ranges; i++)
+        n_bbs += cov->ranges[i].start >= base && cov->ranges[i].end <= end;
+
+    fprintf(f, "BB Table: %u bbs\n", n_bbs);
+    for (uint32_t i = 0; i < cov->n_ranges; i++) {
+        const range_t *range = &cov->ranges[i];
+        if (range->start < base || range->end > end)
+            continue;
+
+        /* struct { uint32_t start; uint16_t size; uint16_t id; } */
+        uint8_t entry[8];
+        uint32_t offset = range->start - base;
+        uint32_t size = range->end - range->start;
+        if (size > UINT16_MAX)
+            size = UINT16_MAX;
+        entry[0] = offset, entry[1] = offset >> 8;
+        entry[2] = offset >> 16, entry[3] = offset >> 24;
+        entry[4] = size, entry[5] = size >> 8;
+        entry[6] = entry[7] = 0;
+        fwrite(entry, 1, sizeof(entry), f);
+    }
+}
+
+static int range_cmp(const void *a, const void *b)
+{
+    const range_t *l = a, *r = b;
+    return (l->start > r->start) - (l->start < r->start);
+}
+
+/* check whether [start, end) overlaps any of the sorted, disjoint @ranges */
+static bool ranges_overlap(const range_t *ranges,
+                           uint32_t n,
+                           uint32_t start,
+                           uint32_t end)
+{
+    /* find the first range which ends after @start */
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ranges[mid].end <= start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < n && ranges[lo].start < end;
+}
+
+/* a source line and whether any of its code has run */
+typedef struct {
+    const char *file;
+    uint32_t line;
+    bool hit;
+} line_t;
+
+typedef struct {
+    const range_t *ranges; /**< sorted and merged blocks */
+    uint32_t n_ranges;
+    line_t *lines;
+    uint32_t n_lines, cap;
+    char **paths; /**< owned file paths, referred by @lines */
+    uint32_t n_paths, paths_cap;
+} lcov_t;
+
+static void lcov_add_line(lcov_t *lcov,
+                          const char *file,
+                          uint32_t line,
+                          uint32_t start,
+                          uint32_t end)
+{
+    if (!file || !line || start > end)
+        return;
+    /* rows without code, e.g. of inlined calls, share the next instruction */
+    if (start == end)
+        end = start + 1;
+
+    if (lcov->n_lines == lcov->cap) {
+        lcov->cap = lcov->cap ? lcov->cap << 1 : 4096;
+        lcov->lines = realloc(lcov->lines, lcov->cap * sizeof(line_t));
+        assert(lcov->lines);
+    }
+    lcov->lines[lcov->n_lines++] = (line_t){
+        .file = file,
+        .line = line,
+        .hit = ranges_overlap(lcov->ranges, lcov->n_ranges, start, end),
+    };
+}
+
+/* Join the name of a file with its directory and with the directory of the
+ * compilation, unless the path is absolute by then.
+ */
+static const char *lcov_add_path(lcov_t *lcov,
+                                 const char *comp_dir,
+                                 const char *dir,
+                                 const char *name)
+{
+    if (lcov->n_paths == lcov->paths_cap) {
+        lcov->paths_cap = lcov->paths_cap ? lcov->paths_cap << 1 : 64;
+        lcov->paths = realloc(lcov->paths, lcov->paths_cap * sizeof(char *));
+        assert(lcov->paths);
+    }
+
+    char path[PATH_MAX], tmp[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", name);
+    /* a path too long to be joined is kept as it is */
+    if (path[0] != '/' && dir && *dir &&
+        snprintf(tmp, sizeof(tmp), "%s/%s", dir, path) < (int) sizeof(tmp))
+        memcpy(path, tmp, sizeof(path));
+    if (path[0] != '/' && comp_dir && *comp_dir && comp_dir != dir &&
+        snprintf(tmp, sizeof(tmp), "%s/%s", comp_dir, path) <
+            (int) sizeof(tmp))
+        memcpy(path, tmp, sizeof(path));
+
+    char *dup = strdup(path);
+    assert(dup);
+    lcov->paths[lcov->n_paths++] = dup;
+    return dup;
+}
+
+/* DWARF constants used by the line number program */
+enum {
+    DW_LNS_copy = 1,
+    DW_LNS_advance_pc = 2,
+    DW_LNS_advance_line = 3,
+    DW_LNS_set_file = 4,
+    DW_LNS_const_add_pc = 8,
+    DW_LNS_fixed_advance_pc = 9,
+    DW_LNE_end_sequence = 1,
+    DW_LNE_set_address = 2,
+    DW_LNCT_path = 1,
+    DW_LNCT_directory_index = 2,
+    DW_FORM_block = 0x09,
+    DW_FORM_data1 = 0x0b,
+    DW_FORM_data2 = 0x05,
+    DW_FORM_data4 = 0x06,
+    DW_FORM_data8 = 0x07,
+    DW_FORM_data16 = 0x1e,
+    DW_FORM_string = 0x08,
+    DW_FORM_strp = 0x0e,
+    DW_FORM_udata = 0x0f,
+    DW_FORM_line_strp = 0x1f,
+};
+
+typedef struct {
+    const uint8_t *p, *end;
+    bool error;
+} reader_t;
+
+static uint64_t read_fixed(reader_t *r, uint32_t size)
+{
+    if (r->error || size > (size_t) (r->end - r->p)) {
+        r->error = true;
+        return 0;
+    }
+    uint64_t val = 0;
+    for (uint32_t i = 0; i < size; i++)
+        val |= (uint64_t) r->p[i] << (i * 8);
+    r->p += size;
+    return val;
+}
+
+static uint64_t read_uleb128(reader_t *r)
+{
+    uint64_t val = 0;
+    for (uint32_t shift = 0; !r->error; shift += 7) {
+        uint8_t byte = read_fixed(r, 1);
+        if (shift < 64)
+            val |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    return val;
+}
+
+static int64_t read_sleb128(reader_t *r)
+{
+    int64_t val = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+    do {
+        byte = read_fixed(r, 1);
+        if (shift < 64)
+            val |= (int64_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && !r->error);
+    if (shift < 64 && (byte & 0x40))
+        val |= -((int64_t) 1 << shift);
+    return val;
+}
+
+static const char *read_cstr(reader_t *r)
+{
+    const char *str = (const char *) r->p;
+    const uint8_t *nul = memchr(r->p, 0, r->end - r->p);
+    if (r->error || !nul) {
+        r->error = true;
+        return NULL;
+    }
+    r->p = nul + 1;
+    return str;
+}
+
+typedef struct {
+    const uint8_t *str, *line_str;
+    uint32_t str_size, line_str_size;
+} str_sections_t;
+
+static const char *section_str(const uint8_t *sec, uint32_t size, uint64_t off)
+{
+    if (!sec || off >= size || !memchr(sec + off, 0, size - off))
+        return NULL;
+    return (const char *) sec + off;
+}
+
+/* Read one attribute of a DWARF 5 directory or file name entry. Strings are
+ * returned in @str, constants in @val, and anything else is skipped.
+ */
+static void read_form(reader_t *r,
+                      uint64_t form,
+                      bool dwarf64,
+                      const str_sections_t *strs,
+                      const char **str,
+                      uint64_t *val)
+{
+    *str = NULL;
+    *val = 0;
+    switch (form) {
+    case DW_FORM_string:
+        *str = read_cstr(r);
+        break;
+    case DW_FORM_strp:
+        *str = section_str(strs->str, strs->str_size,
+                           read_fixed(r, dwarf64 ? 8 : 4));
+        break;
+    case DW_FORM_line_strp:
+        *str = section_str(strs->line_str, strs->line_str_size,
+                           read_fixed(r, dwarf64 ? 8 : 4));
+        break;
+    case DW_FORM_udata:
+        *val = read_uleb128(r);
+        break;
+    case DW_FORM_data1:
+        *val = read_fixed(r, 1);
+        break;
+    case DW_FORM_data2:
+        *val = read_fixed(r, 2);
+        break;
+    case DW_FORM_data4:
+        *val = read_fixed(r, 4);
+        break;
+    case DW_FORM_data8:
+        *val = read_fixed(r, 8);
+        break;
+    case DW_FORM_data16:
+        read_fixed(r, 8);
+        read_fixed(r, 8);
+        break;
+    case DW_FORM_block: {
+        uint64_t len = read_uleb128(r);
+        if (len > (size_t) (r->end - r->p))
+            r->error = true;
+        else
+            r->p += len;
+        break;
+    }
+    default:
+        /* e.g. DW_FORM_strx needs .debug_str_offsets, which is not used */
+        r->error = true;
+        break;
+    }
+}
+
+/* Read a DWARF 5 directory or file name table into @names and, for file
+ * names, @dirs. Return the number of entries.
+ */
+static uint32_t read_entry_table(reader_t *r,
+                                 bool dwarf64,
+                                 const str_sections_t *strs,
+                                 const char ***names,
+                                 uint64_t **dirs)
+{
+    uint8_t n_formats = read_fixed(r, 1);
+    uint64_t formats[2 * UINT8_MAX];
+    for (uint32_t i = 0; i < 2 * n_formats; i++)
+        formats[i] = read_uleb128(r);
+
+    uint64_t n = read_uleb128(r);
+    if (r->error || n > (size_t) (r->end - r->p)) {
+        r->error = true;
+        return 0;
+    }
+    *names = calloc(n ? n : 1, sizeof(char *));
+    *dirs = calloc(n ? n : 1, sizeof(uint64_t));
+    assert(*names && *dirs);
+
+    for (uint64_t i = 0; i < n && !r->error; i++) {
+        for (uint32_t j = 0; j < n_formats; j++) {
+            const char *str;
+            uint64_t val;
+            read_form(r, formats[2 * j + 1], dwarf64, strs, &str, &val);
+            if (formats[2 * j] == DW_LNCT_path)
+                (*names)[i] = str;
+            else if (formats[2 * j] == DW_LNCT_directory_index)
+                (*dirs)[i] = val;
+        }
+    }
+    return n;
+}
+
+/* Run the line number program of a unit and record every row, where a row
+ * covers the addresses up to the next row of the same sequence.
+ */
+static void lcov_read_unit(lcov_t *lcov,
+                           reader_t *r,
+                           bool dwarf64,
+                           const str_sections_t *strs)
+{
+    uint16_t version = read_fixed(r, 2);
+    if (version < 2 || version > 5)
+        return;
+    if (version >= 5)
+        read_fixed(r, 2); /* address_size and segment_selector_size */
+    uint64_t header_length = read_fixed(r, dwarf64 ? 8 : 4);
+    if (r->error || header_length > (size_t) (r->end - r->p))
+        return;
+    const uint8_t *program = r->p + header_length;
+
+    uint8_t min_insn_length = read_fixed(r, 1);
+    if (version >= 4)
+        read_fixed(r, 1); /* maximum_operations_per_instruction */
+    read_fixed(r, 1);     /* default_is_stmt */
+    int8_t line_base = read_fixed(r, 1);
+    uint8_t line_range = read_fixed(r, 1);
+    uint8_t opcode_base = read_fixed(r, 1);
+    const uint8_t *opcode_lengths = r->p;
+    if (r->error || !line_range || !opcode_base ||
+        opcode_base - 1 > r->end - r->p)
+        return;
+    r->p += opcode_base - 1;
+
+    /* resolve the path of every file name entry */
+    const char **dir_names = NULL, **file_names = NULL;
+    uint64_t *dir_idx = NULL, *file_dirs = NULL;
+    uint32_t n_dirs = 0, n_files = 0;
+    if (version >= 5) {
+        n_dirs = read_entry_table(r, dwarf64, strs, &dir_names, &dir_idx);
+        if (!r->error)
+            n_files =
+                read_entry_table(r, dwarf64, strs, &file_names, &file_dirs);
+    } else {
+        /* entries are numbered from 1, where directory 0 is the current
+         * directory of the compilation and file 0 is unused
+         */
+        uint32_t cap = 16;
+        dir_names = calloc(cap, sizeof(char *));
+        assert(dir_names);
+        n_dirs = 1;
+        const char *name;
+        while ((name = read_cstr(r)) && *name) {
+            if (n_dirs == cap) {
+                cap <<= 1;
+                dir_names = realloc(dir_names, cap * sizeof(char *));
+                assert(dir_names);
+            }
+            dir_names[n_dirs++] = name;
+        }
+
+        cap = 16;
+        file_names = calloc(cap, sizeof(char *));
+        file_dirs = calloc(cap, sizeof(uint64_t));
+        assert(file_names && file_dirs);
+        n_files = 1;
+        while ((name = read_cstr(r)) && *name) {
+            if (n_files == cap) {
+                cap <<= 1;
+                file_names = realloc(file_names, cap * sizeof(char *));
+                file_dirs = realloc(file_dirs, cap * sizeof(uint64_t));
+                assert(file_names && file_dirs);
+            }
+            file_names[n_files] = name;
+            file_dirs[n_files++] = read_uleb128(r);
+            read_uleb128(r); /* modification time */
+            read_uleb128(r); /* file length */
+        }
+    }
+
+    const char **paths = calloc(n_files ? n_files : 1, sizeof(char *));
+    assert(paths);
+    for (uint32_t i = 0; i < n_files && !r->error; i++) {
+        if (!file_names[i])
+            continue;
+        const char *dir =
+            file_dirs[i] < n_dirs ? dir_names[file_dirs[i]] : NULL;
+        paths[i] = lcov_add_path(lcov, dir_names[0], dir, file_names[i]);
+    }
+
+    /* the state machine */
+    r->p = program;
+    uint32_t address = 0, file = 1, line = 1;
+    uint32_t row_address = 0, row_file = 0, row_line = 0;
+    bool has_row = false;
+
+#define EMIT_ROW()                                                          \
+    do {                                                                    \
+        if (has_row && row_file < n_files)                                  \
+            lcov_add_line(lcov, paths[row_file], row_line, row_address,     \
+                          address);                                         \
+        row_address = address, row_file = file, row_line = line;            \
+        has_row = true;                                                     \
+    } while (0)
+
+    while (!r->error && r->p < r->end) {
+        uint8_t opcode = read_fixed(r, 1);
+        if (opcode >= opcode_base) { /* special opcode */
+            uint8_t adjusted = opcode - opcode_base;
+            address += (adjusted / line_range) * min_insn_length;
+            line += line_base + adjusted % line_range;
+            EMIT_ROW();
+            continue;
+        }
+
+        switch (opcode) {
+        case 0: { /* extended opcode */
+            uint64_t len = read_uleb128(r);
+            if (!len || len > (size_t) (r->end - r->p)) {
+                r->error = true;
+                break;
+            }
+            const uint8_t *next = r->p + len;
+            uint8_t sub = read_fixed(r, 1);
+            if (sub == DW_LNE_end_sequence) {
+                EMIT_ROW();
+                has_row = false;
+                address = 0, file = 1, line = 1;
+            } else if (sub == DW_LNE_set_address) {
+                /* an address wider than 64 bits is malformed */
+                if (len - 1 > 8) {
+                    r->error = true;
+                    break;
+                }
+                address = read_fixed(r, len - 1);
+            }
+            r->p = next;
+            break;
+        }
+        case DW_LNS_copy:
+            EMIT_ROW();
+            break;
+        case DW_LNS_advance_pc:
+            address += read_uleb128(r) * min_insn_length;
+            break;
+        case DW_LNS_advance_line:
+            line += read_sleb128(r);
+            break;
+        case DW_LNS_set_file:
+            file = read_uleb128(r);
+            break;
+        case DW_LNS_const_add_pc:
+            address += ((255 - opcode_base) / line_range) * min_insn_length;
+            break;
+        case DW_LNS_fixed_advance_pc:
+            address += read_fixed(r, 2);
+            break;
+        default:
+            /* skip the operands of the other standard opcodes */
+            for (uint8_t i = 0; i < opcode_lengths[opcode - 1]; i++)
+                read_uleb128(r);
+            break;
+        }
+    }
+#undef EMIT_ROW
+
+    free(paths);
+    free(dir_names);
+    free(dir_idx);
+    free(file_names);
+    free(file_dirs);
+}
+
+static int line_cmp(const void *a, const void *b)
+{
+    const line_t *l = a, *r = b;
+    int cmp = strcmp(l->file, r->file);
+    if (cmp)
+        return cmp;
+    return (l->line > r->line) - (l->line < r->line);
+}
+
+/* Write an lcov tracefile. Execution counts are not collected, hence a line
+ * is reported as executed once if any of its code has run.
+ */
+static void coverage_write_lcov(coverage_t *cov, FILE *f)
+{
+    uint32_t size;
+    const uint8_t *debug_line = elf_get_section(cov->elf, ".debug_line", &size);
+    if (!debug_line) {
+        rv_log_error("%s has no line number information for lcov",
+                     cov->elf_path);
+        return;
+    }
+
+    /* sort and merge the blocks for lookup */
+    range_t *ranges = malloc((cov->n_ranges ? cov->n_ranges : 1) *
+                             sizeof(range_t));
+    assert(ranges);
+    memcpy(ranges, cov->ranges, cov->n_ranges * sizeof(range_t));
+    qsort(ranges, cov->n_ranges, sizeof(range_t), range_cmp);
+    uint32_t n_ranges = 0;
+    for (uint32_t i = 0; i < cov->n_ranges; i++) {
+        if (n_ranges && ranges[i].start <= ranges[n_ranges - 1].end) {
+            if (ranges[i].end > ranges[n_ranges - 1].end)
+                ranges[n_ranges - 1].end = ranges[i].end;
+        } else {
+            ranges[n_ranges++] = ranges[i];
+        }
+    }
+
+    lcov_t lcov = {.ranges = ranges, .n_ranges = n_ranges};
+    str_sections_t strs = {0};
+    strs.str = elf_get_section(cov->elf, ".debug_str", &strs.str_size);
+    strs.line_str =
+        elf_get_section(cov->elf, ".debug_line_str", &strs.line_str_size);
+
+    reader_t r = {.p = debug_line, .end = debug_line + size};
+    while (!r.error && r.p < r.end) {
+        bool dwarf64 = false;
+        uint64_t unit_length = read_fixed(&r, 4);
+        if (unit_length == 0xffffffff) {
+            dwarf64 = true;
+            unit_length = read_fixed(&r, 8);
+        }
+        if (r.error || unit_length > (size_t) (r.end - r.p))
+            break;
+
+        reader_t unit = {.p = r.p, .end = r.p + unit_length};
+        lcov_read_unit(&lcov, &unit, dwarf64, &strs);
+        r.p += unit_length;
+    }
+
+    /* a line may be split into several rows, possibly in several units */
+    qsort(lcov.lines, lcov.n_lines, sizeof(line_t), line_cmp);
+    fprintf(f, "TN:\n");
+    for (uint32_t i = 0; i < lcov.n_lines;) {
+        const char *file = lcov.lines[i].file;
+        uint32_t n_found = 0, n_hit = 0;
+        fprintf(f, "SF:%s\n", file);
+        while (i < lcov.n_lines && !strcmp(lcov.lines[i].file, file)) {
+            uint32_t line = lcov.lines[i].line;
+            bool hit = false;
+            for (; i < lcov.n_lines && lcov.lines[i].line == line &&
+                   !strcmp(lcov.lines[i].file, file);
+                 i++)
+                hit |= lcov.lines[i].hit;
+            fprintf(f, "DA:%u,%d\n", line, hit);
+            n_found++;
+            n_hit += hit;
+        }
+        fprintf(f, "LF:%u\nLH:%u\nend_of_record\n", n_found, n_hit);
+    }
+
+    for (uint32_t i = 0; i < lcov.n_paths; i++)
+        free(lcov.paths[i]);
+    free(lcov.paths);
+    free(lcov.lines);
+    free(ranges);
+}
+
+void coverage_delete(coverage_t *cov)
+{
+    if (!cov)
+        return;
+
+    FILE *f = fopen(cov->out_file_path, "wb");
+    if (f) {
+        if (cov->format == RV_COVERAGE_LCOV)
+            coverage_write_lcov(cov, f);
+        else
+            coverage_write_drcov(cov, f);
+        fclose(f);
+    } else {
+        rv_log_error("Cannot open coverage output file: %s",
+                     cov->out_file_path);
+    }
+
+    map_delete(cov->blocks);
+    free(cov->ranges);
+    elf_delete(cov->elf);
+    free(cov->elf_path);
+    free(cov->out_file_path);
+    free(cov);
+}
@@ -0,0 +1,47 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "riscv.h"
+
+/* Guest code coverage at basic-block granularity.
+ *
+ * A block is recorded when it is translated, which happens right before its
+ * first execution. Later executions, whether by the interpreter or by the
+ * JIT compilers, cost nothing, and a block that is evicted and translated
+ * again is recorded only once. The output is written when the emulator is
+ * destroyed, either as a drcov log, understood by tools such as Lighthouse
+ * and bncov, or as an lcov tracefile derived from the DWARF line table of
+ * the program.
+ */
+
+typedef struct coverage coverage_t;
+
+/**
+ * coverage_create - create a coverage recorder
+ * @out_file_path: path of the output file
+ * @format: RV_COVERAGE_DRCOV or RV_COVERAGE_LCOV
+ * @elf_path: path of the guest program
+ */
+coverage_t *coverage_create(const char *out_file_path,
+                            uint8_t format,
+                            const char *elf_path);
+
+/**
+ * coverage_record - record a translated block
+ * @cov: a pointer points to the coverage recorder
+ * @pc_start: address of the first instruction of the block
+ * @pc_end: address following the last instruction of the block
+ */
+void coverage_record(coverage_t *cov, uint32_t pc_start, uint32_t pc_end);
+
+/**
+ * coverage_delete - write the output file and release the recorder
+ * @cov: a pointer points to the coverage recorder
+ */
+void coverage_delete(coverage_t *cov);
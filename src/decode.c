@@ -721,6 +721,26 @@ static inline bool op_op(rv_insn_t *ir, const uint32_t insn)
         break;
 #endif /* RV32_HAS(EXT_M) */
 
+#if RV32_HAS(Zicond)
+    /* inst      funct7  rs2 rs1 funct3 rd opcode
+     * ---------+-------+---+---+------+--+-------
+     * CZERO.EQZ 0000111 rs2 rs1 101    rd 0110011
+     * CZERO.NEZ 0000111 rs2 rs1 111    rd 0110011
+     */
+    case 0b0000111:
+        switch (funct3) {
+        case 0b101: /* czero.eqz */
+            ir->opcode = rv_insn_czeroeqz;
+            break;
+        case 0b111: /* czero.nez */
+            ir->opcode = rv_insn_czeronez;
+            break;
+        default: /* illegal instruction */
+            return false;
+        }
+        break;
+#endif /* RV32_HAS(Zicond) */
+
 #if RV32_HAS(Zba)
     /* inst   funct7  rs2 rs1 funct3 rd opcode
      * ------+-------+---+---+------+--+-------
@@ -1100,6 +1120,13 @@ static inline bool op_misc_mem(rv_insn_t *ir, const uint32_t insn)
      * ------+---------+----------+-----------+-----+-------+----+-------
      * FENCE   FM[3:0]   pred[3:0]  succ[3:0]  rs1   000     rd   0001111
      * FENCEI            imm[11:0]             rs1   001     rd   0001111
+     *
+     * inst      imm[11:0]      rs1   funct3  rd      opcode
+     * --------+--------------+-----+-------+-------+--------
+     * CBOINVAL  000000000000   rs1   010     00000   0001111
+     * CBOCLEAN  000000000001   rs1   010     00000   0001111
+     * CBOFLUSH  000000000010   rs1   010     00000   0001111
+     * CBOZERO   000000000100   rs1   010     00000   0001111
      */
 
     const uint32_t funct3 = decode_funct3(insn);
@@ -1113,6 +1140,32 @@ static inline bool op_misc_mem(rv_insn_t *ir, const uint32_t insn)
         ir->opcode = rv_insn_fencei;
         return true;
 #endif       /* RV32_HAS(Zifencei) */
+#if RV32_HAS(Zicbom) || RV32_HAS(Zicboz)
+    case 0b010:
+        if (decode_rd(insn))
+            return false;
+        ir->rs1 = decode_rs1(insn);
+        switch (decode_itype_imm(insn)) {
+#if RV32_HAS(Zicbom)
+        case 0b000:
+            ir->opcode = rv_insn_cboinval;
+            return true;
+        case 0b001:
+            ir->opcode = rv_insn_cboclean;
+            return true;
+        case 0b010:
+            ir->opcode = rv_insn_cboflush;
+            return true;
+#endif /* RV32_HAS(Zicbom) */
+#if RV32_HAS(Zicboz)
+        case 0b100:
+            ir->opcode = rv_insn_cbozero;
+            return true;
+#endif /* RV32_HAS(Zicboz) */
+        default: /* illegal instruction */
+            return false;
+        }
+#endif /* RV32_HAS(Zicbom) || RV32_HAS(Zicboz) */
     default: /* illegal instruction */
         return false;
     }
@@ -1192,6 +1245,220 @@ static inline bool op_amo(rv_insn_t *ir, const uint32_t insn)
 #define op_amo OP_UNIMP
 #endif /* RV32_HAS(EXT_A) */
 
+#if RV32_HAS(Zve32x)
+/* the width of the elements of a vector load or store in bytes, or 0 if the
+ * width field is not one of a vector load or store, or selects 64-bit
+ * elements, which are wider than ELEN
+ */
+static inline uint8_t decode_veew(const uint32_t insn)
+{
+    switch (decode_funct3(insn)) {
+    case 0b000:
+        return 1;
+    case 0b101:
+        return 2;
+    case 0b110:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+/* decode the fields common to the vector loads and stores
+ *  31 29  28   27 26  25  24   20 19   15 14   12 11   7 6      0
+ * |  nf | mew |  mop | vm |  rs2  |  rs1  | width |  vd  | opcode |
+ */
+static inline bool decode_vmem(rv_insn_t *ir, const uint32_t insn)
+{
+    ir->veew = decode_veew(insn);
+    /* mew is reserved for wider elements */
+    if (!ir->veew || (insn & (1U << 28)))
+        return false;
+
+    ir->vnf = insn >> 29;
+    ir->vm = (insn >> 25) & 0x1;
+    ir->rs1 = decode_rs1(insn);
+    ir->rs2 = decode_rs2(insn);
+    ir->rd = decode_rd(insn);
+
+    /* unit-stride: lumop/sumop is either plain, whole register, mask or,
+     * for loads, fault-only-first
+     */
+    ir->vfunct = ir->rs2;
+    return true;
+}
+
+/* LOAD-FP for vectors
+ *  31 29  28   27 26  25  24   20 19   15 14   12 11   7 6      0
+ * |  nf | mew |  mop | vm |  rs2  |  rs1  | width |  vd  | opcode |
+ */
+static inline bool op_vload(rv_insn_t *ir, const uint32_t insn)
+{
+    /* inst     nf mew mop vm lumop rs1 width vd opcode
+     * --------+--+---+---+--+-----+---+-----+--+-------
+     * VLE      nf 0   00  vm 00000 rs1 width vd 0000111
+     * VLR      nf 0   00  1  01000 rs1 width vd 0000111
+     * VLM      000 0  00  1  01011 rs1 000   vd 0000111
+     * VLEFF    nf 0   00  vm 10000 rs1 width vd 0000111
+     * VLUXEI   nf 0   01  vm vs2   rs1 width vd 0000111
+     * VLSE     nf 0   10  vm rs2   rs1 width vd 0000111
+     * VLOXEI   nf 0   11  vm vs2   rs1 width vd 0000111
+     */
+    if (!decode_vmem(ir, insn))
+        return false;
+
+    switch ((insn >> 26) & 0x3) {
+    case 0b00:
+        switch (ir->vfunct) {
+        case 0b00000:
+        case 0b10000:
+            break;
+        case 0b01000:
+            /* whole registers, a power of two of them */
+            if (!ir->vm || (ir->vnf & (ir->vnf + 1)))
+                return false;
+            break;
+        case 0b01011:
+            if (!ir->vm || ir->vnf || ir->veew != 1)
+                return false;
+            break;
+        default:
+            return false;
+        }
+        ir->opcode = rv_insn_vle;
+        break;
+    case 0b10:
+        ir->opcode = rv_insn_vlse;
+        break;
+    default:
+        ir->opcode = rv_insn_vlxe;
+        break;
+    }
+    return true;
+}
+
+/* STORE-FP for vectors
+ *  31 29  28   27 26  25  24   20 19   15 14   12 11   7 6      0
+ * |  nf | mew |  mop | vm |  rs2  |  rs1  | width |  vs3 | opcode |
+ */
+static inline bool op_vstore(rv_insn_t *ir, const uint32_t insn)
+{
+    /* inst     nf mew mop vm sumop rs1 width vs3 opcode
+     * --------+--+---+---+--+-----+---+-----+---+-------
+     * VSE      nf 0   00  vm 00000 rs1 width vs3 0100111
+     * VSR      nf 0   00  1  01000 rs1 000   vs3 0100111
+     * VSM      000 0  00  1  01011 rs1 000   vs3 0100111
+     * VSUXEI   nf 0   01  vm vs2   rs1 width vs3 0100111
+     * VSSE     nf 0   10  vm rs2   rs1 width vs3 0100111
+     * VSOXEI   nf 0   11  vm vs2   rs1 width vs3 0100111
+     */
+    if (!decode_vmem(ir, insn))
+        return false;
+
+    switch ((insn >> 26) & 0x3) {
+    case 0b00:
+        switch (ir->vfunct) {
+        case 0b00000:
+            break;
+        case 0b01000:
+            if (!ir->vm || (ir->vnf & (ir->vnf + 1)) || ir->veew != 1)
+                return false;
+            break;
+        case 0b01011:
+            if (!ir->vm || ir->vnf || ir->veew != 1)
+                return false;
+            break;
+        default:
+            return false;
+        }
+        ir->opcode = rv_insn_vse;
+        break;
+    case 0b10:
+        ir->opcode = rv_insn_vsse;
+        break;
+    default:
+        ir->opcode = rv_insn_vsxe;
+        break;
+    }
+    return true;
+}
+
+/* OP-V
+ *  31    26  25  24   20 19   15 14    12 11   7 6      0
+ * | funct6 | vm |  vs2  |  vs1  | funct3 |  vd  | opcode |
+ */
+static inline bool op_op_v(rv_insn_t *ir, const uint32_t insn)
+{
+    /* inst      funct6 vm vs2 vs1  funct3 vd opcode
+     * ---------+------+--+---+----+------+--+-------
+     * OPIVV     funct6 vm vs2 vs1  000    vd 1010111
+     * OPFVV     funct6 vm vs2 vs1  001    vd 1010111
+     * OPMVV     funct6 vm vs2 vs1  010    vd 1010111
+     * OPIVI     funct6 vm vs2 simm 011    vd 1010111
+     * OPIVX     funct6 vm vs2 rs1  100    vd 1010111
+     * OPFVF     funct6 vm vs2 rs1  101    vd 1010111
+     * OPMVX     funct6 vm vs2 rs1  110    vd 1010111
+     *
+     * inst      31 30 29  25 24   20 19   15 14 12 11  7 opcode
+     * ---------+--+------------+------+------+-----+---+-------
+     * VSETVLI   0  zimm[10:0]         rs1     111   rd  1010111
+     * VSETIVLI  1  1  zimm[9:0]       uimm    111   rd  1010111
+     * VSETVL    1  000000     rs2     rs1     111   rd  1010111
+     */
+    ir->rd = decode_rd(insn);
+    ir->rs1 = decode_rs1(insn);
+    ir->rs2 = decode_rs2(insn);
+    ir->vfunct = insn >> 26;
+    ir->vm = (insn >> 25) & 0x1;
+
+    switch (decode_funct3(insn)) {
+    case 0b000:
+        ir->opcode = rv_insn_vopivv;
+        break;
+    case 0b010:
+        ir->opcode = rv_insn_vopmvv;
+        break;
+    case 0b011:
+        /* simm5, which the unsigned operations take as uimm5 */
+        ir->imm = ((int32_t) (insn << 12)) >> 27;
+        ir->opcode = rv_insn_vopivi;
+        break;
+    case 0b100:
+        ir->opcode = rv_insn_vopivx;
+        break;
+    case 0b110:
+        ir->opcode = rv_insn_vopmvx;
+        break;
+#if RV32_HAS(Zve32f)
+    case 0b001:
+        ir->opcode = rv_insn_vopfvv;
+        break;
+    case 0b101:
+        ir->opcode = rv_insn_vopfvf;
+        break;
+#endif
+    case 0b111:
+        if (!(insn >> 31)) {
+            ir->imm = (insn >> 20) & 0x7ff;
+            ir->opcode = rv_insn_vsetvli;
+        } else if ((insn >> 30) == 0b11) {
+            ir->imm = (insn >> 20) & 0x3ff;
+            ir->opcode = rv_insn_vsetivli;
+        } else if (!decode_funct7(insn & ~(1U << 31))) {
+            ir->opcode = rv_insn_vsetvl;
+        } else {
+            return false;
+        }
+        break;
+    default: /* illegal instruction */
+        return false;
+    }
+    return true;
+}
+#else /* !RV32_HAS(Zve32x) */
+#define op_op_v OP_UNIMP
+#endif /* RV32_HAS(Zve32x) */
+
 #if RV32_HAS(EXT_F)
 /* LOAD-FP: I-type
  *  31       20 19   15 14   12 11   7 6      0
@@ -1203,6 +1470,10 @@ static inline bool op_load_fp(rv_insn_t *ir, const uint32_t insn)
      * ----+---------+---+-----+--+-------
      * FLW  imm[11:0] rs1 010   rd 0000111
      */
+#if RV32_HAS(Zve32x)
+    if (decode_funct3(insn) != 0b010)
+        return op_vload(ir, insn);
+#endif
 
     /* decode I-type */
     decode_itype(ir, insn);
@@ -1221,6 +1492,10 @@ static inline bool op_store_fp(rv_insn_t *ir, const uint32_t insn)
      * ----+---------+---+---+-----+--------+-------
      * FSW  imm[11:5] rs2 rs1 010   imm[4:0] 0100111
      */
+#if RV32_HAS(Zve32x)
+    if (decode_funct3(insn) != 0b010)
+        return op_vstore(ir, insn);
+#endif
 
     /* decode S-type */
     decode_stype(ir, insn);
@@ -1233,6 +1508,44 @@ static inline bool op_store_fp(rv_insn_t *ir, const uint32_t insn)
  *  31    27 26   25 24   20 19   15 14    12 11   7 6      0
  * | funct5 |  fmt  |  rs2  |  rs1  |   rm   |  rd  | opcode |
  */
+#if RV32_HAS(Zfa)
+/* the single-precision constants FLI.S loads, indexed by its rs1 field */
+static const uint32_t fli_table[32] = {
+    0xbf800000, /* -1.0 */
+    0x00800000, /* minimum positive normal */
+    0x37800000, /* 2^-16 */
+    0x38000000, /* 2^-15 */
+    0x3b800000, /* 2^-8 */
+    0x3c000000, /* 2^-7 */
+    0x3d800000, /* 0.0625 */
+    0x3e000000, /* 0.125 */
+    0x3e800000, /* 0.25 */
+    0x3ea00000, /* 0.3125 */
+    0x3ec00000, /* 0.375 */
+    0x3ee00000, /* 0.4375 */
+    0x3f000000, /* 0.5 */
+    0x3f200000, /* 0.625 */
+    0x3f400000, /* 0.75 */
+    0x3f600000, /* 0.875 */
+    0x3f800000, /* 1.0 */
+    0x3fa00000, /* 1.25 */
+    0x3fc00000, /* 1.5 */
+    0x3fe00000, /* 1.75 */
+    0x40000000, /* 2.0 */
+    0x40200000, /* 2.5 */
+    0x40400000, /* 3 */
+    0x40800000, /* 4 */
+    0x41000000, /* 8 */
+    0x41800000, /* 16 */
+    0x43000000, /* 128 */
+    0x43800000, /* 256 */
+    0x47000000, /* 2^15 */
+    0x47800000, /* 2^16 */
+    0x7f800000, /* +inf */
+    0x7fc00000, /* canonical NaN */
+};
+#endif
+
 static inline bool op_op_fp(rv_insn_t *ir, const uint32_t insn)
 {
     /* inst      funct7  rs2   rs1 rm  rd opcode
@@ -1257,6 +1570,16 @@ static inline bool op_op_fp(rv_insn_t *ir, const uint32_t insn)
      * FLE.S     1010000 rs2   rs1 000 rd 1010011
      * FCVT.S.W  1101000 00000 rs1 rm  rd 1010011
      * FCVT.S.WU 1101000 00001 rs1 rm  rd 1010011
+     *
+     * inst       funct7  rs2   rs1 rm  rd opcode
+     * ----------+-------+-----+---+---+--+-------
+     * FLI.S      1111000 00001 rs1 000 rd 1010011
+     * FMINM.S    0010100 rs2   rs1 010 rd 1010011
+     * FMAXM.S    0010100 rs2   rs1 011 rd 1010011
+     * FROUND.S   0100000 00100 rs1 rm  rd 1010011
+     * FROUNDNX.S 0100000 00101 rs1 rm  rd 1010011
+     * FLEQ.S     1010000 rs2   rs1 100 rd 1010011
+     * FLTQ.S     1010000 rs2   rs1 101 rd 1010011
      */
 
     /* decode R-type */
@@ -1316,6 +1639,14 @@ static inline bool op_op_fp(rv_insn_t *ir, const uint32_t insn)
         case 0b001: /* FMAX.S */
             ir->opcode = rv_insn_fmaxs;
             break;
+#if RV32_HAS(Zfa)
+        case 0b010: /* FMINM.S */
+            ir->opcode = rv_insn_fminms;
+            break;
+        case 0b011: /* FMAXM.S */
+            ir->opcode = rv_insn_fmaxms;
+            break;
+#endif
         default: /* illegal instruction */
             return false;
         }
@@ -1345,6 +1676,14 @@ static inline bool op_op_fp(rv_insn_t *ir, const uint32_t insn)
         case 0b000: /* FLE.S */
             ir->opcode = rv_insn_fles;
             break;
+#if RV32_HAS(Zfa)
+        case 0b100: /* FLEQ.S */
+            ir->opcode = rv_insn_fleqs;
+            break;
+        case 0b101: /* FLTQ.S */
+            ir->opcode = rv_insn_fltqs;
+            break;
+#endif
         default: /* illegal instruction */
             return false;
         }
@@ -1362,9 +1701,35 @@ static inline bool op_op_fp(rv_insn_t *ir, const uint32_t insn)
             return false;
         }
         break;
-    case 0b1111000: /* FMV.W.X */
+    case 0b1111000:
+#if RV32_HAS(Zfa)
+        if (ir->rs2 == 0b00001) { /* FLI.S */
+            if (ir->rm)
+                return false;
+            /* keep the bits of the constant rather than its index */
+            ir->imm = fli_table[ir->rs1];
+            ir->opcode = rv_insn_flis;
+            break;
+        }
+#endif
+        /* FMV.W.X */
         ir->opcode = rv_insn_fmvwx;
         break;
+#if RV32_HAS(Zfa)
+    case 0b0100000:
+        /* dispatch from rs2 region */
+        switch (ir->rs2) {
+        case 0b00100: /* FROUND.S */
+            ir->opcode = rv_insn_frounds;
+            break;
+        case 0b00101: /* FROUNDNX.S */
+            ir->opcode = rv_insn_froundnxs;
+            break;
+        default: /* illegal instruction */
+            return false;
+        }
+        break;
+#endif
     default: /* illegal instruction */
         return false;
     }
@@ -1444,8 +1809,13 @@ static inline bool op_nmsub(rv_insn_t *ir, const uint32_t insn)
 }
 
 #else /* !RV32_HAS(EXT_F) */
+#if RV32_HAS(Zve32x)
+#define op_load_fp op_vload
+#define op_store_fp op_vstore
+#else
 #define op_load_fp OP_UNIMP
 #define op_store_fp OP_UNIMP
+#endif
 #define op_op_fp OP_UNIMP
 #define op_madd OP_UNIMP
 #define op_msub OP_UNIMP
@@ -1558,6 +1928,49 @@ static inline bool op_clui(rv_insn_t *ir, const uint32_t insn)
     return true;
 }
 
+#if RV32_HAS(Zcb)
+/* C.ZEXT.B C.SEXT.B C.ZEXT.H C.SEXT.H C.NOT: CU-format
+ *  15                        10 9        7 6      5 4      2 1  0
+ * |           funct6           | rd'/rs1' | funct2 | funct5 | op |
+ */
+static inline bool op_czcb_unary(rv_insn_t *ir, const uint32_t insn)
+{
+    /* inst     funct6 rd'/rs1' funct2 funct5 op
+     * --------+------+--------+------+------+--
+     * C.ZEXT.B 100111 rd'/rs1' 11     000    01
+     * C.SEXT.B 100111 rd'/rs1' 11     001    01
+     * C.ZEXT.H 100111 rd'/rs1' 11     010    01
+     * C.SEXT.H 100111 rd'/rs1' 11     011    01
+     * C.ZEXT.W 100111 rd'/rs1' 11     100    01
+     * C.NOT    100111 rd'/rs1' 11     101    01
+     */
+
+    /* dispatch from funct5 field */
+    switch ((insn & FC_RS2C) >> 2) {
+    case 0: /* C.ZEXT.B */
+        ir->opcode = rv_insn_czextb;
+        break;
+#if RV32_HAS(Zbb)
+    case 1: /* C.SEXT.B */
+        ir->opcode = rv_insn_csextb;
+        break;
+    case 2: /* C.ZEXT.H */
+        ir->opcode = rv_insn_czexth;
+        break;
+    case 3: /* C.SEXT.H */
+        ir->opcode = rv_insn_csexth;
+        break;
+#endif
+    case 5: /* C.NOT */
+        ir->opcode = rv_insn_cnot;
+        break;
+    default: /* C.ZEXT.W is RV64 only, and the rest is reserved */
+        return false;
+    }
+    return true;
+}
+#endif /* RV32_HAS(Zcb) */
+
 /* MISC-ALU: CB-format CA-format
  *
  * C.SRLI C.SRAI C.ANDI: CB-format
@@ -1636,10 +2049,22 @@ static inline bool op_cmisc_alu(rv_insn_t *ir, const uint32_t insn)
         case 5: /* ADDW */
             assert(!"RV64/128C instructions");
             break;
+#if RV32_HAS(Zcb)
+        case 6: /* C.MUL */
+#if RV32_HAS(EXT_M)
+            ir->opcode = rv_insn_cmul;
+            break;
+#else
+            return false;
+#endif
+        case 7: /* C.ZEXT.B, C.SEXT.B, C.ZEXT.H, C.SEXT.H, C.NOT */
+            return op_czcb_unary(ir, insn);
+#else
         case 6: /* Reserved */
         case 7: /* Reserved */
             assert(!"Instruction reserved");
             break;
+#endif
         default:
             __UNREACHABLE;
             break;
@@ -1971,6 +2396,139 @@ static inline bool op_cfsw(rv_insn_t *ir, const uint32_t insn)
 #define op_cflwsp OP_UNIMP
 #endif /* RV32_HAS(EXT_C) && RV32_HAS(EXT_F) */
 
+#if RV32_HAS(Zcb)
+/* C.LBU C.LHU C.LH C.SB C.SH: CLB/CLH/CSB/CSH-format
+ *  15                        10 9    7 6   5 4        2 1  0
+ * |           funct6           | rs1' | imm | rd'/rs2' | op |
+ */
+static inline bool op_czcb(rv_insn_t *ir, const uint32_t insn)
+{
+    /* inst  funct6 rs1' imm       rd'/rs2' op
+     * -----+------+----+---------+--------+--
+     * C.LBU 100000 rs1' uimm[0|1] rd'      00
+     * C.LHU 100001 rs1' 0 uimm[1] rd'      00
+     * C.LH  100001 rs1' 1 uimm[1] rd'      00
+     * C.SB  100010 rs1' uimm[0|1] rs2'     00
+     * C.SH  100011 rs1' 0 uimm[1] rs2'     00
+     */
+    ir->imm = (insn & 0x0040) >> 6 | (insn & 0x0020) >> 4;
+    ir->rs1 = c_decode_rs1c(insn) | 0x08;
+    ir->rd = ir->rs2 = c_decode_rdc(insn) | 0x08;
+
+    /* dispatch from funct6[2:0] field, where the halfword accesses use the
+     * place of uimm[0] to tell C.LH from C.LHU
+     */
+    switch ((insn & FC_IMM_12_10) >> 10) {
+    case 0: /* C.LBU */
+        ir->opcode = rv_insn_clbu;
+        break;
+    case 1: /* C.LHU, C.LH */
+        ir->opcode = (ir->imm & 1) ? rv_insn_clh : rv_insn_clhu;
+        ir->imm &= 2;
+        break;
+    case 2: /* C.SB */
+        ir->opcode = rv_insn_csb;
+        break;
+    case 3: /* C.SH */
+        if (ir->imm & 1)
+            return false;
+        ir->opcode = rv_insn_csh;
+        break;
+    default: /* Reserved */
+        return false;
+    }
+    return true;
+}
+#else /* !RV32_HAS(Zcb) */
+#define op_czcb OP_UNIMP
+#endif /* RV32_HAS(Zcb) */
+
+#if RV32_HAS(Zcmp)
+/* the saved register, s0-s1 or s2-s7, which the 3-bit field @sreg refers to */
+static inline uint8_t c_decode_sreg(const uint16_t sreg)
+{
+    return sreg < 2 ? sreg + 8 : sreg + 16;
+}
+
+/* CM.PUSH CM.POP CM.POPRETZ CM.POPRET: CMPP-format
+ *  15                      8 7     4 3          2 1  0
+ * |          funct8         | rlist | spimm[5:4] | op |
+ *
+ * CM.MVSA01 CM.MVA01S: CMMV-format
+ *  15                        10 9    7 6      5 4    2 1  0
+ * |           funct6           | r1s' | funct2 | r2s' | op |
+ */
+static inline bool op_czcmp(rv_insn_t *ir, const uint32_t insn)
+{
+    /* inst       funct8   rlist spimm[5:4] op
+     * ----------+--------+-----+----------+--
+     * CM.PUSH    10111000 rlist spimm      10
+     * CM.POP     10111010 rlist spimm      10
+     * CM.POPRETZ 10111100 rlist spimm      10
+     * CM.POPRET  10111110 rlist spimm      10
+     *
+     * inst      funct6 r1s' funct2 r2s' op
+     * ---------+------+----+------+----+--
+     * CM.MVSA01 101011 r1s' 01     r2s' 10
+     * CM.MVA01S 101011 r1s' 11     r2s' 10
+     */
+    if ((insn & FC_IMM_12_10) == 0x0c00) {
+        ir->rs1 = c_decode_sreg(c_decode_rs1c(insn));
+        ir->rs2 = c_decode_sreg(c_decode_rs2c(insn));
+
+        /* dispatch from funct2 field */
+        switch ((insn & FC_IMM_6_5) >> 5) {
+        case 1: /* CM.MVSA01 */
+            /* Code point: r1s' = r2s' is reserved */
+            if (ir->rs1 == ir->rs2)
+                return false;
+            ir->opcode = rv_insn_cmmvsa01;
+            break;
+        case 3: /* CM.MVA01S */
+            ir->opcode = rv_insn_cmmva01s;
+            break;
+        default: /* Reserved */
+            return false;
+        }
+        return true;
+    }
+
+    /* rlist 4 is {ra}, 5 to 14 add s0 to s9 one by one, and 15 adds both s10
+     * and s11. 0 to 3 are reserved, and so are the lists beyond s1 on RV32E,
+     * which has no s2 to s11.
+     */
+    const uint8_t rlist = (insn & 0x00f0) >> 4;
+    if (rlist < 4 || (RV32_HAS(RV32E) && rlist > 6))
+        return false;
+    ir->imm2 = rlist == 15 ? 13 : rlist - 3;
+    /* The stack adjustment is the size of the registers rounded up to 16
+     * bytes, plus spimm[5:4] more units of 16 bytes.
+     */
+    ir->imm = ((ir->imm2 * 4 + 15) & ~15) + ((insn & 0x000c) << 2);
+
+    /* dispatch from funct8[4:0] field */
+    switch ((insn & 0x1f00) >> 8) {
+    case 0x18: /* CM.PUSH */
+        ir->opcode = rv_insn_cmpush;
+        break;
+    case 0x1a: /* CM.POP */
+        ir->opcode = rv_insn_cmpop;
+        break;
+    case 0x1c: /* CM.POPRETZ */
+        ir->opcode = rv_insn_cmpopretz;
+        break;
+    case 0x1e: /* CM.POPRET */
+        ir->opcode = rv_insn_cmpopret;
+        break;
+    default: /* Reserved */
+        return false;
+    }
+    return true;
+}
+#else /* !RV32_HAS(Zcmp) */
+#define op_czcmp OP_UNIMP
+#endif /* RV32_HAS(Zcmp) */
+
 /* handler for all unimplemented opcodes */
 static inline bool op_unimp(rv_insn_t *ir UNUSED, uint32_t insn UNUSED)
 {
@@ -1996,7 +2554,7 @@ bool rv_decode(rv_insn_t *ir, uint32_t insn)
     //  000         001           010        011           100         101        110        111
         OP(load),   OP(load_fp),  OP(unimp), OP(misc_mem), OP(op_imm), OP(auipc), OP(unimp), OP(unimp), // 00
         OP(store),  OP(store_fp), OP(unimp), OP(amo),      OP(op),     OP(lui),   OP(unimp), OP(unimp), // 01
-        OP(madd),   OP(msub),     OP(nmsub), OP(nmadd),    OP(op_fp),  OP(unimp), OP(unimp), OP(unimp), // 10
+        OP(madd),   OP(msub),     OP(nmsub), OP(nmadd),    OP(op_fp),  OP(op_v),  OP(unimp), OP(unimp), // 10
         OP(branch), OP(jalr),     OP(unimp), OP(jal),      OP(system), OP(unimp), OP(unimp), OP(unimp), // 11
     };
 
@@ -2008,8 +2566,8 @@ bool rv_decode(rv_insn_t *ir, uint32_t insn)
         OP(unimp),      OP(cjal),      OP(unimp), OP(unimp),  // 001
         OP(clw),       OP(cli),       OP(clwsp),  OP(unimp),  // 010
         OP(cflw),      OP(clui),      OP(cflwsp), OP(unimp),  // 011
-        OP(unimp),     OP(cmisc_alu), OP(ccr),    OP(unimp),  // 100
-        OP(unimp),      OP(cj),        OP(unimp), OP(unimp),  // 101
+        OP(czcb),      OP(cmisc_alu), OP(ccr),    OP(unimp),  // 100
+        OP(unimp),      OP(cj),        OP(czcmp), OP(unimp),  // 101
         OP(csw),       OP(cbeqz),     OP(cswsp),  OP(unimp),  // 110
         OP(cfsw),      OP(cbnez),     OP(cfswsp), OP(unimp),  // 111
     };
@@ -2047,7 +2605,8 @@ end:
 #if RV32_HAS(RV32E)
     /* RV32E forbids x16-x31 for integer registers, but with the F extension,
      * floating-point registers are not limited to 16. */
-    if ((op != op_store_fp && op != op_load_fp && op != op_op_fp) &&
+    if ((op != op_store_fp && op != op_load_fp && op != op_op_fp &&
+         op != op_op_v) &&
         unlikely(ir->rd > 15 || ir->rs1 > 15 || ir->rs2 > 15))
         ret = false;
 #endif
@@ -88,6 +88,16 @@ enum op_field {
     IIF(RV32_HAS(Zifencei))(                           \
         _(fencei, 1, 4, 0, ENC(rs1, rd))               \
     )                                                  \
+    /* RV32 Zicbom Standard Extension */               \
+    IIF(RV32_HAS(Zicbom))(                             \
+        _(cboinval, 0, 4, 0, ENC(rs1))                 \
+        _(cboclean, 0, 4, 0, ENC(rs1))                 \
+        _(cboflush, 0, 4, 0, ENC(rs1))                 \
+    )                                                  \
+    /* RV32 Zicboz Standard Extension */               \
+    IIF(RV32_HAS(Zicboz))(                             \
+        _(cbozero, 0, 4, 0, ENC(rs1))                  \
+    )                                                  \
     /* RV32 Zicsr Standard Extension */                \
     IIF(RV32_HAS(Zicsr))(                              \
         _(csrrw, 1, 4, 0, ENC(rs1, rd))                \
@@ -141,6 +151,11 @@ enum op_field {
         _(bset, 0, 4, 0, ENC(rs1, rs2, rd))            \
         _(bseti, 0, 4, 0, ENC(rs1, rs2, rd))           \
     )                                                  \
+    /* RV32 Zicond Standard Extension */               \
+    IIF(RV32_HAS(Zicond))(                             \
+        _(czeroeqz, 0, 4, 1, ENC(rs1, rs2, rd))        \
+        _(czeronez, 0, 4, 1, ENC(rs1, rs2, rd))        \
+    )                                                  \
     /* RV32M Standard Extension */                     \
     IIF(RV32_HAS(EXT_M))(                              \
         _(mul, 0, 4, 1, ENC(rs1, rs2, rd))             \
@@ -195,6 +210,37 @@ enum op_field {
         _(fcvtswu, 0, 4, 0, ENC(rs1, rs2, rd))         \
         _(fmvwx, 0, 4, 0, ENC(rs1, rs2, rd))           \
     )                                                  \
+    /* RV32 Zfa Standard Extension */                  \
+    IIF(RV32_HAS(Zfa))(                                \
+        _(flis, 0, 4, 0, ENC(rd))                      \
+        _(fminms, 0, 4, 0, ENC(rs1, rs2, rd))          \
+        _(fmaxms, 0, 4, 0, ENC(rs1, rs2, rd))          \
+        _(frounds, 0, 4, 0, ENC(rs1, rd))              \
+        _(froundnxs, 0, 4, 0, ENC(rs1, rd))            \
+        _(fleqs, 0, 4, 0, ENC(rs1, rs2, rd))           \
+        _(fltqs, 0, 4, 0, ENC(rs1, rs2, rd))           \
+    )                                                  \
+    /* RV32 Zve32x/Zve32f Standard Extensions */       \
+    IIF(RV32_HAS(Zve32x))(                             \
+        _(vsetvli, 0, 4, 0, ENC(rs1, rd))              \
+        _(vsetivli, 0, 4, 0, ENC(rd))                  \
+        _(vsetvl, 0, 4, 0, ENC(rs1, rs2, rd))          \
+        _(vle, 0, 4, 0, ENC(rs1))                      \
+        _(vlse, 0, 4, 0, ENC(rs1, rs2))                \
+        _(vlxe, 0, 4, 0, ENC(rs1))                     \
+        _(vse, 0, 4, 0, ENC(rs1))                      \
+        _(vsse, 0, 4, 0, ENC(rs1, rs2))                \
+        _(vsxe, 0, 4, 0, ENC(rs1))                     \
+        _(vopivv, 0, 4, 0, ENC())                      \
+        _(vopivx, 0, 4, 0, ENC(rs1))                   \
+        _(vopivi, 0, 4, 0, ENC())                      \
+        _(vopmvv, 0, 4, 0, ENC(rd))                    \
+        _(vopmvx, 0, 4, 0, ENC(rs1))                   \
+        IIF(RV32_HAS(Zve32f))(                         \
+            _(vopfvv, 0, 4, 0, ENC())                  \
+            _(vopfvf, 0, 4, 0, ENC())                  \
+        )                                              \
+    )                                                  \
     /* RV32C Standard Extension */                     \
     IIF(RV32_HAS(EXT_C))(                              \
         _(caddi4spn, 0, 2, 1, ENC(rd))                 \
@@ -231,6 +277,33 @@ enum op_field {
             _(cflw, 0, 2, 1, ENC(rs1, rd))             \
             _(cfsw, 0, 2, 1, ENC(rs1, rs2))            \
         )                                              \
+        /* RV32 Zcb Standard Extension */              \
+        IIF(RV32_HAS(Zcb))(                            \
+            _(clbu, 0, 2, 1, ENC(rs1, rd))             \
+            _(clhu, 0, 2, 1, ENC(rs1, rd))             \
+            _(clh, 0, 2, 1, ENC(rs1, rd))              \
+            _(csb, 0, 2, 1, ENC(rs1, rs2))             \
+            _(csh, 0, 2, 1, ENC(rs1, rs2))             \
+            _(czextb, 0, 2, 1, ENC(rd))                \
+            _(cnot, 0, 2, 1, ENC(rd))                  \
+            IIF(RV32_HAS(Zbb))(                        \
+                _(csextb, 0, 2, 1, ENC(rd))            \
+                _(czexth, 0, 2, 1, ENC(rd))            \
+                _(csexth, 0, 2, 1, ENC(rd))            \
+            )                                          \
+            IIF(RV32_HAS(EXT_M))(                      \
+                _(cmul, 0, 2, 1, ENC(rs1, rs2, rd))    \
+            )                                          \
+        )                                              \
+        /* RV32 Zcmp Standard Extension */             \
+        IIF(RV32_HAS(Zcmp))(                           \
+            _(cmpush, 0, 2, 1, ENC())                  \
+            _(cmpop, 0, 2, 1, ENC())                   \
+            _(cmpopretz, 1, 2, 1, ENC())               \
+            _(cmpopret, 1, 2, 1, ENC())                \
+            _(cmmvsa01, 0, 2, 1, ENC(rs1, rs2))        \
+            _(cmmva01s, 0, 2, 1, ENC(rs1, rs2))        \
+        )                                              \
     )
 /* clang-format on */
 
@@ -238,13 +311,17 @@ enum op_field {
 
 /* macro operation fusion: convert specific RISC-V instruction patterns
  * into faster and equivalent code
+ *
+ * 'probe' is not a fused instruction, but an internal IR inserted at the head
+ * of a block for instrumentation. It is dispatched in the same manner.
  */
 #define FUSE_INSN_LIST \
     _(fuse1)           \
     _(fuse2)           \
     _(fuse3)           \
     _(fuse4)           \
-    _(fuse5)
+    _(fuse5)           \
+    _(probe)
 
 /* clang-format off */
 /* IR (intermediate representation) is exclusively represented by RISC-V
@@ -324,6 +401,17 @@ typedef struct {
     uint8_t opcode;
 } opcode_fuse_t;
 
+#if RV32_HAS(Zcmp)
+/* The register list of cm.push and cm.pop holds ra and then s0 to s11, in
+ * that order, and the IR keeps the number of registers in @imm2 and the stack
+ * adjustment in @imm. This returns the @i-th register of the list.
+ */
+static inline uint8_t zcmp_reg(int i)
+{
+    return i < 3 ? (i ? i + 7 : rv_reg_ra) : i + 15;
+}
+#endif
+
 #define HISTORY_SIZE 16
 typedef struct {
     uint32_t PC[HISTORY_SIZE];
@@ -364,6 +452,16 @@ typedef struct rv_insn {
     uint8_t rm;
 #endif
 
+#if RV32_HAS(Zve32x)
+    /* Vector instructions keep funct6 in @vfunct, and the mask enable in @vm.
+     * Loads and stores keep the width of their elements in bytes in @veew,
+     * the number of fields minus one in @vnf, the lumop or sumop field of the
+     * unit-stride ones in @vfunct, and the stride or index register in @rs2.
+     * The register stores take the data from is held in @rd.
+     */
+    uint8_t vfunct, vm, veew, vnf;
+#endif
+
     /* fuse operation */
     int32_t imm2;
     opcode_fuse_t *fuse;
@@ -382,9 +480,16 @@ typedef struct rv_insn {
      * the jump address. By utilizing these two members, all instruction
      * emulations can be rewritten into a self-recursive version, enabling the
      * compiler to leverage TCO.
+     *
+     * In the direct-threaded interpreter, @impl holds the address of the label
+     * handling the IR within the dispatch function instead.
      */
     struct rv_insn *next;
+#if RV32_HAS(THREADED_CODE)
+    const void *impl;
+#else
     bool (*impl)(riscv_t *, const struct rv_insn *, uint64_t, uint32_t);
+#endif
 
     /* Two pointers, 'branch_taken' and 'branch_untaken', are employed to
      * avoid the overhead associated with aggressive memory copying. Instead
@@ -22,6 +22,7 @@ void plic_update_interrupts(plic_t *plic)
         rv->csr_sip |= SIP_SEIP;
     else
         rv->csr_sip &= ~SIP_SEIP;
+    rv_update_intr_pending(rv);
 }
 
 uint32_t plic_read(plic_t *plic, const uint32_t addr)
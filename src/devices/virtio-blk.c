@@ -271,6 +271,7 @@ static void virtio_queue_notify_handler(virtio_blk_state_t *vblk, int index)
         int result = virtio_blk_desc_handler(vblk, queue, buffer_idx, &len);
         if (result != 0)
             return virtio_blk_set_fail(vblk);
+        vblk->n_requests++;
 
         /* Write used element information (`struct virtq_used_elem`) to the used
          * queue */
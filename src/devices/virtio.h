@@ -105,6 +105,8 @@ typedef struct {
     uint32_t *disk;
     uint64_t disk_size;
     int disk_fd;
+    /* statistics */
+    uint64_t n_requests;
     /* implementation-specific */
     void *priv;
 } virtio_blk_state_t;
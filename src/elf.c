@@ -52,6 +52,10 @@ enum {
 
 #define ELF_ST_TYPE(x) (((unsigned int) x) & 0xf)
 
+enum {
+    PF_X = 1, /* Executable segment */
+};
+
 struct elf_internal {
     const struct Elf32_Ehdr *hdr;
     uint32_t raw_size;
@@ -241,6 +245,71 @@ bool elf_get_data_section_range(elf_t *e, uint32_t *start, uint32_t *end)
     return true;
 }
 
+const uint8_t *elf_get_section(elf_t *e, const char *name, uint32_t *size)
+{
+    const struct Elf32_Shdr *shdr = get_section_header(e, name);
+    if (!shdr || shdr->sh_type == SHT_NOBITS)
+        return NULL;
+
+    *size = shdr->sh_size;
+    return e->raw_data + shdr->sh_offset;
+}
+
+bool elf_get_load_range(elf_t *e, uint32_t *start, uint32_t *end)
+{
+    bool found = false;
+    for (int p = 0; p < e->hdr->e_phnum; ++p) {
+        uint32_t offset = e->hdr->e_phoff + (p * e->hdr->e_phentsize);
+        const struct Elf32_Phdr *phdr =
+            (const struct Elf32_Phdr *) (e->raw_data + offset);
+        if (phdr->p_type != PT_LOAD)
+            continue;
+
+        if (!found || phdr->p_vaddr < *start)
+            *start = phdr->p_vaddr;
+        if (!found || phdr->p_vaddr + phdr->p_memsz > *end)
+            *end = phdr->p_vaddr + phdr->p_memsz;
+        found = true;
+    }
+    return found;
+}
+
+uint32_t elf_get_functions(elf_t *e, uint32_t *addrs, uint32_t max)
+{
+    const struct Elf32_Shdr *shdr = get_section_header(e, ".symtab");
+    if (!shdr)
+        return 0;
+
+    const struct Elf32_Sym *sym =
+        (const struct Elf32_Sym *) (e->raw_data + shdr->sh_offset);
+    const struct Elf32_Sym *end =
+        (const struct Elf32_Sym *) (e->raw_data + shdr->sh_offset +
+                                    shdr->sh_size);
+
+    uint32_t n = 0;
+    for (; sym < end; ++sym) {
+        if (ELF_ST_TYPE(sym->st_info) != STT_FUNC || !sym->st_value)
+            continue;
+        if (n < max)
+            addrs[n] = sym->st_value;
+        n++;
+    }
+    return n;
+}
+
+bool elf_is_executable(elf_t *e, uint32_t addr)
+{
+    for (int p = 0; p < e->hdr->e_phnum; ++p) {
+        uint32_t offset = e->hdr->e_phoff + (p * e->hdr->e_phentsize);
+        const struct Elf32_Phdr *phdr =
+            (const struct Elf32_Phdr *) (e->raw_data + offset);
+        if (phdr->p_type == PT_LOAD && (phdr->p_flags & PF_X) &&
+            addr - phdr->p_vaddr < phdr->p_filesz)
+            return true;
+    }
+    return false;
+}
+
 /* A quick ELF briefer:
  *    +--------------------------------+
  *    | ELF Header                     |--+
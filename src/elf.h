@@ -140,6 +140,18 @@ const char *elf_find_symbol(elf_t *e, uint32_t addr);
 /* get the range of .data section from the ELF file */
 bool elf_get_data_section_range(elf_t *e, uint32_t *start, uint32_t *end);
 
+/* get the content of a section, NULL if it is absent or has no file data */
+const uint8_t *elf_get_section(elf_t *e, const char *name, uint32_t *size);
+
+/* get the address range covered by all loadable segments */
+bool elf_get_load_range(elf_t *e, uint32_t *start, uint32_t *end);
+
+/* get the addresses of up to @max function symbols, return how many exist */
+uint32_t elf_get_functions(elf_t *e, uint32_t *addrs, uint32_t max);
+
+/* whether @addr lies in the file data of an executable segment */
+bool elf_is_executable(elf_t *e, uint32_t addr);
+
 /* Load the ELF file into a memory abstraction */
 bool elf_load(elf_t *e, memory_t *mem);
 
@@ -10,10 +10,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef __EMSCRIPTEN__
-#include <emscripten.h>
-#endif
-
 #if RV32_HAS(EXT_F)
 #include <math.h>
 #include "softfp.h"
@@ -34,6 +30,10 @@ extern struct target_ops gdbstub_ops;
 #include "jit.h"
 #endif
 
+#if RV32_HAS(SYSTEM)
+#include "system.h"
+#endif
+
 /* Shortcuts for comparing each field of specified RISC-V instruction */
 #define IF_insn(i, o) (i->opcode == rv_insn_##o)
 #define IF_rd(i, r) (i->rd == rv_reg_##r)
@@ -67,26 +67,178 @@ static void __trap_handler(riscv_t *rv);
  * @compress: compressed instruction or not
  * @IO: whether the misaligned handler is for load/store or insn.
  */
-#define RV_EXC_MISALIGN_HANDLER(mask_or_pc, type, compress, IO)       \
-    IIF(IO)                                                           \
-    (if (!PRIV(rv)->allow_misalign && unlikely(addr & (mask_or_pc))), \
-     if (unlikely(insn_is_misaligned(PC))))                           \
-    {                                                                 \
-        rv->compressed = compress;                                    \
-        rv->csr_cycle = cycle;                                        \
-        rv->PC = PC;                                                  \
-        SET_CAUSE_AND_TVAL_THEN_TRAP(rv, type##_MISALIGNED,           \
-                                     IIF(IO)(addr, mask_or_pc));      \
-        return false;                                                 \
+#define RV_EXC_MISALIGN_HANDLER(mask_or_pc, type, compress, IO)          \
+    IIF(IO)                                                              \
+    (if (unlikely(addr & (mask_or_pc)) &&                                \
+         !misaligned_allowed(rv, addr, mask_or_pc)),                     \
+     if (unlikely(insn_is_misaligned(PC))))                              \
+    {                                                                    \
+        rv->compressed = compress;                                       \
+        rv->csr_cycle = cycle;                                           \
+        rv->PC = PC;                                                     \
+        SET_CAUSE_AND_TVAL_THEN_TRAP(rv, type##_MISALIGNED,              \
+                                     IIF(IO)(addr, mask_or_pc));         \
+        return false;                                                    \
+    }
+
+/* raise an illegal instruction exception for an instruction which is reserved
+ * as @cond holds, e.g., under the current vtype
+ */
+#define RV_EXC_ILLEGAL_INSN_HANDLER(cond)                  \
+    if (unlikely(cond)) {                                  \
+        rv->compressed = false;                            \
+        rv->csr_cycle = cycle;                             \
+        rv->PC = PC;                                       \
+        SET_CAUSE_AND_TVAL_THEN_TRAP(rv, ILLEGAL_INSN, 0); \
+        return false;                                      \
+    }
+
+/* account a misaligned load or store of @mask + 1 bytes at @addr, return true
+ * if it is performed, which in system emulation also takes it not to cross a
+ * page nor to reach the devices
+ */
+static inline bool misaligned_allowed(riscv_t *rv,
+                                      uint32_t addr UNUSED,
+                                      uint32_t mask UNUSED)
+{
+    rv_hpm_count(rv, RV_HPM_MISALIGNED, 1);
+#if RV32_HAS(SYSTEM)
+    return PRIV(rv)->allow_misalign &&
+           mmu_misaligned_in_ram(rv, addr, mask + 1);
+#else
+    return PRIV(rv)->allow_misalign;
+#endif
+}
+
+#if RV32_HAS(Zicbom) || RV32_HAS(Zicboz)
+/* whether the cache-block operations enabled by the given fields of senvcfg
+ * are allowed, where only U-mode is subject to senvcfg as there is no M-mode
+ * software to hand menvcfg to
+ */
+static inline bool cbo_enabled(riscv_t *rv, uint32_t fields)
+{
+    return rv->priv_mode != RV_PRIV_U_MODE || (rv->csr_senvcfg & fields);
+}
+#endif
+
+#if RV32_HAS(Zicboz)
+/* Zero the cache block which vaddr falls into with a single memset on the
+ * host, rather than the word stores it stands for, unless the block is out
+ * of the memory, e.g., I/O registers.
+ */
+static void cbo_zero(riscv_t *rv, uint32_t vaddr)
+{
+    vaddr &= ~(CBO_BLOCK_SIZE - 1U);
+#if RV32_HAS(SYSTEM)
+    /* a block never crosses a page, so one translation covers all of it */
+    const uint32_t addr = rv->io.mem_translate(rv, vaddr, W);
+#if !RV32_HAS(ELF_LOADER)
+    if (need_handle_signal)
+        return;
+#endif
+    if ((uint64_t) addr + CBO_BLOCK_SIZE > PRIV(rv)->mem->mem_size) {
+        for (uint32_t i = 0; i < CBO_BLOCK_SIZE; i += 4)
+            rv->io.mem_write_w(rv, vaddr + i, 0);
+        return;
+    }
+#else
+    const uint32_t addr = vaddr;
+#endif
+    memory_fill(PRIV(rv)->mem, addr, CBO_BLOCK_SIZE, 0);
+}
+#endif
+
+/* the running count of the event selected by a performance-monitoring
+ * counter, where an unknown event is never counted
+ */
+static uint64_t hpm_event_count(riscv_t *rv, uint32_t event)
+{
+    if (event == RV_HPM_CYCLES || event == RV_HPM_INSTRET)
+        return rv->csr_cycle;
+    return event < RV_HPM_EVENT_COUNT ? rv->hpm_events[event] : 0;
+}
+
+/* A counting counter is not incremented but derived from the running count
+ * of its event, so that accounting an event costs a single addition.
+ */
+uint64_t rv_hpm_read(riscv_t *rv, uint32_t idx)
+{
+    if (rv->csr_mcountinhibit & (1U << idx))
+        return rv->csr_mhpmcounter[idx];
+    return hpm_event_count(rv, rv->csr_mhpmevent[idx]) - rv->hpm_base[idx];
+}
+
+void rv_hpm_write(riscv_t *rv, uint32_t idx, uint64_t val)
+{
+#if RV32_HAS(JIT)
+    /* the tier-1 code translated without counting its instructions, see
+     * emit_hpm_count(), is dropped once the guest selects them
+     */
+    if (unlikely(rv->csr_mhpmevent[idx] == RV_HPM_T1_INSN &&
+                 !rv->hpm_t1_insn)) {
+        rv->hpm_t1_insn = true;
+        jit_state_flush(rv);
     }
+#endif
+    rv->csr_mhpmcounter[idx] = val;
+    rv->hpm_base[idx] = hpm_event_count(rv, rv->csr_mhpmevent[idx]) - val;
+}
 
 /* FIXME: use more precise methods for updating time, e.g., RTC */
 #if RV32_HAS(Zicsr)
 static uint64_t ctr = 0;
+
+/* timebase-frequency of the device tree, i.e., src/devices/minimal.dts */
+#define TIMEBASE_FREQ 65000000
+
+/* In icount mode, time is derived from the retired instructions alone, as if
+ * the guest ran at icount_mips. Otherwise, it counts the instructions run by
+ * the interpreter in system emulation.
+ */
+static uint64_t get_time(riscv_t *rv)
+{
+    const uint32_t mips = PRIV(rv)->icount_mips;
+    if (mips)
+        return rv_icount(rv) * (TIMEBASE_FREQ / 1000000) / mips;
+    return ctr;
+}
+
 static inline void update_time(riscv_t *rv)
 {
-    rv->csr_time[0] = ctr & 0xFFFFFFFF;
-    rv->csr_time[1] = ctr >> 32;
+    const uint64_t t = get_time(rv);
+    rv->csr_time[0] = t & 0xFFFFFFFF;
+    rv->csr_time[1] = t >> 32;
+}
+
+/* Performance-monitoring CSRs are backed by csr_mhpmcounter, refreshed
+ * here from the running event counts and folded back by csr_hpm_update.
+ */
+static uint32_t *csr_hpm_get_ptr(riscv_t *rv, uint32_t csr)
+{
+    uint32_t idx = csr & 0x1F;
+    if (csr == CSR_MCOUNTINHIBIT) {
+        for (idx = 3; idx < 32; idx++)
+            rv->csr_mhpmcounter[idx] = rv_hpm_read(rv, idx);
+        return &rv->csr_mcountinhibit;
+    }
+    if (idx < 3)
+        return NULL;
+
+    switch (csr & ~0x1FU) {
+    case CSR_MHPMEVENT3 & ~0x1FU:
+        rv->csr_mhpmcounter[idx] = rv_hpm_read(rv, idx);
+        return &rv->csr_mhpmevent[idx];
+    case CSR_MHPMCOUNTER3 & ~0x1FU:
+    case CSR_HPMCOUNTER3 & ~0x1FU:
+        rv->csr_mhpmcounter[idx] = rv_hpm_read(rv, idx);
+        return (uint32_t *) &rv->csr_mhpmcounter[idx];
+    case CSR_MHPMCOUNTER3H & ~0x1FU:
+    case CSR_HPMCOUNTER3H & ~0x1FU:
+        rv->csr_mhpmcounter[idx] = rv_hpm_read(rv, idx);
+        return &((uint32_t *) &rv->csr_mhpmcounter[idx])[1];
+    default:
+        return NULL;
+    }
 }
 
 /* get a pointer to a CSR */
@@ -137,6 +289,23 @@ static uint32_t *csr_get_ptr(riscv_t *rv, uint32_t csr)
         return (uint32_t *) (&rv->csr_fcsr);
     case CSR_FCSR:
         return (uint32_t *) (&rv->csr_fcsr);
+#endif
+#if RV32_HAS(Zve32x)
+    case CSR_VSTART:
+        return &rv->csr_vstart;
+    case CSR_VXSAT:
+        return &rv->csr_vxsat;
+    case CSR_VXRM:
+        return &rv->csr_vxrm;
+    case CSR_VCSR:
+        rv->csr_vcsr = rv->csr_vxrm << 1 | rv->csr_vxsat;
+        return &rv->csr_vcsr;
+    case CSR_VL:
+        return &rv->csr_vl;
+    case CSR_VTYPE:
+        return &rv->csr_vtype;
+    case CSR_VLENB:
+        return &rv->csr_vlenb;
 #endif
     case CSR_SSTATUS:
         return (uint32_t *) (&rv->csr_sstatus);
@@ -146,6 +315,8 @@ static uint32_t *csr_get_ptr(riscv_t *rv, uint32_t csr)
         return (uint32_t *) (&rv->csr_stvec);
     case CSR_SCOUNTEREN:
         return (uint32_t *) (&rv->csr_scounteren);
+    case CSR_SENVCFG:
+        return &rv->csr_senvcfg;
     case CSR_SSCRATCH:
         return (uint32_t *) (&rv->csr_sscratch);
     case CSR_SEPC:
@@ -159,10 +330,67 @@ static uint32_t *csr_get_ptr(riscv_t *rv, uint32_t csr)
     case CSR_SATP:
         return (uint32_t *) (&rv->csr_satp);
     default:
-        return NULL;
+        return csr_hpm_get_ptr(rv, csr & 0xFFF);
     }
 }
 
+/* fold a write to a performance-monitoring CSR back into the counters */
+static void csr_hpm_update(riscv_t *rv, uint32_t csr)
+{
+    csr &= 0xFFF;
+    uint32_t idx = csr & 0x1F;
+    if (csr == CSR_MCOUNTINHIBIT) {
+        /* mcycle and minstret can not be inhibited */
+        rv->csr_mcountinhibit &= ~0x7U;
+        for (idx = 3; idx < 32; idx++)
+            rv_hpm_write(rv, idx, rv->csr_mhpmcounter[idx]);
+    } else if ((csr >= CSR_MHPMEVENT3 && csr <= CSR_MHPMEVENT31) ||
+               (csr >= CSR_MHPMCOUNTER3 && csr <= CSR_MHPMCOUNTER31) ||
+               (csr >= CSR_MHPMCOUNTER3H && csr <= CSR_MHPMCOUNTER31H)) {
+        rv_hpm_write(rv, idx, rv->csr_mhpmcounter[idx]);
+    }
+}
+
+#if RV32_HAS(Zve32x)
+/* keep the vector CSRs within their fields, and split a write to vcsr */
+static void csr_vector_update(riscv_t *rv, uint32_t csr)
+{
+    switch (csr & 0xFFF) {
+    case CSR_VSTART:
+        rv->csr_vstart &= VLEN - 1;
+        break;
+    case CSR_VCSR:
+        rv->csr_vxsat = rv->csr_vcsr & 0x1;
+        rv->csr_vxrm = (rv->csr_vcsr >> 1) & 0x3;
+        break;
+    case CSR_VXSAT:
+        rv->csr_vxsat &= 0x1;
+        break;
+    case CSR_VXRM:
+        rv->csr_vxrm &= 0x3;
+        break;
+    }
+}
+#else
+#define csr_vector_update(rv, csr)
+#endif
+
+#if RV32_HAS(SYSTEM)
+/* an interrupt may become deliverable, or stop being so */
+static void csr_intr_update(riscv_t *rv, uint32_t csr)
+{
+    switch (csr & 0xFFF) {
+    case CSR_SSTATUS:
+    case CSR_SIE:
+    case CSR_SIP:
+        rv_update_intr_pending(rv);
+        break;
+    }
+}
+#else
+#define csr_intr_update(rv, csr)
+#endif
+
 /* CSRRW (Atomic Read/Write CSR) instruction atomically swaps values in the
  * CSRs and integer registers. CSRRW reads the old value of the CSR,
  * zero-extends the value to XLEN bits, and then writes it to register rd.
@@ -183,16 +411,21 @@ static uint32_t csr_csrrw(riscv_t *rv, uint32_t csr, uint32_t val)
 #endif
 
     *c = val;
+    csr_hpm_update(rv, csr);
+    csr_vector_update(rv, csr);
+    csr_intr_update(rv, csr);
 
 #if !RV32_HAS(JIT) && RV32_HAS(SYSTEM)
     /*
-     * guestOS's process might have same VA, so block map cannot be reused
+     * guestOS's process might have same VA, so the blocks of non-global pages
+     * cannot be reused
      *
-     * Instead of calling block_map_clear() directly here,
-     * a flag is set to indicate that the block map should be cleared,
-     * and the clearing occurs after the corresponding 'code' of RVOP
+     * Instead of calling block_map_flush() directly here,
+     * a flag is set to indicate that the block map should be flushed,
+     * and the flushing occurs after the corresponding 'code' of RVOP
      * has executed. This prevents the 'code' of RVOP from potentially
-     * accessing a NULL ir.
+     * accessing a NULL ir. Within a trap handler, it waits for the sret,
+     * since the block of the instruction which trapped is still running.
      */
     if (c == &rv->csr_satp)
         need_clear_block_map = true;
@@ -215,6 +448,9 @@ static uint32_t csr_csrrs(riscv_t *rv, uint32_t csr, uint32_t val)
 #endif
 
     *c |= val;
+    csr_hpm_update(rv, csr);
+    csr_vector_update(rv, csr);
+    csr_intr_update(rv, csr);
 
     return out;
 }
@@ -236,6 +472,9 @@ static uint32_t csr_csrrc(riscv_t *rv, uint32_t csr, uint32_t val)
 #endif
 
     *c &= ~val;
+    csr_hpm_update(rv, csr);
+    csr_vector_update(rv, csr);
+    csr_intr_update(rv, csr);
 
     return out;
 }
@@ -261,6 +500,7 @@ void rv_debug(riscv_t *rv)
         return;
 
     breakpoint_map_destroy(rv->breakpoint_map);
+    rv->breakpoint_map = NULL;
     gdbstub_close(&rv->gdbstub);
 }
 #endif /* RV32_HAS(GDBSTUB) */
@@ -326,6 +566,66 @@ static block_t *block_find(const block_map_t *map, const uint32_t addr)
     }
     return NULL;
 }
+
+#if RV32_HAS(SYSTEM)
+/* whether the block was translated from global pages, see block_map_flush() */
+static bool block_is_global(riscv_t *rv, const block_t *block)
+{
+    if (!rv->csr_satp)
+        return false;
+
+    uint32_t level;
+    const pte_t *pte = mmu_walk(rv, block->pc_start, &level);
+    if (!pte || !(*pte & PTE_G))
+        return false;
+    const uint32_t last = block->pc_end - 1;
+    if (!((block->pc_start ^ last) >> RV_PG_SHIFT))
+        return true;
+    pte = mmu_walk(rv, last, &level);
+    return pte && (*pte & PTE_G);
+}
+
+/* Drop the blocks of the address space left by a write to satp. The ones
+ * translated from global pages stay, since those pages are mapped the same way
+ * in every address space. They are rehashed and unlinked from one another, as
+ * their links might lead to the dropped blocks.
+ */
+static void block_map_flush(riscv_t *rv)
+{
+    block_map_t *map = &rv->block_map;
+    block_t **blocks = map->map;
+
+    map->map = calloc(map->block_capacity, sizeof(struct block *));
+    assert(map->map);
+    map->size = 0;
+
+    for (uint32_t i = 0; i < map->block_capacity; i++) {
+        block_t *block = blocks[i];
+        if (!block)
+            continue;
+
+        if (!block->global) {
+            for (rv_insn_t *ir = block->ir_head, *next; ir; ir = next) {
+                next = ir->next;
+                free(ir->fuse);
+                free(ir->branch_table);
+                mpool_free(rv->block_ir_mp, ir);
+            }
+            mpool_free(rv->block_mp, block);
+            continue;
+        }
+
+        for (rv_insn_t *ir = block->ir_head; ir; ir = ir->next) {
+            ir->branch_taken = ir->branch_untaken = NULL;
+            if (ir->branch_table)
+                memset(ir->branch_table->PC, -1,
+                       sizeof(uint32_t) * HISTORY_SIZE);
+        }
+        block_insert(map, block);
+    }
+    free(blocks);
+}
+#endif
 #endif
 
 #if !RV32_HAS(EXT_C)
@@ -374,11 +674,55 @@ extern void emu_update_uart_interrupts(riscv_t *rv);
 static uint32_t peripheral_update_ctr = 64;
 #endif
 
-/* Interpreter-based execution path */
-#define RVOP(inst, code, asm)                                               \
+/* the shift by an immediate of SLLI, SRLI and SRAI, alone or fused */
+FORCE_INLINE void shift_func(riscv_t *rv, const rv_insn_t *ir)
+{
+    switch (ir->opcode) {
+    case rv_insn_slli:
+        rv->X[ir->rd] = rv->X[ir->rs1] << (ir->imm & 0x1f);
+        break;
+    case rv_insn_srli:
+        rv->X[ir->rd] = rv->X[ir->rs1] >> (ir->imm & 0x1f);
+        break;
+    case rv_insn_srai:
+        rv->X[ir->rd] = ((int32_t) rv->X[ir->rs1]) >> (ir->imm & 0x1f);
+        break;
+    default:
+        __UNREACHABLE;
+        break;
+    }
+}
+
+/* Interpreter-based execution path
+ *
+ * Each IR is emulated by a function which tail-calls the one of the next IR.
+ * With ENABLE_THREADED_CODE, the handlers are the labeled blocks of a single
+ * dispatch function instead, which jump to the label of the next IR held in
+ * its impl member, so that no compiler support for tail calls is needed. The
+ * handlers are written once with RVOP_BEGIN and RVOP_DISPATCH for both.
+ */
+#if RV32_HAS(THREADED_CODE)
+#define RVOP_BEGIN(inst) do_##inst:
+/* the labels of a handler are local to its block, not to the function */
+#define RVOP_LOCAL_LABELS __label__ nextop, end_op;
+#define RVOP_DISPATCH(next) \
+    do {                    \
+        ir = (next);        \
+        goto *ir->impl;     \
+    } while (0)
+#else
+#define RVOP_BEGIN(inst)                                                    \
     static bool do_##inst(riscv_t *rv, const rv_insn_t *ir, uint64_t cycle, \
-                          uint32_t PC)                                      \
+                          uint32_t PC)
+#define RVOP_LOCAL_LABELS
+#define RVOP_DISPATCH(next) \
+    MUST_TAIL return (next)->impl(rv, (next), cycle, PC)
+#endif
+
+#define RVOP(inst, code, asm)                                               \
+    RVOP_BEGIN(inst)                                                        \
     {                                                                       \
+        RVOP_LOCAL_LABELS                                                   \
         IIF(RV32_HAS(SYSTEM))(ctr++;, ) cycle++;                            \
         code;                                                               \
         IIF(RV32_HAS(SYSTEM))                                               \
@@ -389,8 +733,8 @@ static uint32_t peripheral_update_ctr = 64;
             }, ) nextop : PC += __rv_insn_##inst##_len;                     \
         IIF(RV32_HAS(SYSTEM))                                               \
         (IIF(RV32_HAS(JIT))(                                                \
-             , if (unlikely(need_clear_block_map)) {                        \
-                 block_map_clear(rv);                                       \
+             , if (unlikely(need_clear_block_map) && !rv->is_trapped) {     \
+                 block_map_flush(rv);                                       \
                  need_clear_block_map = false;                              \
                  rv->csr_cycle = cycle;                                     \
                  rv->PC = PC;                                               \
@@ -398,22 +742,302 @@ static uint32_t peripheral_update_ctr = 64;
              }), );                                                         \
         if (unlikely(RVOP_NO_NEXT(ir)))                                     \
             goto end_op;                                                    \
-        const rv_insn_t *next = ir->next;                                   \
-        MUST_TAIL return next->impl(rv, next, cycle, PC);                   \
+        RVOP_DISPATCH(ir->next);                                            \
     end_op:                                                                 \
         rv->csr_cycle = cycle;                                              \
         rv->PC = PC;                                                        \
         return true;                                                        \
     }
 
-#include "rv32_template.c"
-#undef RVOP
+#if RV32_HAS(PLUGIN) || RV32_HAS(GDBSTUB)
+bool insn_mem_operand(const riscv_t *rv,
+                      const rv_insn_t *ir,
+                      mem_operand_fn_t access,
+                      void *arg)
+{
+    uint32_t base = rv->X[ir->rs1], size;
+    bool is_store;
+
+    switch (ir->opcode) {
+    case rv_insn_lb:
+    case rv_insn_lbu:
+        size = 1;
+        is_store = false;
+        break;
+    case rv_insn_lh:
+    case rv_insn_lhu:
+        size = 2;
+        is_store = false;
+        break;
+    case rv_insn_lw:
+#if RV32_HAS(EXT_F)
+    case rv_insn_flw:
+#endif
+#if RV32_HAS(EXT_A)
+    case rv_insn_lrw:
+#endif
+        size = 4;
+        is_store = false;
+        break;
+    case rv_insn_sb:
+        size = 1;
+        is_store = true;
+        break;
+    case rv_insn_sh:
+        size = 2;
+        is_store = true;
+        break;
+    case rv_insn_sw:
+#if RV32_HAS(EXT_F)
+    case rv_insn_fsw:
+#endif
+#if RV32_HAS(EXT_A)
+    /* read-modify-write operations are reported as stores */
+    case rv_insn_scw:
+    case rv_insn_amoswapw:
+    case rv_insn_amoaddw:
+    case rv_insn_amoxorw:
+    case rv_insn_amoandw:
+    case rv_insn_amoorw:
+    case rv_insn_amominw:
+    case rv_insn_amomaxw:
+    case rv_insn_amominuw:
+    case rv_insn_amomaxuw:
+#endif
+        size = 4;
+        is_store = true;
+        break;
+#if RV32_HAS(EXT_C)
+    case rv_insn_clw:
+#if RV32_HAS(EXT_F)
+    case rv_insn_cflw:
+#endif
+        size = 4;
+        is_store = false;
+        break;
+    case rv_insn_csw:
+#if RV32_HAS(EXT_F)
+    case rv_insn_cfsw:
+#endif
+        size = 4;
+        is_store = true;
+        break;
+    case rv_insn_clwsp:
+#if RV32_HAS(EXT_F)
+    case rv_insn_cflwsp:
+#endif
+        base = rv->X[rv_reg_sp];
+        size = 4;
+        is_store = false;
+        break;
+    case rv_insn_cswsp:
+#if RV32_HAS(EXT_F)
+    case rv_insn_cfswsp:
+#endif
+        base = rv->X[rv_reg_sp];
+        size = 4;
+        is_store = true;
+        break;
+#endif
+#if RV32_HAS(Zcb)
+    case rv_insn_clbu:
+        size = 1;
+        is_store = false;
+        break;
+    case rv_insn_clhu:
+    case rv_insn_clh:
+        size = 2;
+        is_store = false;
+        break;
+    case rv_insn_csb:
+        size = 1;
+        is_store = true;
+        break;
+    case rv_insn_csh:
+        size = 2;
+        is_store = true;
+        break;
+#endif
+#if RV32_HAS(Zcmp)
+    /* the register list, stored right below sp or loaded from the top of
+     * the stack frame
+     */
+    case rv_insn_cmpush:
+        if (access)
+            access(arg, rv->X[rv_reg_sp] - ir->imm2 * 4, ir->imm2 * 4, true);
+        return true;
+    case rv_insn_cmpop:
+    case rv_insn_cmpopret:
+    case rv_insn_cmpopretz:
+        if (access)
+            access(arg, rv->X[rv_reg_sp] + ir->imm - ir->imm2 * 4,
+                   ir->imm2 * 4, false);
+        return true;
+#endif
+#if RV32_HAS(Zicboz)
+    case rv_insn_cbozero:
+        if (access)
+            access(arg, base & ~(CBO_BLOCK_SIZE - 1U), CBO_BLOCK_SIZE, true);
+        return true;
+#endif
+#if RV32_HAS(Zve32x)
+    case rv_insn_vle:
+    case rv_insn_vlse:
+    case rv_insn_vlxe:
+    case rv_insn_vse:
+    case rv_insn_vsse:
+    case rv_insn_vsxe:
+        if (access)
+            vector_mem_operand(rv, ir, access, arg);
+        return true;
+#endif
+    default:
+        return false;
+    }
 
-/* multiple LUI */
-static bool do_fuse1(riscv_t *rv,
+    if (access)
+        access(arg, base + ir->imm, size, is_store);
+    return true;
+}
+#endif
+
+#if RV32_HAS(GDBSTUB)
+typedef struct {
+    const riscv_t *rv;
+    bool hit;
+} watch_check_t;
+
+/* whether the access of @size bytes at @vaddr hits a watchpoint of GDB, which
+ * ends the visit of the accesses of the instruction
+ */
+static bool debug_watch_access(void *arg,
+                               uint32_t vaddr,
+                               uint32_t size,
+                               bool is_store)
+{
+    watch_check_t *check = arg;
+    const riscv_t *rv = check->rv;
+    for (uint32_t i = 0; i < rv->n_watchpoints; i++) {
+        const watchpoint_t *wp = &rv->watchpoints[i];
+        if (!(is_store ? wp->write : wp->read))
+            continue;
+        if ((uint64_t) vaddr < (uint64_t) wp->addr + WATCHPOINT_LEN &&
+            (uint64_t) wp->addr < (uint64_t) vaddr + size)
+            return check->hit = true;
+    }
+    return false;
+}
+
+/* check the memory operands of @ir against the watchpoints of GDB */
+static bool debug_watch_hit(const riscv_t *rv, const rv_insn_t *ir)
+{
+    watch_check_t check = {.rv = rv, .hit = false};
+    insn_mem_operand(rv, ir, debug_watch_access, &check);
+    return check.hit;
+}
+
+/* whether an enabled breakpoint of GDB sits at @pc */
+static inline bool debug_breakpoint_hit(const riscv_t *rv, uint32_t pc)
+{
+    if (!rv->breakpoint_map)
+        return false;
+    const breakpoint_t *bp = breakpoint_map_find(rv->breakpoint_map, pc);
+    return bp && bp->enabled;
+}
+#endif
+
+bool rv_probe(riscv_t *rv, const rv_insn_t *ir)
+{
+    /* instruction probe, which instruments the IR following it */
+    if (!ir->imm) {
+#if RV32_HAS(GDBSTUB)
+        /* a breakpoint amid the block */
+        if (debug_breakpoint_hit(rv, ir->pc))
+            goto debug_stop;
+        /* stop in front of the access, as the hardware watchpoints do */
+        if (rv->n_watchpoints && debug_watch_hit(rv, ir->next))
+            goto debug_stop;
+#endif
+#if RV32_HAS(PLUGIN)
+        /* the probes may be there for the watchpoints only */
+        if (rv->plugins)
+            plugin_insn_exec(rv, ir->next);
+#endif
+        goto check_halt;
+    }
+
+#if RV32_HAS(GDBSTUB)
+    /* a block starting at a breakpoint probes it */
+    if (debug_breakpoint_hit(rv, ir->pc))
+        goto debug_stop;
+#endif
+
+    /* block probe, where imm2 is the BBV identifier of the block if any */
+    if (ir->imm2 && !bbv_account(rv, ir->imm2, ir->imm, ir->pc))
+        return false;
+#if RV32_HAS(FUZZ)
+    if (rv->fuzz && !fuzz_block(rv, ir->pc))
+        return false;
+#endif
+#if RV32_HAS(SYSTEM)
+    if (rv->bootprof)
+        bootprof_block(rv, ir->pc, rv->csr_cycle);
+#endif
+#if RV32_HAS(PLUGIN)
+    if (plugin_set_callbacks(rv->plugins) & PLUGIN_CB_BLOCK_EXEC)
+        plugin_block_exec(rv->plugins, ir->pc, ir->imm);
+#endif
+
+check_halt:
+    /* a plugin may halt the emulation from its callback */
+    if (unlikely(rv->halt)) {
+        rv->PC = ir->pc;
+        return false;
+    }
+    return true;
+
+#if RV32_HAS(GDBSTUB)
+debug_stop:
+    rv->debug_stop = true;
+    rv->PC = ir->pc;
+    return false;
+#endif
+}
+
+#if RV32_HAS(THREADED_CODE)
+static const void *const *dispatch_table;
+
+/* Emulate the IRs from @ir on, as far as they chain. Called without an IR, it
+ * publishes the labels of the handlers as dispatch_table instead.
+ */
+static bool dispatch(riscv_t *rv,
                      const rv_insn_t *ir,
                      uint64_t cycle,
                      uint32_t PC)
+{
+    /* clang-format off */
+    static const void *const labels[] = {
+#define _(inst, can_branch, insn_len, translatable, reg_mask) [rv_insn_##inst] = &&do_##inst,
+        RV_INSN_LIST
+#undef _
+#define _(inst) [rv_insn_##inst] = &&do_##inst,
+        FUSE_INSN_LIST
+#undef _
+    };
+    /* clang-format on */
+
+    if (unlikely(!ir)) {
+        dispatch_table = labels;
+        return true;
+    }
+    goto *ir->impl;
+#endif
+
+#include "rv32_template.c"
+#undef RVOP
+
+/* multiple LUI */
+RVOP_BEGIN(fuse1)
 {
     cycle += ir->imm2;
     opcode_fuse_t *fuse = ir->fuse;
@@ -425,15 +1049,11 @@ static bool do_fuse1(riscv_t *rv,
         rv->PC = PC;
         return true;
     }
-    const rv_insn_t *next = ir->next;
-    MUST_TAIL return next->impl(rv, next, cycle, PC);
+    RVOP_DISPATCH(ir->next);
 }
 
 /* LUI + ADD */
-static bool do_fuse2(riscv_t *rv,
-                     const rv_insn_t *ir,
-                     uint64_t cycle,
-                     uint32_t PC)
+RVOP_BEGIN(fuse2)
 {
     cycle += 2;
     rv->X[ir->rd] = ir->imm;
@@ -444,15 +1064,11 @@ static bool do_fuse2(riscv_t *rv,
         rv->PC = PC;
         return true;
     }
-    const rv_insn_t *next = ir->next;
-    MUST_TAIL return next->impl(rv, next, cycle, PC);
+    RVOP_DISPATCH(ir->next);
 }
 
 /* multiple SW */
-static bool do_fuse3(riscv_t *rv,
-                     const rv_insn_t *ir,
-                     uint64_t cycle,
-                     uint32_t PC)
+RVOP_BEGIN(fuse3)
 {
     cycle += ir->imm2;
     opcode_fuse_t *fuse = ir->fuse;
@@ -471,15 +1087,11 @@ static bool do_fuse3(riscv_t *rv,
         rv->PC = PC;
         return true;
     }
-    const rv_insn_t *next = ir->next;
-    MUST_TAIL return next->impl(rv, next, cycle, PC);
+    RVOP_DISPATCH(ir->next);
 }
 
 /* multiple LW */
-static bool do_fuse4(riscv_t *rv,
-                     const rv_insn_t *ir,
-                     uint64_t cycle,
-                     uint32_t PC)
+RVOP_BEGIN(fuse4)
 {
     cycle += ir->imm2;
     opcode_fuse_t *fuse = ir->fuse;
@@ -498,15 +1110,11 @@ static bool do_fuse4(riscv_t *rv,
         rv->PC = PC;
         return true;
     }
-    const rv_insn_t *next = ir->next;
-    MUST_TAIL return next->impl(rv, next, cycle, PC);
+    RVOP_DISPATCH(ir->next);
 }
 
 /* multiple shift immediate */
-static bool do_fuse5(riscv_t *rv,
-                     const rv_insn_t *ir,
-                     uint64_t cycle,
-                     uint32_t PC)
+RVOP_BEGIN(fuse5)
 {
     cycle += ir->imm2;
     opcode_fuse_t *fuse = ir->fuse;
@@ -518,10 +1126,35 @@ static bool do_fuse5(riscv_t *rv,
         rv->PC = PC;
         return true;
     }
-    const rv_insn_t *next = ir->next;
-    MUST_TAIL return next->impl(rv, next, cycle, PC);
+    RVOP_DISPATCH(ir->next);
+}
+
+/* block or instruction entry instrumentation, which neither retires an
+ * instruction nor advances PC
+ */
+RVOP_BEGIN(probe)
+{
+    /* let the probe see the instructions retired so far in this chain */
+    rv->csr_cycle = cycle;
+    if (unlikely(!rv_probe(rv, ir))) {
+        rv->PC = PC;
+        return true;
+    }
+    RVOP_DISPATCH(ir->next);
+}
+
+#if RV32_HAS(THREADED_CODE)
+}
+
+/* publish the labels before any block is translated */
+__attribute__((constructor)) static void dispatch_init(void)
+{
+    dispatch(NULL, NULL, 0, 0);
 }
 
+/* emulate the IRs from @ir on, as far as they chain */
+#define RVOP_RUN(rv, ir) dispatch(rv, ir, (rv)->csr_cycle, (rv)->PC)
+#else
 /* clang-format off */
 static const void *dispatch_table[] = {
     /* RV32 instructions */
@@ -535,6 +1168,9 @@ static const void *dispatch_table[] = {
 };
 /* clang-format on */
 
+#define RVOP_RUN(rv, ir) (ir)->impl(rv, ir, (rv)->csr_cycle, (rv)->PC)
+#endif
+
 FORCE_INLINE bool insn_is_branch(uint8_t opcode)
 {
     switch (opcode) {
@@ -584,6 +1220,10 @@ FORCE_INLINE bool insn_is_unconditional_branch(uint8_t opcode)
     case rv_insn_cjal:
     case rv_insn_cjr:
     case rv_insn_cebreak:
+#endif
+#if RV32_HAS(Zcmp)
+    case rv_insn_cmpopretz:
+    case rv_insn_cmpopret:
 #endif
         return true;
     default:
@@ -613,6 +1253,10 @@ FORCE_INLINE bool insn_is_indirect_branch(uint8_t opcode)
 #if RV32_HAS(EXT_C)
     case rv_insn_cjalr:
     case rv_insn_cjr:
+#endif
+#if RV32_HAS(Zcmp)
+    case rv_insn_cmpopretz:
+    case rv_insn_cmpopret:
 #endif
         return true;
     default:
@@ -853,11 +1497,90 @@ static void optimize_constant(riscv_t *rv UNUSED, block_t *block)
         ((constopt_func_t) constopt_table[ir->opcode])(ir, &info);
 }
 
+/* Prepend a probe IR to the block. The probe takes over the address of the
+ * first instruction, so that it is reached by block chaining and by the
+ * branch history table as well.
+ */
+static void block_insert_probe(riscv_t *rv, block_t *block, uint32_t n_insn)
+{
+    rv_insn_t *ir = mpool_calloc(rv->block_ir_mp);
+    ir->opcode = rv_insn_probe;
+    ir->impl = dispatch_table[ir->opcode];
+    ir->pc = block->pc_start;
+    ir->imm = n_insn;
+    ir->imm2 = rv->bbv ? bbv_block_id(rv->bbv, block->pc_start) : 0;
+    ir->next = block->ir_head;
+    block->ir_head = ir;
+    block->n_insn++;
+}
+
+#if RV32_HAS(GDBSTUB)
+/* whether a breakpoint of GDB, even a disabled one, sits amid the block */
+static bool block_has_breakpoint(const riscv_t *rv, const block_t *block)
+{
+    if (!rv->breakpoint_map)
+        return false;
+    for (const rv_insn_t *ir = block->ir_head->next; ir; ir = ir->next) {
+        if (breakpoint_map_find(rv->breakpoint_map, ir->pc))
+            return true;
+    }
+    return false;
+}
+#endif
+
+#if RV32_HAS(PLUGIN) || RV32_HAS(GDBSTUB)
+/* Insert an instruction probe, whose imm is 0, in front of every IR of the
+ * block if @all is set, else in front of those accessing memory if @mem is
+ * set and in front of those at a breakpoint of GDB past the head of the block.
+ * The block must not be fused since each IR stands for exactly one guest
+ * instruction here.
+ */
+static void block_insert_insn_probes(riscv_t *rv,
+                                     block_t *block,
+                                     bool all,
+                                     bool mem)
+{
+    const uint32_t n_insn = block->n_insn;
+    rv_insn_t **link = &block->ir_head;
+    uint32_t n_probes = 0;
+
+    for (uint32_t i = 0; i < n_insn; i++) {
+        rv_insn_t *target = *link;
+        bool probe = all || (mem && insn_mem_operand(rv, target, NULL, NULL));
+#if RV32_HAS(GDBSTUB)
+        probe |= i && rv->breakpoint_map &&
+                 breakpoint_map_find(rv->breakpoint_map, target->pc);
+#endif
+        if (!probe) {
+            link = &target->next;
+            continue;
+        }
+        rv_insn_t *ir = mpool_calloc(rv->block_ir_mp);
+        ir->opcode = rv_insn_probe;
+        ir->impl = dispatch_table[ir->opcode];
+        ir->pc = target->pc;
+        ir->next = target;
+        *link = ir;
+        link = &target->next;
+        n_probes++;
+    }
+    block->n_insn += n_probes;
+}
+#endif
+
 static block_t *prev = NULL;
 static block_t *block_find_or_translate(riscv_t *rv)
 {
 #if !RV32_HAS(JIT)
     block_map_t *map = &rv->block_map;
+#if RV32_HAS(SYSTEM)
+    /* satp was written by a trap handler, see csr_csrrw() */
+    if (unlikely(need_clear_block_map)) {
+        block_map_flush(rv);
+        need_clear_block_map = false;
+        prev = NULL;
+    }
+#endif
     /* lookup the next block in the block map */
     block_t *next_blk = block_find(map, rv->PC);
 #else
@@ -880,25 +1603,89 @@ static block_t *block_find_or_translate(riscv_t *rv)
         prev = NULL;
     }
 #endif
+    const uint64_t start = rv->warmup ? warmup_clock() : 0;
     /* allocate a new block */
     next_blk = block_alloc(rv);
 
     block_translate(rv, next_blk);
+    /* number of guest instructions, as fusion merges IRs afterwards */
+    const uint32_t n_insn = next_blk->n_insn;
+#if RV32_HAS(PLUGIN)
+    const uint32_t plugin_cbs = plugin_set_callbacks(rv->plugins);
+    if (plugin_cbs & PLUGIN_CB_BLOCK_TRANSLATE)
+        plugin_block_translate(rv->plugins, next_blk->pc_start,
+                               next_blk->pc_end, n_insn);
+#endif
+    rv_hpm_count(rv, RV_HPM_BLOCK_TRANSLATE, 1);
+    /* a block is translated right before its first execution */
+    if (rv->coverage)
+        coverage_record(rv->coverage, next_blk->pc_start, next_blk->pc_end);
 
-#if RV32_HAS(JIT) && RV32_HAS(SYSTEM)
+#if RV32_HAS(SYSTEM)
     /*
      * May be an ifetch fault which changes satp, Do not do this
      * in "block_alloc()"
      */
+#if RV32_HAS(JIT)
     next_blk->satp = rv->csr_satp;
+#else
+    next_blk->global = block_is_global(rv, next_blk);
+#endif
 #endif
 
     optimize_constant(rv, next_blk);
+#if RV32_HAS(PLUGIN)
+    const bool plugin_probes =
+        plugin_cbs & (PLUGIN_CB_INSN_EXEC | PLUGIN_CB_MEM_ACCESS);
+#else
+    const bool plugin_probes = false;
+#endif
+#if RV32_HAS(GDBSTUB)
+    const bool watch_probes = rv->watch_probes;
+    /* the breakpoints amid the block are probed in place, so that every
+     * block still ends on a branch for the JIT compilers
+     */
+    const bool bp_probes = block_has_breakpoint(rv, next_blk);
+#else
+    const bool watch_probes = false, bp_probes = false;
+#endif
+    const bool insn_probes UNUSED = plugin_probes || watch_probes || bp_probes;
 #if RV32_HAS(MOP_FUSION)
-    /* macro operation fusion */
-    match_pattern(rv, next_blk);
+    /* macro operation fusion, unless single instructions are instrumented */
+    if (!insn_probes && !PRIV(rv)->no_fusion)
+        match_pattern(rv, next_blk);
 #endif
 
+    bool block_probe = rv->bbv;
+#if RV32_HAS(PLUGIN) || RV32_HAS(GDBSTUB)
+    /* the watchpoints need the memory accesses to be instrumented only */
+    if (insn_probes)
+        block_insert_insn_probes(rv, next_blk, plugin_probes, watch_probes);
+#endif
+#if RV32_HAS(PLUGIN)
+    block_probe |= plugin_cbs & PLUGIN_CB_BLOCK_EXEC;
+#endif
+#if RV32_HAS(GDBSTUB)
+    block_probe |= rv->breakpoint_map &&
+                   breakpoint_map_find(rv->breakpoint_map, next_blk->pc_start);
+#endif
+#if RV32_HAS(FUZZ)
+    block_probe |= !!rv->fuzz;
+#endif
+#if RV32_HAS(SYSTEM)
+    block_probe |=
+        rv->bootprof && bootprof_watched(rv->bootprof, next_blk->pc_start);
+#endif
+    if (block_probe)
+        block_insert_probe(rv, next_blk, n_insn);
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+    /* the code compiled ahead of time runs no probes */
+    if (rv->aot && !block_probe && !insn_probes)
+        aot_attach(rv, next_blk);
+#endif
+    if (rv->warmup)
+        warmup_account(rv->warmup, WARMUP_TRANSLATE, start, n_insn, 0);
+
 #if !RV32_HAS(JIT)
     /* insert the block into block map */
     block_insert(&rv->block_map, next_blk);
@@ -998,30 +1785,29 @@ static bool runtime_profiler(riscv_t *rv, block_t *block)
 #endif
 
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
-static bool rv_has_plic_trap(riscv_t *rv)
-{
-    return ((rv->csr_sstatus & SSTATUS_SIE || !rv->priv_mode) &&
-            (rv->csr_sip & rv->csr_sie));
-}
-
 static void rv_check_interrupt(riscv_t *rv)
 {
     vm_attr_t *attr = PRIV(rv);
-    if (peripheral_update_ctr-- == 0) {
+    if (unlikely(peripheral_update_ctr-- == 0)) {
         peripheral_update_ctr = 64;
 
+        if (rv->replay)
+            replay_uart(rv);
         u8250_check_ready(PRIV(rv)->uart);
         if (PRIV(rv)->uart->in_ready)
             emu_update_uart_interrupts(rv);
     }
 
-    if (ctr > attr->timer)
-        rv->csr_sip |= RV_INT_STI;
-    else
-        rv->csr_sip &= ~RV_INT_STI;
+    /* STIP follows the timer, hence its deadline is the one thing polled */
+    const uint32_t stip = get_time(rv) > attr->timer ? RV_INT_STI : 0;
+    if (unlikely((rv->csr_sip & RV_INT_STI) != stip)) {
+        rv->csr_sip ^= RV_INT_STI;
+        rv_update_intr_pending(rv);
+    }
 
-    if (rv_has_plic_trap(rv)) {
-        uint32_t intr_applicable = rv->csr_sip & rv->csr_sie;
+    if (unlikely(rv->intr_pending)) {
+        uint32_t intr_applicable = rv->csr_sip & rv->csr_sie &
+                                   (SIP_SSIP | SIP_STIP | SIP_SEIP);
         uint8_t intr_idx = ilog2(intr_applicable);
         switch (intr_idx) {
         case (SUPERVISOR_SW_INTR & 0xf):
@@ -1040,6 +1826,17 @@ static void rv_check_interrupt(riscv_t *rv)
 }
 #endif
 
+#if RV32_HAS(GDBSTUB)
+/* a breakpoint, a watchpoint or an interrupt from GDB hands the control back
+ * to the debugger
+ */
+static inline bool debug_should_stop(riscv_t *rv)
+{
+    return rv->debug_stop ||
+           __atomic_load_n(&rv->is_interrupted, __ATOMIC_RELAXED);
+}
+#endif
+
 void rv_step(void *arg)
 {
     assert(arg);
@@ -1052,12 +1849,31 @@ void rv_step(void *arg)
     const uint64_t cycles_target = rv->csr_cycle + cycles;
 
     /* loop until hitting the cycle target */
-    while (rv->csr_cycle < cycles_target && !rv->halt) {
+    while (rv->csr_cycle < cycles_target &&
+           !__atomic_load_n(&rv->halt, __ATOMIC_RELAXED)) {
+#if RV32_HAS(GDBSTUB)
+        if (unlikely(debug_should_stop(rv)))
+            break;
+#endif
+#if !RV32_HAS(SYSTEM)
+        /* check the previous dispatch against the reference interpreter */
+        if (unlikely(rv->lockstep))
+            lockstep_end(rv);
+#endif
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
         /* check for any interrupt after every block emulation */
         rv_check_interrupt(rv);
 #endif
 
+#if RV32_HAS(FUZZ)
+        /* the fuzz target returns to an address without code */
+        if (unlikely(rv->PC == FUZZ_RETURN_PC) && rv->fuzz) {
+            fuzz_return(rv);
+            prev = NULL;
+            break;
+        }
+#endif
+
         if (prev && prev->pc_start != last_pc) {
             /* update previous block */
 #if !RV32_HAS(JIT)
@@ -1090,7 +1906,7 @@ void rv_step(void *arg)
              */
 
 #if RV32_HAS(BLOCK_CHAINING)
-        if (prev
+        if (prev && !attr->no_chaining
 #if RV32_HAS(JIT) && RV32_HAS(SYSTEM)
             && prev->satp == rv->csr_satp
 #endif
@@ -1109,6 +1925,10 @@ void rv_step(void *arg)
                 }
             }
         }
+#endif
+#if !RV32_HAS(SYSTEM)
+        if (unlikely(rv->lockstep))
+            lockstep_begin(rv, block);
 #endif
         last_pc = rv->PC;
 #if RV32_HAS(JIT)
@@ -1119,8 +1939,10 @@ void rv_step(void *arg)
             prev = NULL;
             continue;
         } /* check if invoking times of t1 generated code exceed threshold */
-        else if (!block->compiled && block->n_invoke >= THRESHOLD) {
+        else if (!block->compiled && block->n_invoke >= THRESHOLD &&
+                 attr->engine == RV_ENGINE_T2C) {
             block->compiled = true;
+            rv_hpm_count(rv, RV_HPM_T2_COMPILE, 1);
             queue_entry_t *entry = malloc(sizeof(queue_entry_t));
             entry->block = block;
             pthread_mutex_lock(&rv->wait_queue_lock);
@@ -1142,12 +1964,22 @@ void rv_step(void *arg)
             prev = NULL;
             continue;
         } /* check if the execution path is potential hotspot */
-        if (block->translatable
+        if (block->translatable && attr->engine != RV_ENGINE_INTERP
 #if !RV32_HAS(ARCH_TEST)
             && runtime_profiler(rv, block)
 #endif
         ) {
-            jit_translate(rv, block);
+            if (unlikely(rv->warmup)) {
+                const uint64_t start = warmup_clock();
+                const uint64_t n_insn = state->n_insn, n_bytes = state->n_bytes;
+                jit_translate(rv, block);
+                warmup_account(rv->warmup, WARMUP_T1, start,
+                               state->n_insn - n_insn,
+                               state->n_bytes - n_bytes);
+            } else {
+                jit_translate(rv, block);
+            }
+            rv_hpm_count(rv, RV_HPM_T1_COMPILE, 1);
             ((exec_block_func_t) state->buf)(
                 rv, (uintptr_t) (state->buf + block->offset));
             prev = NULL;
@@ -1158,7 +1990,7 @@ void rv_step(void *arg)
 #endif
         /* execute the block by interpreter */
         const rv_insn_t *ir = block->ir_head;
-        if (unlikely(!ir->impl(rv, ir, rv->csr_cycle, rv->PC))) {
+        if (unlikely(!RVOP_RUN(rv, ir))) {
             /* block should not be extended if execption handler invoked */
             prev = NULL;
             break;
@@ -1169,13 +2001,9 @@ void rv_step(void *arg)
 #endif
         prev = block;
     }
-
-#ifdef __EMSCRIPTEN__
-    if (rv_has_halted(rv)) {
-        emscripten_cancel_main_loop();
-        rv_delete(rv); /* clean up and reuse memory */
-        rv_log_info("RISC-V emulator is destroyed");
-    }
+#if !RV32_HAS(SYSTEM)
+    if (unlikely(rv->lockstep))
+        lockstep_end(rv);
 #endif
 }
 
@@ -1213,18 +2041,275 @@ retranslate:
     ir.impl = dispatch_table[ir.opcode];
     ir.pc = rv->PC;
     ir.next = NULL;
-    ir.impl(rv, &ir, rv->csr_cycle, rv->PC);
+    RVOP_RUN(rv, &ir);
     return;
 }
 
+#if RV32_HAS(GDBSTUB)
+/* Drop every translated block, so that the blocks are translated again with
+ * the breakpoints and the watchpoints GDB has set meanwhile.
+ */
+static void block_flush(riscv_t *rv)
+{
+    prev = NULL;
+#if !RV32_HAS(JIT)
+    block_map_clear(rv);
+#else
+#if RV32_HAS(T2C)
+    /* the background compilation must not pick up a block being freed */
+    pthread_mutex_lock(&rv->cache_lock);
+    pthread_mutex_lock(&rv->wait_queue_lock);
+    queue_entry_t *entry, *safe_entry;
+    list_for_each_entry_safe (entry, safe_entry, &rv->wait_queue, list) {
+        list_del_init(&entry->list);
+        free(entry);
+    }
+    pthread_mutex_unlock(&rv->wait_queue_lock);
+#endif
+    block_t *block, *safe_block;
+    list_for_each_entry_safe (block, safe_block, &rv->block_list, list) {
+        for (rv_insn_t *ir = block->ir_head, *next_ir; ir; ir = next_ir) {
+            next_ir = ir->next;
+            free(ir->fuse);
+            free(ir->branch_table);
+            mpool_free(rv->block_ir_mp, ir);
+        }
+        list_del_init(&block->list);
+        mpool_free(rv->block_mp, block);
+    }
+    cache_free(rv->block_cache);
+    rv->block_cache = cache_create(BLOCK_MAP_CAPACITY_BITS);
+    assert(rv->block_cache);
+    jit_state_flush(rv);
+#if RV32_HAS(T2C)
+    pthread_mutex_unlock(&rv->cache_lock);
+#endif
+#endif
+}
+
+void rv_debug_cont(riscv_t *rv)
+{
+    /* the blocks miss a breakpoint or code written by GDB, or the probes of
+     * the watchpoints are missing or no longer wanted
+     */
+    const bool watch_probes = rv->n_watchpoints > 0;
+    if (rv->debug_flush || watch_probes != rv->watch_probes) {
+        rv->debug_flush = false;
+        rv->watch_probes = watch_probes;
+        block_flush(rv);
+    }
+
+    /* chain the blocks rather than dispatch an instruction at a time */
+    rv->debug_mode = false;
+    while (!rv->halt && !debug_should_stop(rv))
+        rv_step(rv);
+    rv->debug_mode = true;
+    rv->debug_stop = false;
+
+    /* a probe may have stopped amid a block, which must not be chained */
+    prev = NULL;
+}
+#endif
+
+#if !RV32_HAS(SYSTEM)
+/* whether the effect of an instruction reaches beyond registers and memory */
+static bool insn_is_system(uint8_t opcode)
+{
+    switch (opcode) {
+    case rv_insn_ecall:
+    case rv_insn_ebreak:
+    case rv_insn_wfi:
+    case rv_insn_uret:
+    case rv_insn_hret:
+    case rv_insn_mret:
+    case rv_insn_sfencevma:
+#if RV32_HAS(Zifencei)
+    case rv_insn_fencei:
+#endif
+#if RV32_HAS(Zicsr)
+    case rv_insn_csrrw:
+    case rv_insn_csrrs:
+    case rv_insn_csrrc:
+    case rv_insn_csrrwi:
+    case rv_insn_csrrsi:
+    case rv_insn_csrrci:
+#endif
+#if RV32_HAS(EXT_C)
+    case rv_insn_cebreak:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool rv_step_reference(riscv_t *rv)
+{
+    rv_insn_t ir;
+    memset(&ir, 0, sizeof(rv_insn_t));
+
+    const uint32_t insn = rv->io.mem_ifetch(rv, rv->PC);
+    if (!rv_decode(&ir, insn) || insn_is_system(ir.opcode))
+        return false;
+
+    /* an indirect jump finds no block in an empty history, so it ends here */
+    branch_history_table_t history;
+    memset(&history, 0, sizeof(history));
+    memset(history.PC, -1, sizeof(history.PC));
+    ir.branch_table = &history;
+    ir.impl = dispatch_table[ir.opcode];
+    ir.pc = rv->PC;
+
+    /* the emulator chains its blocks after these, keep them as they were */
+    const bool branch_taken = is_branch_taken;
+    const uint32_t prev_pc = last_pc;
+    RVOP_RUN(rv, &ir);
+    is_branch_taken = branch_taken;
+    last_pc = prev_pc;
+    return true;
+}
+#endif
+
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+block_t *rv_translate_block(riscv_t *rv, uint32_t pc)
+{
+    /* decode ahead, as block_translate traps on what it cannot decode */
+    for (uint32_t addr = pc;;) {
+        rv_insn_t ir;
+        memset(&ir, 0, sizeof(rv_insn_t));
+        const uint32_t insn = rv->io.mem_ifetch(rv, addr);
+        if (!insn || !rv_decode(&ir, insn))
+            return NULL;
+        if (insn_is_branch(ir.opcode))
+            break;
+        addr += is_compressed(insn) ? 2 : 4;
+    }
+
+    const uint32_t PC = rv->PC;
+    rv->PC = pc;
+    block_t *block = block_alloc(rv);
+    block_translate(rv, block);
+    optimize_constant(rv, block);
+#if RV32_HAS(MOP_FUSION)
+    if (!PRIV(rv)->no_fusion)
+        match_pattern(rv, block);
+#endif
+    rv->PC = PC;
+    return block;
+}
+
+void rv_free_block(riscv_t *rv, block_t *block)
+{
+    for (rv_insn_t *ir = block->ir_head, *next_ir; ir; ir = next_ir) {
+        next_ir = ir->next;
+        free(ir->fuse);
+        free(ir->branch_table);
+        mpool_free(rv->block_ir_mp, ir);
+    }
+    mpool_free(rv->block_mp, block);
+}
+#endif
+
 #if RV32_HAS(SYSTEM)
+/* Find the block of the trap handler at rv->PC, translating it unless that
+ * would evict another block, maybe the one of the instruction which trapped,
+ * still running below. The compilers of the JIT only read the IRs of a block,
+ * so those can be run here whether the block is compiled or not.
+ */
+static block_t *trap_block_find(riscv_t *rv)
+{
+#if !RV32_HAS(JIT)
+    /* the old address space is flushed after the sret, see csr_csrrw() */
+    if (need_clear_block_map)
+        return NULL;
+    const block_map_t *map = &rv->block_map;
+    block_t *block = block_find(map, rv->PC);
+    if (!block && map->size * 1.25 <= map->block_capacity)
+        block = block_find_or_translate(rv);
+#else
+    block_t *block = (block_t *) cache_get(rv->block_cache, rv->PC, false);
+    if (block && block->satp != rv->csr_satp)
+        return NULL;
+    if (!block && !cache_full(rv->block_cache))
+        block = block_find_or_translate(rv);
+#endif
+    return block;
+}
+
+/* Go on from @ir, the last IR of a block of the trap handler, to the block at
+ * rv->PC, through the link of the branch, which is made first if need be, as
+ * rv_step() does. No block is evicted while trapped, see trap_block_find(),
+ * so no link is dropped either.
+ */
+static rv_insn_t *trap_block_chain(riscv_t *rv, rv_insn_t *ir)
+{
+    rv_insn_t **link = NULL;
+    if (insn_is_direct_branch(ir->opcode))
+        link = &ir->branch_taken;
+    else if (insn_is_branch(ir->opcode) &&
+             !insn_is_unconditional_branch(ir->opcode))
+        link = rv->PC == ir->pc + ir->imm ? &ir->branch_taken
+                                          : &ir->branch_untaken;
+    if (link && *link && (*link)->pc == rv->PC)
+        return *link;
+
+    block_t *block = trap_block_find(rv);
+    if (!block)
+        return NULL;
+#if RV32_HAS(BLOCK_CHAINING)
+    if (link && !*link && !PRIV(rv)->no_chaining)
+        *link = block->ir_head;
+#endif
+    return block->ir_head;
+}
+
+/* Run the guest trap handler in place of the trapped instruction, until its
+ * sret. The handler runs a block at a time, as the top level does, with the
+ * blocks translated and chained on the way. It only runs an instruction at a
+ * time where no block can be translated without evicting another one. The IRs
+ * do not dispatch to one another while trapped, see RVOP_NO_NEXT, hence they
+ * are run one after another here as long as the PC follows them, leaving out
+ * the probes, which the instructions run one at a time do not meet either.
+ */
 static void __trap_handler(riscv_t *rv)
 {
     rv_insn_t *ir = mpool_calloc(rv->block_ir_mp);
     assert(ir);
+    rv_insn_t *next = NULL;
 
     /* set to false by sret implementation */
     while (rv->is_trapped && !rv_has_halted(rv)) {
+        if (!next) {
+#if !RV32_HAS(ELF_LOADER)
+            /* relocate_enable_mmu is tracked an instruction at a time, see
+             * jalr
+             */
+            if (reloc_enable_mmu)
+#endif
+            {
+                block_t *block = trap_block_find(rv);
+                next = block ? block->ir_head : NULL;
+            }
+        }
+        if (next) {
+            /* a nested trap runs to its sret, which ends the walk before
+             * the block, maybe dropped by the nested handler, is read again
+             */
+            rv_insn_t *bir = next;
+            for (next = NULL;; bir = bir->next) {
+                if (bir->opcode != rv_insn_probe &&
+                    (!RVOP_RUN(rv, bir) || !rv->is_trapped))
+                    break;
+                if (!bir->next) {
+                    next = trap_block_chain(rv, bir);
+                    break;
+                }
+                if (rv->PC != bir->next->pc)
+                    break;
+            }
+            continue;
+        }
+
         uint32_t insn = rv->io.mem_ifetch(rv, rv->PC);
         assert(insn);
 
@@ -1233,9 +2318,10 @@ static void __trap_handler(riscv_t *rv)
 
         ir->impl = dispatch_table[ir->opcode];
         rv->compressed = is_compressed(insn);
-        ir->impl(rv, ir, rv->csr_cycle, rv->PC);
+        RVOP_RUN(rv, ir);
     }
 
+    mpool_free(rv->block_ir_mp, ir);
     prev = NULL;
 }
 #endif /* RV32_HAS(SYSTEM) */
@@ -1273,6 +2359,12 @@ static void _trap_handler(riscv_t *rv)
     uint32_t base;
     uint32_t mode;
     uint32_t cause;
+#if RV32_HAS(FUZZ)
+    /* a trap in the fuzz target is a crash */
+    if (rv->fuzz && fuzz_trap(rv))
+        return;
+#endif
+    rv_hpm_count(rv, RV_HPM_TRAP, 1);
     /* user or supervisor */
     if (RV_PRIV_IS_U_OR_S_MODE()) {
         const uint32_t sstatus_sie =
@@ -1304,6 +2396,9 @@ static void _trap_handler(riscv_t *rv)
             return;
         }
     }
+#if RV32_HAS(SYSTEM)
+    rv_update_intr_pending(rv);
+#endif
     switch (mode) {
     /* DIRECT: All traps set PC to base */
     case 0:
@@ -62,6 +62,75 @@
 #define RV32_FEATURE_Zbs 1
 #endif
 
+/* Zcb Simple code-size saving instructions, which extend the Compressed
+ * instructions
+ */
+#ifndef RV32_FEATURE_Zcb
+#define RV32_FEATURE_Zcb 1
+#endif
+#if !RV32_FEATURE_EXT_C
+#undef RV32_FEATURE_Zcb
+#define RV32_FEATURE_Zcb 0
+#endif
+
+/* Zcmp Push/pop and double move instructions, which extend the Compressed
+ * instructions
+ */
+#ifndef RV32_FEATURE_Zcmp
+#define RV32_FEATURE_Zcmp 1
+#endif
+#if !RV32_FEATURE_EXT_C
+#undef RV32_FEATURE_Zcmp
+#define RV32_FEATURE_Zcmp 0
+#endif
+
+/* Zicond Integer conditional operations */
+#ifndef RV32_FEATURE_Zicond
+#define RV32_FEATURE_Zicond 1
+#endif
+
+/* Zfa Additional floating-point instructions, which extend the F extension */
+#ifndef RV32_FEATURE_Zfa
+#define RV32_FEATURE_Zfa 1
+#endif
+#if !RV32_FEATURE_EXT_F
+#undef RV32_FEATURE_Zfa
+#define RV32_FEATURE_Zfa 0
+#endif
+
+/* Zicbom Cache-block management instructions */
+#ifndef RV32_FEATURE_Zicbom
+#define RV32_FEATURE_Zicbom 1
+#endif
+
+/* Zicboz Cache-block zero instructions */
+#ifndef RV32_FEATURE_Zicboz
+#define RV32_FEATURE_Zicboz 1
+#endif
+
+/* Zicbop Cache-block prefetch hints, which are ORI instructions writing to x0
+ * and only advertised to the guest by this
+ */
+#ifndef RV32_FEATURE_Zicbop
+#define RV32_FEATURE_Zicbop 1
+#endif
+
+/* Zve32x Vector extension for embedded processors, integer elements */
+#ifndef RV32_FEATURE_Zve32x
+#define RV32_FEATURE_Zve32x 0
+#endif
+
+/* Zve32f Vector extension for embedded processors, with single-precision
+ * floating-point elements, which depends on Zve32x and the F extension
+ */
+#ifndef RV32_FEATURE_Zve32f
+#define RV32_FEATURE_Zve32f 0
+#endif
+#if !RV32_FEATURE_Zve32x || !RV32_FEATURE_EXT_F
+#undef RV32_FEATURE_Zve32f
+#define RV32_FEATURE_Zve32f 0
+#endif
+
 /* Experimental SDL oriented system calls */
 #ifndef RV32_FEATURE_SDL
 #define RV32_FEATURE_SDL 1
@@ -108,11 +177,26 @@
 #define RV32_FEATURE_BLOCK_CHAINING 1
 #endif
 
+/* Direct-threaded interpreter, in place of tail calls */
+#ifndef RV32_FEATURE_THREADED_CODE
+#define RV32_FEATURE_THREADED_CODE 0
+#endif
+
 /* Logging with color */
 #ifndef RV32_FEATURE_LOG_COLOR
 #define RV32_FEATURE_LOG_COLOR 1
 #endif
 
+/* Instrumentation plugins */
+#ifndef RV32_FEATURE_PLUGIN
+#define RV32_FEATURE_PLUGIN 0
+#endif
+
+/* AFL-compatible persistent fuzzing */
+#ifndef RV32_FEATURE_FUZZ
+#define RV32_FEATURE_FUZZ 0
+#endif
+
 /* Architecture test */
 #ifndef RV32_FEATURE_ARCH_TEST
 #define RV32_FEATURE_ARCH_TEST 0
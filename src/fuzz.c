@@ -0,0 +1,487 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#if !RV32_HAS(FUZZ)
+#error "Do not manage to build this file unless you enable fuzzing support."
+#endif
+
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "elf.h"
+#include "fuzz.h"
+#include "riscv_private.h"
+#include "utils.h"
+
+/* AFL fork server protocol */
+#define FORKSRV_FD 198
+#define FS_OPT_ENABLED 0x80000001U
+#define FS_OPT_MAPSIZE 0x40000000U
+#define FS_OPT_SHDMEM_FUZZ 0x01000000U
+#define FS_OPT_SET_MAPSIZE(x) (((x) - 1) << 1)
+
+#define MAP_SIZE (1U << 16)
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1U << PAGE_SHIFT)
+
+/* state saved when the fuzz target is reached */
+typedef struct {
+    riscv_word_t X[N_RV_REGS];
+#if RV32_HAS(EXT_F)
+    riscv_float_t F[32];
+    uint32_t csr_fcsr;
+#endif
+#if RV32_HAS(Zve32x)
+    uint8_t V[32][VLENB];
+    uint32_t csr_vector[7]; /**< vstart to vlenb */
+#endif
+    uint8_t csr[offsetof(riscv_t, compressed) - offsetof(riscv_t, csr_cycle)];
+    riscv_word_t break_addr;
+} snapshot_t;
+
+struct fuzz {
+    uint32_t entry;      /**< address of the fuzz target */
+    uint32_t max_len;    /**< capacity of the input buffer */
+    uint32_t iterations; /**< runs per child, or runs of the same input */
+    uint32_t buf;        /**< guest address of the input buffer */
+    bool at_entry;       /**< the fuzz target has been reached */
+    bool running;        /**< a run is in progress */
+    bool returned;       /**< the fuzz target has returned */
+    bool crashed;        /**< the run has trapped */
+    snapshot_t snapshot;
+
+    /* edge coverage */
+    uint8_t *trace_bits;
+    uint32_t prev_loc;
+
+    /* AFL shared-memory test case: a 32-bit length followed by the data */
+    uint8_t *shm_input;
+    uint8_t *input; /**< input read from stdin otherwise */
+
+    /* dirty page tracking */
+    uint8_t *mem_base;
+    uint64_t mem_size;
+    uint8_t *shadow;   /**< original content of the dirty pages */
+    uint8_t *is_dirty; /**< per-page flag */
+    uint32_t *dirty;   /**< list of dirty pages */
+    uint32_t n_dirty;
+};
+
+/* the SIGSEGV handler has no other way to reach the harness */
+static fuzz_t *active_fuzz;
+
+/* fill the snapshot with the current state, or restore it */
+static void fuzz_snapshot(riscv_t *rv, snapshot_t *s, bool save)
+{
+    vm_attr_t *attr = PRIV(rv);
+#define SYNC(dst, src, size) \
+    save ? memcpy(dst, src, size) : memcpy(src, dst, size)
+    SYNC(s->X, rv->X, sizeof(s->X));
+#if RV32_HAS(EXT_F)
+    SYNC(s->F, rv->F, sizeof(s->F));
+    SYNC(&s->csr_fcsr, &rv->csr_fcsr, sizeof(s->csr_fcsr));
+#endif
+#if RV32_HAS(Zve32x)
+    SYNC(s->V, rv->V, sizeof(s->V));
+    SYNC(s->csr_vector, &rv->csr_vstart, sizeof(s->csr_vector));
+#endif
+    SYNC(s->csr, &rv->csr_cycle, sizeof(s->csr));
+    SYNC(&s->break_addr, &attr->break_addr, sizeof(s->break_addr));
+#undef SYNC
+}
+
+static void fuzz_segv_handler(int sig, siginfo_t *info, void *ctx UNUSED)
+{
+    fuzz_t *fuzz = active_fuzz;
+    uint8_t *addr = info->si_addr;
+
+    if (fuzz && addr >= fuzz->mem_base &&
+        addr < fuzz->mem_base + fuzz->mem_size) {
+        uint32_t page = (addr - fuzz->mem_base) >> PAGE_SHIFT;
+        uint8_t *base = fuzz->mem_base + ((uint64_t) page << PAGE_SHIFT);
+        if (!fuzz->is_dirty[page]) {
+            /* save the page before it is written for the first time */
+            memcpy(fuzz->shadow + ((uint64_t) page << PAGE_SHIFT), base,
+                   PAGE_SIZE);
+            mprotect(base, PAGE_SIZE, PROT_READ | PROT_WRITE);
+            fuzz->is_dirty[page] = 1;
+            fuzz->dirty[fuzz->n_dirty++] = page;
+            return;
+        }
+    }
+
+    /* a genuine fault, e.g. an access past the guest memory, which takes the
+     * default action once retried and is thus reported as a crash
+     */
+    signal(sig, SIG_DFL);
+}
+
+/* write-protect the guest memory so that the first write to each page is
+ * trapped by fuzz_segv_handler
+ */
+static void fuzz_track_dirty_pages(fuzz_t *fuzz)
+{
+    const uint64_t n_pages = fuzz->mem_size >> PAGE_SHIFT;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    fuzz->shadow = mmap(NULL, fuzz->mem_size, PROT_READ | PROT_WRITE, flags,
+                        -1, 0);
+    fuzz->is_dirty = mmap(NULL, n_pages, PROT_READ | PROT_WRITE, flags, -1, 0);
+    fuzz->dirty = mmap(NULL, n_pages * sizeof(uint32_t),
+                       PROT_READ | PROT_WRITE, flags, -1, 0);
+    assert(fuzz->shadow != MAP_FAILED && fuzz->is_dirty != MAP_FAILED &&
+           fuzz->dirty != MAP_FAILED);
+
+    struct sigaction sa = {
+        .sa_sigaction = fuzz_segv_handler,
+        .sa_flags = SA_SIGINFO | SA_NODEFER,
+    };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGBUS, &sa, NULL);
+    active_fuzz = fuzz;
+
+    mprotect(fuzz->mem_base, fuzz->mem_size, PROT_READ);
+}
+
+/* copy back the pages written by the last run and protect them again */
+static void fuzz_restore_dirty_pages(fuzz_t *fuzz)
+{
+    for (uint32_t i = 0; i < fuzz->n_dirty; i++) {
+        uint64_t offset = (uint64_t) fuzz->dirty[i] << PAGE_SHIFT;
+        memcpy(fuzz->mem_base + offset, fuzz->shadow + offset, PAGE_SIZE);
+        mprotect(fuzz->mem_base + offset, PAGE_SIZE, PROT_READ);
+        fuzz->is_dirty[fuzz->dirty[i]] = 0;
+    }
+    fuzz->n_dirty = 0;
+}
+
+static uint32_t fuzz_resolve_entry(const char *elf_path, const char *entry)
+{
+    char *end;
+    uint32_t addr = strtoul(entry, &end, 0);
+    if (*entry && !*end)
+        return addr;
+
+    elf_t *elf = elf_new();
+    assert(elf);
+    const struct Elf32_Sym *sym = NULL;
+    if (elf_open(elf, elf_path))
+        sym = elf_get_symbol(elf, entry);
+    addr = sym ? sym->st_value : 0;
+    elf_delete(elf);
+    return addr;
+}
+
+fuzz_t *fuzz_create(riscv_t *rv,
+                    const char *entry,
+                    uint32_t max_len,
+                    uint32_t iterations)
+{
+    vm_attr_t *attr = PRIV(rv);
+    assert(entry && max_len && iterations);
+
+    uint32_t entry_pc = fuzz_resolve_entry(attr->data.user.elf_program, entry);
+    if (!entry_pc) {
+        rv_log_error("Cannot find the fuzz target %s", entry);
+        return NULL;
+    }
+
+    fuzz_t *fuzz = calloc(1, sizeof(fuzz_t));
+    assert(fuzz);
+    fuzz->entry = entry_pc;
+    fuzz->max_len = max_len;
+    fuzz->iterations = iterations;
+    fuzz->mem_base = attr->mem->mem_base;
+    fuzz->mem_size = attr->mem->mem_size;
+    fuzz->input = malloc(max_len);
+    assert(fuzz->input);
+
+    /* the coverage bitmap of afl-fuzz, or a private one */
+    const char *shm_id = getenv("__AFL_SHM_ID");
+    if (shm_id) {
+        fuzz->trace_bits = shmat(atoi(shm_id), NULL, 0);
+        if (fuzz->trace_bits == (void *) -1) {
+            rv_log_error("Cannot attach the AFL coverage bitmap");
+            free(fuzz->input);
+            free(fuzz);
+            return NULL;
+        }
+    } else {
+        fuzz->trace_bits = calloc(MAP_SIZE, 1);
+        assert(fuzz->trace_bits);
+    }
+
+    const char *shm_fuzz_id = getenv("__AFL_SHM_FUZZ_ID");
+    if (shm_fuzz_id) {
+        fuzz->shm_input = shmat(atoi(shm_fuzz_id), NULL, 0);
+        if (fuzz->shm_input == (void *) -1)
+            fuzz->shm_input = NULL;
+    }
+
+    return fuzz;
+}
+
+bool fuzz_block(riscv_t *rv, uint32_t pc)
+{
+    fuzz_t *fuzz = rv->fuzz;
+
+    if (unlikely(!fuzz->at_entry)) {
+        if (pc != fuzz->entry)
+            return true;
+        fuzz->at_entry = true;
+        rv->PC = pc;
+        rv_halt(rv);
+        return false;
+    }
+
+    /* AFL's edge coverage, where locations are hashed block addresses */
+    uint32_t cur_loc = (pc * 0x9e3779b1U) >> 16;
+    fuzz->trace_bits[(cur_loc ^ fuzz->prev_loc) & (MAP_SIZE - 1)]++;
+    fuzz->prev_loc = cur_loc >> 1;
+    return true;
+}
+
+void fuzz_return(riscv_t *rv)
+{
+    rv->fuzz->returned = true;
+    rv_halt(rv);
+}
+
+bool fuzz_trap(riscv_t *rv)
+{
+    fuzz_t *fuzz = rv->fuzz;
+    if (!fuzz->running)
+        return false;
+
+    rv_log_error("Trap at PC %#x, cause %u, tval %#x", rv->PC, rv->csr_mcause,
+                 rv->csr_mtval);
+    fuzz->crashed = true;
+    rv_halt(rv);
+    return true;
+}
+
+/* fetch the next input, return its length */
+static uint32_t fuzz_get_input(fuzz_t *fuzz, const uint8_t **data)
+{
+    if (fuzz->shm_input) {
+        uint32_t len;
+        memcpy(&len, fuzz->shm_input, sizeof(uint32_t));
+        *data = fuzz->shm_input + sizeof(uint32_t);
+        return len < fuzz->max_len ? len : fuzz->max_len;
+    }
+
+    /* afl-fuzz rewrites the file behind stdin for every input */
+    lseek(STDIN_FILENO, 0, SEEK_SET);
+    uint32_t len = 0;
+    ssize_t r;
+    while (len < fuzz->max_len &&
+           (r = read(STDIN_FILENO, fuzz->input + len, fuzz->max_len - len)) >
+               0)
+        len += r;
+    *data = fuzz->input;
+    return len;
+}
+
+/* run the fuzz target once, return true if the run crashes */
+static bool fuzz_one(riscv_t *rv, const uint8_t *data, uint32_t len)
+{
+    fuzz_t *fuzz = rv->fuzz;
+    vm_attr_t *attr = PRIV(rv);
+
+    fuzz_restore_dirty_pages(fuzz);
+    fuzz_snapshot(rv, &fuzz->snapshot, false);
+    memory_write(attr->mem, fuzz->buf, data, len);
+    rv->X[rv_reg_a0] = fuzz->buf;
+    rv->X[rv_reg_a1] = len;
+    rv->X[rv_reg_ra] = FUZZ_RETURN_PC;
+    rv->PC = fuzz->entry;
+    rv->halt = false;
+    attr->exit_code = 0;
+    fuzz->prev_loc = 0;
+    fuzz->returned = fuzz->crashed = false;
+    fuzz->running = true;
+
+    while (!rv_has_halted(rv))
+        rv_step(rv);
+
+    fuzz->running = false;
+    return fuzz->crashed || (!fuzz->returned && attr->exit_code);
+}
+
+/* the child of the fork server, which never returns */
+static void fuzz_persistent_loop(riscv_t *rv)
+{
+    fuzz_t *fuzz = rv->fuzz;
+
+    fuzz_track_dirty_pages(fuzz);
+    for (uint32_t i = 0; i < fuzz->iterations; i++) {
+        /* tell the fork server that the previous run is complete */
+        if (i)
+            raise(SIGSTOP);
+
+        const uint8_t *data;
+        uint32_t len = fuzz_get_input(fuzz, &data);
+        if (fuzz_one(rv, data, len))
+            abort();
+    }
+    _exit(0);
+}
+
+/* Serve afl-fuzz, return false if the emulator is not run by afl-fuzz */
+static bool fuzz_fork_server(riscv_t *rv)
+{
+    fuzz_t *fuzz = rv->fuzz;
+    uint32_t status = FS_OPT_ENABLED | FS_OPT_MAPSIZE |
+                      FS_OPT_SET_MAPSIZE(MAP_SIZE) |
+                      (fuzz->shm_input ? FS_OPT_SHDMEM_FUZZ : 0);
+    if (write(FORKSRV_FD + 1, &status, 4) != 4)
+        return false;
+
+    if (fuzz->shm_input) {
+        uint32_t reply;
+        if (read(FORKSRV_FD, &reply, 4) != 4 ||
+            (reply & (FS_OPT_ENABLED | FS_OPT_SHDMEM_FUZZ)) !=
+                (FS_OPT_ENABLED | FS_OPT_SHDMEM_FUZZ)) {
+            rv_log_fatal("Unexpected reply from afl-fuzz: %#x", reply);
+            _exit(1);
+        }
+    }
+    rv_log_info("Fork server is up, fuzz target at %#x", fuzz->entry);
+
+    pid_t child = -1;
+    bool child_stopped = false;
+    while (true) {
+        uint32_t was_killed;
+        if (read(FORKSRV_FD, &was_killed, 4) != 4)
+            _exit(0);
+
+        /* afl-fuzz has killed the stopped child on timeout */
+        if (child_stopped && was_killed) {
+            child_stopped = false;
+            waitpid(child, NULL, 0);
+        }
+
+        if (!child_stopped) {
+#if RV32_HAS(T2C)
+            /* the compilation thread is not inherited, nor are its locks */
+            pthread_mutex_lock(&rv->wait_queue_lock);
+            pthread_mutex_lock(&rv->cache_lock);
+#endif
+            child = fork();
+#if RV32_HAS(T2C)
+            pthread_mutex_unlock(&rv->cache_lock);
+            pthread_mutex_unlock(&rv->wait_queue_lock);
+#endif
+            if (child < 0) {
+                rv_log_fatal("fork() failed");
+                _exit(1);
+            }
+            if (!child) {
+                close(FORKSRV_FD);
+                close(FORKSRV_FD + 1);
+                fuzz_persistent_loop(rv);
+            }
+        } else {
+            kill(child, SIGCONT);
+            child_stopped = false;
+        }
+
+        int child_status;
+        if (write(FORKSRV_FD + 1, &child, 4) != 4 ||
+            waitpid(child, &child_status, WUNTRACED) < 0)
+            _exit(1);
+        child_stopped = WIFSTOPPED(child_status);
+        if (write(FORKSRV_FD + 1, &child_status, 4) != 4)
+            _exit(1);
+    }
+}
+
+void fuzz_run(riscv_t *rv)
+{
+    fuzz_t *fuzz = rv->fuzz;
+    vm_attr_t *attr = PRIV(rv);
+
+    /* run the initialization of the program up to the fuzz target */
+    while (!rv_has_halted(rv))
+        rv_step(rv);
+    if (!fuzz->at_entry) {
+        rv_log_error("The program exits before reaching the fuzz target");
+        return;
+    }
+
+    /* reserve the input buffer past the program break */
+    fuzz->buf = (attr->break_addr + 15) & ~15U;
+    attr->break_addr = fuzz->buf + fuzz->max_len;
+    if ((uint64_t) fuzz->buf + fuzz->max_len + attr->stack_size >
+        rv->X[rv_reg_sp]) {
+        rv_log_error("No room for an input buffer of %u bytes", fuzz->max_len);
+        return;
+    }
+    fuzz_snapshot(rv, &fuzz->snapshot, true);
+
+    if (fuzz_fork_server(rv))
+        return;
+
+    /* Without afl-fuzz, run the input from stdin, which is useful to
+     * reproduce a crash or to measure the speed of the harness.
+     */
+    fuzz_track_dirty_pages(fuzz);
+    const uint8_t *data;
+    uint32_t len = fuzz_get_input(fuzz, &data);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool crashed = false;
+    uint32_t i;
+    for (i = 0; i < fuzz->iterations && !crashed; i++)
+        crashed = fuzz_one(rv, data, len);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double secs =
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    uint32_t n_edges = 0;
+    for (uint32_t j = 0; j < MAP_SIZE; j++)
+        n_edges += !!fuzz->trace_bits[j];
+    rv_log_info("%u runs in %.3f s (%.0f runs/s), %u edges, %u dirty pages", i,
+                secs, secs > 0 ? i / secs : 0, n_edges, fuzz->n_dirty);
+
+    if (crashed) {
+        rv_log_error("The fuzz target crashes on the input");
+        attr->exit_code = 1;
+    }
+}
+
+void fuzz_delete(fuzz_t *fuzz)
+{
+    if (!fuzz)
+        return;
+
+    /* leave the guest memory writable for the rest of the teardown */
+    if (active_fuzz == fuzz) {
+        mprotect(fuzz->mem_base, fuzz->mem_size, PROT_READ | PROT_WRITE);
+        signal(SIGSEGV, SIG_DFL);
+        signal(SIGBUS, SIG_DFL);
+        active_fuzz = NULL;
+        munmap(fuzz->shadow, fuzz->mem_size);
+        munmap(fuzz->is_dirty, fuzz->mem_size >> PAGE_SHIFT);
+        munmap(fuzz->dirty, (fuzz->mem_size >> PAGE_SHIFT) * sizeof(uint32_t));
+    }
+    if (getenv("__AFL_SHM_ID"))
+        shmdt(fuzz->trace_bits);
+    else
+        free(fuzz->trace_bits);
+    if (fuzz->shm_input)
+        shmdt(fuzz->shm_input);
+    free(fuzz->input);
+    free(fuzz);
+}
@@ -0,0 +1,97 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#if !RV32_HAS(FUZZ)
+#error "Do not manage to build this file unless you enable fuzzing support."
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "riscv.h"
+
+/* Persistent fuzzing compatible with AFL and AFL++.
+ *
+ * The guest program is run until it reaches the fuzz target, a function with
+ * the libFuzzer signature
+ *
+ *   int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+ *
+ * where the registers are saved. Every input is then copied into a buffer
+ * reserved past the program break, and the target is called with it and
+ * with a return address that holds no code, so that returning from the
+ * target ends the run. Between runs, the registers are restored and only the
+ * guest pages written by the previous run are copied back; translated blocks
+ * and the JIT code cache stay warm.
+ *
+ * Guest pages are write-protected at the beginning of the persistent loop and
+ * saved on their first write by a SIGSEGV handler, which is triggered by the
+ * interpreter, the JIT-compiled code and the system call emulation alike.
+ *
+ * Under afl-fuzz, the emulator acts as the fork server: it forks a child
+ * once the target is reached, and the child runs up to a given number of
+ * inputs, stopping itself after each one as AFL's persistent mode expects.
+ * Inputs come from AFL's shared-memory test case if available, otherwise from
+ * standard input. The edges between basic blocks are recorded in the shared
+ * coverage bitmap. A trap, or an exit with a non-zero status, during a run is
+ * reported as a crash by aborting the child.
+ */
+
+/* the return address of the fuzz target, where no code is ever placed */
+#define FUZZ_RETURN_PC 0xfffffff0U
+
+typedef struct fuzz fuzz_t;
+
+/**
+ * fuzz_create - create the fuzzing harness
+ * @rv: a pointer points to the RISC-V emulator
+ * @entry: symbol or address of the fuzz target
+ * @max_len: capacity of the input buffer in the guest
+ * @iterations: runs per child under afl-fuzz, or runs of the same input
+ *              otherwise
+ */
+fuzz_t *fuzz_create(riscv_t *rv,
+                    const char *entry,
+                    uint32_t max_len,
+                    uint32_t iterations);
+
+/**
+ * fuzz_run - run the guest program to the fuzz target and fuzz it
+ * @rv: a pointer points to the RISC-V emulator
+ */
+void fuzz_run(riscv_t *rv);
+
+/**
+ * fuzz_block - record the edge to the block starting at @pc
+ * @rv: a pointer points to the RISC-V emulator
+ * @pc: start address of the block about to run
+ *
+ * Return false if the emulation has to stop before the block runs, which is
+ * the case when the fuzz target is reached for the first time.
+ */
+bool fuzz_block(riscv_t *rv, uint32_t pc);
+
+/**
+ * fuzz_return - end the current run as the fuzz target returns
+ * @rv: a pointer points to the RISC-V emulator
+ */
+void fuzz_return(riscv_t *rv);
+
+/**
+ * fuzz_trap - end the current run on a trap, reported as a crash
+ * @rv: a pointer points to the RISC-V emulator
+ *
+ * Return false if no run is in progress, in which case the trap is handled
+ * as usual.
+ */
+bool fuzz_trap(riscv_t *rv);
+
+/**
+ * fuzz_delete - release the fuzzing harness
+ * @fuzz: a pointer points to the fuzzing harness
+ */
+void fuzz_delete(fuzz_t *fuzz);
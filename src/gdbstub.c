@@ -15,6 +15,9 @@
 #include "breakpoint.h"
 #include "riscv.h"
 #include "riscv_private.h"
+#if RV32_HAS(SYSTEM)
+#include "system.h"
+#endif
 
 static size_t rv_get_reg_bytes(UNUSED int regno)
 {
@@ -50,35 +53,74 @@ static int rv_write_reg(void *args, int regno, void *data)
     return 0;
 }
 
-static int rv_read_mem(void *args, size_t addr, size_t len, void *val)
+/* Copy between GDB and the guest memory up to a page at a time, through
+ * memory_read and memory_write rather than the byte accessors. An address is
+ * translated as the guest would, but without raising a page fault into it.
+ */
+static int rv_access_mem(riscv_t *rv,
+                         size_t addr,
+                         size_t len,
+                         uint8_t *buf,
+                         bool is_write)
 {
-    riscv_t *rv = (riscv_t *) args;
+    memory_t *mem = PRIV(rv)->mem;
+
+    while (len) {
+        const uint32_t vaddr = addr;
+        size_t chunk = RV_PG_SIZE - (vaddr & (RV_PG_SIZE - 1));
+        if (chunk > len)
+            chunk = len;
+        uint32_t paddr = vaddr;
+#if RV32_HAS(SYSTEM)
+        if (rv->csr_satp) {
+            uint32_t level;
+            pte_t *pte = mmu_walk(rv, vaddr, &level);
+            if (!pte)
+                return EFAULT;
+            get_ppn_and_offset();
+            paddr = ppn | offset;
+        }
+#endif
 
-    int err = 0;
-    for (size_t i = 0; i < len; i++) {
-        /* FIXME: This is implemented as a simple workaround for reading
-         * an invalid address. We may have to do error handling in the
-         * mem_read_* function directly.
-         */
-        *((uint8_t *) val + i) = rv->io.mem_read_b(rv, addr + i);
+        if ((uint64_t) paddr + chunk <= mem->mem_size) {
+            if (is_write)
+                memory_write(mem, paddr, buf, chunk);
+            else
+                memory_read(mem, buf, paddr, chunk);
+        } else {
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+            /* the registers of the devices are reached one by one */
+            for (size_t i = 0; i < chunk; i++) {
+                if (is_write)
+                    rv->io.mem_write_b(rv, vaddr + i, buf[i]);
+                else
+                    buf[i] = rv->io.mem_read_b(rv, vaddr + i);
+            }
+#else
+            return EFAULT;
+#endif
+        }
+
+        addr += chunk;
+        buf += chunk;
+        len -= chunk;
     }
 
-    return err;
+    return 0;
 }
 
-static int rv_write_mem(void *args, size_t addr, size_t len, void *val)
+static int rv_read_mem(void *args, size_t addr, size_t len, void *val)
 {
-    riscv_t *rv = (riscv_t *) args;
-
-    for (size_t i = 0; i < len; i++)
-        rv->io.mem_write_b(rv, addr + i, *((uint8_t *) val + i));
-
-    return 0;
+    return rv_access_mem((riscv_t *) args, addr, len, val, false);
 }
 
-static inline bool rv_is_interrupt(riscv_t *rv)
+static int rv_write_mem(void *args, size_t addr, size_t len, void *val)
 {
-    return __atomic_load_n(&rv->is_interrupted, __ATOMIC_RELAXED);
+    riscv_t *rv = (riscv_t *) args;
+
+    /* the write may patch code which has been translated */
+    rv->debug_flush = true;
+    return rv_access_mem(rv, addr, len, val, true);
 }
 
 static gdb_action_t rv_cont(void *args)
@@ -86,12 +128,7 @@ static gdb_action_t rv_cont(void *args)
     riscv_t *rv = (riscv_t *) args;
     assert(rv);
 
-    for (; !rv_has_halted(rv) && !rv_is_interrupt(rv);) {
-        if (breakpoint_map_find(rv->breakpoint_map, rv_get_pc(rv)))
-            break;
-
-        rv_step_debug(rv);
-    }
+    rv_debug_cont(rv);
 
     /* Clear the interrupt if it's pending */
     __atomic_store_n(&rv->is_interrupted, false, __ATOMIC_RELAXED);
@@ -108,31 +145,89 @@ static gdb_action_t rv_stepi(void *args)
     return ACT_RESUME;
 }
 
+static bool rv_set_watchpoint(riscv_t *rv, size_t addr, int type)
+{
+    if (rv->n_watchpoints == MAX_WATCHPOINTS)
+        return false;
+
+    rv->watchpoints[rv->n_watchpoints++] = (watchpoint_t){
+        .addr = addr,
+        .read = type != WATCH_WRITE,
+        .write = type != WATCH_READ,
+    };
+    return true;
+}
+
+static void rv_del_watchpoint(riscv_t *rv, size_t addr, int type)
+{
+    for (uint32_t i = 0; i < rv->n_watchpoints; i++) {
+        const watchpoint_t *wp = &rv->watchpoints[i];
+        if (wp->addr != addr || wp->read != (type != WATCH_WRITE) ||
+            wp->write != (type != WATCH_READ))
+            continue;
+
+        rv->watchpoints[i] = rv->watchpoints[--rv->n_watchpoints];
+        return;
+    }
+}
+
 static bool rv_set_bp(void *args, size_t addr, bp_type_t type)
 {
     riscv_t *rv = (riscv_t *) args;
-    if (type != BP_SOFTWARE)
-        return false;
 
-    return breakpoint_map_insert(rv->breakpoint_map, addr);
+    switch ((int) type) {
+    case BP_SOFTWARE:
+    case HW_BREAKPOINT: {
+        /* a removed breakpoint is kept for the blocks probing it */
+        breakpoint_t *bp = breakpoint_map_find(rv->breakpoint_map, addr);
+        if (bp) {
+            if (bp->enabled)
+                return false;
+            bp->enabled = true;
+            return true;
+        }
+
+        /* a block may run across the new breakpoint */
+        rv->debug_flush = true;
+        return breakpoint_map_insert(rv->breakpoint_map, addr);
+    }
+    case WATCH_WRITE:
+    case WATCH_READ:
+    case WATCH_ACCESS:
+        return rv_set_watchpoint(rv, addr, type);
+    default:
+        return false;
+    }
 }
 
 static bool rv_del_bp(void *args, size_t addr, bp_type_t type)
 {
     riscv_t *rv = (riscv_t *) args;
-    if (type != BP_SOFTWARE)
-        return false;
 
     /* When there is no matched breakpoint, no further action is taken */
-    breakpoint_map_del(rv->breakpoint_map, addr);
-    return true;
+    switch ((int) type) {
+    case BP_SOFTWARE:
+    case HW_BREAKPOINT: {
+        breakpoint_t *bp = breakpoint_map_find(rv->breakpoint_map, addr);
+        if (bp)
+            bp->enabled = false;
+        return true;
+    }
+    case WATCH_WRITE:
+    case WATCH_READ:
+    case WATCH_ACCESS:
+        rv_del_watchpoint(rv, addr, type);
+        return true;
+    default:
+        return false;
+    }
 }
 
 static void rv_on_interrupt(void *args)
 {
     riscv_t *rv = (riscv_t *) args;
 
-    /* Notify the emulator to break out the for loop in rv_cont */
+    /* Notify the emulator to break out the loop of blocks in rv_cont */
     __atomic_store_n(&rv->is_interrupted, true, __ATOMIC_RELAXED);
 }
 
@@ -787,6 +787,23 @@ static inline void emit_mov(struct jit_state *state, int src, int dst)
 #endif
 }
 
+/* Sign-extend the low 32 bits of a register to the whole of it. Mapped
+ * registers only hold zero-extended values, so the 64-bit multiplication
+ * of MULH and MULHSU works on sign-extended copies.
+ */
+static inline void emit_sext32(struct jit_state *state, int reg)
+{
+#if defined(__x86_64__)
+    /* movsxd */
+    emit_basic_rex(state, 1, reg, reg);
+    emit1(state, 0x63);
+    emit_modrm_reg2reg(state, reg, reg);
+#elif defined(__aarch64__)
+    /* sxtw, i.e., sbfm reg, reg, #0, #31 */
+    emit_a64(state, 0x93407c00 | (reg << 5) | reg);
+#endif
+}
+
 
 #if defined(__x86_64__)
 /* REX.W prefix, ModRM byte, and 32-bit immediate */
@@ -1173,18 +1190,20 @@ static inline void emit_exit(struct jit_state *state)
 #endif
 }
 
-#if RV32_HAS(EXT_M)
+#if RV32_HAS(EXT_M) || RV32_HAS(Zicond)
 #if defined(__x86_64__)
+/* cmove: move src into dst if ZF is set */
 static inline void emit_conditional_move(struct jit_state *state,
                                          int src,
                                          int dst)
 {
-    emit1(state, 0x48);
+    emit_basic_rex(state, 1, dst, src);
     emit1(state, 0x0f);
     emit1(state, 0x44);
     emit_modrm_reg2reg(state, dst, src);
 }
 #elif defined(__aarch64__)
+/* csel: rd = cond ? rn : rm */
 static inline void emit_conditional_move(struct jit_state *state,
                                          int rd,
                                          int rn,
@@ -1194,7 +1213,40 @@ static inline void emit_conditional_move(struct jit_state *state,
     emit_a64(state, 0x1a800000 | (rm << 16) | (cond << 12) | (rn << 5) | rd);
     set_dirty(rd, true);
 }
+#endif
+#endif
+
+#if RV32_HAS(Zicond)
+/* Move src into dst, or zero if cond is zero (eqz) or not zero (!eqz), which
+ * CZERO.EQZ and CZERO.NEZ lower to without a host branch.
+ */
+static void emit_czero(struct jit_state *state,
+                       int src,
+                       int cond,
+                       int dst,
+                       bool eqz)
+{
+#if defined(__x86_64__)
+    emit_alu32(state, 0x85, cond, cond); /* test cond, cond */
+    /* neither mov nor the immediate loads below change the flags */
+    if (eqz) {
+        if (src != dst)
+            emit_mov(state, src, dst);
+        emit_load_imm(state, temp_reg, 0);
+    } else {
+        emit_mov(state, src, temp_reg);
+        emit_load_imm(state, dst, 0);
+    }
+    emit_conditional_move(state, temp_reg, dst);
+    set_dirty(dst, true);
+#elif defined(__aarch64__)
+    emit_cmp_imm32(state, cond, 0);
+    emit_conditional_move(state, dst, RZ, src, eqz ? COND_EQ : COND_NE);
+#endif
+}
+#endif
 
+#if RV32_HAS(EXT_M) && defined(__aarch64__)
 static void divmod(struct jit_state *state,
                    uint8_t opcode,
                    int rd,
@@ -1234,6 +1286,7 @@ static void divmod(struct jit_state *state,
 }
 #endif
 
+#if RV32_HAS(EXT_M)
 static void muldivmod(struct jit_state *state,
                       uint8_t opcode,
                       int src,
@@ -1295,14 +1348,24 @@ static void muldivmod(struct jit_state *state,
         /* Set the divisor to 1 if it is zero */
         emit_load_imm(state, RDX, 1);
         emit_conditional_move(state, RDX, RCX);
-        /* xor %edx,%edx */
-        emit_alu32(state, 0x31, RDX, RDX);
+        if (sign) {
+            /* Divide by 1 in place of -1, since IDIV faults on the overflow
+             * of INT_MIN / -1, and negate the quotient afterwards.
+             */
+            emit_cmp_imm32(state, RCX, -1);
+            emit_conditional_move(state, RDX, RCX);
+            /* cdq */
+            emit1(state, 0x99);
+        } else {
+            /* xor %edx,%edx */
+            emit_alu32(state, 0x31, RDX, RDX);
+        }
     }
 
     if (is64)
         emit_rex(state, 1, 0, 0, 0);
     /* Multiply or divide */
-    emit_alu32(state, 0xf7, mul ? 4 : 6, RCX);
+    emit_alu32(state, 0xf7, mul ? 4 : (sign ? 7 : 6), RCX);
 
     /* The division operation stores the remainder in RDX and the quotient
      * in RAX.
@@ -1314,20 +1377,21 @@ static void muldivmod(struct jit_state *state,
         /* If zero flag is set, then the divisor was zero. */
 
         if (div) {
-            /* Set the dividend to zero if the divisor was zero. */
-            emit_load_imm_sext(state, RCX, -1);
+            /* Set the quotient to -1 if the divisor was zero, zero-extended
+             * as the other vm registers are.
+             */
+            emit_load_imm(state, RCX, -1);
 
             /* Store 0 in RAX if the divisor was zero. */
             /* Use conditional move to avoid a branch. */
             emit_conditional_move(state, RCX, RAX);
             if (sign) {
                 emit_pop(state, RCX);
-                /* handle DIV overflow */
+                /* negate the quotient if the divisor was -1 */
                 emit1(state, 0x9d); /* popfq */
                 uint32_t jump_loc_0 = state->offset;
                 emit_jcc_offset(state, 0x85);
-                emit_cmp_imm32(state, RCX, 0x80000000);
-                emit_conditional_move(state, RCX, RAX);
+                emit_alu32(state, 0xf7, 3, RAX); /* neg */
                 emit_jump_target_offset(state, JUMP_LOC_0, state->offset);
             }
         } else {
@@ -1336,16 +1400,9 @@ static void muldivmod(struct jit_state *state,
             /* Store the dividend in RAX if the divisor was zero. */
             /* Use conditional move to avoid a branch. */
             emit_conditional_move(state, RCX, RDX);
-            if (sign) {
-                /* handle REM overflow */
+            /* The remainder of a division by -1, done as one, is 0 already */
+            if (sign)
                 emit1(state, 0x9d); /* popfq */
-                uint32_t jump_loc_0 = state->offset;
-                emit_jcc_offset(state, 0x85);
-                emit_cmp_imm32(state, RCX, 0x80000000);
-                emit_load_imm(state, RCX, 0);
-                emit_conditional_move(state, RCX, RDX);
-                emit_jump_target_offset(state, JUMP_LOC_0, state->offset);
-            }
         }
     }
 
@@ -1392,18 +1449,76 @@ uint32_t jit_mmio_read_wrapper(riscv_t *rv, uint32_t addr)
     __UNREACHABLE;
 }
 
-void jit_mmu_handler(riscv_t *rv, uint32_t vreg_idx)
+void jit_mmu_handler(riscv_t *rv, uint32_t vreg_idx, uint32_t pc)
 {
     assert(vreg_idx < 32);
 
     uint32_t addr;
-
-    if (rv->jit_mmu.type == rv_insn_lb || rv->jit_mmu.type == rv_insn_lh ||
+    const bool is_load =
+        rv->jit_mmu.type == rv_insn_lb || rv->jit_mmu.type == rv_insn_lh ||
         rv->jit_mmu.type == rv_insn_lbu || rv->jit_mmu.type == rv_insn_lhu ||
-        rv->jit_mmu.type == rv_insn_lw)
-        addr = rv->io.mem_translate(rv, rv->jit_mmu.vaddr, R);
-    else
-        addr = rv->io.mem_translate(rv, rv->jit_mmu.vaddr, W);
+        rv->jit_mmu.type == rv_insn_lw;
+
+    /* A misaligned access is performed by the translated code like any other,
+     * unless the interpreter would trap on it, see misaligned_allowed(). Then
+     * it traps here at @pc, the PC of the access, and the code skips the
+     * access as done, like one to MMIO.
+     */
+    uint32_t mask = 0;
+    switch (rv->jit_mmu.type) {
+    case rv_insn_lh:
+    case rv_insn_lhu:
+    case rv_insn_sh:
+        mask = 1;
+        break;
+    case rv_insn_lw:
+    case rv_insn_sw:
+        mask = 3;
+        break;
+    }
+    if (unlikely(rv->jit_mmu.vaddr & mask)) {
+        rv_hpm_count(rv, RV_HPM_MISALIGNED, 1);
+        if (!PRIV(rv)->allow_misalign ||
+            !mmu_misaligned_in_ram(rv, rv->jit_mmu.vaddr, mask + 1)) {
+            rv->jit_mmu.is_mmio = 1;
+            rv->PC = pc;
+            rv->compressed = false;
+            /* the access does not retire, see emit_hpm_count() */
+            if (rv->hpm_t1_insn)
+                rv->hpm_events[RV_HPM_T1_INSN]--;
+            const uint32_t cause =
+                is_load ? LOAD_MISALIGNED : STORE_MISALIGNED;
+            SET_CAUSE_AND_TVAL_THEN_TRAP(rv, cause, rv->jit_mmu.vaddr);
+            return;
+        }
+        /* the code accesses one page, so the accessors of the MMU split an
+         * access crossing a page here, which the code then skips as done
+         */
+        const uint32_t vaddr = rv->jit_mmu.vaddr;
+        if ((vaddr & MASK(RV_PG_SHIFT)) + mask + 1 > RV_PG_SIZE) {
+            rv->jit_mmu.is_mmio = 1;
+            switch (rv->jit_mmu.type) {
+            case rv_insn_lh:
+                rv->X[vreg_idx] = (int16_t) rv->io.mem_read_s(rv, vaddr);
+                break;
+            case rv_insn_lhu:
+                rv->X[vreg_idx] = rv->io.mem_read_s(rv, vaddr);
+                break;
+            case rv_insn_lw:
+                rv->X[vreg_idx] = rv->io.mem_read_w(rv, vaddr);
+                break;
+            case rv_insn_sh:
+                rv->io.mem_write_s(rv, vaddr, rv->X[vreg_idx]);
+                break;
+            case rv_insn_sw:
+                rv->io.mem_write_w(rv, vaddr, rv->X[vreg_idx]);
+                break;
+            }
+            return;
+        }
+    }
+
+    addr = rv->io.mem_translate(rv, rv->jit_mmu.vaddr, is_load ? R : W);
 
     if (addr == rv->jit_mmu.vaddr || addr < PRIV(rv)->mem->mem_size) {
         rv->jit_mmu.is_mmio = 0;
@@ -1448,7 +1563,9 @@ void jit_mmu_handler(riscv_t *rv, uint32_t vreg_idx)
     }
 }
 
-void emit_jit_mmu_handler(struct jit_state *state, uint8_t vreg_idx)
+void emit_jit_mmu_handler(struct jit_state *state,
+                          uint8_t vreg_idx,
+                          uint32_t pc)
 {
     assert(vreg_idx < 32);
 
@@ -1461,6 +1578,10 @@ void emit_jit_mmu_handler(struct jit_state *state, uint8_t vreg_idx)
     emit1(state, 0xbe);
     emit4(state, vreg_idx);
 
+    /* mov $pc, %edx */
+    emit1(state, 0xba);
+    emit4(state, pc);
+
     /* call jit_mmu_handler */
     emit_load_imm_sext(state, temp_reg, (uintptr_t) &jit_mmu_handler);
     emit1(state, 0xff);
@@ -1479,6 +1600,9 @@ void emit_jit_mmu_handler(struct jit_state *state, uint8_t vreg_idx)
     /* move vreg_idx into R1 */
     emit_movewide_imm(state, false, R1, vreg_idx);
 
+    /* move pc into R2 */
+    emit_movewide_imm(state, false, R2, pc);
+
     /* load &jit_mmu_handler */
     emit_movewide_imm(state, true, temp_reg, (uintptr_t) &jit_mmu_handler);
     /* blr jit_mmu_handler */
@@ -1771,6 +1895,62 @@ static inline void liveness_calc(block_t *block)
             liveness[rv_reg_sp] = idx;
             liveness[ir->rs2] = idx;
             break;
+#endif
+#if RV32_HAS(Zcb)
+        case rv_insn_clbu:
+        case rv_insn_clhu:
+        case rv_insn_clh:
+            liveness[ir->rs1] = idx;
+            break;
+        case rv_insn_csb:
+        case rv_insn_csh:
+            liveness[ir->rs1] = idx;
+            liveness[ir->rs2] = idx;
+            break;
+        case rv_insn_czextb:
+        case rv_insn_cnot:
+            liveness[ir->rd] = idx;
+            break;
+#if RV32_HAS(Zbb)
+        case rv_insn_csextb:
+        case rv_insn_czexth:
+        case rv_insn_csexth:
+            liveness[ir->rd] = idx;
+            break;
+#endif
+#if RV32_HAS(EXT_M)
+        case rv_insn_cmul:
+            liveness[ir->rs1] = idx;
+            liveness[ir->rs2] = idx;
+            break;
+#endif
+#endif
+#if RV32_HAS(Zicond)
+        case rv_insn_czeroeqz:
+        case rv_insn_czeronez:
+            liveness[ir->rs1] = idx;
+            liveness[ir->rs2] = idx;
+            break;
+#endif
+#if RV32_HAS(Zcmp)
+        case rv_insn_cmpush:
+            liveness[rv_reg_sp] = idx;
+            for (int i = 0; i < ir->imm2; i++)
+                liveness[zcmp_reg(i)] = idx;
+            break;
+        case rv_insn_cmpop:
+        case rv_insn_cmpopretz:
+        case rv_insn_cmpopret:
+            liveness[rv_reg_sp] = idx;
+            break;
+        case rv_insn_cmmvsa01:
+            liveness[rv_reg_a0] = idx;
+            liveness[rv_reg_a1] = idx;
+            break;
+        case rv_insn_cmmva01s:
+            liveness[ir->rs1] = idx;
+            liveness[ir->rs2] = idx;
+            break;
 #endif
         case rv_insn_fuse1:
             for (int i = 0; i < ir->imm2; i++) {
@@ -1792,6 +1972,8 @@ static inline void liveness_calc(block_t *block)
                 liveness[ir->fuse[i].rs1] = idx;
             }
             break;
+        case rv_insn_probe:
+            break;
         default:
             __UNREACHABLE;
         }
@@ -1972,7 +2154,7 @@ static void ra_load2_sext(struct jit_state *state,
         vm_reg[0] = vm_reg[1] = map_vm_reg(state, vm_reg_idx1);
     } else {
         vm_reg[0] = map_vm_reg(state, vm_reg_idx1);
-        vm_reg[1] = map_vm_reg_reserved(state, vm_reg_idx2, vm_reg[1]);
+        vm_reg[1] = map_vm_reg_reserved(state, vm_reg_idx2, vm_reg[0]);
         assert(vm_reg[0] != vm_reg[1]);
     }
 
@@ -2026,6 +2208,46 @@ void parse_branch_history_table(struct jit_state *state,
     }
 }
 
+#if RV32_HAS(Zcmp)
+/* Store the register list of cm.push right below sp and allocate the stack
+ * frame. The list is stored the same way as the stores of fuse3 are.
+ */
+static void emit_cm_push(struct jit_state *state, riscv_t *rv, rv_insn_t *ir)
+{
+    memory_t *m = PRIV(rv)->mem;
+    const int32_t base = -ir->imm2 * 4;
+    for (int i = 0; i < ir->imm2; i++) {
+        vm_reg[0] = ra_load(state, rv_reg_sp);
+        emit_load_imm_sext(state, temp_reg,
+                           (intptr_t) (m->mem_base + base + i * 4));
+        emit_alu64(state, 0x01, vm_reg[0], temp_reg);
+        vm_reg[1] = ra_load(state, zcmp_reg(i));
+        emit_store(state, S32, vm_reg[1], temp_reg, 0);
+    }
+    vm_reg[0] = ra_load(state, rv_reg_sp);
+    emit_alu32_imm32(state, 0x81, 0, vm_reg[0], -ir->imm);
+}
+
+/* Load the register list of cm.pop and its variants from the top of the stack
+ * frame and deallocate the frame.
+ */
+static void emit_cm_pop(struct jit_state *state, riscv_t *rv, rv_insn_t *ir)
+{
+    memory_t *m = PRIV(rv)->mem;
+    const int32_t base = ir->imm - ir->imm2 * 4;
+    for (int i = 0; i < ir->imm2; i++) {
+        vm_reg[0] = ra_load(state, rv_reg_sp);
+        emit_load_imm_sext(state, temp_reg,
+                           (intptr_t) (m->mem_base + base + i * 4));
+        emit_alu64(state, 0x01, vm_reg[0], temp_reg);
+        vm_reg[1] = map_vm_reg(state, zcmp_reg(i));
+        emit_load(state, S32, temp_reg, vm_reg[1], 0);
+    }
+    vm_reg[0] = ra_load(state, rv_reg_sp);
+    emit_alu32_imm32(state, 0x81, 0, vm_reg[0], ir->imm);
+}
+#endif
+
 #define GEN(inst, code)                                                       \
     static void do_##inst(struct jit_state *state UNUSED, riscv_t *rv UNUSED, \
                           rv_insn_t *ir UNUSED)                               \
@@ -2116,6 +2338,125 @@ static void do_fuse5(struct jit_state *state, riscv_t *rv UNUSED, rv_insn_t *ir)
     }
 }
 
+/* the instructions retired by the IRs from @ir to the end of its block, where
+ * a fused IR retires all the instructions it stands for, and a probe none
+ */
+static uint32_t insn_retired(const rv_insn_t *ir)
+{
+    uint32_t n_insn = 0;
+    for (; ir; ir = ir->next) {
+        switch (ir->opcode) {
+        case rv_insn_fuse1:
+        case rv_insn_fuse3:
+        case rv_insn_fuse4:
+        case rv_insn_fuse5:
+            n_insn += ir->imm2;
+            break;
+        case rv_insn_fuse2:
+            n_insn += 2;
+            break;
+        case rv_insn_probe:
+            break;
+        default:
+            n_insn++;
+            break;
+        }
+    }
+    return n_insn;
+}
+
+/* Account the instructions of a block for the performance-monitoring
+ * counters, as tier-1 code does not maintain the cycle counter. They are
+ * added as the block is entered, and the ones which do not retire as it is
+ * left early are taken back, see do_probe(). Nothing is emitted unless the
+ * count is read, see rv->hpm_t1_insn.
+ */
+static void emit_hpm_count(struct jit_state *state, int32_t n_insn)
+{
+    const int32_t offset = offsetof(riscv_t, hpm_events[RV_HPM_T1_INSN]);
+#if defined(__x86_64__)
+    /* add qword [rv + offset], n_insn */
+    emit_basic_rex(state, 1, 0, parameter_reg[0]);
+    emit1(state, 0x81);
+    emit_modrm_and_displacement(state, 0, parameter_reg[0], offset);
+    emit4(state, n_insn);
+#elif defined(__aarch64__)
+    const a64opcode_t op = n_insn < 0 ? AS_SUB : AS_ADD;
+    uint32_t n = n_insn < 0 ? -(uint32_t) n_insn : (uint32_t) n_insn;
+    emit_load_imm(state, R10, offset);
+    emit_addsub_register(state, true, AS_ADD, R10, parameter_reg[0], R10);
+    emit_loadstore_imm(state, LS_LDRX, temp_reg, R10, 0);
+    for (; n > 0xFFF; n -= 0xFFF)
+        emit_addsub_imm(state, true, op, temp_reg, temp_reg, 0xFFF);
+    emit_addsub_imm(state, true, op, temp_reg, temp_reg, n);
+    emit_loadstore_imm(state, LS_STRX, temp_reg, R10, 0);
+#endif
+}
+
+/* Call rv_probe() with the IR itself. Probes may sit in the middle of a block
+ * when instructions are instrumented, hence VM registers are written back
+ * before the call, which clobbers the caller-saved host registers, and only
+ * rv has to be preserved across it.
+ */
+static void do_probe(struct jit_state *state, riscv_t *rv, rv_insn_t *ir)
+{
+    store_back(state);
+    reset_reg();
+
+#if defined(__x86_64__)
+    /* push $rdi twice to keep the stack 16-byte aligned */
+    emit_push(state, parameter_reg[0]);
+    emit_push(state, parameter_reg[0]);
+
+    /* movabs $ir, %rsi */
+    emit_basic_rex(state, 1, 0, parameter_reg[1]);
+    emit1(state, 0xb8 | (parameter_reg[1] & 7));
+    emit8(state, (uintptr_t) ir);
+
+    /* call rv_probe */
+    emit_load_imm_sext(state, temp_reg, (uintptr_t) &rv_probe);
+    emit1(state, 0xff);
+    emit_modrm(state, 0x3 << 6, 0x2, temp_reg);
+
+    /* pop rv to $rdi */
+    emit_pop(state, parameter_reg[0]);
+    emit_pop(state, parameter_reg[0]);
+
+    /* test %al, %al */
+    emit1(state, 0x84);
+    emit1(state, 0xc0);
+#elif defined(__aarch64__)
+    /* push rv into stack */
+    emit_a64(state, (0xf81f0fe << 4) | R0);
+
+    /* move ir into R1 */
+    emit_movewide_imm(state, true, R1, (uintptr_t) ir);
+
+    /* blr rv_probe */
+    emit_movewide_imm(state, true, temp_reg, (uintptr_t) &rv_probe);
+    emit_uncond_branch_reg(state, BR_BLR, temp_reg);
+
+    /* only the lowest byte of a returned bool is defined */
+    emit_mov(state, R0, temp_reg);
+    emit_alu32_imm32(state, 0x81, 4, temp_reg, 0xff);
+
+    /* pop from stack */
+    emit_a64(state, (0xf84107e << 4) | R0);
+
+    emit_cmp_imm32(state, temp_reg, 0);
+#endif
+    /* continue with the block unless rv_probe requests to stop, in which case
+     * rv->PC has been set to the address of the instrumented code, and the
+     * rest of the block does not retire.
+     */
+    uint32_t jump_loc_0 = state->offset;
+    emit_jcc_offset(state, 0x85);
+    if (rv->hpm_t1_insn)
+        emit_hpm_count(state, -(int32_t) insn_retired(ir->next));
+    emit_exit(state);
+    emit_jump_target_offset(state, JUMP_LOC_0, state->offset);
+}
+
 /* clang-format off */
 static const void *dispatch_table[] = {
     /* RV32 instructions */
@@ -2147,6 +2488,11 @@ static void code_cache_flush(struct jit_state *state, riscv_t *rv)
     return;
 }
 
+void jit_state_flush(riscv_t *rv)
+{
+    code_cache_flush(rv->jit_state, rv);
+}
+
 typedef void (*codegen_block_func_t)(struct jit_state *,
                                      riscv_t *,
                                      rv_insn_t *);
@@ -2158,6 +2504,9 @@ static void translate(struct jit_state *state, riscv_t *rv, block_t *block)
     reset_reg();
     liveness_reset();
     liveness_calc(block);
+    if (rv->hpm_t1_insn)
+        emit_hpm_count(state, insn_retired(block->ir_head));
+    state->n_insn += block->n_insn;
     for (idx = 0, ir = block->ir_head; idx < block->n_insn && !should_flush;
          idx++, ir = next) {
         next = ir->next;
@@ -2296,6 +2645,7 @@ restart:
         goto restart;
     }
     resolve_jumps(state);
+    state->n_bytes += state->offset - block->offset;
     block->hot = true;
 }
 
@@ -2305,6 +2655,7 @@ struct jit_state *jit_state_init(size_t size)
     assert(state);
     state->offset = 0;
     state->size = size;
+    state->n_insn = state->n_bytes = 0;
     state->buf = mmap(0, size, PROT_READ | PROT_WRITE | PROT_EXEC,
                       MAP_PRIVATE | MAP_ANONYMOUS
 #if defined(__APPLE__)
@@ -2314,7 +2665,7 @@ struct jit_state *jit_state_init(size_t size)
                       -1, 0);
     state->n_blocks = 0;
     assert(state->buf != MAP_FAILED);
-    set_reset(&state->set);
+    set_init(&state->set);
     reset_reg();
     prepare_translate(state);
     state->offset_map = calloc(MAX_BLOCKS, sizeof(struct offset_map));
@@ -41,6 +41,8 @@ struct jit_state {
     int n_blocks;
     struct jump *jumps;
     int n_jumps;
+    uint64_t n_insn;  /* guest instructions translated so far */
+    uint64_t n_bytes; /* host code emitted so far */
 };
 
 struct host_reg {
@@ -54,12 +56,26 @@ struct host_reg {
 struct jit_state *jit_state_init(size_t size);
 void jit_state_exit(struct jit_state *state);
 void jit_translate(riscv_t *rv, block_t *block);
+/* forget the code emitted so far, whose blocks have been freed */
+void jit_state_flush(riscv_t *rv);
 typedef void (*exec_block_func_t)(riscv_t *rv, uintptr_t);
 
 #if RV32_HAS(T2C)
 void t2c_compile(riscv_t *, block_t *);
 typedef void (*exec_t2c_func_t)(riscv_t *);
 
+/* Ahead-of-time compilation, see aot.c. A module collects a function per
+ * region, named @name, which is emitted as position-independent code into an
+ * object file along with the 32-bit words of @table.
+ */
+void *t2c_aot_create(void);
+void t2c_aot_add(void *module, riscv_t *rv, block_t *block, const char *name);
+bool t2c_aot_emit(void *module,
+                  const char *table_name,
+                  const uint32_t *table,
+                  uint32_t n_words,
+                  const char *path);
+
 /* The jit-cache records the program counters and the entries of executable
  * instructions generated by T2C. Like hardware cache, the old jit-cache will be
  * replaced by the new one which uses the same slot.
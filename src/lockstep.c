@@ -0,0 +1,439 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io.h"
+#include "lockstep.h"
+#include "riscv_private.h"
+
+/* the reference runs at most this many instructions, or touches as many
+ * bytes of memory, in a dispatch
+ */
+#define LOCKSTEP_MAX_INSN (1U << 20)
+#define LOCKSTEP_MAX_BYTES (1U << 18)
+
+#define BYTE_BITS 19 /* twice LOCKSTEP_MAX_BYTES, to keep probing short */
+#define SPAN_BITS 12
+#define MAX_REPORTED_BYTES 16
+
+static const char *insn_names[] = {
+#define _(inst, can_branch, insn_len, translatable, reg_mask) \
+    [rv_insn_##inst] = #inst,
+    RV_INSN_LIST
+#undef _
+#define _(inst) [rv_insn_##inst] = #inst,
+        FUSE_INSN_LIST
+#undef _
+};
+
+/* a byte of guest memory the reference touched during a dispatch */
+typedef struct {
+    uint32_t addr;
+    uint32_t epoch; /**< the slot is in use if this is the current dispatch */
+    uint32_t run;   /**< cur is valid if this is the current run */
+    bool has_pre;
+    uint8_t pre; /**< the byte before the dispatch */
+    uint8_t cur; /**< the byte stored by the current run */
+} byte_t;
+
+/* how far the reference runs ahead of a dispatch from @pc, in instructions */
+typedef struct {
+    uint32_t pc, n_insn;
+} span_t;
+
+struct lockstep {
+    riscv_t *rv;
+    riscv_t *start;  /**< the state before the dispatch */
+    riscv_t *shadow; /**< the reference, run from start */
+    riscv_io_t io;   /**< the I/O of the reference */
+#if !RV32_HAS(JIT)
+    block_t *no_block[1]; /**< block map of the reference, which stays empty */
+#else
+    struct cache *no_block;
+#endif
+
+    /* The memory as seen by the reference, an open-addressing table of the
+     * bytes it touched. The byte before the dispatch is kept on the first
+     * read, so that the reference can run again once the emulator has
+     * changed the memory.
+     */
+    byte_t *bytes;
+    uint32_t *stores; /**< slots stored by the current run, in order */
+    uint32_t n_bytes, n_stores, epoch, run;
+    bool trapped, overflow;
+
+    span_t spans[1U << SPAN_BITS];
+
+    /* the dispatch being checked */
+    bool pending;
+    bool partial; /**< the run ahead stopped within an instruction */
+    const block_t *block;
+    uint32_t pc, n_ahead;
+    uint64_t icount, t1_insn, t2_insn;
+
+    uint64_t n_checked, n_unchecked;
+};
+
+static byte_t *byte_of(lockstep_t *ls, uint32_t addr)
+{
+    const uint32_t mask = (1U << BYTE_BITS) - 1;
+    uint32_t slot = (addr * 2654435761U) >> (32 - BYTE_BITS);
+    for (;; slot = (slot + 1) & mask) {
+        byte_t *b = &ls->bytes[slot];
+        if (b->epoch != ls->epoch) {
+            if (ls->n_bytes == LOCKSTEP_MAX_BYTES) {
+                ls->overflow = true;
+                return NULL;
+            }
+            ls->n_bytes++;
+            b->epoch = ls->epoch;
+            b->run = 0;
+            b->addr = addr;
+            b->has_pre = false;
+            return b;
+        }
+        if (b->addr == addr)
+            return b;
+    }
+}
+
+static uint8_t read_byte(lockstep_t *ls, uint32_t addr)
+{
+    byte_t *b = byte_of(ls, addr);
+    if (!b)
+        return 0;
+    if (b->run == ls->run)
+        return b->cur;
+    if (!b->has_pre) {
+        b->pre = memory_read_b(addr);
+        b->has_pre = true;
+    }
+    return b->pre;
+}
+
+static void write_byte(lockstep_t *ls, uint32_t addr, uint8_t value)
+{
+    byte_t *b = byte_of(ls, addr);
+    if (!b)
+        return;
+    if (b->run != ls->run) {
+        b->run = ls->run;
+        ls->stores[ls->n_stores++] = b - ls->bytes;
+    }
+    b->cur = value;
+}
+
+static uint32_t read_bytes(riscv_t *shadow, uint32_t addr, uint32_t len)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < len; i++)
+        value |= (uint32_t) read_byte(shadow->lockstep, addr + i) << (8 * i);
+    return value;
+}
+
+static void write_bytes(riscv_t *shadow,
+                        uint32_t addr,
+                        uint32_t value,
+                        uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+        write_byte(shadow->lockstep, addr + i, value >> (8 * i));
+}
+
+static riscv_word_t ref_ifetch(riscv_t *shadow UNUSED, riscv_word_t addr)
+{
+    return memory_ifetch(addr);
+}
+
+static riscv_word_t ref_read_w(riscv_t *shadow, riscv_word_t addr)
+{
+    return read_bytes(shadow, addr, 4);
+}
+
+static riscv_half_t ref_read_s(riscv_t *shadow, riscv_word_t addr)
+{
+    return read_bytes(shadow, addr, 2);
+}
+
+static riscv_byte_t ref_read_b(riscv_t *shadow, riscv_word_t addr)
+{
+    return read_bytes(shadow, addr, 1);
+}
+
+static void ref_write_w(riscv_t *shadow, riscv_word_t addr, riscv_word_t data)
+{
+    write_bytes(shadow, addr, data, 4);
+}
+
+static void ref_write_s(riscv_t *shadow, riscv_word_t addr, riscv_half_t data)
+{
+    write_bytes(shadow, addr, data, 2);
+}
+
+static void ref_write_b(riscv_t *shadow, riscv_word_t addr, riscv_byte_t data)
+{
+    write_bytes(shadow, addr, data, 1);
+}
+
+/* traps are left to the emulator, the dispatch is not checked */
+static void ref_on_trap(riscv_t *shadow)
+{
+    shadow->lockstep->trapped = true;
+}
+
+lockstep_t *lockstep_create(riscv_t *rv)
+{
+    lockstep_t *ls = calloc(1, sizeof(lockstep_t));
+    assert(ls);
+    ls->rv = rv;
+    ls->start = malloc(sizeof(riscv_t));
+    ls->shadow = malloc(sizeof(riscv_t));
+    ls->bytes = calloc(1U << BYTE_BITS, sizeof(byte_t));
+    ls->stores = malloc(sizeof(uint32_t) * LOCKSTEP_MAX_BYTES);
+    assert(ls->start && ls->shadow && ls->bytes && ls->stores);
+#if RV32_HAS(JIT)
+    ls->no_block = cache_create(1);
+    assert(ls->no_block);
+#endif
+
+    ls->io = rv->io;
+    ls->io.mem_ifetch = ref_ifetch;
+    ls->io.mem_read_w = ref_read_w;
+    ls->io.mem_read_s = ref_read_s;
+    ls->io.mem_read_b = ref_read_b;
+    ls->io.mem_write_w = ref_write_w;
+    ls->io.mem_write_s = ref_write_s;
+    ls->io.mem_write_b = ref_write_b;
+    ls->io.on_trap = ref_on_trap;
+    return ls;
+}
+
+static span_t *span_of(lockstep_t *ls, uint32_t pc)
+{
+    return &ls->spans[(pc >> 1) & ((1U << SPAN_BITS) - 1)];
+}
+
+/* Run the reference from the state before the dispatch, for @limit
+ * instructions or, given @block, to the end of the block. Returns the number
+ * of instructions which ran to completion.
+ */
+static uint32_t run_reference(lockstep_t *ls,
+                              uint32_t limit,
+                              const block_t *block)
+{
+    riscv_t *shadow = ls->shadow;
+    memcpy(shadow, ls->start, sizeof(riscv_t));
+    ls->run++;
+    ls->n_stores = 0;
+    ls->trapped = ls->overflow = ls->partial = false;
+
+    uint32_t n_insn = 0;
+    while (n_insn < limit) {
+        const uint32_t pc = shadow->PC;
+        const uint32_t len = is_compressed(memory_ifetch(pc)) ? 2 : 4;
+        if (!rv_step_reference(shadow))
+            break;
+        if (ls->trapped || ls->overflow || shadow->halt) {
+            ls->partial = true;
+            break;
+        }
+        n_insn++;
+        if (block && (shadow->PC != pc + len || pc + len >= block->pc_end))
+            break;
+    }
+    return n_insn;
+}
+
+void lockstep_begin(riscv_t *rv, const block_t *block)
+{
+    lockstep_t *ls = rv->lockstep;
+    ls->pending = false;
+
+    /* without a span, stop at the end of the first block */
+    const span_t *span = span_of(ls, rv->PC);
+    const uint32_t limit = span->pc == rv->PC ? span->n_insn : 0;
+    if (limit > LOCKSTEP_MAX_INSN) {
+        ls->n_unchecked++;
+        return;
+    }
+
+    riscv_t *start = ls->start;
+    memcpy(start, rv, sizeof(riscv_t));
+    start->io = ls->io;
+#if !RV32_HAS(JIT)
+    start->block_map.block_capacity = 1;
+    start->block_map.map = ls->no_block;
+#else
+    start->block_cache = ls->no_block;
+#endif
+    ls->epoch++;
+    ls->n_bytes = 0;
+
+    ls->n_ahead = run_reference(ls, limit ? limit : LOCKSTEP_MAX_INSN,
+                                limit ? NULL : block);
+    if (!ls->n_ahead) {
+        ls->n_unchecked++;
+        return;
+    }
+
+    ls->pending = true;
+    ls->block = block;
+    ls->pc = rv->PC;
+    ls->icount = rv_icount(rv);
+    ls->t1_insn = rv->hpm_events[RV_HPM_T1_INSN];
+    ls->t2_insn = rv->hpm_events[RV_HPM_T2_INSN];
+}
+
+static void report(lockstep_t *ls, uint32_t n_insn)
+{
+    riscv_t *rv = ls->rv, *shadow = ls->shadow;
+    const block_t *block = ls->block;
+    const char *engine = "interpreter";
+    if (rv->hpm_events[RV_HPM_T2_INSN] != ls->t2_insn)
+        engine = "tier-2 JIT";
+    else if (rv->hpm_events[RV_HPM_T1_INSN] != ls->t1_insn)
+        engine = "tier-1 JIT";
+
+    rv_log_error("Lockstep divergence in the %s, dispatched at 0x%08" PRIx32
+                 " after %" PRIu64 " instructions, running %" PRIu32
+                 " instructions",
+                 engine, ls->pc, ls->icount, n_insn);
+    rv_log_error("  register    reference   %s", engine);
+    if (shadow->PC != rv->PC)
+        rv_log_error("  pc          0x%08" PRIx32 "  0x%08" PRIx32, shadow->PC,
+                     rv->PC);
+    for (uint32_t i = 0; i < N_RV_REGS; i++) {
+        if (shadow->X[i] != rv->X[i])
+            rv_log_error("  x%-2" PRIu32 "         0x%08" PRIx32
+                         "  0x%08" PRIx32,
+                         i, shadow->X[i], rv->X[i]);
+    }
+#if RV32_HAS(EXT_F)
+    for (uint32_t i = 0; i < N_RV_REGS; i++) {
+        if (shadow->F[i].v != rv->F[i].v)
+            rv_log_error("  f%-2" PRIu32 "         0x%08" PRIx32
+                         "  0x%08" PRIx32,
+                         i, shadow->F[i].v, rv->F[i].v);
+    }
+#endif
+#if RV32_HAS(Zve32x)
+    for (uint32_t i = 0; i < 32; i++) {
+        for (uint32_t j = 0; j < VLENB; j += 4) {
+            uint32_t ref, cur;
+            memcpy(&ref, &shadow->V[i][j], sizeof(ref));
+            memcpy(&cur, &rv->V[i][j], sizeof(cur));
+            if (ref != cur)
+                rv_log_error("  v%-2" PRIu32 "[%2" PRIu32 "]     0x%08" PRIx32
+                             "  0x%08" PRIx32,
+                             i, j / 4, ref, cur);
+        }
+    }
+#endif
+    uint32_t n_bytes = 0;
+    for (uint32_t i = 0; i < ls->n_stores; i++) {
+        const byte_t *b = &ls->bytes[ls->stores[i]];
+        const uint8_t value = memory_read_b(b->addr);
+        if (b->cur == value)
+            continue;
+        if (n_bytes++ == MAX_REPORTED_BYTES) {
+            rv_log_error("  more bytes differ");
+            break;
+        }
+        rv_log_error("  [0x%08" PRIx32 "]  0x%02x        0x%02x", b->addr,
+                     b->cur, value);
+    }
+
+    rv_log_error("IR of the block at 0x%08" PRIx32 "-0x%08" PRIx32 ":",
+                 block->pc_start, block->pc_end);
+    const rv_insn_t *ir = block->ir_head;
+    for (uint32_t i = 0; i < block->n_insn && ir; i++, ir = ir->next) {
+        const char *name =
+            ir->opcode < ARRAY_SIZE(insn_names) ? insn_names[ir->opcode] : 0;
+        rv_log_error("  0x%08" PRIx32 "  %-10s rd=%-2u rs1=%-2u rs2=%-2u "
+                     "imm=%" PRId32 " imm2=%" PRId32,
+                     ir->pc, name ? name : "?", ir->rd, ir->rs1, ir->rs2,
+                     ir->imm, ir->imm2);
+    }
+}
+
+void lockstep_end(riscv_t *rv)
+{
+    lockstep_t *ls = rv->lockstep;
+    if (!ls->pending)
+        return;
+    ls->pending = false;
+
+    const uint64_t n_insn = rv_icount(rv) - ls->icount;
+    span_t *span = span_of(ls, ls->pc);
+    if (span->pc != ls->pc) {
+        span->pc = ls->pc;
+        span->n_insn = 0;
+    }
+    /* a shorter dispatch halves the span, so that a single long one does not
+     * make the reference run far ahead of all the later ones
+     */
+    if (n_insn >= span->n_insn)
+        span->n_insn = n_insn > LOCKSTEP_MAX_INSN ? LOCKSTEP_MAX_INSN + 1
+                                                  : n_insn;
+    else
+        span->n_insn = n_insn > span->n_insn / 2 ? n_insn : span->n_insn / 2;
+    if (n_insn > ls->n_ahead || (n_insn == ls->n_ahead && ls->partial)) {
+        ls->n_unchecked++;
+        return;
+    }
+
+    /* The reference went further than the dispatch. Run it again, only as
+     * far, reading the memory as it was before the dispatch.
+     */
+    if (n_insn < ls->n_ahead || ls->partial) {
+        if (run_reference(ls, n_insn, NULL) != n_insn || ls->partial) {
+            ls->n_unchecked++;
+            return;
+        }
+    }
+
+    riscv_t *shadow = ls->shadow;
+    bool diverged = shadow->PC != rv->PC ||
+                    memcmp(shadow->X, rv->X, sizeof(rv->X));
+#if RV32_HAS(EXT_F)
+    diverged |= !!memcmp(shadow->F, rv->F, sizeof(rv->F));
+#endif
+#if RV32_HAS(Zve32x)
+    diverged |= !!memcmp(shadow->V, rv->V, sizeof(rv->V));
+#endif
+    for (uint32_t i = 0; i < ls->n_stores && !diverged; i++) {
+        const byte_t *b = &ls->bytes[ls->stores[i]];
+        diverged = b->cur != memory_read_b(b->addr);
+    }
+    ls->n_checked++;
+    if (!diverged)
+        return;
+
+    report(ls, n_insn);
+    PRIV(rv)->exit_code = 1;
+    rv_halt(rv);
+}
+
+void lockstep_delete(lockstep_t *ls)
+{
+    if (!ls)
+        return;
+
+    rv_log_info("Lockstep: %" PRIu64 " dispatches checked, %" PRIu64
+                " unchecked",
+                ls->n_checked, ls->n_unchecked);
+#if RV32_HAS(JIT)
+    cache_free(ls->no_block);
+#endif
+    free(ls->stores);
+    free(ls->bytes);
+    free(ls->shadow);
+    free(ls->start);
+    free(ls);
+}
@@ -0,0 +1,52 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "riscv.h"
+
+/* Lockstep differential execution.
+ *
+ * Before every dispatch of rv_step, which runs a block, or a chain or region
+ * of blocks, in the interpreter or in the code of a JIT compiler, a copy of
+ * the registers runs ahead through the reference interpreter one instruction
+ * at a time, i.e., as decoded, without macro-operation fusion, constant
+ * optimization or block chaining. The reference keeps the bytes it stores
+ * apart, along with those it reads as they were before the dispatch, so the
+ * guest memory is left for the optimized run. After the dispatch, the
+ * reference is brought to the same instruction count, running again from the
+ * start if it went further, and the integer, floating-point and vector
+ * registers, the PC and every byte the reference stored are compared. A
+ * divergence reports the block along with its IR and halts the emulator.
+ *
+ * The reference runs as far as the longest recent dispatch from the same
+ * address, or to the end of the first block the first time. Dispatches going
+ * further than the reference, and those reaching a system instruction such
+ * as ecall, are counted as unchecked.
+ */
+
+typedef struct lockstep lockstep_t;
+struct block;
+
+/**
+ * lockstep_create - check every dispatch against the reference interpreter
+ * @rv: a pointer points to the RISC-V emulator
+ */
+lockstep_t *lockstep_create(riscv_t *rv);
+
+/* run the reference ahead of the dispatch of @block */
+void lockstep_begin(riscv_t *rv, const struct block *block);
+
+/* compare the dispatch which has just run with its reference, if any */
+void lockstep_end(riscv_t *rv);
+
+/**
+ * lockstep_delete - report the number of checked dispatches and release
+ * @ls: a pointer points to the lockstep checker
+ */
+void lockstep_delete(lockstep_t *ls);
@@ -14,6 +14,9 @@
 #include "elf.h"
 #include "riscv.h"
 #include "utils.h"
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+#include "aot.h"
+#endif
 
 /* enable program trace mode */
 #if !RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER))
@@ -42,7 +45,7 @@ static char *opt_prog_name;
 /* target argc and argv */
 static int prog_argc;
 static char **prog_args;
-static const char *optstr = "tgqmhpd:a:k:i:b:x:";
+static const char *optstr = "tgqmhpDd:a:k:i:b:x:B:P:C:F:W:L:I:R:A:e:";
 
 /* enable misaligned memory access */
 static bool opt_misaligned = false;
@@ -51,12 +54,73 @@ static bool opt_misaligned = false;
 static bool opt_prof_data = false;
 static char *prof_out_file;
 
+/* basic-block vectors for SimPoint */
+static bool opt_bbv = false;
+static char *bbv_out_file;
+static uint64_t bbv_interval = 100000000; /* SimPoint's usual choice */
+static int64_t bbv_stop = -1;
+static int64_t bbv_checkpoint = -1;
+
+/* guest code coverage */
+static bool opt_coverage = false;
+static char *coverage_out_file;
+static uint8_t coverage_format = RV_COVERAGE_DRCOV;
+
+/* icount mode, i.e., guest time derived from the retired instructions */
+static uint32_t icount_mips = 0;
+
+/* record or replay of the nondeterministic inputs */
+static char *replay_log;
+static bool replay_record = false;
+
+#if !RV32_HAS(SYSTEM)
+/* lockstep differential execution */
+static bool opt_lockstep = false;
+#endif
+
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+/* ahead-of-time compilation */
+static char *aot_file;
+static bool aot_compile_only = false;
+#endif
+
+/* execution engine and the block optimizations it uses */
+static uint8_t engine = RV_ENGINE_DEFAULT;
+static bool no_fusion = false;
+static bool no_chaining = false;
+
+/* warm-up curve */
+static bool opt_warmup = false;
+static char *warmup_out_file;
+static uint32_t warmup_interval = 10; /* milliseconds */
+
+#if RV32_HAS(FUZZ)
+/* persistent fuzzing */
+static bool opt_fuzz = false;
+static char *fuzz_entry;
+static uint32_t fuzz_max_len = 65536;
+static uint32_t fuzz_iterations = 1000;
+#endif
+
+#if RV32_HAS(PLUGIN)
+/* instrumentation plugins */
+static char **plugin_specs;
+static int n_plugins;
+#endif
+
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
 /* Linux kernel data */
 static char *opt_kernel_img;
 static char *opt_rootfs_img;
 static char *opt_bootargs;
 static char *opt_virtio_blk_img;
+
+/* boot-time profile */
+static bool opt_bootprof = false;
+static char *bootprof_out_file;
+static char *bootprof_map_file;
+static char *bootprof_prompt = "login:";
+static bool bootprof_halt = false;
 #endif
 
 static void print_usage(const char *filename)
@@ -77,6 +141,10 @@ static void print_usage(const char *filename)
         "  -x vblk:<image>[,readonly] : use <image> as virtio-blk disk image "
         "(default read and write)\n"
         "  -b <bootargs> : use customized <bootargs> for the kernel\n"
+        "  -L <filename>[,map=<System.map>][,prompt=<string>][,exit] : write "
+        "the time and events taken by every boot phase, until <string> "
+        "(default \"login:\") is printed, to <filename>, timing each "
+        "initcall given the kernel symbols, and optionally halt there\n"
 #endif
         "  -d [filename]: dump registers as JSON to the "
         "given file or `-` (STDOUT)\n"
@@ -85,10 +153,175 @@ static void print_usage(const char *filename)
         "required by arch-test test\n"
         "  -m : enable misaligned memory access\n"
         "  -p : generate profiling data\n"
+        "  -B <filename>[,interval=<n>][,stop=<k>][,checkpoint=<k>] : write "
+        "basic-block vectors of <n> instructions per interval (default "
+        "100000000) to <filename>, and optionally halt or checkpoint once <k> "
+        "intervals are complete\n"
+#if !RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER))
+        "  -C <filename>[,format=<drcov|lcov>] : write the coverage of the "
+        "executed blocks to <filename> (default format: drcov)\n"
+#endif
+#if RV32_HAS(FUZZ) && \
+    (!RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER)))
+        "  -F <function>[,max_len=<n>][,iterations=<k>] : fuzz <function> "
+        "under afl-fuzz with inputs of up to <n> bytes (default 65536), "
+        "running <k> inputs per forked child (default 1000)\n"
+#endif
+#if RV32_HAS(PLUGIN)
+        "  -P <plugin>[,<args>] : load the instrumentation plugin <plugin> "
+        "and pass <args> to it, can be repeated\n"
+#endif
+        "  -I <mips> : derive the time seen by the guest from the retired "
+        "instructions, as if it ran at <mips> million instructions per "
+        "second, so that repeated runs are identical\n"
+        "  -R record:<filename> | replay:<filename> : log the system call "
+        "results and the UART input to <filename>, or feed them back from "
+        "it\n"
+#if !RV32_HAS(SYSTEM)
+        "  -D : run every block through the reference interpreter as well, "
+        "compare the registers and stores, and halt on a divergence\n"
+#endif
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+        "  -A compile:<filename> | load:<filename> : compile the code of the "
+        "program ahead of time into the shared object <filename> and exit, "
+        "or run the program with the code of <filename>\n"
+#endif
+        "  -e <interp|t1|t2c>[,nofusion][,nochain] : run on the given "
+        "execution engine, which defaults to the highest one built in, and "
+        "optionally without macro-operation fusion or block chaining\n"
+        "  -W <filename>[,interval=<ms>] : write the throughput of every "
+        "execution tier and the time spent compiling, sampled every <ms> "
+        "milliseconds (default 10), as CSV to <filename>\n"
         "  -h : show this message",
         filename);
 }
 
+static bool parse_bbv_opts(char *opts)
+{
+    char *opt = strtok(opts, ",");
+    bbv_out_file = opt;
+    while ((opt = strtok(NULL, ","))) {
+        if (!strncmp("interval=", opt, 9))
+            bbv_interval = strtoull(opt + 9, NULL, 0);
+        else if (!strncmp("stop=", opt, 5))
+            bbv_stop = strtoll(opt + 5, NULL, 0);
+        else if (!strncmp("checkpoint=", opt, 11))
+            bbv_checkpoint = strtoll(opt + 11, NULL, 0);
+        else {
+            rv_log_error("Unknown BBV option: %s", opt);
+            return false;
+        }
+    }
+    return bbv_out_file && bbv_interval;
+}
+
+#if !RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER))
+static bool parse_coverage_opts(char *opts)
+{
+    char *opt = strtok(opts, ",");
+    coverage_out_file = opt;
+    while ((opt = strtok(NULL, ","))) {
+        if (!strcmp("format=drcov", opt))
+            coverage_format = RV_COVERAGE_DRCOV;
+        else if (!strcmp("format=lcov", opt))
+            coverage_format = RV_COVERAGE_LCOV;
+        else {
+            rv_log_error("Unknown coverage option: %s", opt);
+            return false;
+        }
+    }
+    return coverage_out_file;
+}
+#endif
+
+static bool parse_warmup_opts(char *opts)
+{
+    char *opt = strtok(opts, ",");
+    warmup_out_file = opt;
+    while ((opt = strtok(NULL, ","))) {
+        if (!strncmp("interval=", opt, 9))
+            warmup_interval = strtoul(opt + 9, NULL, 0);
+        else {
+            rv_log_error("Unknown warm-up option: %s", opt);
+            return false;
+        }
+    }
+    return warmup_out_file && warmup_interval;
+}
+
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+static bool parse_bootprof_opts(char *opts)
+{
+    char *opt = strtok(opts, ",");
+    bootprof_out_file = opt;
+    while ((opt = strtok(NULL, ","))) {
+        if (!strncmp("map=", opt, 4))
+            bootprof_map_file = opt + 4;
+        else if (!strncmp("prompt=", opt, 7))
+            bootprof_prompt = opt + 7;
+        else if (!strcmp("exit", opt))
+            bootprof_halt = true;
+        else {
+            rv_log_error("Unknown boot profile option: %s", opt);
+            return false;
+        }
+    }
+    return bootprof_out_file && *bootprof_prompt;
+}
+#endif
+
+static bool parse_engine_opts(char *opts)
+{
+    static const char *names[] = {
+        [RV_ENGINE_INTERP] = "interp",
+        [RV_ENGINE_T1] = "t1",
+        [RV_ENGINE_T2C] = "t2c",
+    };
+    char *opt = strtok(opts, ",");
+    for (uint8_t i = RV_ENGINE_INTERP; opt && i <= RV_ENGINE_T2C; i++) {
+        if (!strcmp(names[i], opt))
+            engine = i;
+    }
+    if (engine == RV_ENGINE_DEFAULT) {
+        rv_log_error("Unknown execution engine: %s", opt ? opt : "");
+        return false;
+    }
+    if (engine > RV_ENGINE_BUILTIN) {
+        rv_log_error("Execution engine %s is not built in", opt);
+        return false;
+    }
+    while ((opt = strtok(NULL, ","))) {
+        if (!strcmp("nofusion", opt))
+            no_fusion = true;
+        else if (!strcmp("nochain", opt))
+            no_chaining = true;
+        else {
+            rv_log_error("Unknown engine option: %s", opt);
+            return false;
+        }
+    }
+    return true;
+}
+
+#if RV32_HAS(FUZZ)
+static bool parse_fuzz_opts(char *opts)
+{
+    char *opt = strtok(opts, ",");
+    fuzz_entry = opt;
+    while ((opt = strtok(NULL, ","))) {
+        if (!strncmp("max_len=", opt, 8))
+            fuzz_max_len = strtoul(opt + 8, NULL, 0);
+        else if (!strncmp("iterations=", opt, 11))
+            fuzz_iterations = strtoul(opt + 11, NULL, 0);
+        else {
+            rv_log_error("Unknown fuzzing option: %s", opt);
+            return false;
+        }
+    }
+    return fuzz_entry && fuzz_max_len && fuzz_iterations;
+}
+#endif
+
 static bool parse_args(int argc, char **args)
 {
     int opt;
@@ -128,6 +361,12 @@ static bool parse_args(int argc, char **args)
                 return false;
             emu_argc++;
             break;
+        case 'L':
+            opt_bootprof = true;
+            if (!parse_bootprof_opts(optarg))
+                return false;
+            emu_argc++;
+            break;
 #endif
         case 'q':
             opt_quiet_outputs = true;
@@ -150,6 +389,78 @@ static bool parse_args(int argc, char **args)
             signature_out_file = optarg;
             emu_argc++;
             break;
+        case 'B':
+            opt_bbv = true;
+            if (!parse_bbv_opts(optarg))
+                return false;
+            emu_argc++;
+            break;
+#if !RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER))
+        case 'C':
+            opt_coverage = true;
+            if (!parse_coverage_opts(optarg))
+                return false;
+            emu_argc++;
+            break;
+#endif
+#if RV32_HAS(FUZZ) && \
+    (!RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER)))
+        case 'F':
+            opt_fuzz = true;
+            if (!parse_fuzz_opts(optarg))
+                return false;
+            emu_argc++;
+            break;
+#endif
+        case 'I':
+            icount_mips = strtoul(optarg, NULL, 0);
+            if (!icount_mips)
+                return false;
+            emu_argc++;
+            break;
+        case 'R':
+            if (!strncmp("record:", optarg, 7))
+                replay_record = true;
+            else if (strncmp("replay:", optarg, 7))
+                return false;
+            replay_log = optarg + 7; /* strlen("record:") */
+            emu_argc++;
+            break;
+#if !RV32_HAS(SYSTEM)
+        case 'D':
+            opt_lockstep = true;
+            break;
+#endif
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+        case 'A':
+            if (!strncmp("compile:", optarg, 8))
+                aot_compile_only = true;
+            else if (strncmp("load:", optarg, 5))
+                return false;
+            aot_file = strchr(optarg, ':') + 1;
+            emu_argc++;
+            break;
+#endif
+        case 'e':
+            if (!parse_engine_opts(optarg))
+                return false;
+            emu_argc++;
+            break;
+        case 'W':
+            opt_warmup = true;
+            if (!parse_warmup_opts(optarg))
+                return false;
+            emu_argc++;
+            break;
+#if RV32_HAS(PLUGIN)
+        case 'P':
+            plugin_specs =
+                realloc(plugin_specs, (n_plugins + 1) * sizeof(char *));
+            assert(plugin_specs);
+            plugin_specs[n_plugins++] = optarg;
+            emu_argc++;
+            break;
+#endif
         default:
             return false;
         }
@@ -226,17 +537,44 @@ static void dump_test_signature(const char *prog_name)
 /* To use rv_halt function in wasm, we have to expose RISC-V instance(rv),
  * but we can add a layer to not expose the instance and make rv_halt
  * callable. A small trade-off is that declaring instance as a global
- * variable. rv_halt is useful when cancelling the main loop of wasm,
- * see rv_step in emulate.c for more detail
+ * variable. The page calls rv_halt from the main thread of the browser to
+ * stop the emulation worker, which then returns from main(), before it runs
+ * the next ELF, see mk/wasm.mk and assets/wasm/html/index.html
  */
 riscv_t *rv;
 #ifdef __EMSCRIPTEN__
+/* the number of calls of the page which may be reading rv, which the worker
+ * waits to drain after it retracts rv and before it deletes the instance,
+ * so that the main thread of the browser never blocks on the worker
+ */
+static int rv_readers;
+
 void indirect_rv_halt()
 {
-    rv_halt(rv);
+    /* announce the read before making it, which pairs with the retraction in
+     * rv_publish(): either the worker sees the reader and waits, or the
+     * reader sees NULL
+     */
+    __atomic_add_fetch(&rv_readers, 1, __ATOMIC_SEQ_CST);
+    riscv_t *vm = __atomic_load_n(&rv, __ATOMIC_SEQ_CST);
+    if (vm) /* nothing runs before the first ELF or after it exits */
+        rv_halt(vm);
+    __atomic_sub_fetch(&rv_readers, 1, __ATOMIC_RELEASE);
 }
 #endif
 
+static void rv_publish(riscv_t *new_rv)
+{
+#ifdef __EMSCRIPTEN__
+    __atomic_store_n(&rv, new_rv, __ATOMIC_SEQ_CST);
+    /* the page only holds rv for the few instructions of rv_halt() */
+    while (!new_rv && __atomic_load_n(&rv_readers, __ATOMIC_SEQ_CST))
+        ;
+#else
+    rv = new_rv;
+#endif
+}
+
 int main(int argc, char **args)
 {
     if (argc == 1 || !parse_args(argc, args)) {
@@ -252,6 +590,15 @@ int main(int argc, char **args)
     run_flag |= opt_gdbstub << 1;
 #endif
     run_flag |= opt_prof_data << 2;
+    run_flag |= opt_bbv << 3;
+    run_flag |= opt_coverage << 4;
+#if RV32_HAS(FUZZ)
+    run_flag |= opt_fuzz << 5;
+#endif
+    run_flag |= opt_warmup << 6;
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    run_flag |= opt_bootprof << 7;
+#endif
 
     vm_attr_t attr = {
         .mem_size = MEM_SIZE,
@@ -262,7 +609,21 @@ int main(int argc, char **args)
         .log_level = LOG_TRACE,
         .run_flag = run_flag,
         .profile_output_file = prof_out_file,
+        .bbv_output_file = bbv_out_file,
+        .bbv_interval = bbv_interval,
+        .bbv_stop = bbv_stop,
+        .bbv_checkpoint = bbv_checkpoint,
+        .coverage_output_file = coverage_out_file,
+        .coverage_format = coverage_format,
+        .warmup_output_file = warmup_out_file,
+        .warmup_interval = warmup_interval,
         .cycle_per_step = CYCLE_PER_STEP,
+        .icount_mips = icount_mips,
+        .replay_log = replay_log,
+        .replay_record = replay_record,
+        .engine = engine,
+        .no_fusion = no_fusion,
+        .no_chaining = no_chaining,
         .allow_misalign = opt_misaligned,
     };
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
@@ -270,15 +631,35 @@ int main(int argc, char **args)
     attr.data.system.initrd = opt_rootfs_img;
     attr.data.system.bootargs = opt_bootargs;
     attr.data.system.vblk_device = opt_virtio_blk_img;
+    attr.data.system.bootprof_output_file = bootprof_out_file;
+    attr.data.system.bootprof_map_file = bootprof_map_file;
+    attr.data.system.bootprof_prompt = bootprof_prompt;
+    attr.data.system.bootprof_halt = bootprof_halt;
 #else
     attr.data.user.elf_program = opt_prog_name;
 #endif
+#if !RV32_HAS(SYSTEM)
+    attr.lockstep = opt_lockstep;
+#endif
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+    attr.aot_file = aot_file;
+    attr.aot_compile = aot_compile_only;
+#endif
+#if RV32_HAS(FUZZ)
+    attr.fuzz_entry = fuzz_entry;
+    attr.fuzz_max_len = fuzz_max_len;
+    attr.fuzz_iterations = fuzz_iterations;
+#endif
+#if RV32_HAS(PLUGIN)
+    attr.plugin_specs = plugin_specs;
+    attr.n_plugins = n_plugins;
+#endif
 
     /* enable or disable the logging outputs */
     rv_log_set_quiet(opt_quiet_outputs);
 
     /* create the RISC-V runtime */
-    rv = rv_create(&attr);
+    rv_publish(rv_create(&attr));
     if (!rv) {
         rv_log_fatal("Unable to create riscv emulator");
         attr.exit_code = 1;
@@ -286,6 +667,16 @@ int main(int argc, char **args)
     }
     rv_log_info("RISC-V emulator is created and ready to run");
 
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+    if (aot_compile_only) {
+        if (!aot_compile(rv, aot_file))
+            attr.exit_code = 1;
+        riscv_t *vm = rv;
+        rv_publish(NULL);
+        rv_delete(vm);
+        goto end;
+    }
+#endif
     rv_run(rv);
 
     /* dump registers as JSON */
@@ -296,16 +687,19 @@ int main(int argc, char **args)
     if (opt_arch_test)
         dump_test_signature(opt_prog_name);
 
-    /* finalize the RISC-V runtime */
-    rv_delete(rv);
-    /*
-     * Other translation units cannot update the pointer, update it here
-     * to prevent multiple atexit()'s callback be called.
+    /* finalize the RISC-V runtime. Other translation units cannot update
+     * the pointer, so retract it here, which also keeps multiple atexit()
+     * callbacks from running on it.
      */
-    rv = NULL;
+    riscv_t *vm = rv;
+    rv_publish(NULL);
+    rv_delete(vm);
     rv_log_info("RISC-V emulator is destroyed");
 
 end:
     free(prof_out_file);
+#if RV32_HAS(PLUGIN)
+    free(plugin_specs);
+#endif
     return attr.exit_code;
 }
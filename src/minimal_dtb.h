@@ -0,0 +1,4 @@
+//
+// minimal
+//
+const uint8_t minimal[] = {};
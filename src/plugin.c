@@ -0,0 +1,230 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#if !RV32_HAS(PLUGIN)
+#error "Do not manage to build this file unless you enable plugin support."
+#endif
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plugin.h"
+#include "riscv_private.h"
+#include "rv32emu_plugin.h"
+
+#define MAX_PLUGINS 8
+
+typedef struct {
+    void *handle; /**< returned by dlopen */
+    rv_plugin_ops_t ops;
+} plugin_t;
+
+struct plugin_set {
+    riscv_t *rv;
+    rv_plugin_api_t api;
+    uint32_t callbacks; /**< bitwise OR of PLUGIN_CB_* */
+    int n_plugins;
+    plugin_t plugins[MAX_PLUGINS];
+};
+
+static uint32_t api_get_reg(void *vm, uint32_t idx)
+{
+    return idx < N_RV_REGS ? rv_get_reg(vm, idx) : 0;
+}
+
+static bool api_read_mem(void *vm, uint32_t addr, void *dst, uint32_t size)
+{
+    riscv_t *rv = vm;
+    const memory_t *mem = PRIV(rv)->mem;
+    if ((uint64_t) addr + size > mem->mem_size)
+        return false;
+    memory_read(mem, dst, addr, size);
+    return true;
+}
+
+static void api_halt(void *vm)
+{
+    rv_halt(vm);
+}
+
+static bool plugin_load(plugin_set_t *set, char *spec)
+{
+    /* '<path>[,<args>]' */
+    char *args = strchr(spec, ',');
+    if (args)
+        *args++ = '\0';
+
+    void *handle = dlopen(spec, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        rv_log_error("Cannot load plugin: %s", dlerror());
+        return false;
+    }
+
+    const uint32_t *version = dlsym(handle, "rv_plugin_version");
+    rv_plugin_install_t install =
+        (rv_plugin_install_t) dlsym(handle, "rv_plugin_install");
+    if (!version || !install) {
+        rv_log_error("%s is not a rv32emu plugin", spec);
+        goto fail;
+    }
+    if (*version != RV_PLUGIN_VERSION) {
+        rv_log_error("%s is built for plugin API version %u, expected %u", spec,
+                     *version, RV_PLUGIN_VERSION);
+        goto fail;
+    }
+
+    plugin_t *plugin = &set->plugins[set->n_plugins];
+    memset(&plugin->ops, 0, sizeof(rv_plugin_ops_t));
+    if (install(&set->api, &plugin->ops, args)) {
+        rv_log_error("Failed to install plugin %s", spec);
+        goto fail;
+    }
+    plugin->handle = handle;
+    set->n_plugins++;
+
+    const rv_plugin_ops_t *ops = &plugin->ops;
+    if (ops->block_translate)
+        set->callbacks |= PLUGIN_CB_BLOCK_TRANSLATE;
+    if (ops->block_exec)
+        set->callbacks |= PLUGIN_CB_BLOCK_EXEC;
+    if (ops->insn_exec)
+        set->callbacks |= PLUGIN_CB_INSN_EXEC;
+    if (ops->mem_access)
+        set->callbacks |= PLUGIN_CB_MEM_ACCESS;
+    if (ops->syscall || ops->syscall_ret)
+        set->callbacks |= PLUGIN_CB_SYSCALL;
+
+    rv_log_info("Plugin %s loaded", spec);
+    return true;
+
+fail:
+    dlclose(handle);
+    return false;
+}
+
+plugin_set_t *plugin_set_load(riscv_t *rv, char **specs, int n_specs)
+{
+    if (n_specs > MAX_PLUGINS) {
+        rv_log_error("Too many plugins, at most %d are supported", MAX_PLUGINS);
+        return NULL;
+    }
+
+    plugin_set_t *set = calloc(1, sizeof(plugin_set_t));
+    assert(set);
+    set->rv = rv;
+    set->api = (rv_plugin_api_t){
+        .vm = rv,
+        .get_reg = api_get_reg,
+        .read_mem = api_read_mem,
+        .halt = api_halt,
+    };
+
+    for (int i = 0; i < n_specs; i++) {
+        if (!plugin_load(set, specs[i])) {
+            plugin_set_unload(set);
+            return NULL;
+        }
+    }
+    return set;
+}
+
+void plugin_set_unload(plugin_set_t *set)
+{
+    if (!set)
+        return;
+
+    for (int i = 0; i < set->n_plugins; i++) {
+        plugin_t *plugin = &set->plugins[i];
+        if (plugin->ops.exit)
+            plugin->ops.exit(plugin->ops.udata);
+        dlclose(plugin->handle);
+    }
+    free(set);
+}
+
+uint32_t plugin_set_callbacks(const plugin_set_t *set)
+{
+    return set ? set->callbacks : 0;
+}
+
+void plugin_block_translate(plugin_set_t *set,
+                            uint32_t pc_start,
+                            uint32_t pc_end,
+                            uint32_t n_insn)
+{
+    for (int i = 0; i < set->n_plugins; i++) {
+        const rv_plugin_ops_t *ops = &set->plugins[i].ops;
+        if (ops->block_translate)
+            ops->block_translate(ops->udata, pc_start, pc_end, n_insn);
+    }
+}
+
+void plugin_block_exec(plugin_set_t *set, uint32_t pc, uint32_t n_insn)
+{
+    for (int i = 0; i < set->n_plugins; i++) {
+        const rv_plugin_ops_t *ops = &set->plugins[i].ops;
+        if (ops->block_exec)
+            ops->block_exec(ops->udata, pc, n_insn);
+    }
+}
+
+typedef struct {
+    const rv_plugin_ops_t *ops;
+    uint32_t pc;
+} mem_access_t;
+
+static bool plugin_mem_access(void *arg,
+                              uint32_t vaddr,
+                              uint32_t size,
+                              bool is_store)
+{
+    const mem_access_t *access = arg;
+    const rv_plugin_ops_t *ops = access->ops;
+    ops->mem_access(ops->udata, access->pc, vaddr, size, is_store);
+    return false;
+}
+
+void plugin_insn_exec(riscv_t *rv, const rv_insn_t *ir)
+{
+    plugin_set_t *set = rv->plugins;
+
+    for (int i = 0; i < set->n_plugins; i++) {
+        const rv_plugin_ops_t *ops = &set->plugins[i].ops;
+        if (ops->insn_exec)
+            ops->insn_exec(ops->udata, ir->pc);
+        if (ops->mem_access) {
+            mem_access_t access = {.ops = ops, .pc = ir->pc};
+            insn_mem_operand(rv, ir, plugin_mem_access, &access);
+        }
+    }
+}
+
+void plugin_syscall(riscv_t *rv, uint32_t nr)
+{
+    plugin_set_t *set = rv->plugins;
+    const uint32_t args[6] = {
+        rv->X[rv_reg_a0], rv->X[rv_reg_a1], rv->X[rv_reg_a2],
+        rv->X[rv_reg_a3], rv->X[rv_reg_a4], rv->X[rv_reg_a5],
+    };
+
+    for (int i = 0; i < set->n_plugins; i++) {
+        const rv_plugin_ops_t *ops = &set->plugins[i].ops;
+        if (ops->syscall)
+            ops->syscall(ops->udata, nr, args);
+    }
+}
+
+void plugin_syscall_ret(riscv_t *rv, uint32_t nr)
+{
+    plugin_set_t *set = rv->plugins;
+
+    for (int i = 0; i < set->n_plugins; i++) {
+        const rv_plugin_ops_t *ops = &set->plugins[i].ops;
+        if (ops->syscall_ret)
+            ops->syscall_ret(ops->udata, nr, rv->X[rv_reg_a0]);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#if !RV32_HAS(PLUGIN)
+#error "Do not manage to build this file unless you enable plugin support."
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "decode.h"
+#include "riscv.h"
+
+typedef struct plugin_set plugin_set_t;
+
+/* Callbacks a plugin can register. The emulator only inserts the probes
+ * needed by the callbacks registered by at least one plugin.
+ */
+enum {
+    PLUGIN_CB_BLOCK_TRANSLATE = 1 << 0,
+    PLUGIN_CB_BLOCK_EXEC = 1 << 1,
+    PLUGIN_CB_INSN_EXEC = 1 << 2,
+    PLUGIN_CB_MEM_ACCESS = 1 << 3,
+    PLUGIN_CB_SYSCALL = 1 << 4,
+};
+
+/**
+ * plugin_set_load - load plugins and call their install functions
+ * @rv: a pointer points to the RISC-V emulator
+ * @specs: array of '<path>[,<args>]' strings
+ * @n_specs: number of elements in @specs
+ *
+ * Return NULL if any of the plugins cannot be loaded.
+ */
+plugin_set_t *plugin_set_load(riscv_t *rv, char **specs, int n_specs);
+
+/**
+ * plugin_set_unload - call the exit callbacks and unload all plugins
+ * @set: a pointer points to the plugin set
+ */
+void plugin_set_unload(plugin_set_t *set);
+
+/**
+ * plugin_set_callbacks - get the bitwise OR of PLUGIN_CB_* in use
+ * @set: a pointer points to the plugin set
+ */
+uint32_t plugin_set_callbacks(const plugin_set_t *set);
+
+/* notifiers, called by the emulator */
+void plugin_block_translate(plugin_set_t *set,
+                            uint32_t pc_start,
+                            uint32_t pc_end,
+                            uint32_t n_insn);
+void plugin_block_exec(plugin_set_t *set, uint32_t pc, uint32_t n_insn);
+void plugin_insn_exec(riscv_t *rv, const rv_insn_t *ir);
+void plugin_syscall(riscv_t *rv, uint32_t nr);
+void plugin_syscall_ret(riscv_t *rv, uint32_t nr);
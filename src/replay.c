@@ -0,0 +1,343 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "replay.h"
+#include "riscv_private.h"
+
+#define REPLAY_MAGIC "RVRR1"
+
+enum {
+    REC_SYSCALL = 1, /* nr, a0, a1, n_mem, then n_mem of (addr, len, data) */
+    REC_UART = 2,    /* len, data */
+};
+
+struct replay {
+    riscv_t *rv;
+    bool record;
+    bool active;     /**< false once the replay diverged or ran out of log */
+    bool pending;    /**< between replay_syscall_begin and _end */
+    uint64_t icount; /**< instruction count of the last record */
+
+    /* record mode */
+    FILE *out;
+    uint32_t nr;
+    uint32_t n_mem;
+    uint8_t *mem; /**< encoded memory writes of the pending system call */
+    size_t mem_len, mem_cap;
+
+    /* replay mode */
+    uint8_t *log;
+    size_t log_len, pos;
+    bool has_next;           /**< the header of the next record is loaded */
+    uint32_t next_tag;       /**< tag of the next record */
+    uint64_t next_icount;    /**< instruction count of the next record */
+    uint32_t a0, a1;         /**< results of the pending system call */
+    size_t mem_pos, mem_end; /**< its memory writes, as offsets in log */
+
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    int host_fd;    /**< where the UART input came from */
+    int pipe_fd[2]; /**< what the UART reads from now */
+#endif
+};
+
+static void put_varint(uint8_t *buf, size_t *len, uint64_t v)
+{
+    do {
+        buf[(*len)++] = (v & 0x7F) | (v > 0x7F ? 0x80 : 0);
+        v >>= 7;
+    } while (v);
+}
+
+static void write_varint(FILE *f, uint64_t v)
+{
+    uint8_t buf[10];
+    size_t len = 0;
+    put_varint(buf, &len, v);
+    fwrite(buf, 1, len, f);
+}
+
+/* make room for @n more bytes of pending memory writes */
+static void mem_reserve(replay_t *rp, size_t n)
+{
+    if (rp->mem_len + n <= rp->mem_cap)
+        return;
+    while (rp->mem_len + n > rp->mem_cap)
+        rp->mem_cap = rp->mem_cap ? 2 * rp->mem_cap : 4096;
+    rp->mem = realloc(rp->mem, rp->mem_cap);
+    assert(rp->mem);
+}
+
+static bool read_varint(replay_t *rp, uint64_t *v)
+{
+    *v = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (rp->pos >= rp->log_len)
+            return false;
+        const uint8_t b = rp->log[rp->pos++];
+        *v |= (uint64_t) (b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/* load the tag and the instruction count of the next record */
+static void next_record(replay_t *rp)
+{
+    uint64_t tag, delta;
+    rp->has_next = read_varint(rp, &tag) && read_varint(rp, &delta);
+    if (!rp->has_next)
+        return;
+    rp->next_tag = tag;
+    rp->next_icount = rp->icount + delta;
+}
+
+static void diverge(replay_t *rp, const char *what)
+{
+    rv_log_error("Replay diverged after %" PRIu64 " instructions: %s",
+                 rv_icount(rp->rv), what);
+    rp->active = false;
+    rv_halt(rp->rv);
+}
+
+replay_t *replay_create(riscv_t *rv, const char *log_path, bool record)
+{
+    replay_t *rp = calloc(1, sizeof(replay_t));
+    assert(rp);
+    rp->rv = rv;
+    rp->record = record;
+    rp->active = true;
+
+    if (record) {
+        rp->out = fopen(log_path, "wb");
+        if (!rp->out) {
+            rv_log_error("Cannot open replay log for writing: %s", log_path);
+            free(rp);
+            return NULL;
+        }
+        fwrite(REPLAY_MAGIC, 1, strlen(REPLAY_MAGIC), rp->out);
+    } else {
+        FILE *f = fopen(log_path, "rb");
+        if (!f) {
+            rv_log_error("Cannot open replay log: %s", log_path);
+            free(rp);
+            return NULL;
+        }
+        fseek(f, 0, SEEK_END);
+        rp->log_len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        rp->log = malloc(rp->log_len + 1);
+        assert(rp->log);
+        const size_t n = fread(rp->log, 1, rp->log_len, f);
+        fclose(f);
+        if (n != rp->log_len || rp->log_len < strlen(REPLAY_MAGIC) ||
+            memcmp(rp->log, REPLAY_MAGIC, strlen(REPLAY_MAGIC))) {
+            rv_log_error("Not a replay log: %s", log_path);
+            free(rp->log);
+            free(rp);
+            return NULL;
+        }
+        rp->pos = strlen(REPLAY_MAGIC);
+        next_record(rp);
+    }
+
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    /* the UART reads from a pipe filled by replay_uart() */
+    if (pipe(rp->pipe_fd)) {
+        rv_log_error("Cannot create the UART input pipe");
+        replay_delete(rp);
+        return NULL;
+    }
+    u8250_state_t *uart = PRIV(rv)->uart;
+    rp->host_fd = uart->in_fd;
+    uart->in_fd = rp->pipe_fd[0];
+#endif
+    return rp;
+}
+
+bool replay_syscall_begin(riscv_t *rv, uint32_t nr)
+{
+    replay_t *rp = rv->replay;
+    if (!rp->active)
+        return false;
+
+    if (rp->record) {
+        rp->pending = true;
+        rp->nr = nr;
+        rp->n_mem = 0;
+        rp->mem_len = 0;
+        return false;
+    }
+
+    if (!rp->has_next) {
+        rv_log_info("Replay log is exhausted, running live from now on");
+        rp->active = false;
+        return false;
+    }
+    if (rp->next_tag != REC_SYSCALL || rp->next_icount != rv_icount(rv)) {
+        diverge(rp, "unexpected system call");
+        return false;
+    }
+
+    uint64_t rec_nr, a0, a1, n_mem;
+    if (!read_varint(rp, &rec_nr) || !read_varint(rp, &a0) ||
+        !read_varint(rp, &a1) || !read_varint(rp, &n_mem)) {
+        diverge(rp, "truncated log");
+        return false;
+    }
+    if (rec_nr != nr) {
+        diverge(rp, "another system call was recorded");
+        return false;
+    }
+
+    /* skip over the memory writes, which are applied at the end */
+    rp->mem_pos = rp->pos;
+    for (uint64_t i = 0; i < n_mem; i++) {
+        uint64_t addr, len;
+        if (!read_varint(rp, &addr) || !read_varint(rp, &len) ||
+            len > rp->log_len - rp->pos) {
+            diverge(rp, "truncated log");
+            return false;
+        }
+        rp->pos += len;
+    }
+    rp->mem_end = rp->pos;
+    rp->a0 = a0;
+    rp->a1 = a1;
+    rp->icount = rp->next_icount;
+    rp->pending = true;
+    return true;
+}
+
+void replay_syscall_mem(riscv_t *rv,
+                        uint32_t addr,
+                        const uint8_t *src,
+                        uint32_t len)
+{
+    replay_t *rp = rv->replay;
+    if (!rp || !rp->record || !rp->pending)
+        return;
+
+    mem_reserve(rp, 20 + len);
+    put_varint(rp->mem, &rp->mem_len, addr);
+    put_varint(rp->mem, &rp->mem_len, len);
+    memcpy(rp->mem + rp->mem_len, src, len);
+    rp->mem_len += len;
+    rp->n_mem++;
+}
+
+void replay_syscall_end(riscv_t *rv)
+{
+    replay_t *rp = rv->replay;
+    if (!rp->pending)
+        return;
+    rp->pending = false;
+
+    const uint64_t icount = rv_icount(rv);
+    if (rp->record) {
+        write_varint(rp->out, REC_SYSCALL);
+        write_varint(rp->out, icount - rp->icount);
+        write_varint(rp->out, rp->nr);
+        write_varint(rp->out, rv_get_reg(rv, rv_reg_a0));
+        write_varint(rp->out, rv_get_reg(rv, rv_reg_a1));
+        write_varint(rp->out, rp->n_mem);
+        fwrite(rp->mem, 1, rp->mem_len, rp->out);
+        rp->icount = icount;
+        return;
+    }
+
+    memory_t *mem = PRIV(rv)->mem;
+    size_t pos = rp->mem_pos;
+    while (pos < rp->mem_end) {
+        uint64_t addr, len;
+        rp->pos = pos;
+        read_varint(rp, &addr);
+        read_varint(rp, &len);
+        memory_write(mem, addr, rp->log + rp->pos, len);
+        pos = rp->pos + len;
+    }
+    rv_set_reg(rv, rv_reg_a0, rp->a0);
+    rv_set_reg(rv, rv_reg_a1, rp->a1);
+
+    rp->pos = rp->mem_end;
+    next_record(rp);
+}
+
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+static void feed_uart(replay_t *rp, const uint8_t *data, size_t len)
+{
+    if (write(rp->pipe_fd[1], data, len) != (ssize_t) len)
+        rv_log_error("Failed to pass UART input on");
+}
+
+void replay_uart(riscv_t *rv)
+{
+    replay_t *rp = rv->replay;
+    const uint64_t icount = rv_icount(rv);
+
+    if (rp->record) {
+        struct pollfd pfd = {rp->host_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN))
+            return;
+        uint8_t buf[64];
+        const ssize_t n = read(rp->host_fd, buf, sizeof(buf));
+        if (n <= 0)
+            return;
+        write_varint(rp->out, REC_UART);
+        write_varint(rp->out, icount - rp->icount);
+        write_varint(rp->out, n);
+        fwrite(buf, 1, n, rp->out);
+        rp->icount = icount;
+        feed_uart(rp, buf, n);
+        return;
+    }
+
+    while (rp->active && rp->has_next && rp->next_tag == REC_UART &&
+           rp->next_icount <= icount) {
+        uint64_t len;
+        if (!read_varint(rp, &len) || len > rp->log_len - rp->pos) {
+            diverge(rp, "truncated log");
+            return;
+        }
+        feed_uart(rp, rp->log + rp->pos, len);
+        rp->pos += len;
+        rp->icount = rp->next_icount;
+        next_record(rp);
+    }
+}
+#endif
+
+void replay_delete(replay_t *rp)
+{
+    if (!rp)
+        return;
+
+    if (rp->record) {
+        fclose(rp->out);
+    } else if (rp->active && rp->has_next) {
+        rv_log_warn("Replay ended with %zu bytes of the log left",
+                    rp->log_len - rp->pos);
+    }
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    if (rp->pipe_fd[0] || rp->pipe_fd[1]) {
+        PRIV(rp->rv)->uart->in_fd = rp->host_fd;
+        close(rp->pipe_fd[0]);
+        close(rp->pipe_fd[1]);
+    }
+#endif
+    free(rp->mem);
+    free(rp->log);
+    free(rp);
+}
@@ -0,0 +1,74 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "riscv.h"
+
+/* Record and replay of the nondeterministic inputs of the guest.
+ *
+ * In record mode, the results of every system call, i.e., the returned a0
+ * and a1 along with the guest memory the call wrote, such as the data of
+ * read and the time of clock_gettime, are logged together with the number
+ * of instructions retired when the call was made. In system emulation, the
+ * bytes arriving at the UART are logged along with the instruction count at
+ * which the guest could first see them.
+ *
+ * In replay mode, the calls which consult the host for input are not run at
+ * all. Their results come from the log instead. The other calls still run,
+ * so that the output shows up, but their results come from the log too.
+ * UART bytes are released to the guest once it has retired as many
+ * instructions as when they were recorded. Every call is checked against
+ * its record, and a mismatch stops the replay as a divergence.
+ *
+ * Instruction counts include the ones retired by the JIT compilers, so a
+ * log can be replayed with another execution engine.
+ *
+ * The log is a sequence of records made of variable-length integers: a tag,
+ * the instruction count since the previous record, and a payload.
+ */
+
+typedef struct replay replay_t;
+
+/**
+ * replay_create - open a log to record to or to replay from
+ * @rv: a pointer points to the RISC-V emulator
+ * @log_path: path of the log
+ * @record: true to record, false to replay
+ */
+replay_t *replay_create(riscv_t *rv, const char *log_path, bool record);
+
+/**
+ * replay_syscall_begin - a system call is about to run
+ * @rv: a pointer points to the RISC-V emulator
+ * @nr: the system call number
+ *
+ * Return true if the results of the call are to be replayed, in which case
+ * calls taking input from the host should not run.
+ */
+bool replay_syscall_begin(riscv_t *rv, uint32_t nr);
+
+/* record the guest memory a system call has written */
+void replay_syscall_mem(riscv_t *rv,
+                        uint32_t addr,
+                        const uint8_t *src,
+                        uint32_t len);
+
+/* record the results of the system call, or replay them */
+void replay_syscall_end(riscv_t *rv);
+
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+/* move pending input from the host, or from the log, to the UART */
+void replay_uart(riscv_t *rv);
+#endif
+
+/**
+ * replay_delete - close the log and release the recorder or replayer
+ * @rp: a pointer points to the recorder or replayer
+ */
+void replay_delete(replay_t *rp);
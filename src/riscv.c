@@ -27,10 +27,6 @@
 #define STDERR_FILENO FILENO(stderr)
 #endif
 
-#ifdef __EMSCRIPTEN__
-#include <emscripten.h>
-#endif
-
 #include "elf.h"
 #include "mpool.h"
 #include "riscv.h"
@@ -208,13 +204,24 @@ static void *t2c_runloop(void *arg)
     riscv_t *rv = (riscv_t *) arg;
     while (!rv->quit) {
         if (!list_empty(&rv->wait_queue)) {
+            /* hold the cache from the dequeue on, as the block may be freed
+             * along with the queue entries under the lock otherwise
+             */
+            pthread_mutex_lock(&rv->cache_lock);
+            pthread_mutex_lock(&rv->wait_queue_lock);
+            if (list_empty(&rv->wait_queue)) {
+                pthread_mutex_unlock(&rv->wait_queue_lock);
+                pthread_mutex_unlock(&rv->cache_lock);
+                continue;
+            }
             queue_entry_t *entry =
                 list_last_entry(&rv->wait_queue, queue_entry_t, list);
-            pthread_mutex_lock(&rv->wait_queue_lock);
             list_del_init(&entry->list);
             pthread_mutex_unlock(&rv->wait_queue_lock);
-            pthread_mutex_lock(&rv->cache_lock);
+            const uint64_t start = rv->warmup ? warmup_clock() : 0;
             t2c_compile(rv, entry->block);
+            if (rv->warmup)
+                warmup_account(rv->warmup, WARMUP_T2, start, 0, 0);
             pthread_mutex_unlock(&rv->cache_lock);
             free(entry);
         }
@@ -316,6 +323,43 @@ static void load_dtb(char **ram_loc, vm_attr_t *attr)
         assert(!err);
     }
 
+#if RV32_HAS(Zicbom) || RV32_HAS(Zicboz) || RV32_HAS(Zicbop)
+    /* append the cache-block extensions to the ISA string along with the size
+     * of their blocks, so that the guest kernel manages, zeroes and prefetches
+     * memory with them. misa has no bits for them.
+     */
+    node = fdt_path_offset(blob, "/cpus/cpu@0");
+    assert(node > 0);
+
+    char isa[64];
+    const char *base = fdt_getprop(blob, node, "riscv,isa", NULL);
+    assert(base);
+    snprintf(isa, sizeof(isa), "%s%s%s%s", base,
+             RV32_HAS(Zicbom) ? "_zicbom" : "",
+             RV32_HAS(Zicboz) ? "_zicboz" : "",
+             RV32_HAS(Zicbop) ? "_zicbop" : "");
+    blob = realloc_property(blob, node, "riscv,isa", strlen(isa) + 1);
+    err = fdt_setprop_string(blob, node, "riscv,isa", isa);
+    assert(!err);
+
+    static const char *block_sizes[] = {
+#if RV32_HAS(Zicbom)
+        "riscv,cbom-block-size",
+#endif
+#if RV32_HAS(Zicboz)
+        "riscv,cboz-block-size",
+#endif
+#if RV32_HAS(Zicbop)
+        "riscv,cbop-block-size",
+#endif
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(block_sizes); i++) {
+        blob = realloc_property(blob, node, block_sizes[i], sizeof(uint32_t));
+        err = fdt_setprop_u32(blob, node, block_sizes[i], CBO_BLOCK_SIZE);
+        assert(!err);
+    }
+#endif
+
     /* remove the vblk node from soc if it is not specified */
     if (!vblk) {
         int subnode;
@@ -446,6 +490,10 @@ riscv_t *rv_create(riscv_user_t rv_attr)
     rv->data = rv_attr;
 
     vm_attr_t *attr = PRIV(rv);
+    if (attr->engine == RV_ENGINE_DEFAULT)
+        attr->engine = RV_ENGINE_BUILTIN;
+    assert(attr->engine <= RV_ENGINE_BUILTIN);
+
     attr->mem = memory_new(attr->mem_size);
     assert(attr->mem);
     assert(!(((uintptr_t) attr->mem) & 0b11));
@@ -643,8 +691,102 @@ riscv_t *rv_create(riscv_user_t rv_attr)
     pthread_mutex_init(&rv->wait_queue_lock, NULL);
     pthread_mutex_init(&rv->cache_lock, NULL);
     INIT_LIST_HEAD(&rv->wait_queue);
-    /* activate the background compilation thread. */
-    pthread_create(&t2c_thread, NULL, t2c_runloop, rv);
+    /* activate the background compilation thread, which spins while idle */
+    if (attr->engine == RV_ENGINE_T2C)
+        pthread_create(&t2c_thread, NULL, t2c_runloop, rv);
+#endif
+#endif
+
+    if (attr->run_flag & RV_RUN_BBV) {
+        assert(attr->bbv_output_file);
+        rv->bbv = bbv_create(attr->bbv_output_file, attr->bbv_interval,
+                             attr->bbv_stop, attr->bbv_checkpoint);
+    }
+
+#if !RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER))
+    if (attr->run_flag & RV_RUN_COVERAGE) {
+        assert(attr->coverage_output_file);
+        rv->coverage =
+            coverage_create(attr->coverage_output_file, attr->coverage_format,
+                            attr->data.user.elf_program);
+    }
+#endif
+
+#if RV32_HAS(FUZZ)
+    if (attr->run_flag & RV_RUN_FUZZ) {
+        rv->fuzz = fuzz_create(rv, attr->fuzz_entry, attr->fuzz_max_len,
+                               attr->fuzz_iterations);
+        if (!rv->fuzz) {
+            rv_delete(rv);
+            return NULL;
+        }
+    }
+#endif
+
+#if RV32_HAS(PLUGIN)
+    if (attr->n_plugins) {
+        rv->plugins = plugin_set_load(rv, attr->plugin_specs, attr->n_plugins);
+        if (!rv->plugins) {
+            rv_delete(rv);
+            return NULL;
+        }
+    }
+#endif
+
+    if (attr->replay_log) {
+        rv->replay = replay_create(rv, attr->replay_log, attr->replay_record);
+        if (!rv->replay) {
+            rv_delete(rv);
+            return NULL;
+        }
+    }
+
+#if !RV32_HAS(SYSTEM)
+    if (attr->lockstep)
+        rv->lockstep = lockstep_create(rv);
+#endif
+
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+    if (attr->aot_file && !attr->aot_compile) {
+        rv->aot = aot_load(rv, attr->aot_file);
+        if (!rv->aot) {
+            rv_delete(rv);
+            return NULL;
+        }
+    }
+#endif
+
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    if (attr->run_flag & RV_RUN_BOOTPROF) {
+        vm_system_t *sys = &attr->data.system;
+        assert(sys->bootprof_output_file && sys->bootprof_prompt);
+        rv->bootprof =
+            bootprof_create(rv, sys->bootprof_output_file,
+                            sys->bootprof_map_file, sys->bootprof_prompt,
+                            sys->bootprof_halt);
+        if (!rv->bootprof) {
+            rv_delete(rv);
+            return NULL;
+        }
+    }
+#endif
+
+    /* last, so that the curve starts with the guest */
+    if (attr->run_flag & RV_RUN_WARMUP) {
+        assert(attr->warmup_output_file);
+        rv->warmup = warmup_create(rv, attr->warmup_output_file,
+                                   attr->warmup_interval);
+    }
+
+#if RV32_HAS(JIT)
+    /* tier-1 code counts its instructions only for those reading them
+     * through rv_icount() or directly, or for the guest, see rv_hpm_write()
+     */
+    rv->hpm_t1_insn = attr->icount_mips || rv->replay || rv->warmup;
+#if RV32_HAS(SYSTEM)
+    rv->hpm_t1_insn |= rv->bootprof != NULL;
+#else
+    rv->hpm_t1_insn |= rv->lockstep != NULL;
 #endif
 #endif
 
@@ -700,14 +842,12 @@ void rv_run(riscv_t *rv)
 #endif
     );
 
-    if (!(attr->run_flag & (RV_RUN_TRACE | RV_RUN_GDBSTUB))) {
-#ifdef __EMSCRIPTEN__
-        emscripten_set_main_loop_arg(rv_step, (void *) rv, 0, 1);
-#else
-        /* default main loop */
+    if (!(attr->run_flag & (RV_RUN_TRACE | RV_RUN_GDBSTUB | RV_RUN_FUZZ))) {
+        /* default main loop, which runs in a worker of its own rather than
+         * the main thread of the browser under emscripten, see mk/wasm.mk
+         */
         for (; !rv_has_halted(rv);) /* run until the flag is done */
             rv_step(rv);            /* step instructions */
-#endif
     }
 #if !RV32_HAS(SYSTEM) || (RV32_HAS(SYSTEM) && RV32_HAS(ELF_LOADER))
     else if (attr->run_flag & RV_RUN_TRACE)
@@ -717,6 +857,10 @@ void rv_run(riscv_t *rv)
     else if (attr->run_flag & RV_RUN_GDBSTUB)
         rv_debug(rv);
 #endif
+#if RV32_HAS(FUZZ)
+    else if (attr->run_flag & RV_RUN_FUZZ)
+        fuzz_run(rv);
+#endif
 
     if (attr->run_flag & RV_RUN_PROFILE) {
         assert(attr->profile_output_file);
@@ -724,19 +868,36 @@ void rv_run(riscv_t *rv)
     }
 }
 
+/* the page of the wasm build halts the emulation from another thread */
 void rv_halt(riscv_t *rv)
 {
-    rv->halt = true;
+    __atomic_store_n(&rv->halt, true, __ATOMIC_RELAXED);
 }
 
 bool rv_has_halted(riscv_t *rv)
 {
-    return rv->halt;
+    return __atomic_load_n(&rv->halt, __ATOMIC_RELAXED);
 }
 
 void rv_delete(riscv_t *rv)
 {
     assert(rv);
+#if RV32_HAS(FUZZ)
+    /* make the guest memory writable again first */
+    fuzz_delete(rv->fuzz);
+#endif
+#if RV32_HAS(PLUGIN)
+    plugin_set_unload(rv->plugins);
+#endif
+    bbv_delete(rv->bbv);
+    coverage_delete(rv->coverage);
+#if RV32_HAS(SYSTEM)
+    /* before the devices it reads are gone */
+    bootprof_delete(rv->bootprof);
+#else
+    lockstep_delete(rv->lockstep);
+#endif
+    replay_delete(rv->replay);
 #if !RV32_HAS(JIT) || (RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER))
     vm_attr_t *attr = PRIV(rv);
 #endif
@@ -747,14 +908,20 @@ void rv_delete(riscv_t *rv)
 #else
 #if RV32_HAS(T2C)
     rv->quit = true;
-    pthread_join(t2c_thread, NULL);
+    if (PRIV(rv)->engine == RV_ENGINE_T2C)
+        pthread_join(t2c_thread, NULL);
     pthread_mutex_destroy(&rv->wait_queue_lock);
     pthread_mutex_destroy(&rv->cache_lock);
     jit_cache_exit(rv->jit_cache);
+#if !RV32_HAS(SYSTEM)
+    aot_delete(rv->aot);
+#endif
 #endif
     jit_state_exit(rv->jit_state);
     cache_free(rv->block_cache);
 #endif
+    /* after the tier-2 compiler thread, which accounts to it, has ended */
+    warmup_delete(rv->warmup);
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
     u8250_delete(attr->uart);
     plic_delete(attr->plic);
@@ -909,9 +1076,20 @@ void rv_reset(riscv_t *rv, riscv_word_t pc)
         rv->F[i].v = 0;
     rv->csr_fcsr = 0;
 #endif
+#if RV32_HAS(Zve32x)
+    /* reset vector registers, and leave the vector unit unconfigured */
+    memset(rv->V, 0, sizeof(rv->V));
+    rv->csr_vstart = rv->csr_vxsat = rv->csr_vxrm = rv->csr_vcsr = 0;
+    rv->csr_vl = 0;
+    rv->csr_vtype = VTYPE_VILL;
+    rv->csr_vlenb = VLENB;
+#endif
 #if RV32_HAS(EXT_M)
     rv->csr_misa |= MISA_M;
 #endif
+#if RV32_HAS(SYSTEM)
+    rv_update_intr_pending(rv);
+#endif
 
     rv->halt = false;
 }
@@ -98,6 +98,17 @@ enum {
 #define RV_PG_SHIFT 12
 #define RV_PG_SIZE (1 << RV_PG_SHIFT)
 
+/* the size of the blocks which the instructions of Zicbom and Zicboz act on,
+ * which never cross a page
+ */
+#ifndef CBO_BLOCK_SIZE
+#define CBO_BLOCK_SIZE 64
+#endif
+#if CBO_BLOCK_SIZE < 16 || CBO_BLOCK_SIZE > RV_PG_SIZE || \
+    (CBO_BLOCK_SIZE & (CBO_BLOCK_SIZE - 1))
+#error "CBO_BLOCK_SIZE must be a power of 2 from 16 to the page size"
+#endif
+
 typedef uint32_t pte_t;
 #define PTE_V (1U)
 #define PTE_R (1U << 1)
@@ -180,6 +191,14 @@ enum SV32_PTE_PERM {
 #define SIP_STIP (1 << SIP_STIP_SHIFT)
 #define SIP_SEIP (1 << SIP_SEIP_SHIFT)
 
+/* senvcfg, whose fields enable the cache-block operations in U-mode */
+#define SENVCFG_CBIE_SHIFT 4
+#define SENVCFG_CBCFE_SHIFT 6
+#define SENVCFG_CBZE_SHIFT 7
+#define SENVCFG_CBIE (3 << SENVCFG_CBIE_SHIFT)
+#define SENVCFG_CBCFE (1 << SENVCFG_CBCFE_SHIFT)
+#define SENVCFG_CBZE (1 << SENVCFG_CBZE_SHIFT)
+
 #define RV_PRIV_U_MODE 0
 #define RV_PRIV_S_MODE 1
 #define RV_PRIV_M_MODE 3
@@ -261,6 +280,9 @@ enum TRAP_CODE {
  */
 #define SBI_SUCCESS 0
 #define SBI_ERR_NOT_SUPPORTED -2
+#define SBI_ERR_INVALID_PARAM -3
+#define SBI_ERR_ALREADY_STARTED -7
+#define SBI_ERR_ALREADY_STOPPED -8
 
 /*
  * All of the functions in the base extension must be supported by
@@ -283,6 +305,14 @@ enum TRAP_CODE {
 #define SBI_EID_RST 0x53525354
 #define SBI_RST_SYSTEM_RESET 0
 
+/* Allows the supervisor to program the performance-monitoring counters. */
+#define SBI_EID_PMU 0x504D55
+#define SBI_PMU_NUM_COUNTERS 0
+#define SBI_PMU_COUNTER_GET_INFO 1
+#define SBI_PMU_COUNTER_CFG_MATCH 2
+#define SBI_PMU_COUNTER_START 3
+#define SBI_PMU_COUNTER_STOP 4
+
 #define BLOCK_MAP_CAPACITY_BITS 10
 
 /* forward declaration for internal structure */
@@ -450,8 +480,49 @@ enum {
     /* run and profile relationship of blocks and save to prof_output_file
        during emulation */
     RV_RUN_PROFILE = 4,
+
+    /* run and collect basic-block vectors, save them to bbv_output_file
+       during emulation */
+    RV_RUN_BBV = 8,
+
+    /* run and record the executed blocks, save them to
+       coverage_output_file during emulation */
+    RV_RUN_COVERAGE = 16,
+
+    /* run to fuzz_entry and fuzz it, as the fork server of afl-fuzz */
+    RV_RUN_FUZZ = 32,
+
+    /* run and sample the throughput of every execution tier, save it to
+       warmup_output_file during emulation */
+    RV_RUN_WARMUP = 64,
+
+    /* run and split the Linux boot into phases, save them to
+       data.system.bootprof_output_file during emulation */
+    RV_RUN_BOOTPROF = 128,
+};
+
+/* output format of RV_RUN_COVERAGE */
+enum {
+    RV_COVERAGE_DRCOV = 0, /* drcov log, e.g. for Lighthouse */
+    RV_COVERAGE_LCOV = 1,  /* lcov tracefile, using DWARF line information */
 };
 
+/* execution engine, which builds with the JIT compilers select per run */
+enum {
+    RV_ENGINE_DEFAULT = 0, /* the highest tier built in */
+    RV_ENGINE_INTERP = 1,  /* interpreter only */
+    RV_ENGINE_T1 = 2,      /* interpreter and tier-1 JIT compiler */
+    RV_ENGINE_T2C = 3,     /* interpreter, tier-1 and tier-2 JIT compilers */
+};
+
+#if RV32_HAS(T2C)
+#define RV_ENGINE_BUILTIN RV_ENGINE_T2C
+#elif RV32_HAS(JIT)
+#define RV_ENGINE_BUILTIN RV_ENGINE_T1
+#else
+#define RV_ENGINE_BUILTIN RV_ENGINE_INTERP
+#endif
+
 typedef struct {
     char *elf_program;
 } vm_user_t;
@@ -462,6 +533,12 @@ typedef struct {
     char *initrd;
     char *bootargs;
     char *vblk_device;
+
+    /* RV_RUN_BOOTPROF */
+    char *bootprof_output_file;
+    char *bootprof_map_file; /* System.map of the kernel, optional */
+    char *bootprof_prompt;   /* UART output which ends the boot */
+    bool bootprof_halt;      /* halt at the prompt */
 } vm_system_t;
 #endif /* RV32_HAS(SYSTEM) */
 
@@ -526,17 +603,74 @@ typedef struct {
     /* number of cycle(instruction) in a rv_step call*/
     int cycle_per_step;
 
-    /* allow misaligned memory access */
+    /* icount mode: if nonzero, the clocks seen by the guest advance as if it
+     * ran at this many millions of instructions per second, rather than
+     * following the host clock, so that every run sees the same times.
+     */
+    uint32_t icount_mips;
+
+    /* allow misaligned memory access, performed as a single host access by
+     * every tier. In system emulation, the ones crossing a page are split
+     * into bytes, and only the ones reaching the devices still trap as
+     * misaligned.
+     */
     bool allow_misalign;
 
+    /* execution engine, one of RV_ENGINE_* up to RV_ENGINE_BUILTIN, along
+     * with the block optimizations which can be turned off to compare against
+     */
+    uint8_t engine;
+    bool no_fusion;   /**< skip macro-operation fusion */
+    bool no_chaining; /**< do not chain interpreted blocks together */
+
     /* run flag, it is the bitwise OR from
-     * RV_RUN_TRACE, RV_RUN_GDBSTUB, and RV_RUN_PROFILE
+     * RV_RUN_TRACE, RV_RUN_GDBSTUB, RV_RUN_PROFILE, RV_RUN_BBV,
+     * RV_RUN_COVERAGE, RV_RUN_FUZZ, RV_RUN_WARMUP, and RV_RUN_BOOTPROF
      */
     uint8_t run_flag;
 
     /* profiling output file if RV_RUN_PROFILE is set in run_flag */
     char *profile_output_file;
 
+    /* basic-block vector output if RV_RUN_BBV is set in run_flag */
+    char *bbv_output_file;
+    uint64_t bbv_interval;  /**< number of instructions per interval */
+    int64_t bbv_stop;       /**< halt after this many intervals, -1: never */
+    int64_t bbv_checkpoint; /**< checkpoint after this many intervals */
+
+    /* guest code coverage if RV_RUN_COVERAGE is set in run_flag */
+    char *coverage_output_file;
+    uint8_t coverage_format; /**< RV_COVERAGE_DRCOV or RV_COVERAGE_LCOV */
+
+    /* fuzz target if RV_RUN_FUZZ is set in run_flag */
+    char *fuzz_entry;         /**< symbol or address */
+    uint32_t fuzz_max_len;    /**< capacity of the input buffer */
+    uint32_t fuzz_iterations; /**< runs per forked child */
+
+    /* warm-up curve if RV_RUN_WARMUP is set in run_flag */
+    char *warmup_output_file;
+    uint32_t warmup_interval; /**< sampling interval in milliseconds */
+
+    /* check every dispatch against the reference interpreter, which is
+     * available in user-mode emulation only
+     */
+    bool lockstep;
+
+    /* shared object of code compiled ahead of time, written by main rather
+     * than running if aot_compile is set, or loaded, or NULL. Available with
+     * the tier-2 compiler in user-mode emulation only.
+     */
+    char *aot_file;
+    bool aot_compile;
+
+    /* log of the nondeterministic inputs, recorded or replayed, or NULL */
+    char *replay_log;
+    bool replay_record; /**< record to replay_log rather than replay it */
+
+    /* instrumentation plugins, each of which is '<path>[,<args>]' */
+    char **plugin_specs;
+    int n_plugins;
+
     /* set by rv_create during initialization.
      * use rv_remap_stdstream to overwrite them
      */
@@ -10,7 +10,28 @@
 #include "breakpoint.h"
 #include "mini-gdbstub/include/gdbstub.h"
 #endif
+#include "bbv.h"
+#include "coverage.h"
+#include "replay.h"
+#include "warmup.h"
+#if RV32_HAS(SYSTEM)
+#include "bootprof.h"
+#else
+#include "lockstep.h"
+#endif
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+#include "aot.h"
+#endif
 #include "decode.h"
+#if RV32_HAS(FUZZ)
+#include "fuzz.h"
+#endif
+#if RV32_HAS(Zve32x)
+#include "vector.h"
+#endif
+#if RV32_HAS(PLUGIN)
+#include "plugin.h"
+#endif
 #include "riscv.h"
 #include "utils.h"
 #if RV32_HAS(JIT)
@@ -29,12 +50,24 @@ enum {
     CSR_FRM = 0x002,    /* Floating-point dynamic rounding mode */
     CSR_FCSR = 0x003,   /* Floating-point control and status register */
 
+    /* vector */
+    CSR_VSTART = 0x008, /* Vector start position */
+    CSR_VXSAT = 0x009,  /* Fixed-point accrued saturation flag */
+    CSR_VXRM = 0x00A,   /* Fixed-point rounding mode */
+    CSR_VCSR = 0x00F,   /* Vector control and status register */
+    CSR_VL = 0xC20,     /* Vector length */
+    CSR_VTYPE = 0xC21,  /* Vector data type register */
+    CSR_VLENB = 0xC22,  /* VLEN/8 (vector register length in bytes) */
+
     /* Supervisor trap setup */
     CSR_SSTATUS = 0x100,    /* Supervisor status register */
     CSR_SIE = 0x104,        /* Supervisor interrupt-enable register */
     CSR_STVEC = 0x105,      /* Supervisor trap-handler base address */
     CSR_SCOUNTEREN = 0x106, /* Supervisor counter enable */
 
+    /* Supervisor configuration */
+    CSR_SENVCFG = 0x10A, /* Supervisor environment configuration register */
+
     /* Supervisor trap handling */
     CSR_SSCRATCH = 0x140, /* Supervisor register for machine trap handlers */
     CSR_SEPC = 0x141,     /* Supervisor exception program counter */
@@ -60,6 +93,11 @@ enum {
     CSR_MTVEC = 0x305,      /* Machine trap-handler base address */
     CSR_MCOUNTEREN = 0x306, /* Machine counter enable */
 
+    /* Machine counter setup */
+    CSR_MCOUNTINHIBIT = 0x320, /* Machine counter-inhibit register */
+    CSR_MHPMEVENT3 = 0x323,    /* Machine performance-monitoring event */
+    CSR_MHPMEVENT31 = 0x33F,
+
     /* machine trap handling */
     CSR_MSCRATCH = 0x340, /* Scratch register for machine trap handlers */
     CSR_MEPC = 0x341,     /* Machine exception program counter */
@@ -67,15 +105,45 @@ enum {
     CSR_MTVAL = 0x343,    /* Machine bad address or instruction */
     CSR_MIP = 0x344,      /* Machine interrupt pending */
 
+    /* Machine performance-monitoring counters */
+    CSR_MHPMCOUNTER3 = 0xB03,
+    CSR_MHPMCOUNTER31 = 0xB1F,
+    CSR_MHPMCOUNTER3H = 0xB83,
+    CSR_MHPMCOUNTER31H = 0xB9F,
+
     /* low words */
     CSR_CYCLE = 0xC00, /* Cycle counter for RDCYCLE instruction */
     CSR_TIME = 0xC01,  /* Timer for RDTIME instruction */
     CSR_INSTRET = 0xC02,
+    CSR_HPMCOUNTER3 = 0xC03, /* Performance-monitoring counter */
+    CSR_HPMCOUNTER31 = 0xC1F,
 
     /* high words */
     CSR_CYCLEH = 0xC80,
     CSR_TIMEH = 0xC81,
     CSR_INSTRETH = 0xC82,
+    CSR_HPMCOUNTER3H = 0xC83,
+    CSR_HPMCOUNTER31H = 0xC9F,
+};
+
+/* Emulator events counted by the performance-monitoring counters 3 to 31,
+ * selected by writing one of the following to the matching mhpmevent.
+ * These values are part of the guest-visible interface, so new events must
+ * be appended.
+ */
+enum {
+    RV_HPM_NONE = 0,            /* the counter does not count */
+    RV_HPM_CYCLES = 1,          /* same as mcycle */
+    RV_HPM_INSTRET = 2,         /* same as minstret */
+    RV_HPM_BLOCK_TRANSLATE = 3, /* basic blocks decoded into IR */
+    RV_HPM_T1_COMPILE = 4,      /* blocks compiled by the tier-1 JIT */
+    RV_HPM_T1_INSN = 5,         /* instructions retired in tier-1 code */
+    RV_HPM_T2_COMPILE = 6,      /* blocks queued for the tier-2 JIT */
+    RV_HPM_T2_INSN = 7,         /* instructions retired in tier-2 code */
+    RV_HPM_MMU_WALK = 8,        /* page-table walks, i.e., TLB misses */
+    RV_HPM_TRAP = 9,            /* exceptions and interrupts taken */
+    RV_HPM_MISALIGNED = 10,     /* misaligned loads and stores */
+    RV_HPM_EVENT_COUNT,
 };
 
 /* translated basic block */
@@ -84,6 +152,9 @@ typedef struct block {
     uint32_t pc_start, pc_end; /**< address range of the basic block */
 
     rv_insn_t *ir_head, *ir_tail; /**< the first and last ir for this block */
+#if RV32_HAS(SYSTEM) && !RV32_HAS(JIT)
+    bool global; /**< translated from global pages, see block_map_flush() */
+#endif
 #if RV32_HAS(JIT)
     bool hot;  /**< Determine the block is potential hotspot or not */
     bool hot2; /**< Determine the block is strong hotspot or not */
@@ -119,6 +190,60 @@ typedef struct {
 /* clear all block in the block map */
 void block_map_clear(riscv_t *rv);
 
+/* run the instrumentation of a probe IR, return false to stop before the
+ * block is executed
+ */
+bool rv_probe(riscv_t *rv, const rv_insn_t *ir);
+
+#if RV32_HAS(PLUGIN) || RV32_HAS(GDBSTUB)
+/* an access of @size bytes at @vaddr, returning true to skip the remaining
+ * accesses of the instruction
+ */
+typedef bool (*mem_operand_fn_t)(void *arg,
+                                 uint32_t vaddr,
+                                 uint32_t size,
+                                 bool is_store);
+
+/* Decode the memory operands of @ir and call @access with @arg for each of
+ * the ranges the instruction is about to access, where a read-modify-write
+ * is reported as a store. Return false if @ir does not access memory, in
+ * which case @access, which may be NULL, is not called.
+ */
+bool insn_mem_operand(const riscv_t *rv,
+                      const rv_insn_t *ir,
+                      mem_operand_fn_t access,
+                      void *arg);
+#endif
+
+#if RV32_HAS(GDBSTUB)
+/* resume under GDB with the block cache and the JIT, until a breakpoint, a
+ * watchpoint, an interrupt from GDB or the end of the emulation
+ */
+void rv_debug_cont(riscv_t *rv);
+#endif
+
+#if !RV32_HAS(SYSTEM)
+/* run the instruction at the PC alone, as decoded and without optimization,
+ * or return false if it is a system instruction, which is left alone. The
+ * caller must make sure @rv has no blocks to jump into.
+ */
+bool rv_step_reference(riscv_t *rv);
+#endif
+
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+/* translate the block at @pc as the emulator would, without caching or
+ * running it, or return NULL if an instruction there cannot be decoded
+ */
+block_t *rv_translate_block(riscv_t *rv, uint32_t pc);
+
+/* release a block returned by rv_translate_block */
+void rv_free_block(riscv_t *rv, block_t *block);
+#endif
+
+/* read or write the performance-monitoring counter @idx, from 3 to 31 */
+uint64_t rv_hpm_read(riscv_t *rv, uint32_t idx);
+void rv_hpm_write(riscv_t *rv, uint32_t idx, uint64_t val);
+
 struct riscv_internal {
     bool halt; /* indicate whether the core is halted */
 
@@ -154,6 +279,18 @@ struct riscv_internal {
     uint32_t csr_fcsr;
 #endif
 
+#if RV32_HAS(Zve32x)
+    /* vector registers, where a register group is a run of them */
+    uint8_t V[32][VLENB] __ALIGNED(16);
+    uint32_t csr_vstart; /* first element to process */
+    uint32_t csr_vxsat;  /* fixed-point saturation flag */
+    uint32_t csr_vxrm;   /* fixed-point rounding mode */
+    uint32_t csr_vcsr;   /* vxrm and vxsat, assembled when read */
+    uint32_t csr_vl;     /* vector length */
+    uint32_t csr_vtype;  /* vector data type */
+    uint32_t csr_vlenb;  /* VLEN in bytes */
+#endif
+
     /* csr registers */
     uint64_t csr_cycle;     /* Machine cycle counter */
     uint32_t csr_time[2];   /* Performance counter */
@@ -178,6 +315,7 @@ struct riscv_internal {
     uint32_t csr_sip;        /* supervisor interrupt pending register */
     uint32_t csr_sie;        /* supervisor interrupt enable register */
     uint32_t csr_scounteren; /* supervisor counter-enable register */
+    uint32_t csr_senvcfg;    /* supervisor environment configuration */
     uint32_t csr_sscratch;   /* supervisor scratch register */
     uint32_t csr_sepc;       /* supervisor exception program counter */
     uint32_t csr_scause;     /* supervisor cause register */
@@ -187,6 +325,17 @@ struct riscv_internal {
     uint32_t priv_mode; /* U-mode or S-mode or M-mode */
 
     bool compressed; /**< current instruction is compressed or not */
+
+    /* performance-monitoring counters, indexed by counter number */
+    uint64_t hpm_events[RV_HPM_EVENT_COUNT]; /**< running event counts */
+    uint64_t csr_mhpmcounter[32]; /**< counter values, when not counting */
+    uint64_t hpm_base[32];        /**< event count at which counting began */
+    uint32_t csr_mhpmevent[32];
+    uint32_t csr_mcountinhibit;
+    uint32_t hpm_allocated; /**< counters in use by the SBI PMU extension */
+#if RV32_HAS(JIT)
+    bool hpm_t1_insn; /**< tier-1 code counts RV_HPM_T1_INSN for a reader */
+#endif
 #if !RV32_HAS(JIT)
     block_map_t block_map; /**< basic block map */
 #else
@@ -202,6 +351,25 @@ struct riscv_internal {
 #endif
     struct mpool *block_mp, *block_ir_mp;
 
+    bbv_t *bbv;           /**< basic-block vector profiler, NULL if disabled */
+    coverage_t *coverage; /**< coverage recorder, NULL if disabled */
+    warmup_t *warmup;     /**< warm-up profiler, NULL if disabled */
+    replay_t *replay;     /**< input recorder or replayer, NULL if disabled */
+#if RV32_HAS(SYSTEM)
+    bootprof_t *bootprof; /**< Linux boot profiler, NULL if disabled */
+#else
+    lockstep_t *lockstep; /**< differential checker, NULL if disabled */
+#endif
+#if RV32_HAS(T2C) && !RV32_HAS(SYSTEM)
+    aot_t *aot; /**< code compiled ahead of time, NULL if none */
+#endif
+#if RV32_HAS(PLUGIN)
+    plugin_set_t *plugins; /**< loaded plugins, NULL if none */
+#endif
+#if RV32_HAS(FUZZ)
+    fuzz_t *fuzz; /**< fuzzing harness, NULL if disabled */
+#endif
+
 #if RV32_HAS(GDBSTUB)
     /* gdbstub instance */
     gdbstub_t gdbstub;
@@ -211,6 +379,19 @@ struct riscv_internal {
     /* GDB instruction breakpoint */
     breakpoint_map_t breakpoint_map;
 
+    /* GDB data watchpoints */
+    watchpoint_t watchpoints[MAX_WATCHPOINTS];
+    uint32_t n_watchpoints;
+
+    /* set by the probe of a breakpoint or a watchpoint to stop the blocks */
+    bool debug_stop;
+
+    /* the translated blocks may miss a breakpoint, or code GDB has written */
+    bool debug_flush;
+
+    /* the translated blocks carry probes in front of the memory accesses */
+    bool watch_probes;
+
     /* The flag to notify interrupt from GDB client: it should be accessed by
      * atomic operation when starting the GDBSTUB.
      */
@@ -221,6 +402,11 @@ struct riscv_internal {
     /* The flag is used to indicate the current emulation is in a trap */
     bool is_trapped;
 
+    /* a supervisor interrupt is pending, enabled and not masked by sstatus,
+     * kept by rv_update_intr_pending() so that no block has to check CSRs
+     */
+    bool intr_pending;
+
     /*
      * The flag that stores the SEPC CSR at the trap point for corectly
      * executing signal handler.
@@ -229,6 +415,31 @@ struct riscv_internal {
 #endif
 };
 
+/* account @n occurrences of the emulator event @event, one of RV_HPM_* */
+FORCE_INLINE void rv_hpm_count(riscv_t *rv, uint32_t event, uint64_t n)
+{
+    rv->hpm_events[event] += n;
+}
+
+/* guest instructions retired so far, by whichever execution tier */
+FORCE_INLINE uint64_t rv_icount(const riscv_t *rv)
+{
+    return rv->csr_cycle + rv->hpm_events[RV_HPM_T1_INSN] +
+           rv->hpm_events[RV_HPM_T2_INSN];
+}
+
+#if RV32_HAS(SYSTEM)
+/* Recompute rv->intr_pending. Whatever writes sip, sie, sstatus or the
+ * privilege mode calls this, and rv_step only tests the flag between blocks.
+ */
+FORCE_INLINE void rv_update_intr_pending(riscv_t *rv)
+{
+    rv->intr_pending =
+        (rv->csr_sstatus & SSTATUS_SIE || rv->priv_mode == RV_PRIV_U_MODE) &&
+        (rv->csr_sip & rv->csr_sie & (SIP_SSIP | SIP_STIP | SIP_SEIP));
+}
+#endif
+
 /* sign extend a 16 bit value */
 FORCE_INLINE uint32_t sign_extend_h(const uint32_t x)
 {
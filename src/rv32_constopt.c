@@ -394,6 +394,18 @@ CONSTOPT(sfencevma, {})
 CONSTOPT(fencei, {})
 #endif
 
+#if RV32_HAS(Zicbom) /* RV32 Zicbom Standard Extension */
+CONSTOPT(cboinval, {})
+
+CONSTOPT(cboclean, {})
+
+CONSTOPT(cboflush, {})
+#endif
+
+#if RV32_HAS(Zicboz) /* RV32 Zicboz Standard Extension */
+CONSTOPT(cbozero, {})
+#endif
+
 #if RV32_HAS(Zicsr) /* RV32 Zicsr Standard Extension */
 /* CSRRW: Atomic Read/Write CSR */
 CONSTOPT(csrrw, { info->is_constant[ir->rd] = false; })
@@ -745,6 +757,78 @@ CONSTOPT(fcvtswu, {})
 
 /* FMV.W.X */
 CONSTOPT(fmvwx, {})
+
+#if RV32_HAS(Zfa)
+/* FLI.S */
+CONSTOPT(flis, {})
+
+/* FMINM.S */
+CONSTOPT(fminms, {})
+
+/* FMAXM.S */
+CONSTOPT(fmaxms, {})
+
+/* FROUND.S */
+CONSTOPT(frounds, {})
+
+/* FROUNDNX.S */
+CONSTOPT(froundnxs, {})
+
+/* FLEQ.S */
+CONSTOPT(fleqs, {
+    if (ir->rd)
+        info->is_constant[ir->rd] = false;
+})
+
+/* FLTQ.S */
+CONSTOPT(fltqs, {
+    if (ir->rd)
+        info->is_constant[ir->rd] = false;
+})
+#endif
+#endif
+
+/* RV32 Zve32x/Zve32f Standard Extensions */
+
+#if RV32_HAS(Zve32x)
+/* VSETVLI, VSETIVLI and VSETVL write the new vl to x[rd] */
+CONSTOPT(vsetvli, {
+    if (ir->rd)
+        info->is_constant[ir->rd] = false;
+})
+
+CONSTOPT(vsetivli, {
+    if (ir->rd)
+        info->is_constant[ir->rd] = false;
+})
+
+CONSTOPT(vsetvl, {
+    if (ir->rd)
+        info->is_constant[ir->rd] = false;
+})
+
+CONSTOPT(vle, {})
+CONSTOPT(vlse, {})
+CONSTOPT(vlxe, {})
+CONSTOPT(vse, {})
+CONSTOPT(vsse, {})
+CONSTOPT(vsxe, {})
+CONSTOPT(vopivv, {})
+CONSTOPT(vopivx, {})
+CONSTOPT(vopivi, {})
+
+/* vmv.x.s, vcpop.m and vfirst.m write x[rd] */
+CONSTOPT(vopmvv, {
+    if (ir->rd)
+        info->is_constant[ir->rd] = false;
+})
+
+CONSTOPT(vopmvx, {})
+
+#if RV32_HAS(Zve32f)
+CONSTOPT(vopfvv, {})
+CONSTOPT(vopfvf, {})
+#endif
 #endif
 
 /* RV32C Standard Extension */
@@ -1040,6 +1124,79 @@ CONSTOPT(cflw, {})
 CONSTOPT(cfsw, {})
 #endif
 
+/* RV32 Zcb Standard Extension */
+
+#if RV32_HAS(Zcb)
+/* C.LBU */
+CONSTOPT(clbu, { info->is_constant[ir->rd] = false; })
+
+/* C.LHU */
+CONSTOPT(clhu, { info->is_constant[ir->rd] = false; })
+
+/* C.LH */
+CONSTOPT(clh, { info->is_constant[ir->rd] = false; })
+
+/* C.SB */
+CONSTOPT(csb, {})
+
+/* C.SH */
+CONSTOPT(csh, {})
+
+/* C.ZEXT.B */
+CONSTOPT(czextb, { info->is_constant[ir->rd] = false; })
+
+/* C.NOT */
+CONSTOPT(cnot, { info->is_constant[ir->rd] = false; })
+
+#if RV32_HAS(Zbb)
+/* C.SEXT.B */
+CONSTOPT(csextb, { info->is_constant[ir->rd] = false; })
+
+/* C.ZEXT.H */
+CONSTOPT(czexth, { info->is_constant[ir->rd] = false; })
+
+/* C.SEXT.H */
+CONSTOPT(csexth, { info->is_constant[ir->rd] = false; })
+#endif
+
+#if RV32_HAS(EXT_M)
+/* C.MUL */
+CONSTOPT(cmul, { info->is_constant[ir->rd] = false; })
+#endif
+#endif
+
+/* RV32 Zcmp Standard Extension */
+
+#if RV32_HAS(Zcmp)
+/* CM.PUSH */
+CONSTOPT(cmpush, { info->is_constant[rv_reg_sp] = false; })
+
+/* CM.POP */
+CONSTOPT(cmpop, {
+    info->is_constant[rv_reg_sp] = false;
+    for (int i = 0; i < ir->imm2; i++)
+        info->is_constant[zcmp_reg(i)] = false;
+})
+
+/* CM.POPRETZ */
+CONSTOPT(cmpopretz, {})
+
+/* CM.POPRET */
+CONSTOPT(cmpopret, {})
+
+/* CM.MVSA01 */
+CONSTOPT(cmmvsa01, {
+    info->is_constant[ir->rs1] = false;
+    info->is_constant[ir->rs2] = false;
+})
+
+/* CM.MVA01S */
+CONSTOPT(cmmva01s, {
+    info->is_constant[rv_reg_a0] = false;
+    info->is_constant[rv_reg_a1] = false;
+})
+#endif
+
 #if RV32_HAS(Zba)
 /* SH1ADD */
 CONSTOPT(sh1add, {
@@ -1240,3 +1397,31 @@ CONSTOPT(bseti, {
 })
 
 #endif
+
+/* RV32 Zicond Standard Extension */
+
+#if RV32_HAS(Zicond)
+/* CZERO.EQZ */
+CONSTOPT(czeroeqz, {
+    if (info->is_constant[ir->rs1] && info->is_constant[ir->rs2]) {
+        info->is_constant[ir->rd] = true;
+        ir->imm = info->const_val[ir->rs2] ? info->const_val[ir->rs1] : 0;
+        info->const_val[ir->rd] = ir->imm;
+        ir->opcode = rv_insn_lui;
+        ir->impl = dispatch_table[ir->opcode];
+    } else
+        info->is_constant[ir->rd] = false;
+})
+
+/* CZERO.NEZ */
+CONSTOPT(czeronez, {
+    if (info->is_constant[ir->rs1] && info->is_constant[ir->rs2]) {
+        info->is_constant[ir->rd] = true;
+        ir->imm = info->const_val[ir->rs2] ? 0 : info->const_val[ir->rs1];
+        info->const_val[ir->rd] = ir->imm;
+        ir->opcode = rv_insn_lui;
+        ir->impl = dispatch_table[ir->opcode];
+    } else
+        info->is_constant[ir->rd] = false;
+})
+#endif
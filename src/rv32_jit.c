@@ -167,7 +167,7 @@ GEN(lb, {
                        offsetof(riscv_t, jit_mmu.type));
 
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rd);
+            emit_jit_mmu_handler(state, ir->rd, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -219,7 +219,7 @@ GEN(lh, {
                        offsetof(riscv_t, jit_mmu.type));
 
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rd);
+            emit_jit_mmu_handler(state, ir->rd, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -271,7 +271,7 @@ GEN(lw, {
                        offsetof(riscv_t, jit_mmu.type));
 
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rd);
+            emit_jit_mmu_handler(state, ir->rd, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -323,7 +323,7 @@ GEN(lbu, {
                        offsetof(riscv_t, jit_mmu.type));
 
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rd);
+            emit_jit_mmu_handler(state, ir->rd, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -375,7 +375,7 @@ GEN(lhu, {
                        offsetof(riscv_t, jit_mmu.type));
 
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rd);
+            emit_jit_mmu_handler(state, ir->rd, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -426,7 +426,7 @@ GEN(sb, {
             emit_store(state, S32, temp_reg, parameter_reg[0],
                        offsetof(riscv_t, jit_mmu.type));
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rs2);
+            emit_jit_mmu_handler(state, ir->rs2, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -476,7 +476,7 @@ GEN(sh, {
             emit_store(state, S32, temp_reg, parameter_reg[0],
                        offsetof(riscv_t, jit_mmu.type));
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rs2);
+            emit_jit_mmu_handler(state, ir->rs2, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -526,7 +526,7 @@ GEN(sw, {
             emit_store(state, S32, temp_reg, parameter_reg[0],
                        offsetof(riscv_t, jit_mmu.type));
             store_back(state);
-            emit_jit_mmu_handler(state, ir->rs2);
+            emit_jit_mmu_handler(state, ir->rs2, ir->pc);
             /* clear register mapping */
             reset_reg();
 
@@ -743,6 +743,14 @@ GEN(sfencevma, { assert(NULL); })
 #if RV32_HAS(Zifencei) /* RV32 Zifencei Standard Extension */
 GEN(fencei, { assert(NULL); })
 #endif
+#if RV32_HAS(Zicbom) /* RV32 Zicbom Standard Extension */
+GEN(cboinval, { assert(NULL); })
+GEN(cboclean, { assert(NULL); })
+GEN(cboflush, { assert(NULL); })
+#endif
+#if RV32_HAS(Zicboz) /* RV32 Zicboz Standard Extension */
+GEN(cbozero, { assert(NULL); })
+#endif
 #if RV32_HAS(Zicsr) /* RV32 Zicsr Standard Extension */
 GEN(csrrw, { assert(NULL); })
 GEN(csrrs, { assert(NULL); })
@@ -764,6 +772,8 @@ GEN(mulh, {
     vm_reg[2] = map_vm_reg(state, ir->rd);
     emit_mov(state, vm_reg[1], temp_reg);
     emit_mov(state, vm_reg[0], vm_reg[2]);
+    emit_sext32(state, temp_reg);
+    emit_sext32(state, vm_reg[2]);
     muldivmod(state, 0x2f, temp_reg, vm_reg[2], 0);
     emit_alu64_imm8(state, 0xc1, 5, vm_reg[2], 32);
 })
@@ -772,6 +782,7 @@ GEN(mulhsu, {
     vm_reg[2] = map_vm_reg(state, ir->rd);
     emit_mov(state, vm_reg[1], temp_reg);
     emit_mov(state, vm_reg[0], vm_reg[2]);
+    emit_sext32(state, vm_reg[2]);
     muldivmod(state, 0x2f, temp_reg, vm_reg[2], 0);
     emit_alu64_imm8(state, 0xc1, 5, vm_reg[2], 32);
 })
@@ -852,6 +863,35 @@ GEN(fclasss, { assert(NULL); })
 GEN(fcvtsw, { assert(NULL); })
 GEN(fcvtswu, { assert(NULL); })
 GEN(fmvwx, { assert(NULL); })
+#if RV32_HAS(Zfa)
+GEN(flis, { assert(NULL); })
+GEN(fminms, { assert(NULL); })
+GEN(fmaxms, { assert(NULL); })
+GEN(frounds, { assert(NULL); })
+GEN(froundnxs, { assert(NULL); })
+GEN(fleqs, { assert(NULL); })
+GEN(fltqs, { assert(NULL); })
+#endif
+#endif
+#if RV32_HAS(Zve32x)
+GEN(vsetvli, { assert(NULL); })
+GEN(vsetivli, { assert(NULL); })
+GEN(vsetvl, { assert(NULL); })
+GEN(vle, { assert(NULL); })
+GEN(vlse, { assert(NULL); })
+GEN(vlxe, { assert(NULL); })
+GEN(vse, { assert(NULL); })
+GEN(vsse, { assert(NULL); })
+GEN(vsxe, { assert(NULL); })
+GEN(vopivv, { assert(NULL); })
+GEN(vopivx, { assert(NULL); })
+GEN(vopivi, { assert(NULL); })
+GEN(vopmvv, { assert(NULL); })
+GEN(vopmvx, { assert(NULL); })
+#if RV32_HAS(Zve32f)
+GEN(vopfvv, { assert(NULL); })
+GEN(vopfvf, { assert(NULL); })
+#endif
 #endif
 #if RV32_HAS(EXT_C)
 GEN(caddi4spn, {
@@ -1059,6 +1099,137 @@ GEN(cfswsp, { assert(NULL); })
 GEN(cflw, { assert(NULL); })
 GEN(cfsw, { assert(NULL); })
 #endif
+#if RV32_HAS(Zcb)
+GEN(clbu, {
+    memory_t *m = PRIV(rv)->mem;
+    vm_reg[0] = ra_load(state, ir->rs1);
+    emit_load_imm_sext(state, temp_reg, (intptr_t) (m->mem_base + ir->imm));
+    emit_alu64(state, 0x01, vm_reg[0], temp_reg);
+    vm_reg[1] = map_vm_reg(state, ir->rd);
+    emit_load(state, S8, temp_reg, vm_reg[1], 0);
+})
+GEN(clhu, {
+    memory_t *m = PRIV(rv)->mem;
+    vm_reg[0] = ra_load(state, ir->rs1);
+    emit_load_imm_sext(state, temp_reg, (intptr_t) (m->mem_base + ir->imm));
+    emit_alu64(state, 0x01, vm_reg[0], temp_reg);
+    vm_reg[1] = map_vm_reg(state, ir->rd);
+    emit_load(state, S16, temp_reg, vm_reg[1], 0);
+})
+GEN(clh, {
+    memory_t *m = PRIV(rv)->mem;
+    vm_reg[0] = ra_load(state, ir->rs1);
+    emit_load_imm_sext(state, temp_reg, (intptr_t) (m->mem_base + ir->imm));
+    emit_alu64(state, 0x01, vm_reg[0], temp_reg);
+    vm_reg[1] = map_vm_reg(state, ir->rd);
+    emit_load_sext(state, S16, temp_reg, vm_reg[1], 0);
+})
+GEN(csb, {
+    memory_t *m = PRIV(rv)->mem;
+    vm_reg[0] = ra_load(state, ir->rs1);
+    emit_load_imm_sext(state, temp_reg, (intptr_t) (m->mem_base + ir->imm));
+    emit_alu64(state, 0x01, vm_reg[0], temp_reg);
+    vm_reg[1] = ra_load(state, ir->rs2);
+    emit_store(state, S8, vm_reg[1], temp_reg, 0);
+})
+GEN(csh, {
+    memory_t *m = PRIV(rv)->mem;
+    vm_reg[0] = ra_load(state, ir->rs1);
+    emit_load_imm_sext(state, temp_reg, (intptr_t) (m->mem_base + ir->imm));
+    emit_alu64(state, 0x01, vm_reg[0], temp_reg);
+    vm_reg[1] = ra_load(state, ir->rs2);
+    emit_store(state, S16, vm_reg[1], temp_reg, 0);
+})
+GEN(czextb, {
+    vm_reg[0] = ra_load(state, ir->rd);
+    emit_alu32_imm32(state, 0x81, 4, vm_reg[0], 0xff);
+})
+GEN(cnot, {
+    vm_reg[0] = ra_load(state, ir->rd);
+    emit_alu32_imm32(state, 0x81, 6, vm_reg[0], -1);
+})
+#if RV32_HAS(Zbb)
+GEN(csextb, {
+    vm_reg[0] = ra_load(state, ir->rd);
+    emit_alu32_imm8(state, 0xc1, 4, vm_reg[0], 24);
+    emit_alu32_imm8(state, 0xc1, 7, vm_reg[0], 24);
+})
+GEN(czexth, {
+    vm_reg[0] = ra_load(state, ir->rd);
+    emit_alu32_imm32(state, 0x81, 4, vm_reg[0], 0xffff);
+})
+GEN(csexth, {
+    vm_reg[0] = ra_load(state, ir->rd);
+    emit_alu32_imm8(state, 0xc1, 4, vm_reg[0], 16);
+    emit_alu32_imm8(state, 0xc1, 7, vm_reg[0], 16);
+})
+#endif
+#if RV32_HAS(EXT_M)
+GEN(cmul, {
+    ra_load2(state, ir->rs1, ir->rs2);
+    vm_reg[2] = map_vm_reg(state, ir->rd);
+    emit_mov(state, vm_reg[1], temp_reg);
+    emit_mov(state, vm_reg[0], vm_reg[2]);
+    muldivmod(state, 0x28, temp_reg, vm_reg[2], 0);
+})
+#endif
+#endif
+#if RV32_HAS(Zcmp)
+GEN(cmpush, { emit_cm_push(state, rv, ir); })
+GEN(cmpop, { emit_cm_pop(state, rv, ir); })
+GEN(cmpopretz, {
+    emit_cm_pop(state, rv, ir);
+    vm_reg[0] = map_vm_reg(state, rv_reg_a0);
+    emit_load_imm(state, vm_reg[0], 0);
+    vm_reg[0] = ra_load(state, rv_reg_ra);
+    emit_mov(state, vm_reg[0], temp_reg);
+    store_back(state);
+    parse_branch_history_table(state, rv, ir);
+    emit_store(state, S32, temp_reg, parameter_reg[0], offsetof(riscv_t, PC));
+    emit_exit(state);
+})
+GEN(cmpopret, {
+    emit_cm_pop(state, rv, ir);
+    vm_reg[0] = ra_load(state, rv_reg_ra);
+    emit_mov(state, vm_reg[0], temp_reg);
+    store_back(state);
+    parse_branch_history_table(state, rv, ir);
+    emit_store(state, S32, temp_reg, parameter_reg[0], offsetof(riscv_t, PC));
+    emit_exit(state);
+})
+GEN(cmmvsa01, {
+    vm_reg[0] = ra_load(state, rv_reg_a0);
+    vm_reg[1] = map_vm_reg(state, ir->rs1);
+    if (vm_reg[0] != vm_reg[1]) {
+        emit_mov(state, vm_reg[0], vm_reg[1]);
+    } else {
+        set_dirty(vm_reg[1], true);
+    }
+    vm_reg[0] = ra_load(state, rv_reg_a1);
+    vm_reg[1] = map_vm_reg(state, ir->rs2);
+    if (vm_reg[0] != vm_reg[1]) {
+        emit_mov(state, vm_reg[0], vm_reg[1]);
+    } else {
+        set_dirty(vm_reg[1], true);
+    }
+})
+GEN(cmmva01s, {
+    vm_reg[0] = ra_load(state, ir->rs1);
+    vm_reg[1] = map_vm_reg(state, rv_reg_a0);
+    if (vm_reg[0] != vm_reg[1]) {
+        emit_mov(state, vm_reg[0], vm_reg[1]);
+    } else {
+        set_dirty(vm_reg[1], true);
+    }
+    vm_reg[0] = ra_load(state, ir->rs2);
+    vm_reg[1] = map_vm_reg(state, rv_reg_a1);
+    if (vm_reg[0] != vm_reg[1]) {
+        emit_mov(state, vm_reg[0], vm_reg[1]);
+    } else {
+        set_dirty(vm_reg[1], true);
+    }
+})
+#endif
 #if RV32_HAS(Zba)
 GEN(sh1add, { assert(NULL); })
 GEN(sh2add, { assert(NULL); })
@@ -1099,3 +1270,15 @@ GEN(binvi, { assert(NULL); })
 GEN(bset, { assert(NULL); })
 GEN(bseti, { assert(NULL); })
 #endif
+#if RV32_HAS(Zicond)
+GEN(czeroeqz, {
+    ra_load2(state, ir->rs1, ir->rs2);
+    vm_reg[2] = map_vm_reg(state, ir->rd);
+    emit_czero(state, vm_reg[0], vm_reg[1], vm_reg[2], true);
+})
+GEN(czeronez, {
+    ra_load2(state, ir->rs1, ir->rs2);
+    vm_reg[2] = map_vm_reg(state, ir->rd);
+    emit_czero(state, vm_reg[0], vm_reg[1], vm_reg[2], false);
+})
+#endif
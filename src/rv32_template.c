@@ -113,6 +113,14 @@
  * |                                | maximal frequency. Then, comparing    |
  * |                                | and jumping to the target if the       |
  * |                                | program counter matches.               |
+ * | cmpush;                        | store the register list of cm.push     |
+ * |                                | below sp and allocate the stack frame. |
+ * | cmpop;                         | load the register list of cm.pop from  |
+ * |                                | the top of the stack frame and         |
+ * |                                | deallocate the frame.                  |
+ * | czero, src, cond, dst, eqz;    | move src into dst, or zero if cond is  |
+ * |                                | zero (eqz) or not zero (!eqz), with a  |
+ * |                                | conditional move of the host.          |
  * | break;                         | In the end of a basic block, we need   |
  * |                                | to store all VM register value to rv   |
  * |                                | data, because the register allocation  |
@@ -198,7 +206,7 @@ RVOP(
                  */
                 last_pc = PC;
 
-                MUST_TAIL return taken->impl(rv, taken, cycle, PC);
+                RVOP_DISPATCH(taken);
             }
         }
         goto end_op;
@@ -238,8 +246,7 @@ RVOP(
         {                                                                      \
             for (int i = 0; i < HISTORY_SIZE; i++) {                           \
                 if (ir->branch_table->PC[i] == PC) {                           \
-                    MUST_TAIL return ir->branch_table->target[i]->impl(        \
-                        rv, ir->branch_table->target[i], cycle, PC);           \
+                    RVOP_DISPATCH(ir->branch_table->target[i]);                \
                 }                                                              \
             }                                                                  \
             block_t *block = block_find(&rv->block_map, PC);                   \
@@ -250,13 +257,13 @@ RVOP(
                     block->ir_head;                                            \
                 ir->branch_table->idx =                                        \
                     (ir->branch_table->idx + 1) % HISTORY_SIZE;                \
-                MUST_TAIL return block->ir_head->impl(rv, block->ir_head,      \
-                                                      cycle, PC);              \
+                RVOP_DISPATCH(block->ir_head);                                 \
             }                                                                  \
         }                                                                      \
     }
 #else
 #define LOOKUP_OR_UPDATE_BRANCH_HISTORY_TABLE()                              \
+    IIF(RV32_HAS(GDBSTUB)(if (!rv->debug_mode), ))                           \
     IIF(RV32_HAS(SYSTEM))(if (!rv->is_trapped && !reloc_enable_mmu), )       \
     {                                                                        \
         block_t *block = cache_get(rv->block_cache, PC, true);               \
@@ -289,8 +296,7 @@ RVOP(
             (ir->branch_table->satp[min_idx] = rv->csr_satp, );              \
             if (cache_hot(rv->block_cache, PC))                              \
                 goto end_op;                                                 \
-            MUST_TAIL return block->ir_head->impl(rv, block->ir_head, cycle, \
-                                                  PC);                       \
+            RVOP_DISPATCH(block->ir_head);                                   \
         }                                                                    \
     }
 #endif
@@ -335,6 +341,8 @@ RVOP(
             reloc_enable_mmu = true;
             need_retranslate = true;
             rv->is_trapped = false;
+            if (rv->bootprof)
+                bootprof_mark(rv, BOOTPROF_MMU, NULL, cycle);
         }
 
 #endif /* RV32_HAS(SYSTEM) */
@@ -396,7 +404,7 @@ RVOP(
             {                                                               \
                 if (!rv->is_trapped) {                                      \
                     last_pc = PC;                                           \
-                    MUST_TAIL return untaken->impl(rv, untaken, cycle, PC); \
+                    RVOP_DISPATCH(untaken);                                 \
                 }                                                           \
             }, );                                                           \
         goto end_op;                                                        \
@@ -432,7 +440,7 @@ RVOP(
             {                                                               \
                 if (!rv->is_trapped) {                                      \
                     last_pc = PC;                                           \
-                    MUST_TAIL return taken->impl(rv, taken, cycle, PC);     \
+                    RVOP_DISPATCH(taken);                                   \
                 }                                                           \
             }, );                                                           \
     }                                                                       \
@@ -843,24 +851,6 @@ RVOP(
         alu32imm, 32, 0x81, 4, VR1, imm;
     }))
 
-FORCE_INLINE void shift_func(riscv_t *rv, const rv_insn_t *ir)
-{
-    switch (ir->opcode) {
-    case rv_insn_slli:
-        rv->X[ir->rd] = rv->X[ir->rs1] << (ir->imm & 0x1f);
-        break;
-    case rv_insn_srli:
-        rv->X[ir->rd] = rv->X[ir->rs1] >> (ir->imm & 0x1f);
-        break;
-    case rv_insn_srai:
-        rv->X[ir->rd] = ((int32_t) rv->X[ir->rs1]) >> (ir->imm & 0x1f);
-        break;
-    default:
-        __UNREACHABLE;
-        break;
-    }
-};
-
 /* SLLI performs logical left shift on the value in register rs1 by the shift
  * amount held in the lower 5 bits of the immediate.
  */
@@ -1125,11 +1115,14 @@ RVOP(
         rv->is_trapped = false;
         rv->priv_mode = (rv->csr_sstatus & SSTATUS_SPP) >> SSTATUS_SPP_SHIFT;
         rv->csr_sstatus &= ~(SSTATUS_SPP);
+        if (unlikely(rv->bootprof) && rv->priv_mode == RV_PRIV_U_MODE)
+            bootprof_mark(rv, BOOTPROF_USER, NULL, cycle);
 
         const uint32_t sstatus_spie =
             (rv->csr_sstatus & SSTATUS_SPIE) >> SSTATUS_SPIE_SHIFT;
         rv->csr_sstatus |= (sstatus_spie << SSTATUS_SIE_SHIFT);
         rv->csr_sstatus |= SSTATUS_SPIE;
+        rv_update_intr_pending(rv);
 
         rv->PC = rv->csr_sepc;
 
@@ -1162,6 +1155,7 @@ RVOP(
             (rv->csr_mstatus & MSTATUS_MPIE) >> MSTATUS_MPIE_SHIFT;
         rv->csr_mstatus |= (mstatus_mpie << MSTATUS_MIE_SHIFT);
         rv->csr_mstatus |= MSTATUS_MPIE;
+        IIF(RV32_HAS(SYSTEM))(rv_update_intr_pending(rv);, )
 
         rv->PC = rv->csr_mepc;
         return true;
@@ -1199,11 +1193,59 @@ RVOP(
     }))
 #endif
 
+#if RV32_HAS(Zicbom) /* RV32 Zicbom Standard Extension */
+/* There are no caches to write back or to discard, so that the cache-block
+ * management instructions only have to be allowed. CBO.INVAL stands for
+ * CBO.FLUSH when senvcfg.CBIE is 01, which makes no difference either.
+ */
+
+/* CBO.INVAL: invalidate the cache block which x[rs1] points into */
+RVOP(
+    cboinval,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!cbo_enabled(rv, SENVCFG_CBIE)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* CBO.CLEAN: write back the cache block which x[rs1] points into */
+RVOP(
+    cboclean,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!cbo_enabled(rv, SENVCFG_CBCFE)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* CBO.FLUSH: write back and invalidate the cache block which x[rs1] points
+ * into
+ */
+RVOP(
+    cboflush,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!cbo_enabled(rv, SENVCFG_CBCFE)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+#endif
+
+#if RV32_HAS(Zicboz) /* RV32 Zicboz Standard Extension */
+/* CBO.ZERO: store zeros to the whole cache block which x[rs1] points into */
+RVOP(
+    cbozero,
+    {
+        RV_EXC_ILLEGAL_INSN_HANDLER(!cbo_enabled(rv, SENVCFG_CBZE));
+        cbo_zero(rv, rv->X[ir->rs1]);
+    },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+#endif
+
 #if RV32_HAS(Zicsr) /* RV32 Zicsr Standard Extension */
 /* CSRRW: Atomic Read/Write CSR */
 RVOP(
     csrrw,
     {
+        /* reads of the counters and of time see this instruction retired */
+        rv->csr_cycle = cycle;
         uint32_t tmp = csr_csrrw(rv, ir->imm, rv->X[ir->rs1]);
         rv->X[ir->rd] = ir->rd ? tmp : rv->X[ir->rd];
     },
@@ -1223,6 +1265,7 @@ RVOP(
 RVOP(
     csrrs,
     {
+        rv->csr_cycle = cycle;
         uint32_t tmp = csr_csrrs(
             rv, ir->imm, (ir->rs1 == rv_reg_zero) ? 0U : rv->X[ir->rs1]);
         rv->X[ir->rd] = ir->rd ? tmp : rv->X[ir->rd];
@@ -1235,6 +1278,7 @@ RVOP(
 RVOP(
     csrrc,
     {
+        rv->csr_cycle = cycle;
         uint32_t tmp = csr_csrrc(
             rv, ir->imm, (ir->rs1 == rv_reg_zero) ? 0U : rv->X[ir->rs1]);
         rv->X[ir->rd] = ir->rd ? tmp : rv->X[ir->rd];
@@ -1247,6 +1291,7 @@ RVOP(
 RVOP(
     csrrwi,
     {
+        rv->csr_cycle = cycle;
         uint32_t tmp = csr_csrrw(rv, ir->imm, ir->rs1);
         rv->X[ir->rd] = ir->rd ? tmp : rv->X[ir->rd];
     },
@@ -1258,6 +1303,7 @@ RVOP(
 RVOP(
     csrrsi,
     {
+        rv->csr_cycle = cycle;
         uint32_t tmp = csr_csrrs(rv, ir->imm, ir->rs1);
         rv->X[ir->rd] = ir->rd ? tmp : rv->X[ir->rd];
     },
@@ -1269,6 +1315,7 @@ RVOP(
 RVOP(
     csrrci,
     {
+        rv->csr_cycle = cycle;
         uint32_t tmp = csr_csrrc(rv, ir->imm, ir->rs1);
         rv->X[ir->rd] = ir->rd ? tmp : rv->X[ir->rd];
     },
@@ -2017,6 +2064,255 @@ RVOP(
     GEN({
         assert; /* FIXME: Implement */
     }))
+
+#if RV32_HAS(Zfa)
+/* FLI.S loads one of 32 single-precision constants, whose bits the decoder
+ * has already put in @imm.
+ */
+RVOP(
+    flis,
+    { rv->F[ir->rd].v = ir->imm; },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* FMINM.S and FMAXM.S are FMIN.S and FMAX.S, except that they return the
+ * canonical NaN when either input is NaN.
+ */
+RVOP(
+    fminms,
+    {
+        if (f32_isSignalingNaN(rv->F[ir->rs1]) ||
+            f32_isSignalingNaN(rv->F[ir->rs2]))
+            rv->csr_fcsr |= FFLAG_INVALID_OP;
+        bool less = f32_lt_quiet(rv->F[ir->rs1], rv->F[ir->rs2]) ||
+                    (f32_eq(rv->F[ir->rs1], rv->F[ir->rs2]) &&
+                     (rv->F[ir->rs1].v & FMASK_SIGN));
+        if (is_nan(rv->F[ir->rs1].v) || is_nan(rv->F[ir->rs2].v))
+            rv->F[ir->rd].v = RV_NAN;
+        else
+            rv->F[ir->rd] = less ? rv->F[ir->rs1] : rv->F[ir->rs2];
+    },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* FMAXM.S */
+RVOP(
+    fmaxms,
+    {
+        if (f32_isSignalingNaN(rv->F[ir->rs1]) ||
+            f32_isSignalingNaN(rv->F[ir->rs2]))
+            rv->csr_fcsr |= FFLAG_INVALID_OP;
+        bool greater = f32_lt_quiet(rv->F[ir->rs2], rv->F[ir->rs1]) ||
+                       (f32_eq(rv->F[ir->rs1], rv->F[ir->rs2]) &&
+                        (rv->F[ir->rs2].v & FMASK_SIGN));
+        if (is_nan(rv->F[ir->rs1].v) || is_nan(rv->F[ir->rs2].v))
+            rv->F[ir->rd].v = RV_NAN;
+        else
+            rv->F[ir->rd] = greater ? rv->F[ir->rs1] : rv->F[ir->rs2];
+    },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* FROUND.S rounds to an integral value in floating-point format with the
+ * rounding mode, without raising the inexact exception.
+ */
+RVOP(
+    frounds,
+    {
+        set_rounding_mode(rv, ir->rm);
+        rv->F[ir->rd] =
+            f32_roundToInt(rv->F[ir->rs1], softfloat_roundingMode, false);
+        set_fflag(rv);
+    },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* FROUNDNX.S does as FROUND.S, but raises the inexact exception when the
+ * result differs from the input.
+ */
+RVOP(
+    froundnxs,
+    {
+        set_rounding_mode(rv, ir->rm);
+        rv->F[ir->rd] =
+            f32_roundToInt(rv->F[ir->rs1], softfloat_roundingMode, true);
+        set_fflag(rv);
+    },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* FLEQ.S and FLTQ.S are the quiet versions of FLE.S and FLT.S, which only
+ * raise the invalid operation exception on signaling NaN inputs.
+ */
+RVOP(
+    fleqs,
+    {
+        uint32_t ret = f32_le_quiet(rv->F[ir->rs1], rv->F[ir->rs2]);
+        if (ir->rd)
+            rv->X[ir->rd] = ret;
+        set_fflag(rv);
+    },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* FLTQ.S */
+RVOP(
+    fltqs,
+    {
+        uint32_t ret = f32_lt_quiet(rv->F[ir->rs1], rv->F[ir->rs2]);
+        if (ir->rd)
+            rv->X[ir->rd] = ret;
+        set_fflag(rv);
+    },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+#endif
+#endif
+
+/* RV32 Zve32x/Zve32f Standard Extensions
+ *
+ * The vector instructions are carried out by the vector unit in vector.c,
+ * one instruction at a time, and raise an illegal instruction exception
+ * where they are reserved under the current vtype or for their operands.
+ */
+
+#if RV32_HAS(Zve32x)
+/* VSETVLI */
+RVOP(
+    vsetvli,
+    { vector_setvl(rv, ir); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* VSETIVLI */
+RVOP(
+    vsetivli,
+    { vector_setvl(rv, ir); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* VSETVL */
+RVOP(
+    vsetvl,
+    { vector_setvl(rv, ir); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* unit-stride loads, including the whole register and the mask ones */
+RVOP(
+    vle,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_load(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* strided loads */
+RVOP(
+    vlse,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_load(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* indexed loads, either ordered or not */
+RVOP(
+    vlxe,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_load(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* unit-stride stores, including the whole register and the mask ones */
+RVOP(
+    vse,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_store(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* strided stores */
+RVOP(
+    vsse,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_store(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* indexed stores, either ordered or not */
+RVOP(
+    vsxe,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_store(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* integer operations on vectors */
+RVOP(
+    vopivv,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_opi(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* integer operations on a vector and x[rs1] */
+RVOP(
+    vopivx,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_opi(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* integer operations on a vector and a 5-bit immediate */
+RVOP(
+    vopivi,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_opi(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* integer and mask operations on vectors, some of which write x[rd] */
+RVOP(
+    vopmvv,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_opm(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* integer operations on a vector and x[rs1] */
+RVOP(
+    vopmvx,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_opm(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+#if RV32_HAS(Zve32f)
+/* floating-point operations on vectors, some of which write f[rd] */
+RVOP(
+    vopfvv,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_opf(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+
+/* floating-point operations on a vector and f[rs1] */
+RVOP(
+    vopfvf,
+    { RV_EXC_ILLEGAL_INSN_HANDLER(!vector_opf(rv, ir)); },
+    GEN({
+        assert; /* FIXME: Implement */
+    }))
+#endif
 #endif
 
 /* RV32C Standard Extension */
@@ -2123,7 +2419,7 @@ RVOP(
 #endif
             {
                 last_pc = PC;
-                MUST_TAIL return taken->impl(rv, taken, cycle, PC);
+                RVOP_DISPATCH(taken);
             }
         }
         goto end_op;
@@ -2293,7 +2589,7 @@ RVOP(
 #endif
             {
                 last_pc = PC;
-                MUST_TAIL return taken->impl(rv, taken, cycle, PC);
+                RVOP_DISPATCH(taken);
             }
         }
         goto end_op;
@@ -2336,7 +2632,7 @@ RVOP(
 #endif
             {
                 last_pc = PC;
-                MUST_TAIL return untaken->impl(rv, untaken, cycle, PC);
+                RVOP_DISPATCH(untaken);
             }
 
             goto end_op;
@@ -2361,7 +2657,7 @@ RVOP(
 #endif
             {
                 last_pc = PC;
-                MUST_TAIL return taken->impl(rv, taken, cycle, PC);
+                RVOP_DISPATCH(taken);
             }
         }
         goto end_op;
@@ -2413,7 +2709,7 @@ RVOP(
 #endif
             {
                 last_pc = PC;
-                MUST_TAIL return untaken->impl(rv, untaken, cycle, PC);
+                RVOP_DISPATCH(untaken);
             }
 
             goto end_op;
@@ -2438,7 +2734,7 @@ RVOP(
 #endif
             {
                 last_pc = PC;
-                MUST_TAIL return taken->impl(rv, taken, cycle, PC);
+                RVOP_DISPATCH(taken);
             }
         }
         goto end_op;
@@ -2653,6 +2949,313 @@ RVOP(
     }))
 #endif
 
+/* RV32 Zcb Standard Extension */
+
+#if RV32_HAS(Zcb)
+/* C.LBU loads a byte from memory and zero-extends it into register rd'. It
+ * computes an effective address by adding the 2-bit zero-extended offset to
+ * the base address in register rs1'. It expands to lbu rd', uimm(rs1').
+ */
+RVOP(
+    clbu,
+    {
+        const uint32_t addr = rv->X[ir->rs1] + (uint32_t) ir->imm;
+        rv->X[ir->rd] = rv->io.mem_read_b(rv, addr);
+    },
+    GEN({
+        mem;
+        rald, VR0, rs1;
+        ldimms, TMP, mem;
+        alu64, 0x01, VR0, TMP;
+        map, VR1, rd;
+        ld, S8, TMP, VR1, 0;
+    }))
+
+/* C.LHU expands to lhu rd', uimm(rs1'), whose offset is 0 or 2. */
+RVOP(
+    clhu,
+    {
+        const uint32_t addr = rv->X[ir->rs1] + (uint32_t) ir->imm;
+        RV_EXC_MISALIGN_HANDLER(1, LOAD, true, 1);
+        rv->X[ir->rd] = rv->io.mem_read_s(rv, addr);
+    },
+    GEN({
+        mem;
+        rald, VR0, rs1;
+        ldimms, TMP, mem;
+        alu64, 0x01, VR0, TMP;
+        map, VR1, rd;
+        ld, S16, TMP, VR1, 0;
+    }))
+
+/* C.LH expands to lh rd', uimm(rs1'), whose offset is 0 or 2. */
+RVOP(
+    clh,
+    {
+        const uint32_t addr = rv->X[ir->rs1] + (uint32_t) ir->imm;
+        RV_EXC_MISALIGN_HANDLER(1, LOAD, true, 1);
+        rv->X[ir->rd] = sign_extend_h(rv->io.mem_read_s(rv, addr));
+    },
+    GEN({
+        mem;
+        rald, VR0, rs1;
+        ldimms, TMP, mem;
+        alu64, 0x01, VR0, TMP;
+        map, VR1, rd;
+        lds, S16, TMP, VR1, 0;
+    }))
+
+/* C.SB stores the low byte of register rs2' to memory. It expands to
+ * sb rs2', uimm(rs1').
+ */
+RVOP(
+    csb,
+    {
+        const uint32_t addr = rv->X[ir->rs1] + (uint32_t) ir->imm;
+        rv->io.mem_write_b(rv, addr, rv->X[ir->rs2]);
+    },
+    GEN({
+        mem;
+        rald, VR0, rs1;
+        ldimms, TMP, mem;
+        alu64, 0x01, VR0, TMP;
+        rald, VR1, rs2;
+        st, S8, VR1, TMP, 0;
+    }))
+
+/* C.SH stores the low halfword of register rs2' to memory. It expands to
+ * sh rs2', uimm(rs1').
+ */
+RVOP(
+    csh,
+    {
+        const uint32_t addr = rv->X[ir->rs1] + (uint32_t) ir->imm;
+        RV_EXC_MISALIGN_HANDLER(1, STORE, true, 1);
+        rv->io.mem_write_s(rv, addr, rv->X[ir->rs2]);
+    },
+    GEN({
+        mem;
+        rald, VR0, rs1;
+        ldimms, TMP, mem;
+        alu64, 0x01, VR0, TMP;
+        rald, VR1, rs2;
+        st, S16, VR1, TMP, 0;
+    }))
+
+/* C.ZEXT.B zero-extends the low byte of register rd'/rs1'. It expands to
+ * andi rd'/rs1', rd'/rs1', 0xff.
+ */
+RVOP(
+    czextb,
+    { rv->X[ir->rd] &= 0xff; },
+    GEN({
+        rald, VR0, rd;
+        alu32imm, 32, 0x81, 4, VR0, 0xff;
+    }))
+
+/* C.NOT takes the one's complement of register rd'/rs1'. It expands to
+ * xori rd'/rs1', rd'/rs1', -1.
+ */
+RVOP(
+    cnot,
+    { rv->X[ir->rd] = ~rv->X[ir->rd]; },
+    GEN({
+        rald, VR0, rd;
+        alu32imm, 32, 0x81, 6, VR0, -1;
+    }))
+
+#if RV32_HAS(Zbb)
+/* C.SEXT.B sign-extends the low byte of register rd'/rs1'. It expands to
+ * sext.b rd'/rs1', rd'/rs1'.
+ */
+RVOP(
+    csextb,
+    { rv->X[ir->rd] = sign_extend_b(rv->X[ir->rd]); },
+    GEN({
+        rald, VR0, rd;
+        alu32imm, 8, 0xc1, 4, VR0, 24;
+        alu32imm, 8, 0xc1, 7, VR0, 24;
+    }))
+
+/* C.ZEXT.H zero-extends the low halfword of register rd'/rs1'. It expands to
+ * zext.h rd'/rs1', rd'/rs1'.
+ */
+RVOP(
+    czexth,
+    { rv->X[ir->rd] &= 0xffff; },
+    GEN({
+        rald, VR0, rd;
+        alu32imm, 32, 0x81, 4, VR0, 0xffff;
+    }))
+
+/* C.SEXT.H sign-extends the low halfword of register rd'/rs1'. It expands to
+ * sext.h rd'/rs1', rd'/rs1'.
+ */
+RVOP(
+    csexth,
+    { rv->X[ir->rd] = sign_extend_h(rv->X[ir->rd]); },
+    GEN({
+        rald, VR0, rd;
+        alu32imm, 8, 0xc1, 4, VR0, 16;
+        alu32imm, 8, 0xc1, 7, VR0, 16;
+    }))
+#endif
+
+#if RV32_HAS(EXT_M)
+/* C.MUL multiplies register rd'/rs1' by register rs2' and writes the low 32
+ * bits of the product to rd'. It expands to mul rd', rd', rs2'.
+ */
+RVOP(
+    cmul,
+    { rv->X[ir->rd] = (int32_t) rv->X[ir->rs1] * (int32_t) rv->X[ir->rs2]; },
+    GEN({
+        rald2, rs1, rs2;
+        map, VR2, rd;
+        mov, VR1, TMP;
+        mov, VR0, VR2;
+        mul, 0x28, TMP, VR2, 0;
+    }))
+#endif
+#endif
+
+/* RV32 Zcmp Standard Extension */
+
+#if RV32_HAS(Zcmp)
+/* CM.PUSH stores ra and the saved registers of its register list right below
+ * sp, the last register of the list at the highest address, and then
+ * allocates the stack frame by decrementing sp by the stack adjustment. Like
+ * the fused stores, the whole list is stored by a single IR, and the
+ * addresses are contiguous, so only the first one is checked for alignment.
+ */
+RVOP(
+    cmpush,
+    {
+        uint32_t addr = rv->X[rv_reg_sp] - ir->imm2 * 4;
+        RV_EXC_MISALIGN_HANDLER(3, STORE, true, 1);
+        for (int i = 0; i < ir->imm2; i++, addr += 4)
+            rv->io.mem_write_w(rv, addr, rv->X[zcmp_reg(i)]);
+        rv->X[rv_reg_sp] -= ir->imm;
+    },
+    GEN({
+        cmpush;
+    }))
+
+/* load the register list of cm.pop and its variants from the top of the
+ * stack frame, and then deallocate the frame
+ */
+#define ZCMP_POP()                                             \
+    uint32_t addr = rv->X[rv_reg_sp] + ir->imm - ir->imm2 * 4; \
+    RV_EXC_MISALIGN_HANDLER(3, LOAD, true, 1);                 \
+    for (int i = 0; i < ir->imm2; i++, addr += 4)              \
+        rv->X[zcmp_reg(i)] = rv->io.mem_read_w(rv, addr);      \
+    rv->X[rv_reg_sp] += ir->imm;
+
+/* CM.POP loads ra and the saved registers of its register list, stored by
+ * cm.push at the top of the stack frame, and deallocates the frame by
+ * incrementing sp by the stack adjustment.
+ */
+RVOP(
+    cmpop,
+    { ZCMP_POP(); },
+    GEN({
+        cmpop;
+    }))
+
+/* CM.POPRETZ does as cm.pop, then sets a0 to zero and returns to ra. */
+RVOP(
+    cmpopretz,
+    {
+        ZCMP_POP();
+        rv->X[rv_reg_a0] = 0;
+        PC = rv->X[rv_reg_ra];
+        LOOKUP_OR_UPDATE_BRANCH_HISTORY_TABLE();
+        goto end_op;
+    },
+    GEN({
+        cmpop;
+        map, VR0, rv_reg_a0;
+        ldimm, VR0, 0;
+        rald, VR0, rv_reg_ra;
+        mov, VR0, TMP;
+        break;
+        predict;
+        st, S32, TMP, PC;
+        exit;
+    }))
+
+/* CM.POPRET does as cm.pop, then returns to ra. */
+RVOP(
+    cmpopret,
+    {
+        ZCMP_POP();
+        PC = rv->X[rv_reg_ra];
+        LOOKUP_OR_UPDATE_BRANCH_HISTORY_TABLE();
+        goto end_op;
+    },
+    GEN({
+        cmpop;
+        rald, VR0, rv_reg_ra;
+        mov, VR0, TMP;
+        break;
+        predict;
+        st, S32, TMP, PC;
+        exit;
+    }))
+#undef ZCMP_POP
+
+/* CM.MVSA01 moves a0 and a1 into the saved registers r1s' and r2s', which
+ * differ from each other.
+ */
+RVOP(
+    cmmvsa01,
+    {
+        rv->X[ir->rs1] = rv->X[rv_reg_a0];
+        rv->X[ir->rs2] = rv->X[rv_reg_a1];
+    },
+    GEN({
+        rald, VR0, rv_reg_a0;
+        map, VR1, rs1;
+        cond, regneq;
+        mov, VR0, VR1;
+        else;
+        pollute, VR1;
+        end;
+        rald, VR0, rv_reg_a1;
+        map, VR1, rs2;
+        cond, regneq;
+        mov, VR0, VR1;
+        else;
+        pollute, VR1;
+        end;
+    }))
+
+/* CM.MVA01S moves the saved registers r1s' and r2s' into a0 and a1. */
+RVOP(
+    cmmva01s,
+    {
+        const uint32_t r1s = rv->X[ir->rs1];
+        const uint32_t r2s = rv->X[ir->rs2];
+        rv->X[rv_reg_a0] = r1s;
+        rv->X[rv_reg_a1] = r2s;
+    },
+    GEN({
+        rald, VR0, rs1;
+        map, VR1, rv_reg_a0;
+        cond, regneq;
+        mov, VR0, VR1;
+        else;
+        pollute, VR1;
+        end;
+        rald, VR0, rs2;
+        map, VR1, rv_reg_a1;
+        cond, regneq;
+        mov, VR0, VR1;
+        else;
+        pollute, VR1;
+        end;
+    }))
+#endif
+
 /* RV32Zba Standard Extension */
 
 #if RV32_HAS(Zba)
@@ -3031,3 +3634,29 @@ RVOP(
     }))
 
 #endif
+
+/* RV32 Zicond Standard Extension */
+
+#if RV32_HAS(Zicond)
+/* CZERO.EQZ writes zero to rd if rs2 is zero, and rs1 otherwise. Tier-1 code
+ * does it with a conditional move of the host instead of a branch.
+ */
+RVOP(
+    czeroeqz,
+    { rv->X[ir->rd] = rv->X[ir->rs2] ? rv->X[ir->rs1] : 0; },
+    GEN({
+        rald2, rs1, rs2;
+        map, VR2, rd;
+        czero, VR0, VR1, VR2, true;
+    }))
+
+/* CZERO.NEZ writes zero to rd if rs2 is not zero, and rs1 otherwise. */
+RVOP(
+    czeronez,
+    { rv->X[ir->rd] = rv->X[ir->rs2] ? 0 : rv->X[ir->rs1]; },
+    GEN({
+        rald2, rs1, rs2;
+        map, VR2, rd;
+        czero, VR0, VR1, VR2, false;
+    }))
+#endif
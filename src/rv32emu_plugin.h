@@ -0,0 +1,103 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+/* Instrumentation plugin interface
+ *
+ * A plugin is a shared object loaded with '-P <plugin.so>[,<args>]'. It is
+ * the only header a plugin has to include, and it does not depend on any
+ * other header of rv32emu, so plugins can be built out of tree.
+ *
+ * Every plugin exports two symbols:
+ *
+ *   const uint32_t rv_plugin_version = RV_PLUGIN_VERSION;
+ *
+ *   int rv_plugin_install(const rv_plugin_api_t *api,
+ *                         rv_plugin_ops_t *ops,
+ *                         const char *args);
+ *
+ * rv_plugin_install() is called once, before the guest starts, with @ops
+ * zero-filled. The plugin fills in the callbacks it is interested in and
+ * returns 0, or a non-zero value to abort the emulation. @args is the text
+ * following the first comma of the '-P' option, or NULL.
+ *
+ * Callbacks are woven into the translated code when a block is translated,
+ * hence a callback which is left NULL costs nothing at run time:
+ * - block_exec is called on every entry of a basic block;
+ * - insn_exec is called before every guest instruction;
+ * - mem_access is called before every load, store and atomic instruction
+ *   with the virtual address about to be accessed, once for each range an
+ *   instruction accesses: the register list of cm.push and cm.pop, the cache
+ *   block of cbo.zero, the elements of a unit-stride vector access as a
+ *   whole unless masked, and every active element otherwise.
+ * Registering insn_exec or mem_access disables macro-operation fusion, since
+ * every guest instruction needs its own hook. All three are honored by the
+ * interpreter as well as by the tier-1 and tier-2 JIT compilers.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* bumped whenever rv_plugin_api_t or rv_plugin_ops_t changes incompatibly */
+#define RV_PLUGIN_VERSION 2
+
+/* services provided by the emulator */
+typedef struct {
+    void *vm; /**< opaque emulator handle, passed back to the services */
+
+    /* read an integer register, valid from within any callback */
+    uint32_t (*get_reg)(void *vm, uint32_t idx);
+
+    /* copy guest memory, where @addr is a physical address (identical to the
+     * virtual address in user-mode emulation). Return false if the range is
+     * out of the guest memory.
+     */
+    bool (*read_mem)(void *vm, uint32_t addr, void *dst, uint32_t size);
+
+    /* stop the emulation. Called from block_exec, insn_exec or mem_access,
+     * the guest stops before the instrumented instruction, which is left
+     * unexecuted with the program counter pointing at it. Called from the
+     * other callbacks, it stops once the current block finishes.
+     */
+    void (*halt)(void *vm);
+} rv_plugin_api_t;
+
+/* callbacks provided by a plugin, any of them may be NULL */
+typedef struct {
+    void *udata; /**< passed as the first argument of every callback */
+
+    /* a block covering [pc_start, pc_end) has been translated */
+    void (*block_translate)(void *udata,
+                            uint32_t pc_start,
+                            uint32_t pc_end,
+                            uint32_t n_insn);
+
+    /* a block of n_insn guest instructions is about to be executed */
+    void (*block_exec)(void *udata, uint32_t pc, uint32_t n_insn);
+
+    /* the guest instruction at pc is about to be executed */
+    void (*insn_exec)(void *udata, uint32_t pc);
+
+    /* the guest instruction at pc is about to access size bytes at vaddr */
+    void (*mem_access)(void *udata,
+                       uint32_t pc,
+                       uint32_t vaddr,
+                       uint32_t size,
+                       bool is_store);
+
+    /* system call nr with arguments a0-a5 is about to be emulated */
+    void (*syscall)(void *udata, uint32_t nr, const uint32_t args[6]);
+
+    /* system call nr has been emulated and returned ret */
+    void (*syscall_ret)(void *udata, uint32_t nr, uint32_t ret);
+
+    /* the emulator is about to be destroyed */
+    void (*exit)(void *udata);
+} rv_plugin_ops_t;
+
+typedef int (*rv_plugin_install_t)(const rv_plugin_api_t *api,
+                                   rv_plugin_ops_t *ops,
+                                   const char *args);
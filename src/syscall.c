@@ -38,6 +38,7 @@
         _(sbi_base,         0x10)          \
         _(sbi_timer,        0x54494D45)    \
         _(sbi_rst,          0x53525354)    \
+        _(sbi_pmu,          0x504D55)      \
     )                                      \
     IIF(RV32_HAS(SDL))(                    \
         _(draw_frame,       0xBEEF)        \
@@ -173,6 +174,34 @@ static void syscall_brk(riscv_t *rv)
     rv_set_reg(rv, rv_reg_a0, attr->break_addr);
 }
 
+/* write the results of a system call to guest memory, as part of what a
+ * replay log records
+ */
+static void syscall_write_mem(riscv_t *rv,
+                              uint32_t addr,
+                              const uint8_t *src,
+                              uint32_t len)
+{
+    memory_write(PRIV(rv)->mem, addr, src, len);
+    if (rv->replay)
+        replay_syscall_mem(rv, addr, src, len);
+}
+
+/* the clock seen by the guest, which follows the host clock unless the
+ * icount mode derives it from the retired instructions
+ */
+static void guest_clock_gettime(riscv_t *rv, struct timespec *tp)
+{
+    const uint32_t mips = PRIV(rv)->icount_mips;
+    if (!mips) {
+        rv_clock_gettime(tp);
+        return;
+    }
+    const uint64_t ns = rv_icount(rv) * 1000 / mips;
+    tp->tv_sec = ns / 1000000000;
+    tp->tv_nsec = ns % 1000000000;
+}
+
 static void syscall_gettimeofday(riscv_t *rv)
 {
     /* get the parameters */
@@ -181,10 +210,14 @@ static void syscall_gettimeofday(riscv_t *rv)
 
     /* return the clock time */
     if (tv) {
-        struct timeval tv_s;
-        rv_gettimeofday(&tv_s);
-        memory_write_w(tv + 0, (const uint8_t *) &tv_s.tv_sec);
-        memory_write_w(tv + 8, (const uint8_t *) &tv_s.tv_usec);
+        struct timespec tp_s;
+        guest_clock_gettime(rv, &tp_s);
+        struct timeval tv_s = {
+            .tv_sec = tp_s.tv_sec,
+            .tv_usec = tp_s.tv_nsec / 1000,
+        };
+        syscall_write_mem(rv, tv + 0, (const uint8_t *) &tv_s.tv_sec, 4);
+        syscall_write_mem(rv, tv + 8, (const uint8_t *) &tv_s.tv_usec, 4);
     }
 
     if (tz) {
@@ -214,9 +247,9 @@ static void syscall_clock_gettime(riscv_t *rv)
 
     if (tp) {
         struct timespec tp_s;
-        rv_clock_gettime(&tp_s);
-        memory_write_w(tp + 0, (const uint8_t *) &tp_s.tv_sec);
-        memory_write_w(tp + 8, (const uint8_t *) &tp_s.tv_nsec);
+        guest_clock_gettime(rv, &tp_s);
+        syscall_write_mem(rv, tp + 0, (const uint8_t *) &tp_s.tv_sec, 4);
+        syscall_write_mem(rv, tp + 8, (const uint8_t *) &tp_s.tv_nsec, 4);
     }
 
     /* success */
@@ -330,14 +363,14 @@ static void syscall_read(riscv_t *rv)
 
     while (count > PREALLOC_SIZE) {
         size_t r = fread(tmp, 1, PREALLOC_SIZE, handle);
-        memory_write(attr->mem, buf + total_read, tmp, r);
+        syscall_write_mem(rv, buf + total_read, tmp, r);
         count -= r;
         total_read += r;
         if (r != PREALLOC_SIZE)
             break;
     }
     size_t r = fread(tmp, 1, count, handle);
-    memory_write(attr->mem, buf + total_read, tmp, r);
+    syscall_write_mem(rv, buf + total_read, tmp, r);
     total_read += r;
     if (total_read != rv_get_reg(rv, rv_reg_a2) && ferror(handle)) {
         /* error */
@@ -457,8 +490,8 @@ static void syscall_sbi_base(riscv_t *rv)
         break;
     case SBI_BASE_PROBE_EXTENSION: {
         const riscv_word_t eid = rv_get_reg(rv, rv_reg_a0);
-        bool available =
-            eid == SBI_EID_BASE || eid == SBI_EID_TIMER || eid == SBI_EID_RST;
+        bool available = eid == SBI_EID_BASE || eid == SBI_EID_TIMER ||
+                         eid == SBI_EID_RST || eid == SBI_EID_PMU;
         rv_set_reg(rv, rv_reg_a0, SBI_SUCCESS);
         rv_set_reg(rv, rv_reg_a1, available);
         break;
@@ -489,6 +522,146 @@ static void syscall_sbi_rst(riscv_t *rv)
         break;
     }
 }
+
+/* flags of the SBI PMU functions */
+#define SBI_PMU_CFG_SKIP_MATCH (1U << 0)
+#define SBI_PMU_CFG_CLEAR_VALUE (1U << 1)
+#define SBI_PMU_CFG_AUTO_START (1U << 2)
+#define SBI_PMU_START_SET_INIT_VALUE (1U << 0)
+#define SBI_PMU_STOP_RESET (1U << 0)
+
+/* SBI event types, found in bits [19:16] of the event index */
+#define SBI_PMU_EVENT_HW 0
+#define SBI_PMU_EVENT_HW_CACHE 1
+#define SBI_PMU_EVENT_RAW 2
+
+/* Map an SBI event to the emulator event counted by mhpmevent, which is
+ * also the raw event code, e.g., 'perf stat -e r3' counts block translations.
+ */
+static uint32_t sbi_pmu_event(uint32_t event_idx, uint32_t event_data)
+{
+    const uint32_t code = event_idx & 0xFFFF;
+    switch (event_idx >> 16) {
+    case SBI_PMU_EVENT_HW:
+        if (code == 1) /* SBI_PMU_HW_CPU_CYCLES */
+            return RV_HPM_CYCLES;
+        if (code == 2) /* SBI_PMU_HW_INSTRUCTIONS */
+            return RV_HPM_INSTRET;
+        return RV_HPM_NONE;
+    case SBI_PMU_EVENT_HW_CACHE:
+        /* read misses of the data or instruction TLB, as cache 3 or 4 */
+        if (code == ((3 << 3) | 1) || code == ((4 << 3) | 1))
+            return RV_HPM_MMU_WALK;
+        return RV_HPM_NONE;
+    case SBI_PMU_EVENT_RAW:
+        return event_data < RV_HPM_EVENT_COUNT ? event_data : RV_HPM_NONE;
+    default:
+        return RV_HPM_NONE;
+    }
+}
+
+/* Counters 3 to 31 are handed out, while cycle and instret stay fixed since
+ * the emulator can neither inhibit nor reload them.
+ */
+static void syscall_sbi_pmu(riscv_t *rv)
+{
+    const riscv_word_t fid = rv_get_reg(rv, rv_reg_a6);
+    const riscv_word_t base = rv_get_reg(rv, rv_reg_a0);
+    const riscv_word_t mask = rv_get_reg(rv, rv_reg_a1);
+    const riscv_word_t flags = rv_get_reg(rv, rv_reg_a2);
+    const riscv_word_t a3 = rv_get_reg(rv, rv_reg_a3);
+    const riscv_word_t a4 = rv_get_reg(rv, rv_reg_a4);
+    int32_t error = SBI_SUCCESS;
+    uint32_t value = 0;
+
+    switch (fid) {
+    case SBI_PMU_NUM_COUNTERS:
+        value = 32;
+        break;
+    case SBI_PMU_COUNTER_GET_INFO:
+        /* CSR number and width minus one of a hardware counter */
+        if (base >= 3 && base < 32)
+            value = (CSR_HPMCOUNTER3 - 3 + base) | (63 << 12);
+        else
+            error = SBI_ERR_INVALID_PARAM;
+        break;
+    case SBI_PMU_COUNTER_CFG_MATCH: {
+        const uint32_t event = sbi_pmu_event(a3, a4);
+        if (event == RV_HPM_NONE) {
+            error = SBI_ERR_NOT_SUPPORTED;
+            break;
+        }
+        uint32_t idx = 32;
+        if (flags & SBI_PMU_CFG_SKIP_MATCH) {
+            idx = base;
+        } else {
+            for (uint32_t i = 0; i < 32 && base + i < 32; i++) {
+                if ((mask & (1U << i)) && base + i >= 3 &&
+                    !(rv->hpm_allocated & (1U << (base + i)))) {
+                    idx = base + i;
+                    break;
+                }
+            }
+        }
+        if (idx < 3 || idx >= 32) {
+            error = SBI_ERR_NOT_SUPPORTED;
+            break;
+        }
+        uint64_t count = (flags & SBI_PMU_CFG_CLEAR_VALUE)
+                             ? 0
+                             : rv_hpm_read(rv, idx);
+        rv->hpm_allocated |= 1U << idx;
+        rv->csr_mhpmevent[idx] = event;
+        if (flags & SBI_PMU_CFG_AUTO_START)
+            rv->csr_mcountinhibit &= ~(1U << idx);
+        else
+            rv->csr_mcountinhibit |= 1U << idx;
+        rv_hpm_write(rv, idx, count);
+        value = idx;
+        break;
+    }
+    case SBI_PMU_COUNTER_START:
+    case SBI_PMU_COUNTER_STOP:
+        for (uint32_t i = 0; i < 32 && base + i < 32; i++) {
+            const uint32_t idx = base + i;
+            if (!(mask & (1U << i)))
+                continue;
+            if (idx < 3 || !(rv->hpm_allocated & (1U << idx))) {
+                error = SBI_ERR_INVALID_PARAM;
+                break;
+            }
+            const bool stopped = rv->csr_mcountinhibit & (1U << idx);
+            if (fid == SBI_PMU_COUNTER_START && !stopped) {
+                error = SBI_ERR_ALREADY_STARTED;
+                continue;
+            }
+            if (fid == SBI_PMU_COUNTER_STOP && stopped &&
+                !(flags & SBI_PMU_STOP_RESET)) {
+                error = SBI_ERR_ALREADY_STOPPED;
+                continue;
+            }
+
+            uint64_t count = rv_hpm_read(rv, idx);
+            if (fid == SBI_PMU_COUNTER_START) {
+                if (flags & SBI_PMU_START_SET_INIT_VALUE)
+                    count = ((uint64_t) a4 << 32) | a3;
+                rv->csr_mcountinhibit &= ~(1U << idx);
+            } else {
+                rv->csr_mcountinhibit |= 1U << idx;
+                if (flags & SBI_PMU_STOP_RESET)
+                    rv->hpm_allocated &= ~(1U << idx);
+            }
+            rv_hpm_write(rv, idx, count);
+        }
+        break;
+    default:
+        error = SBI_ERR_NOT_SUPPORTED;
+        break;
+    }
+
+    rv_set_reg(rv, rv_reg_a0, error);
+    rv_set_reg(rv, rv_reg_a1, value);
+}
 #endif /* SYSTEM */
 
 void syscall_handler(riscv_t *rv)
@@ -500,6 +673,18 @@ void syscall_handler(riscv_t *rv)
     riscv_word_t syscall = rv_get_reg(rv, rv_reg_t0);
 #endif
 
+#if RV32_HAS(PLUGIN)
+    if (rv->plugins)
+        plugin_syscall(rv, syscall);
+#endif
+
+    /* a replayed call taking input from the host is not run at all */
+    if (rv->replay && replay_syscall_begin(rv, syscall) &&
+        (syscall == SYS_read || syscall == SYS_open || syscall == SYS_close ||
+         syscall == SYS_lseek || syscall == SYS_gettimeofday ||
+         syscall == SYS_clock_gettime))
+        goto replayed;
+
     switch (syscall) { /* dispatch system call */
 #define _(name, number)     \
     case SYS_##name:        \
@@ -512,9 +697,19 @@ void syscall_handler(riscv_t *rv)
         break;
     }
 
+replayed:
+    /* record the results, or overwrite them with the replayed ones */
+    if (rv->replay)
+        replay_syscall_end(rv);
+
     /* save return code.
      * the application decides the usage of the return code
      */
     vm_attr_t *attr = PRIV(rv);
     attr->error = rv_get_reg(rv, rv_reg_a0);
+
+#if RV32_HAS(PLUGIN)
+    if (rv->plugins)
+        plugin_syscall_ret(rv, syscall);
+#endif
 }
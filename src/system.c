@@ -54,6 +54,9 @@ pte_t *mmu_walk(riscv_t *rv, const uint32_t vaddr, uint32_t *level)
     vm_attr_t *attr = PRIV(rv);
     uint32_t ppn = rv->csr_satp & MASK(22);
 
+    /* there is no TLB, so every translation walks the page table */
+    rv_hpm_count(rv, RV_HPM_MMU_WALK, 1);
+
     /* root page table */
     uint32_t *page_table = PAGE_TABLE(ppn);
     if (!page_table)
@@ -186,6 +189,62 @@ MMU_FAULT_CHECK_IMPL(write, pagefault_store)
  * - mmu_write_b
  */
 extern bool need_retranslate;
+
+/* A misaligned access which crosses a page, as -m allows in RAM, see
+ * mmu_misaligned_in_ram(), is split at the page boundary into two accesses,
+ * each translated on its own, since the pages need not be adjacent in RAM.
+ * Both pages are translated before any byte is accessed, so that a page fault
+ * on the second one leaves the first one untouched.
+ */
+#define MMU_CROSSES_PAGE(vaddr, len) \
+    (((vaddr) & MASK(RV_PG_SHIFT)) + (len) > RV_PG_SIZE)
+
+static uint32_t mmu_read_split(riscv_t *rv, uint32_t vaddr, uint32_t len)
+{
+    const uint32_t head = RV_PG_SIZE - (vaddr & MASK(RV_PG_SHIFT));
+    const uint32_t lo = rv->io.mem_translate(rv, vaddr, R);
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    if (need_handle_signal)
+        return 0;
+#endif
+    const uint32_t hi = rv->io.mem_translate(rv, vaddr + head, R);
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    if (need_handle_signal)
+        return 0;
+#endif
+
+    uint32_t val = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        const uint32_t addr = i < head ? lo + i : hi + i - head;
+        val |= (uint32_t) memory_read_b(addr) << (8 * i);
+    }
+    return val;
+}
+
+static void mmu_write_split(riscv_t *rv,
+                            uint32_t vaddr,
+                            uint32_t len,
+                            uint32_t val)
+{
+    const uint32_t head = RV_PG_SIZE - (vaddr & MASK(RV_PG_SHIFT));
+    const uint32_t lo = rv->io.mem_translate(rv, vaddr, W);
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    if (need_handle_signal)
+        return;
+#endif
+    const uint32_t hi = rv->io.mem_translate(rv, vaddr + head, W);
+#if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
+    if (need_handle_signal)
+        return;
+#endif
+
+    for (uint32_t i = 0; i < len; i++) {
+        const uint32_t addr = i < head ? lo + i : hi + i - head;
+        const uint8_t byte = val >> (8 * i);
+        memory_write_b(addr, &byte);
+    }
+}
+
 static uint32_t mmu_ifetch(riscv_t *rv, const uint32_t vaddr)
 {
     /*
@@ -218,6 +277,9 @@ static uint32_t mmu_ifetch(riscv_t *rv, const uint32_t vaddr)
 
 static uint32_t mmu_read_w(riscv_t *rv, const uint32_t vaddr)
 {
+    if (unlikely(MMU_CROSSES_PAGE(vaddr, 4)))
+        return mmu_read_split(rv, vaddr, 4);
+
     uint32_t addr = rv->io.mem_translate(rv, vaddr, R);
 
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
@@ -237,6 +299,9 @@ static uint32_t mmu_read_w(riscv_t *rv, const uint32_t vaddr)
 
 static uint16_t mmu_read_s(riscv_t *rv, const uint32_t vaddr)
 {
+    if (unlikely(MMU_CROSSES_PAGE(vaddr, 2)))
+        return mmu_read_split(rv, vaddr, 2);
+
     uint32_t addr = rv->io.mem_translate(rv, vaddr, R);
 
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
@@ -268,6 +333,11 @@ static uint8_t mmu_read_b(riscv_t *rv, const uint32_t vaddr)
 
 static void mmu_write_w(riscv_t *rv, const uint32_t vaddr, const uint32_t val)
 {
+    if (unlikely(MMU_CROSSES_PAGE(vaddr, 4))) {
+        mmu_write_split(rv, vaddr, 4, val);
+        return;
+    }
+
     uint32_t addr = rv->io.mem_translate(rv, vaddr, W);
 
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
@@ -287,6 +357,11 @@ static void mmu_write_w(riscv_t *rv, const uint32_t vaddr, const uint32_t val)
 
 static void mmu_write_s(riscv_t *rv, const uint32_t vaddr, const uint16_t val)
 {
+    if (unlikely(MMU_CROSSES_PAGE(vaddr, 2))) {
+        mmu_write_split(rv, vaddr, 2, val);
+        return;
+    }
+
     uint32_t addr = rv->io.mem_translate(rv, vaddr, W);
 
 #if RV32_HAS(SYSTEM) && !RV32_HAS(ELF_LOADER)
@@ -345,6 +420,46 @@ uint32_t mmu_translate(riscv_t *rv, uint32_t vaddr, bool rw)
     return ppn | offset;
 }
 
+bool mmu_readable(riscv_t *rv, uint32_t vaddr)
+{
+    if (!rv->csr_satp)
+        return true;
+
+    /* the same checks as MMU_FAULT_CHECK(read), without the trap */
+    uint32_t level;
+    const pte_t *pte = mmu_walk(rv, vaddr, &level);
+    if (!pte || !(*pte & PTE_V) || !(*pte & PTE_R))
+        return false;
+    return !(rv->priv_mode == RV_PRIV_S_MODE &&
+             !(SSTATUS_SUM & rv->csr_sstatus) && (*pte & PTE_U));
+}
+
+/* whether the @len bytes at @vaddr, within a page, are mapped to RAM */
+static bool mmu_page_in_ram(riscv_t *rv, uint32_t vaddr, uint32_t len)
+{
+    /* leave a page fault to the guest handler of the misaligned access */
+    uint32_t level;
+    pte_t *pte = mmu_walk(rv, vaddr, &level);
+    if (!pte)
+        return false;
+
+    get_ppn_and_offset();
+    return (ppn | offset) + len <= PRIV(rv)->mem->mem_size;
+}
+
+bool mmu_misaligned_in_ram(riscv_t *rv, uint32_t vaddr, uint32_t len)
+{
+    if (!rv->csr_satp)
+        return vaddr + len <= PRIV(rv)->mem->mem_size;
+
+    /* the next page may be mapped elsewhere, see mmu_read_split() */
+    const uint32_t head = RV_PG_SIZE - (vaddr & MASK(RV_PG_SHIFT));
+    if (len <= head)
+        return mmu_page_in_ram(rv, vaddr, len);
+    return mmu_page_in_ram(rv, vaddr, head) &&
+           mmu_page_in_ram(rv, vaddr + head, len - head);
+}
+
 riscv_io_t mmu_io = {
     /* memory read interface */
     .mem_ifetch = mmu_ifetch,
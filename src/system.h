@@ -49,6 +49,8 @@ enum SUPPORTED_MMIO {
                 ,    /* write */                                                 \
                 u8250_write(PRIV(rv)->uart, addr & 0xFFFFF, val);                \
                 emu_update_uart_interrupts(rv);                                  \
+                if (unlikely(rv->bootprof))                                      \
+                    bootprof_uart(rv, addr & 0xFFFFF, val);                      \
                 return;                                                          \
             )                                                                    \
             break;                                                               \
@@ -163,6 +165,26 @@ MMU_FAULT_CHECK_DECL(write);
  */
 uint32_t mmu_translate(riscv_t *rv, uint32_t vaddr, bool rw);
 
+/* Check whether a load from a virtual address would complete without a page
+ * fault, as fault-only-first vector loads need to know past their first
+ * element.
+ * @rv: RISC-V emulator
+ * @vaddr: virtual address of the load
+ * @return: true if the load would not fault
+ */
+bool mmu_readable(riscv_t *rv, uint32_t vaddr);
+
+/* Check whether a misaligned access can be performed in the guest RAM, i.e.,
+ * each page it touches is mapped to RAM rather than to the devices. One that
+ * crosses a page is split into an access to each page.
+ * @rv: RISC-V emulator
+ * @vaddr: virtual address of the access
+ * @len: size of the access in bytes
+ * @return: true if so, else the access traps as misaligned for the guest to
+ * split it
+ */
+bool mmu_misaligned_in_ram(riscv_t *rv, uint32_t vaddr, uint32_t len);
+
 uint32_t *mmu_walk(riscv_t *rv, const uint32_t addr, uint32_t *level);
 
 #define get_ppn_and_offset()                                   \
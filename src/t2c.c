@@ -8,7 +8,9 @@
 #include <llvm-c/Core.h>
 #include <llvm-c/ExecutionEngine.h>
 #include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
 #include <llvm-c/Transforms/PassBuilder.h>
+#include <assert.h>
 #include <stdlib.h>
 
 #include "jit.h"
@@ -55,7 +57,7 @@ FORCE_INLINE LLVMBasicBlockRef t2c_block_map_search(struct LLVM_block_map *map,
         LLVMValueRef start UNUSED, LLVMBasicBlockRef *entry UNUSED,      \
         LLVMBuilderRef *taken_builder UNUSED,                            \
         LLVMBuilderRef *untaken_builder UNUSED, riscv_t *rv UNUSED,      \
-        uint64_t mem_base UNUSED, rv_insn_t *ir UNUSED)                  \
+        LLVMValueRef mem_base UNUSED, rv_insn_t *ir UNUSED)              \
     {                                                                    \
         code;                                                            \
     }
@@ -78,6 +80,10 @@ T2C_LLVM_GEN_ADDR(rd, X, ir->rd);
 T2C_LLVM_GEN_ADDR(ra, X, rv_reg_ra);
 T2C_LLVM_GEN_ADDR(sp, X, rv_reg_sp);
 #endif
+#if RV32_HAS(Zcmp)
+T2C_LLVM_GEN_ADDR(a0, X, rv_reg_a0);
+T2C_LLVM_GEN_ADDR(a1, X, rv_reg_a1);
+#endif
 T2C_LLVM_GEN_ADDR(PC, PC, 0);
 
 #define T2C_LLVM_GEN_STORE_IMM32(builder, val, addr) \
@@ -104,20 +110,37 @@ T2C_LLVM_GEN_ADDR(PC, PC, 0);
 FORCE_INLINE LLVMValueRef t2c_gen_mem_loc(LLVMValueRef start,
                                           LLVMBuilderRef *builder,
                                           UNUSED rv_insn_t *ir,
-                                          uint64_t mem_base)
+                                          LLVMValueRef mem_base)
 {
     LLVMValueRef val_rs1 =
         LLVMBuildZExt(*builder,
                       LLVMBuildLoad2(*builder, LLVMInt32Type(),
                                      t2c_gen_rs1_addr(start, builder, ir), ""),
                       LLVMInt64Type(), "");
-    LLVMValueRef addr =
-        T2C_LLVM_GEN_ALU64_IMM(Add, val_rs1, ir->imm + mem_base);
+    LLVMValueRef addr = LLVMBuildAdd(
+        *builder, val_rs1, T2C_LLVM_GEN_ALU64_IMM(Add, mem_base, ir->imm), "");
     addr = LLVMBuildIntToPtr(*builder, addr,
                              LLVMPointerType(LLVMInt32Type(), 0), "");
     return addr;
 }
 
+/* load the pointer @offset bytes into the structure @base points to */
+static LLVMValueRef t2c_gen_load_ptr(LLVMBuilderRef builder,
+                                     LLVMValueRef base,
+                                     size_t offset)
+{
+    LLVMTypeRef ptr_type = LLVMPointerType(LLVMInt8Type(), 0);
+    LLVMValueRef index = LLVMConstInt(LLVMInt64Type(), offset, false);
+    LLVMValueRef addr = LLVMBuildInBoundsGEP2(
+        builder, LLVMInt8Type(), LLVMBuildBitCast(builder, base, ptr_type, ""),
+        &index, 1, "");
+    addr = LLVMBuildBitCast(builder, addr, LLVMPointerType(ptr_type, 0), "");
+    return LLVMBuildLoad2(builder, ptr_type, addr, "");
+}
+
+/* index of the I/O handler @func of riscv_t, counted in pointers */
+#define T2C_IO_FUNC(func) (offsetof(riscv_t, io.func) / sizeof(void *))
+
 FORCE_INLINE void t2c_gen_call_io_func(LLVMValueRef start,
                                        LLVMBuilderRef *builder,
                                        LLVMTypeRef *param_types,
@@ -140,6 +163,53 @@ FORCE_INLINE void t2c_gen_call_io_func(LLVMValueRef start,
 static LLVMTypeRef t2c_jit_cache_func_type;
 static LLVMTypeRef t2c_jit_cache_struct_type;
 
+/* the instructions retired by the IRs from @ir to the end of its block, where
+ * a fused IR retires all the instructions it stands for, and a probe none
+ */
+static uint64_t t2c_insn_retired(const rv_insn_t *ir)
+{
+    uint64_t n_insn = 0;
+    for (; ir; ir = ir->next) {
+        switch (ir->opcode) {
+        case rv_insn_fuse1:
+        case rv_insn_fuse3:
+        case rv_insn_fuse4:
+        case rv_insn_fuse5:
+            n_insn += ir->imm2;
+            break;
+        case rv_insn_fuse2:
+            n_insn += 2;
+            break;
+        case rv_insn_probe:
+            break;
+        default:
+            n_insn++;
+            break;
+        }
+    }
+    return n_insn;
+}
+
+/* Account the instructions of a block for the performance-monitoring
+ * counters, as tier-2 code does not maintain the cycle counter. They are
+ * added as the block is entered, and the ones which do not retire as it is
+ * left early are taken back, see the probe.
+ */
+static void t2c_gen_hpm_count(LLVMBuilderRef *builder,
+                              LLVMValueRef start,
+                              int64_t n_insn)
+{
+    LLVMValueRef offset = LLVMConstInt(
+        LLVMInt32Type(),
+        offsetof(riscv_t, hpm_events[RV_HPM_T2_INSN]) / sizeof(uint64_t),
+        true);
+    LLVMValueRef addr = LLVMBuildInBoundsGEP2(
+        *builder, LLVMInt64Type(), LLVMGetParam(start, 0), &offset, 1, "");
+    LLVMValueRef count = LLVMBuildLoad2(*builder, LLVMInt64Type(), addr, "");
+    count = T2C_LLVM_GEN_ALU64_IMM(Add, count, n_insn);
+    LLVMBuildStore(*builder, count, addr);
+}
+
 #include "t2c_template.c"
 #undef T2C_OP
 
@@ -169,6 +239,10 @@ FORCE_INLINE bool t2c_insn_is_terminal(uint8_t opcode)
     case rv_insn_cjalr:
     case rv_insn_cjr:
     case rv_insn_cebreak:
+#endif
+#if RV32_HAS(Zcmp)
+    case rv_insn_cmpopretz:
+    case rv_insn_cmpopret:
 #endif
         return true;
     }
@@ -182,7 +256,7 @@ typedef void (*t2c_codegen_block_func_t)(LLVMBuilderRef *builder UNUSED,
                                          LLVMBuilderRef *taken_builder UNUSED,
                                          LLVMBuilderRef *untaken_builder UNUSED,
                                          riscv_t *rv UNUSED,
-                                         uint64_t mem_base UNUSED,
+                                         LLVMValueRef mem_base UNUSED,
                                          rv_insn_t *ir UNUSED);
 
 static void t2c_trace_ebb(LLVMBuilderRef *builder,
@@ -190,6 +264,7 @@ static void t2c_trace_ebb(LLVMBuilderRef *builder,
                           LLVMValueRef start,
                           LLVMBasicBlockRef *entry,
                           riscv_t *rv,
+                          LLVMValueRef mem_base,
                           rv_insn_t *ir,
                           set_t *set,
                           struct LLVM_block_map *map)
@@ -198,12 +273,12 @@ static void t2c_trace_ebb(LLVMBuilderRef *builder,
         return;
     set_add(set, ir->pc);
     t2c_block_map_insert(map, entry, ir->pc);
+    t2c_gen_hpm_count(builder, start, t2c_insn_retired(ir));
     LLVMBuilderRef tk, utk;
 
     while (1) {
         ((t2c_codegen_block_func_t) dispatch_table[ir->opcode])(
-            builder, param_types, start, entry, &tk, &utk, rv,
-            (uint64_t) ((memory_t *) PRIV(rv)->mem)->mem_base, ir);
+            builder, param_types, start, entry, &tk, &utk, rv, mem_base, ir);
         if (!ir->next)
             break;
         ir = ir->next;
@@ -223,7 +298,8 @@ static void t2c_trace_ebb(LLVMBuilderRef *builder,
                 LLVMPositionBuilderAtEnd(untaken_builder, untaken_entry);
                 LLVMBuildBr(utk, untaken_entry);
                 t2c_trace_ebb(&untaken_builder, param_types, start,
-                              &untaken_entry, rv, ir->branch_untaken, set, map);
+                              &untaken_entry, rv, mem_base, ir->branch_untaken,
+                              set, map);
             }
         }
         if (ir->branch_taken) {
@@ -238,15 +314,23 @@ static void t2c_trace_ebb(LLVMBuilderRef *builder,
                 LLVMPositionBuilderAtEnd(taken_builder, taken_entry);
                 LLVMBuildBr(tk, taken_entry);
                 t2c_trace_ebb(&taken_builder, param_types, start, &taken_entry,
-                              rv, ir->branch_taken, set, map);
+                              rv, mem_base, ir->branch_taken, set, map);
             }
         }
     }
 }
 
-void t2c_compile(riscv_t *rv, block_t *block)
+/* Build the function @name of @module, which runs the blocks reachable from
+ * @block through their chained branches. The code compiled ahead of time
+ * finds the guest memory through its argument, as the address of the memory
+ * changes from run to run.
+ */
+static LLVMValueRef t2c_build(LLVMModuleRef module,
+                              const char *name,
+                              riscv_t *rv,
+                              block_t *block,
+                              bool aot)
 {
-    LLVMModuleRef module = LLVMModuleCreateWithName("my_module");
     LLVMTypeRef io_members[] = {
         LLVMPointerType(LLVMVoidType(), 0), LLVMPointerType(LLVMVoidType(), 0),
         LLVMPointerType(LLVMVoidType(), 0), LLVMPointerType(LLVMVoidType(), 0),
@@ -261,7 +345,7 @@ void t2c_compile(riscv_t *rv, block_t *block)
     LLVMTypeRef struct_rv = LLVMStructType(rv_members, 4, false);
     LLVMTypeRef param_types[] = {LLVMPointerType(struct_rv, 0)};
     LLVMValueRef start = LLVMAddFunction(
-        module, "start", LLVMFunctionType(LLVMVoidType(), param_types, 1, 0));
+        module, name, LLVMFunctionType(LLVMVoidType(), param_types, 1, 0));
 
     LLVMTypeRef t2c_args[1] = {LLVMInt64Type()};
     t2c_jit_cache_func_type =
@@ -275,17 +359,38 @@ void t2c_compile(riscv_t *rv, block_t *block)
     LLVMBasicBlockRef first_block = LLVMAppendBasicBlock(start, "first_block");
     LLVMBuilderRef first_builder = LLVMCreateBuilder();
     LLVMPositionBuilderAtEnd(first_builder, first_block);
+    LLVMValueRef mem_base;
+    if (aot) {
+        LLVMValueRef attr = t2c_gen_load_ptr(
+            first_builder, LLVMGetParam(start, 0), offsetof(riscv_t, data));
+        LLVMValueRef mem =
+            t2c_gen_load_ptr(first_builder, attr, offsetof(vm_attr_t, mem));
+        mem_base = LLVMBuildPtrToInt(
+            first_builder,
+            t2c_gen_load_ptr(first_builder, mem, offsetof(memory_t, mem_base)),
+            LLVMInt64Type(), "mem_base");
+    } else {
+        mem_base = LLVMConstInt(
+            LLVMInt64Type(), (uint64_t) PRIV(rv)->mem->mem_base, false);
+    }
     LLVMBasicBlockRef entry = LLVMAppendBasicBlock(start, "entry");
     LLVMBuilderRef builder = LLVMCreateBuilder();
     LLVMPositionBuilderAtEnd(builder, entry);
     LLVMBuildBr(first_builder, entry);
     set_t set;
-    set_reset(&set);
+    set_init(&set);
     struct LLVM_block_map map;
     map.count = 0;
     /* Translate custon IR into LLVM IR */
-    t2c_trace_ebb(&builder, param_types, start, &entry, rv, block->ir_head,
-                  &set, &map);
+    t2c_trace_ebb(&builder, param_types, start, &entry, rv, mem_base,
+                  block->ir_head, &set, &map);
+    return start;
+}
+
+void t2c_compile(riscv_t *rv, block_t *block)
+{
+    LLVMModuleRef module = LLVMModuleCreateWithName("my_module");
+    LLVMValueRef start = t2c_build(module, "start", rv, block, false);
     /* Offload LLVM IR to LLVM backend */
     char *error = NULL, *triple = LLVMGetDefaultTargetTriple();
     LLVMExecutionEngineRef engine;
@@ -316,6 +421,67 @@ void t2c_compile(riscv_t *rv, block_t *block)
     block->hot2 = true;
 }
 
+void *t2c_aot_create(void)
+{
+    return LLVMModuleCreateWithName("aot");
+}
+
+void t2c_aot_add(void *module, riscv_t *rv, block_t *block, const char *name)
+{
+    t2c_build(module, name, rv, block, true);
+}
+
+bool t2c_aot_emit(void *module,
+                  const char *table_name,
+                  const uint32_t *table,
+                  uint32_t n_words,
+                  const char *path)
+{
+    LLVMValueRef *words = malloc(n_words * sizeof(LLVMValueRef));
+    assert(words);
+    for (uint32_t i = 0; i < n_words; i++)
+        words[i] = LLVMConstInt(LLVMInt32Type(), table[i], false);
+    LLVMValueRef global = LLVMAddGlobal(
+        module, LLVMArrayType(LLVMInt32Type(), n_words), table_name);
+    LLVMSetInitializer(global,
+                       LLVMConstArray(LLVMInt32Type(), words, n_words));
+    LLVMSetGlobalConstant(global, true);
+    free(words);
+
+    /* position-independent code for the generic CPU, to be loaded anywhere */
+    char *error = NULL, *triple = LLVMGetDefaultTargetTriple();
+    LLVMTargetRef target;
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+    if (LLVMGetTargetFromTriple(triple, &target, &error) != 0) {
+        rv_log_error("Failed to create target: %s", error);
+        LLVMDisposeMessage(error);
+        return false;
+    }
+    LLVMTargetMachineRef tm = LLVMCreateTargetMachine(
+        target, triple, "generic", "", LLVMCodeGenLevelDefault, LLVMRelocPIC,
+        LLVMCodeModelDefault);
+    LLVMSetTarget(module, triple);
+    LLVMTargetDataRef layout = LLVMCreateTargetDataLayout(tm);
+    LLVMSetModuleDataLayout(module, layout);
+    LLVMPassBuilderOptionsRef pb_option = LLVMCreatePassBuilderOptions();
+    LLVMRunPasses(module, "default<O3>,early-cse<memssa>,instcombine", tm,
+                  pb_option);
+
+    const bool ok = !LLVMTargetMachineEmitToFile(tm, module, (char *) path,
+                                                 LLVMObjectFile, &error);
+    if (!ok) {
+        rv_log_error("Failed to emit %s: %s", path, error);
+        LLVMDisposeMessage(error);
+    }
+    LLVMDisposePassBuilderOptions(pb_option);
+    LLVMDisposeTargetData(layout);
+    LLVMDisposeTargetMachine(tm);
+    LLVMDisposeMessage(triple);
+    LLVMDisposeModule(module);
+    return ok;
+}
+
 struct jit_cache *jit_cache_init()
 {
     return calloc(N_JIT_CACHE_ENTRIES, sizeof(struct jit_cache));
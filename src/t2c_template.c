@@ -35,7 +35,6 @@ T2C_OP(jal, {
 FORCE_INLINE void t2c_jit_cache_helper(LLVMBuilderRef *builder,
                                        LLVMValueRef start,
                                        LLVMValueRef addr,
-                                       riscv_t *rv,
                                        rv_insn_t *ir)
 {
     LLVMBasicBlockRef true_path = LLVMAppendBasicBlock(start, "");
@@ -46,10 +45,12 @@ FORCE_INLINE void t2c_jit_cache_helper(LLVMBuilderRef *builder,
     LLVMBuilderRef false_builder = LLVMCreateBuilder();
     LLVMPositionBuilderAtEnd(false_builder, false_path);
 
-    /* get jit-cache base address */
-    LLVMValueRef base = LLVMConstIntToPtr(
-        LLVMConstInt(LLVMInt64Type(), (long) rv->jit_cache, false),
-        LLVMPointerType(t2c_jit_cache_struct_type, 0));
+    /* get jit-cache base address, from rv as the code may be built ahead */
+    LLVMValueRef base = LLVMBuildBitCast(
+        *builder,
+        t2c_gen_load_ptr(*builder, LLVMGetParam(start, 0),
+                         offsetof(riscv_t, jit_cache)),
+        LLVMPointerType(t2c_jit_cache_struct_type, 0), "");
 
     /* get index */
     LLVMValueRef hash = LLVMBuildAnd(
@@ -75,8 +76,8 @@ FORCE_INLINE void t2c_jit_cache_helper(LLVMBuilderRef *builder,
         true_builder, t2c_jit_cache_struct_type, element_ptr, 1, "");
 
     /* invoke T2C JIT-ed code */
-    LLVMValueRef t2c_args[1] = {
-        LLVMConstInt(LLVMInt64Type(), (long) rv, false)};
+    LLVMValueRef t2c_args[1] = {LLVMBuildPtrToInt(
+        true_builder, LLVMGetParam(start, 0), LLVMInt64Type(), "")};
 
     LLVMBuildCall2(true_builder, t2c_jit_cache_func_type,
                    LLVMBuildLoad2(true_builder, LLVMInt64Type(), entry_ptr, ""),
@@ -101,7 +102,7 @@ T2C_OP(jalr, {
         T2C_LLVM_GEN_STORE_IMM32(*builder, ir->pc + 4,
                                  t2c_gen_rd_addr(start, builder, ir));
 
-    t2c_jit_cache_helper(builder, start, val_rs1, rv, ir);
+    t2c_jit_cache_helper(builder, start, val_rs1, ir);
 })
 
 #define BRANCH_FUNC(type, cond)                                             \
@@ -346,14 +347,14 @@ T2C_OP(fence, { __UNREACHABLE; })
 T2C_OP(ecall, {
     T2C_LLVM_GEN_STORE_IMM32(*builder, ir->pc,
                              t2c_gen_PC_addr(start, builder, ir));
-    t2c_gen_call_io_func(start, builder, param_types, 8);
+    t2c_gen_call_io_func(start, builder, param_types, T2C_IO_FUNC(on_ecall));
     LLVMBuildRetVoid(*builder);
 })
 
 T2C_OP(ebreak, {
     T2C_LLVM_GEN_STORE_IMM32(*builder, ir->pc,
                              t2c_gen_PC_addr(start, builder, ir));
-    t2c_gen_call_io_func(start, builder, param_types, 9);
+    t2c_gen_call_io_func(start, builder, param_types, T2C_IO_FUNC(on_ebreak));
     LLVMBuildRetVoid(*builder);
 })
 
@@ -375,6 +376,18 @@ T2C_OP(sfencevma, { __UNREACHABLE; })
 T2C_OP(fencei, { __UNREACHABLE; })
 #endif
 
+#if RV32_HAS(Zicbom)
+T2C_OP(cboinval, { __UNREACHABLE; })
+
+T2C_OP(cboclean, { __UNREACHABLE; })
+
+T2C_OP(cboflush, { __UNREACHABLE; })
+#endif
+
+#if RV32_HAS(Zicboz)
+T2C_OP(cbozero, { __UNREACHABLE; })
+#endif
+
 #if RV32_HAS(Zicsr)
 T2C_OP(csrrw, { __UNREACHABLE; })
 
@@ -434,31 +447,83 @@ T2C_OP(mulhu, {
     LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
 })
 
+/* LLVM leaves division by zero, and the overflow of INT_MIN / -1, undefined,
+ * while RISC-V defines their results. Divide by 1 in these cases instead, then
+ * select the result RISC-V defines for a zero divisor.
+ */
+FORCE_INLINE LLVMValueRef t2c_gen_divisor(LLVMBuilderRef *builder,
+                                          LLVMValueRef val_rs1,
+                                          LLVMValueRef val_rs2,
+                                          bool sign)
+{
+    LLVMValueRef one = LLVMConstInt(LLVMInt32Type(), 1, false);
+    LLVMValueRef zero_div = LLVMBuildICmp(
+        *builder, LLVMIntEQ, val_rs2, LLVMConstInt(LLVMInt32Type(), 0, false),
+        "");
+    if (sign) {
+        LLVMValueRef overflow = LLVMBuildAnd(
+            *builder,
+            LLVMBuildICmp(*builder, LLVMIntEQ, val_rs1,
+                          LLVMConstInt(LLVMInt32Type(), 0x80000000, false),
+                          ""),
+            LLVMBuildICmp(*builder, LLVMIntEQ, val_rs2,
+                          LLVMConstInt(LLVMInt32Type(), -1, true), ""),
+            "");
+        zero_div = LLVMBuildOr(*builder, zero_div, overflow, "");
+    }
+    return LLVMBuildSelect(*builder, zero_div, one, val_rs2, "");
+}
+
+FORCE_INLINE LLVMValueRef t2c_gen_div_zero(LLVMBuilderRef *builder,
+                                           LLVMValueRef val_rs2,
+                                           LLVMValueRef if_zero,
+                                           LLVMValueRef res)
+{
+    LLVMValueRef zero_div = LLVMBuildICmp(
+        *builder, LLVMIntEQ, val_rs2, LLVMConstInt(LLVMInt32Type(), 0, false),
+        "");
+    return LLVMBuildSelect(*builder, zero_div, if_zero, res, "");
+}
+
 T2C_OP(div, {
     T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
     T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
-    LLVMValueRef res = LLVMBuildSDiv(*builder, val_rs1, val_rs2, "sdiv");
+    LLVMValueRef res = LLVMBuildSDiv(
+        *builder, val_rs1, t2c_gen_divisor(builder, val_rs1, val_rs2, true),
+        "sdiv");
+    res = t2c_gen_div_zero(builder, val_rs2,
+                           LLVMConstInt(LLVMInt32Type(), -1, true), res);
     LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
 })
 
 T2C_OP(divu, {
     T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
     T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
-    LLVMValueRef res = LLVMBuildUDiv(*builder, val_rs1, val_rs2, "udiv");
+    LLVMValueRef res = LLVMBuildUDiv(
+        *builder, val_rs1, t2c_gen_divisor(builder, val_rs1, val_rs2, false),
+        "udiv");
+    res = t2c_gen_div_zero(builder, val_rs2,
+                           LLVMConstInt(LLVMInt32Type(), -1, true), res);
     LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
 })
 
 T2C_OP(rem, {
     T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
     T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
-    LLVMValueRef res = LLVMBuildSRem(*builder, val_rs1, val_rs2, "srem");
+    LLVMValueRef res = LLVMBuildSRem(
+        *builder, val_rs1, t2c_gen_divisor(builder, val_rs1, val_rs2, true),
+        "srem");
+    res = t2c_gen_div_zero(builder, val_rs2, val_rs1, res);
     LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
 })
 
 T2C_OP(remu, {
     T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
     T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
-    LLVMValueRef res = LLVMBuildURem(*builder, val_rs1, val_rs2, "urem");
+    LLVMValueRef res = LLVMBuildURem(
+        *builder, val_rs1, t2c_gen_divisor(builder, val_rs1, val_rs2, false),
+        "urem");
+    res = t2c_gen_div_zero(builder, val_rs2, val_rs1, res);
     LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
 })
 #endif
@@ -539,6 +604,58 @@ T2C_OP(fcvtsw, { __UNREACHABLE; })
 T2C_OP(fcvtswu, { __UNREACHABLE; })
 
 T2C_OP(fmvwx, { __UNREACHABLE; })
+
+#if RV32_HAS(Zfa)
+T2C_OP(flis, { __UNREACHABLE; })
+
+T2C_OP(fminms, { __UNREACHABLE; })
+
+T2C_OP(fmaxms, { __UNREACHABLE; })
+
+T2C_OP(frounds, { __UNREACHABLE; })
+
+T2C_OP(froundnxs, { __UNREACHABLE; })
+
+T2C_OP(fleqs, { __UNREACHABLE; })
+
+T2C_OP(fltqs, { __UNREACHABLE; })
+#endif
+#endif
+
+#if RV32_HAS(Zve32x)
+T2C_OP(vsetvli, { __UNREACHABLE; })
+
+T2C_OP(vsetivli, { __UNREACHABLE; })
+
+T2C_OP(vsetvl, { __UNREACHABLE; })
+
+T2C_OP(vle, { __UNREACHABLE; })
+
+T2C_OP(vlse, { __UNREACHABLE; })
+
+T2C_OP(vlxe, { __UNREACHABLE; })
+
+T2C_OP(vse, { __UNREACHABLE; })
+
+T2C_OP(vsse, { __UNREACHABLE; })
+
+T2C_OP(vsxe, { __UNREACHABLE; })
+
+T2C_OP(vopivv, { __UNREACHABLE; })
+
+T2C_OP(vopivx, { __UNREACHABLE; })
+
+T2C_OP(vopivi, { __UNREACHABLE; })
+
+T2C_OP(vopmvv, { __UNREACHABLE; })
+
+T2C_OP(vopmvx, { __UNREACHABLE; })
+
+#if RV32_HAS(Zve32f)
+T2C_OP(vopfvv, { __UNREACHABLE; })
+
+T2C_OP(vopfvf, { __UNREACHABLE; })
+#endif
 #endif
 
 #if RV32_HAS(EXT_C)
@@ -723,8 +840,8 @@ T2C_OP(clwsp, {
                        t2c_gen_sp_addr(start, builder, ir), "val_sp"),
         LLVMInt64Type(), "zext32to64");
     LLVMValueRef addr = LLVMBuildAdd(
-        *builder, val_sp,
-        LLVMConstInt(LLVMInt64Type(), ir->imm + mem_base, true), "addr");
+        *builder, val_sp, T2C_LLVM_GEN_ALU64_IMM(Add, mem_base, ir->imm),
+        "addr");
     LLVMValueRef cast_addr = LLVMBuildIntToPtr(
         *builder, addr, LLVMPointerType(LLVMInt32Type(), 0), "cast");
     LLVMValueRef res =
@@ -734,7 +851,7 @@ T2C_OP(clwsp, {
 
 T2C_OP(cjr, {
     T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
-    t2c_jit_cache_helper(builder, start, val_rs1, rv, ir);
+    t2c_jit_cache_helper(builder, start, val_rs1, ir);
 })
 
 T2C_OP(cmv, {
@@ -745,7 +862,7 @@ T2C_OP(cmv, {
 T2C_OP(cebreak, {
     T2C_LLVM_GEN_STORE_IMM32(*builder, ir->pc,
                              t2c_gen_PC_addr(start, builder, ir));
-    t2c_gen_call_io_func(start, builder, param_types, 9);
+    t2c_gen_call_io_func(start, builder, param_types, T2C_IO_FUNC(on_ebreak));
     LLVMBuildRetVoid(*builder);
 })
 
@@ -756,7 +873,7 @@ T2C_OP(cjalr, {
     T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
     T2C_LLVM_GEN_STORE_IMM32(*builder, ir->pc + 2,
                              t2c_gen_ra_addr(start, builder, ir));
-    t2c_jit_cache_helper(builder, start, val_rs1, rv, ir);
+    t2c_jit_cache_helper(builder, start, val_rs1, ir);
 })
 
 T2C_OP(cadd, {
@@ -775,8 +892,8 @@ T2C_OP(cswsp, {
         LLVMInt64Type(), "zext32to64");
     T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, addr_rs2);
     LLVMValueRef addr = LLVMBuildAdd(
-        *builder, val_sp,
-        LLVMConstInt(LLVMInt64Type(), ir->imm + mem_base, true), "addr");
+        *builder, val_sp, T2C_LLVM_GEN_ALU64_IMM(Add, mem_base, ir->imm),
+        "addr");
     LLVMValueRef cast_addr = LLVMBuildIntToPtr(
         *builder, addr, LLVMPointerType(LLVMInt32Type(), 0), "cast");
     LLVMBuildStore(*builder, val_rs2, cast_addr);
@@ -793,6 +910,166 @@ T2C_OP(cflw, { __UNREACHABLE; })
 T2C_OP(cfsw, { __UNREACHABLE; })
 #endif
 
+#if RV32_HAS(Zcb)
+T2C_OP(clbu, {
+    LLVMValueRef mem_loc = t2c_gen_mem_loc(start, builder, ir, mem_base);
+    LLVMValueRef res = LLVMBuildZExt(
+        *builder, LLVMBuildLoad2(*builder, LLVMInt8Type(), mem_loc, "res"),
+        LLVMInt32Type(), "zext8to32");
+    LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
+})
+
+T2C_OP(clhu, {
+    LLVMValueRef mem_loc = t2c_gen_mem_loc(start, builder, ir, mem_base);
+    LLVMValueRef res = LLVMBuildZExt(
+        *builder, LLVMBuildLoad2(*builder, LLVMInt16Type(), mem_loc, "res"),
+        LLVMInt32Type(), "zext16to32");
+    LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
+})
+
+T2C_OP(clh, {
+    LLVMValueRef mem_loc = t2c_gen_mem_loc(start, builder, ir, mem_base);
+    LLVMValueRef res = LLVMBuildSExt(
+        *builder, LLVMBuildLoad2(*builder, LLVMInt16Type(), mem_loc, "res"),
+        LLVMInt32Type(), "sext16to32");
+    LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
+})
+
+T2C_OP(csb, {
+    LLVMValueRef mem_loc = t2c_gen_mem_loc(start, builder, ir, mem_base);
+    T2C_LLVM_GEN_LOAD_VMREG(rs2, 8, t2c_gen_rs2_addr(start, builder, ir));
+    LLVMBuildStore(*builder, val_rs2, mem_loc);
+})
+
+T2C_OP(csh, {
+    LLVMValueRef mem_loc = t2c_gen_mem_loc(start, builder, ir, mem_base);
+    T2C_LLVM_GEN_LOAD_VMREG(rs2, 16, t2c_gen_rs2_addr(start, builder, ir));
+    LLVMBuildStore(*builder, val_rs2, mem_loc);
+})
+
+T2C_OP(czextb, {
+    LLVMValueRef addr_rd = t2c_gen_rd_addr(start, builder, ir);
+    T2C_LLVM_GEN_LOAD_VMREG(rd, 32, addr_rd);
+    LLVMValueRef res = T2C_LLVM_GEN_ALU32_IMM(And, val_rd, 0xff);
+    LLVMBuildStore(*builder, res, addr_rd);
+})
+
+T2C_OP(cnot, {
+    LLVMValueRef addr_rd = t2c_gen_rd_addr(start, builder, ir);
+    T2C_LLVM_GEN_LOAD_VMREG(rd, 32, addr_rd);
+    LLVMValueRef res = LLVMBuildNot(*builder, val_rd, "not");
+    LLVMBuildStore(*builder, res, addr_rd);
+})
+
+#if RV32_HAS(Zbb)
+T2C_OP(csextb, {
+    LLVMValueRef addr_rd = t2c_gen_rd_addr(start, builder, ir);
+    T2C_LLVM_GEN_LOAD_VMREG(rd, 8, addr_rd);
+    LLVMValueRef res =
+        LLVMBuildSExt(*builder, val_rd, LLVMInt32Type(), "sext8to32");
+    LLVMBuildStore(*builder, res, addr_rd);
+})
+
+T2C_OP(czexth, {
+    LLVMValueRef addr_rd = t2c_gen_rd_addr(start, builder, ir);
+    T2C_LLVM_GEN_LOAD_VMREG(rd, 16, addr_rd);
+    LLVMValueRef res =
+        LLVMBuildZExt(*builder, val_rd, LLVMInt32Type(), "zext16to32");
+    LLVMBuildStore(*builder, res, addr_rd);
+})
+
+T2C_OP(csexth, {
+    LLVMValueRef addr_rd = t2c_gen_rd_addr(start, builder, ir);
+    T2C_LLVM_GEN_LOAD_VMREG(rd, 16, addr_rd);
+    LLVMValueRef res =
+        LLVMBuildSExt(*builder, val_rd, LLVMInt32Type(), "sext16to32");
+    LLVMBuildStore(*builder, res, addr_rd);
+})
+#endif
+
+#if RV32_HAS(EXT_M)
+T2C_OP(cmul, {
+    T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
+    T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
+    LLVMValueRef res = LLVMBuildMul(*builder, val_rs1, val_rs2, "mul");
+    LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
+})
+#endif
+#endif
+
+#if RV32_HAS(Zcmp)
+/* Store the register list of cm.push below sp, or load the one of cm.pop and
+ * its variants from the top of the stack frame, the way fuse3 and fuse4 do,
+ * and then adjust sp.
+ */
+FORCE_INLINE void t2c_gen_cm_push_pop(LLVMValueRef start,
+                                      LLVMBuilderRef *builder,
+                                      rv_insn_t *ir,
+                                      LLVMValueRef mem_base,
+                                      bool is_push)
+{
+    const int32_t base = (is_push ? 0 : ir->imm) - ir->imm2 * 4;
+    for (int i = 0; i < ir->imm2; i++) {
+        opcode_fuse_t fuse = {
+            .imm = base + i * 4,
+            .rd = zcmp_reg(i),
+            .rs1 = rv_reg_sp,
+            .rs2 = zcmp_reg(i),
+        };
+        rv_insn_t *list_ir = (rv_insn_t *) (&fuse);
+        LLVMValueRef mem_loc =
+            t2c_gen_mem_loc(start, builder, list_ir, mem_base);
+        if (is_push) {
+            T2C_LLVM_GEN_LOAD_VMREG(rs2, 32,
+                                    t2c_gen_rs2_addr(start, builder, list_ir));
+            LLVMBuildStore(*builder, val_rs2, mem_loc);
+        } else {
+            LLVMValueRef res =
+                LLVMBuildLoad2(*builder, LLVMInt32Type(), mem_loc, "res");
+            LLVMBuildStore(*builder, res,
+                           t2c_gen_rd_addr(start, builder, list_ir));
+        }
+    }
+
+    LLVMValueRef addr_sp = t2c_gen_sp_addr(start, builder, ir);
+    T2C_LLVM_GEN_LOAD_VMREG(sp, 32, addr_sp);
+    LLVMValueRef res =
+        T2C_LLVM_GEN_ALU32_IMM(Add, val_sp, is_push ? -ir->imm : ir->imm);
+    LLVMBuildStore(*builder, res, addr_sp);
+}
+
+T2C_OP(cmpush, { t2c_gen_cm_push_pop(start, builder, ir, mem_base, true); })
+
+T2C_OP(cmpop, { t2c_gen_cm_push_pop(start, builder, ir, mem_base, false); })
+
+T2C_OP(cmpopretz, {
+    t2c_gen_cm_push_pop(start, builder, ir, mem_base, false);
+    T2C_LLVM_GEN_STORE_IMM32(*builder, 0, t2c_gen_a0_addr(start, builder, ir));
+    T2C_LLVM_GEN_LOAD_VMREG(ra, 32, t2c_gen_ra_addr(start, builder, ir));
+    t2c_jit_cache_helper(builder, start, val_ra, ir);
+})
+
+T2C_OP(cmpopret, {
+    t2c_gen_cm_push_pop(start, builder, ir, mem_base, false);
+    T2C_LLVM_GEN_LOAD_VMREG(ra, 32, t2c_gen_ra_addr(start, builder, ir));
+    t2c_jit_cache_helper(builder, start, val_ra, ir);
+})
+
+T2C_OP(cmmvsa01, {
+    T2C_LLVM_GEN_LOAD_VMREG(a0, 32, t2c_gen_a0_addr(start, builder, ir));
+    T2C_LLVM_GEN_LOAD_VMREG(a1, 32, t2c_gen_a1_addr(start, builder, ir));
+    LLVMBuildStore(*builder, val_a0, t2c_gen_rs1_addr(start, builder, ir));
+    LLVMBuildStore(*builder, val_a1, t2c_gen_rs2_addr(start, builder, ir));
+})
+
+T2C_OP(cmmva01s, {
+    T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
+    T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
+    LLVMBuildStore(*builder, val_rs1, t2c_gen_a0_addr(start, builder, ir));
+    LLVMBuildStore(*builder, val_rs2, t2c_gen_a1_addr(start, builder, ir));
+})
+#endif
+
 #if RV32_HAS(Zba)
 T2C_OP(sh1add, { __UNREACHABLE; })
 
@@ -865,6 +1142,26 @@ T2C_OP(bset, { __UNREACHABLE; })
 T2C_OP(bseti, { __UNREACHABLE; })
 #endif
 
+#if RV32_HAS(Zicond)
+T2C_OP(czeroeqz, {
+    T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
+    T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
+    T2C_LLVM_GEN_CMP_IMM32(EQ, val_rs2, 0);
+    LLVMValueRef res = LLVMBuildSelect(
+        *builder, cmp, LLVMConstInt(LLVMInt32Type(), 0, false), val_rs1, "");
+    LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
+})
+
+T2C_OP(czeronez, {
+    T2C_LLVM_GEN_LOAD_VMREG(rs1, 32, t2c_gen_rs1_addr(start, builder, ir));
+    T2C_LLVM_GEN_LOAD_VMREG(rs2, 32, t2c_gen_rs2_addr(start, builder, ir));
+    T2C_LLVM_GEN_CMP_IMM32(NE, val_rs2, 0);
+    LLVMValueRef res = LLVMBuildSelect(
+        *builder, cmp, LLVMConstInt(LLVMInt32Type(), 0, false), val_rs1, "");
+    LLVMBuildStore(*builder, res, t2c_gen_rd_addr(start, builder, ir));
+})
+#endif
+
 T2C_OP(fuse1, {
     opcode_fuse_t *fuse = ir->fuse;
     for (int i = 0; i < ir->imm2; i++) {
@@ -936,3 +1233,37 @@ T2C_OP(fuse5, {
         }
     }
 })
+
+T2C_OP(probe, {
+    /* no initializer lists, whose commas would split the macro arguments */
+    LLVMTypeRef probe_param_types[2];
+    probe_param_types[0] = LLVMPointerType(LLVMVoidType(), 0);
+    probe_param_types[1] = LLVMInt64Type();
+    LLVMTypeRef probe_func_type =
+        LLVMFunctionType(LLVMInt8Type(), probe_param_types, 2, false);
+    LLVMValueRef probe_func = LLVMConstIntToPtr(
+        LLVMConstInt(LLVMInt64Type(), (long) &rv_probe, false),
+        LLVMPointerType(probe_func_type, 0));
+    LLVMValueRef probe_args[2];
+    probe_args[0] = LLVMGetParam(start, 0);
+    probe_args[1] = LLVMConstInt(LLVMInt64Type(), (long) ir, false);
+    LLVMValueRef ret = LLVMBuildCall2(*builder, probe_func_type, probe_func,
+                                      probe_args, 2, "");
+    LLVMValueRef cmp =
+        LLVMBuildICmp(*builder, LLVMIntNE, ret,
+                      LLVMConstInt(LLVMInt8Type(), 0, false), "");
+
+    /* rv->PC has been set by rv_probe if the emulation has to stop, and the
+     * rest of the block does not retire
+     */
+    LLVMBasicBlockRef stop = LLVMAppendBasicBlock(start, "probe_stop");
+    LLVMBuilderRef stop_builder = LLVMCreateBuilder();
+    LLVMPositionBuilderAtEnd(stop_builder, stop);
+    t2c_gen_hpm_count(&stop_builder, start,
+                      -(int64_t) t2c_insn_retired(ir->next));
+    LLVMBuildRetVoid(stop_builder);
+
+    LLVMBasicBlockRef cont = LLVMAppendBasicBlock(start, "probe_cont");
+    LLVMBuildCondBr(*builder, cmp, cont, stop);
+    LLVMPositionBuilderAtEnd(*builder, cont);
+})
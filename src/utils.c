@@ -177,11 +177,18 @@ char *sanitize_path(const char *input)
 
 HASH_FUNC_IMPL(set_hash, SET_SIZE_BITS, 1 << SET_SIZE_BITS);
 
-void set_reset(set_t *set)
+void set_init(set_t *set)
 {
     memset(set, 0, sizeof(set_t));
 }
 
+void set_reset(set_t *set)
+{
+    for (uint32_t i = 0; i < set->n_used; i++)
+        memset(set->table[set->used[i]], 0, sizeof(set->table[0]));
+    set->n_used = 0;
+}
+
 /**
  * set_add - insert a new element into the set
  * @set: a pointer points to target set
@@ -199,6 +206,8 @@ bool set_add(set_t *set, rv_hash_key_t key)
     }
 
     assert(count < SET_SLOTS_SIZE);
+    if (!count)
+        set->used[set->n_used++] = index;
     set->table[index][count] = key;
     return true;
 }
@@ -162,12 +162,21 @@ static inline void list_del_init(struct list_head *node)
 #endif
 
 /* The set consists of SET_SIZE buckets, with each bucket containing
- * SET_SLOTS_SIZE slots.
+ * SET_SLOTS_SIZE slots. The buckets in use are listed so that clearing the
+ * set costs as much as filling it.
  */
 typedef struct {
     rv_hash_key_t table[SET_SIZE][SET_SLOTS_SIZE];
+    uint16_t used[SET_SIZE];
+    uint32_t n_used;
 } set_t;
 
+/**
+ * set_init - initialize an empty set
+ * @set: a pointer points to target set
+ */
+void set_init(set_t *set);
+
 /**
  * set_reset - clear a set
  * @set: a pointer points to target set
@@ -0,0 +1,2403 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if RV32_HAS(Zve32f)
+#include <fenv.h>
+#include <math.h>
+#endif
+
+#include "decode.h"
+#include "riscv.h"
+#include "riscv_private.h"
+#if RV32_HAS(Zve32f)
+#include "softfp.h"
+#endif
+#if RV32_HAS(SYSTEM)
+#include "system.h"
+#endif
+
+/* the configuration of the vector unit, as vtype and vl set it */
+typedef struct {
+    uint32_t sew;   /**< element width in bytes */
+    int32_t lmul;   /**< log2 of the register group multiplier, -3 to 3 */
+    uint32_t vl;    /**< number of elements to operate on */
+    uint32_t vlmax; /**< number of elements of a register group */
+} vconf_t;
+
+/* the bytes of the register @reg, and of the group it starts */
+#define VREG(rv, reg) ((uint8_t *) (rv)->V + (reg) * VLENB)
+
+/* the number of registers of a group with EMUL 2^@emul */
+#define VREGS(emul) ((emul) > 0 ? 1U << (emul) : 1U)
+
+/* the bits of an element of @sew bytes */
+#define VMASK(sew) ((uint32_t) ((1ULL << ((sew) * 8)) - 1))
+
+/* element @i is active, i.e., either unmasked or enabled by v0 */
+#define VACTIVE(rv, ir, i) ((ir)->vm || vmask_get(rv, 0, i))
+
+#if RV32_HAS(Zve32f)
+#define VV(ir)                                                   \
+    ((ir)->opcode == rv_insn_vopivv || (ir)->opcode == rv_insn_vopmvv || \
+     (ir)->opcode == rv_insn_vopfvv)
+#else
+#define VV(ir) \
+    ((ir)->opcode == rv_insn_vopivv || (ir)->opcode == rv_insn_vopmvv)
+#endif
+
+static inline uint32_t vlmax(uint32_t sew, int32_t lmul)
+{
+    return lmul >= 0 ? (VLENB / sew) << lmul : (VLENB / sew) >> -lmul;
+}
+
+static bool vtype_valid(uint32_t vtype)
+{
+    const uint32_t vsew = (vtype >> 3) & 0x7;
+    const int32_t lmul = ((int32_t) (vtype << 29)) >> 29;
+
+    if ((vtype >> 8) || vsew > 2 || lmul == -4)
+        return false;
+    /* a fractional LMUL must hold an element of SEW, i.e., SEW <= LMUL*ELEN */
+    return lmul >= 0 || (8U << vsew) <= (uint32_t) ELEN >> -lmul;
+}
+
+static inline bool vconf(const riscv_t *rv, vconf_t *c)
+{
+    const uint32_t vtype = rv->csr_vtype;
+
+    if (vtype & VTYPE_VILL)
+        return false;
+    c->sew = 1U << ((vtype >> 3) & 0x7);
+    c->lmul = ((int32_t) (vtype << 29)) >> 29;
+    c->vl = rv->csr_vl;
+    c->vlmax = vlmax(c->sew, c->lmul);
+    return true;
+}
+
+/* a group with EMUL 2^@emul is supported and aligned when it starts at @reg */
+static inline bool vgroup(uint32_t reg, int32_t emul)
+{
+    return emul >= -3 && emul <= 3 && !(reg & (VREGS(emul) - 1));
+}
+
+/* the groups of @na registers at @a and of @nb registers at @b overlap */
+static inline bool voverlap(uint32_t a, uint32_t na, uint32_t b, uint32_t nb)
+{
+    return a < b + nb && b < a + na;
+}
+
+static inline uint32_t vget(const riscv_t *rv,
+                            uint32_t reg,
+                            uint32_t i,
+                            uint32_t sew)
+{
+    const uint8_t *p = VREG(rv, reg) + i * sew;
+
+    switch (sew) {
+    case 1:
+        return *p;
+    case 2: {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    default: {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    }
+}
+
+static inline void vset(riscv_t *rv,
+                        uint32_t reg,
+                        uint32_t i,
+                        uint32_t sew,
+                        uint32_t v)
+{
+    uint8_t *p = VREG(rv, reg) + i * sew;
+
+    switch (sew) {
+    case 1:
+        *p = v;
+        break;
+    case 2: {
+        const uint16_t h = v;
+        memcpy(p, &h, sizeof(h));
+        break;
+    }
+    default:
+        memcpy(p, &v, sizeof(v));
+        break;
+    }
+}
+
+static inline bool vmask_get(const riscv_t *rv, uint32_t reg, uint32_t i)
+{
+    return (VREG(rv, reg)[i >> 3] >> (i & 7)) & 1;
+}
+
+static inline void vmask_set(riscv_t *rv, uint32_t reg, uint32_t i, bool bit)
+{
+    uint8_t *p = &VREG(rv, reg)[i >> 3];
+    *p = (*p & ~(1U << (i & 7))) | (bit << (i & 7));
+}
+
+static inline int32_t vsext(uint32_t v, uint32_t sew)
+{
+    const uint32_t shift = 32 - sew * 8;
+    return ((int32_t) (v << shift)) >> shift;
+}
+
+void vector_setvl(riscv_t *rv, const rv_insn_t *ir)
+{
+    const uint32_t vtype =
+        ir->opcode == rv_insn_vsetvl ? rv->X[ir->rs2] : (uint32_t) ir->imm;
+
+    if (!vtype_valid(vtype)) {
+        rv->csr_vtype = VTYPE_VILL;
+        rv->csr_vl = 0;
+    } else {
+        const uint32_t max = vlmax(1U << ((vtype >> 3) & 0x7),
+                                   ((int32_t) (vtype << 29)) >> 29);
+        uint32_t avl;
+        if (ir->opcode == rv_insn_vsetivli)
+            avl = ir->rs1; /* uimm */
+        else if (ir->rs1)
+            avl = rv->X[ir->rs1];
+        else if (ir->rd)
+            avl = UINT32_MAX;
+        else /* keep vl, which vtype is expected not to shrink VLMAX for */
+            avl = rv->csr_vl;
+        rv->csr_vtype = vtype;
+        rv->csr_vl = avl < max ? avl : max;
+    }
+    rv->csr_vstart = 0;
+    if (ir->rd)
+        rv->X[ir->rd] = rv->csr_vl;
+}
+
+/*
+ * Loads and stores
+ */
+
+static inline uint32_t vmem_read(riscv_t *rv, uint32_t addr, uint32_t eew)
+{
+    switch (eew) {
+    case 1:
+        return rv->io.mem_read_b(rv, addr);
+    case 2:
+        return rv->io.mem_read_s(rv, addr);
+    default:
+        return rv->io.mem_read_w(rv, addr);
+    }
+}
+
+static inline void vmem_write(riscv_t *rv,
+                              uint32_t addr,
+                              uint32_t v,
+                              uint32_t eew)
+{
+    switch (eew) {
+    case 1:
+        rv->io.mem_write_b(rv, addr, v);
+        break;
+    case 2:
+        rv->io.mem_write_s(rv, addr, v);
+        break;
+    default:
+        rv->io.mem_write_w(rv, addr, v);
+        break;
+    }
+}
+
+#if !RV32_HAS(SYSTEM)
+/* move @n bytes between @buf and the memory at @addr, a word at a time where
+ * the address is aligned
+ */
+static void vmem_move(riscv_t *rv,
+                      uint32_t addr,
+                      uint8_t *buf,
+                      uint32_t n,
+                      bool store)
+{
+    uint32_t i = 0;
+    for (; i < n && ((addr + i) & 3); i++) {
+        if (store)
+            rv->io.mem_write_b(rv, addr + i, buf[i]);
+        else
+            buf[i] = rv->io.mem_read_b(rv, addr + i);
+    }
+    for (; i + 4 <= n; i += 4) {
+        uint32_t w;
+        if (store) {
+            memcpy(&w, buf + i, sizeof(w));
+            rv->io.mem_write_w(rv, addr + i, w);
+        } else {
+            w = rv->io.mem_read_w(rv, addr + i);
+            memcpy(buf + i, &w, sizeof(w));
+        }
+    }
+    for (; i < n; i++) {
+        if (store)
+            rv->io.mem_write_b(rv, addr + i, buf[i]);
+        else
+            buf[i] = rv->io.mem_read_b(rv, addr + i);
+    }
+}
+#endif
+
+/* elements [vstart, @evl) of @eew bytes from the register @reg on, which are
+ * contiguous in memory from @base
+ */
+static void vmem_bytes(riscv_t *rv,
+                       uint32_t reg,
+                       uint32_t base,
+                       uint32_t evl,
+                       uint32_t eew,
+                       bool store)
+{
+#if !RV32_HAS(SYSTEM)
+    const uint32_t start = rv->csr_vstart * eew;
+    if (start < evl * eew)
+        vmem_move(rv, base + start, VREG(rv, reg) + start,
+                  evl * eew - start, store);
+#else
+    const bool trapped = rv->is_trapped;
+    for (uint32_t i = rv->csr_vstart; i < evl; i++) {
+        if (store)
+            vmem_write(rv, base + i * eew, vget(rv, reg, i, eew), eew);
+        else
+            vset(rv, reg, i, eew, vmem_read(rv, base + i * eew, eew));
+        if (unlikely(rv->is_trapped != trapped)) {
+            rv->csr_vstart = i;
+            return;
+        }
+    }
+#endif
+    rv->csr_vstart = 0;
+}
+
+/* the layouts of the loads and the stores */
+enum {
+    VMEM_RESERVED, /* reserved under the current vtype or with its operands */
+    VMEM_BYTES,    /* whole registers and masks, contiguous from x[rs1] */
+    VMEM_ELEMENTS, /* elements of vtype, which may be masked off */
+};
+
+typedef struct {
+    uint32_t eew;  /**< width of the elements in bytes */
+    uint32_t evl;  /**< number of elements */
+    uint32_t nf;   /**< number of fields of an element */
+    uint32_t regs; /**< number of registers of the group of a field */
+} vmem_t;
+
+static int vmem_layout(const riscv_t *rv,
+                       const rv_insn_t *ir,
+                       bool store,
+                       vmem_t *m)
+{
+    const bool unit = ir->opcode == rv_insn_vle || ir->opcode == rv_insn_vse;
+    const uint32_t nf = ir->vnf + 1;
+    vconf_t c;
+
+    m->nf = 1;
+    m->regs = 1;
+    /* whole registers, regardless of vtype and vl */
+    if (unit && ir->vfunct == 0x08) {
+        if (ir->rd & ir->vnf)
+            return VMEM_RESERVED;
+        m->eew = ir->veew;
+        m->evl = nf * VLENB / ir->veew;
+        return VMEM_BYTES;
+    }
+
+    if (!vconf(rv, &c))
+        return VMEM_RESERVED;
+
+    /* masks, a byte for every 8 elements */
+    if (unit && ir->vfunct == 0x0b) {
+        m->eew = 1;
+        m->evl = (c.vl + 7) / 8;
+        return VMEM_BYTES;
+    }
+
+    uint32_t eew = ir->veew;
+    int32_t emul;
+    if (ir->opcode == rv_insn_vlxe || ir->opcode == rv_insn_vsxe) {
+        /* the data has SEW and LMUL, the indices have the encoded width */
+        const int32_t iemul = c.lmul + rv_ctz(eew) - rv_ctz(c.sew);
+        if (!vgroup(ir->rs2, iemul))
+            return VMEM_RESERVED;
+        eew = c.sew;
+        emul = c.lmul;
+    } else {
+        emul = c.lmul + rv_ctz(eew) - rv_ctz(c.sew);
+    }
+    const uint32_t regs = VREGS(emul);
+    if (!vgroup(ir->rd, emul) || nf * regs > 8 || ir->rd + nf * regs > 32)
+        return VMEM_RESERVED;
+    if (!store && !ir->vm && !ir->rd)
+        return VMEM_RESERVED;
+
+    m->eew = eew;
+    m->evl = c.vl;
+    m->nf = nf;
+    m->regs = regs;
+    return VMEM_ELEMENTS;
+}
+
+/* the address of the field @f of the element @i */
+static inline uint32_t vmem_addr(const riscv_t *rv,
+                                 const rv_insn_t *ir,
+                                 const vmem_t *m,
+                                 uint32_t i,
+                                 uint32_t f)
+{
+    const uint32_t base = rv->X[ir->rs1];
+
+    switch (ir->opcode) {
+    case rv_insn_vle:
+    case rv_insn_vse:
+        return base + (i * m->nf + f) * m->eew;
+    case rv_insn_vlse:
+    case rv_insn_vsse:
+        return base + i * rv->X[ir->rs2] + f * m->eew;
+    default:
+        return base + vget(rv, ir->rs2, i, ir->veew) + f * m->eew;
+    }
+}
+
+static bool vmem(riscv_t *rv, const rv_insn_t *ir, bool store)
+{
+    vmem_t m;
+
+    switch (vmem_layout(rv, ir, store, &m)) {
+    case VMEM_RESERVED:
+        return false;
+    case VMEM_BYTES:
+        vmem_bytes(rv, ir->rd, rv->X[ir->rs1], m.evl, m.eew, store);
+        return true;
+    }
+
+#if !RV32_HAS(SYSTEM)
+    if (ir->opcode == rv_insn_vle || ir->opcode == rv_insn_vse) {
+        if (m.nf == 1 && ir->vm) {
+            vmem_bytes(rv, ir->rd, rv->X[ir->rs1], m.evl, m.eew, store);
+            return true;
+        }
+    }
+#else
+    const bool trapped = rv->is_trapped;
+    /* fault-only-first, whose elements past the first one trim vl rather
+     * than fault, as only page faults are raised here
+     */
+    const bool ff = ir->opcode == rv_insn_vle && ir->vfunct == 0x10;
+#endif
+
+    for (uint32_t i = rv->csr_vstart; i < m.evl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        for (uint32_t f = 0; f < m.nf; f++) {
+            const uint32_t addr = vmem_addr(rv, ir, &m, i, f);
+            const uint32_t reg = ir->rd + f * m.regs;
+#if RV32_HAS(SYSTEM)
+            if (ff && i &&
+                (!mmu_readable(rv, addr) ||
+                 !mmu_readable(rv, addr + m.eew - 1))) {
+                rv->csr_vl = i;
+                rv->csr_vstart = 0;
+                return true;
+            }
+#endif
+            if (store)
+                vmem_write(rv, addr, vget(rv, reg, i, m.eew), m.eew);
+            else
+                vset(rv, reg, i, m.eew, vmem_read(rv, addr, m.eew));
+#if RV32_HAS(SYSTEM)
+            if (unlikely(rv->is_trapped != trapped)) {
+                rv->csr_vstart = i;
+                return true;
+            }
+#endif
+        }
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+bool vector_load(riscv_t *rv, const rv_insn_t *ir)
+{
+    return vmem(rv, ir, false);
+}
+
+bool vector_store(riscv_t *rv, const rv_insn_t *ir)
+{
+    return vmem(rv, ir, true);
+}
+
+#if RV32_HAS(PLUGIN) || RV32_HAS(GDBSTUB)
+void vector_mem_operand(const riscv_t *rv,
+                        const rv_insn_t *ir,
+                        bool (*access)(void *arg,
+                                       uint32_t vaddr,
+                                       uint32_t size,
+                                       bool is_store),
+                        void *arg)
+{
+    const bool store = ir->opcode == rv_insn_vse ||
+                       ir->opcode == rv_insn_vsse || ir->opcode == rv_insn_vsxe;
+    vmem_t m;
+    const int layout = vmem_layout(rv, ir, store, &m);
+    const uint32_t start = rv->csr_vstart;
+
+    if (layout == VMEM_RESERVED || start >= m.evl)
+        return;
+
+    /* the fields of an element are contiguous, and so are the elements of
+     * the unit-stride ones with no mask
+     */
+    const uint32_t size = m.nf * m.eew;
+    if (layout == VMEM_BYTES ||
+        (ir->vm && (ir->opcode == rv_insn_vle || ir->opcode == rv_insn_vse))) {
+        access(arg, vmem_addr(rv, ir, &m, start, 0), (m.evl - start) * size,
+               store);
+        return;
+    }
+    for (uint32_t i = start; i < m.evl; i++) {
+        if (VACTIVE(rv, ir, i) &&
+            access(arg, vmem_addr(rv, ir, &m, i, 0), size, store))
+            return;
+    }
+}
+#endif
+
+/*
+ * Integer operations
+ */
+
+enum {
+    /* elementwise, with SIMD paths */
+    VOP_ADD,
+    VOP_SUB,
+    VOP_RSUB,
+    VOP_AND,
+    VOP_OR,
+    VOP_XOR,
+    VOP_MINU,
+    VOP_MIN,
+    VOP_MAXU,
+    VOP_MAX,
+    VOP_SLL,
+    VOP_SRL,
+    VOP_SRA,
+    VOP_MUL,
+    VOP_MACC,
+    VOP_NMSAC,
+    VOP_MADD,
+    VOP_NMSUB,
+    VOP_MV,
+    /* elementwise */
+    VOP_ADC,
+    VOP_SBC,
+    VOP_MERGE,
+    VOP_SADDU,
+    VOP_SADD,
+    VOP_SSUBU,
+    VOP_SSUB,
+    VOP_AADDU,
+    VOP_AADD,
+    VOP_ASUBU,
+    VOP_ASUB,
+    VOP_SMUL,
+    VOP_SSRL,
+    VOP_SSRA,
+    VOP_DIVU,
+    VOP_DIV,
+    VOP_REMU,
+    VOP_REM,
+    VOP_MULHU,
+    VOP_MULH,
+    VOP_MULHSU,
+    /* to masks */
+    VOP_MADC,
+    VOP_MSBC,
+    VOP_MSEQ,
+    VOP_MSNE,
+    VOP_MSLTU,
+    VOP_MSLT,
+    VOP_MSLEU,
+    VOP_MSLE,
+    VOP_MSGTU,
+    VOP_MSGT,
+};
+
+/* the increment which rounds @v shifted right by @d as vxrm selects */
+static inline uint64_t vround(const riscv_t *rv, uint64_t v, uint32_t d)
+{
+    if (!d)
+        return 0;
+    const uint64_t lsb = (v >> d) & 1;
+    const uint64_t half = (v >> (d - 1)) & 1;
+    const bool rest = v & ((1ULL << (d - 1)) - 1);
+
+    switch (rv->csr_vxrm) {
+    case 0: /* round-to-nearest-up */
+        return half;
+    case 1: /* round-to-nearest-even */
+        return half & (rest | lsb);
+    case 2: /* round-down */
+        return 0;
+    default: /* round-to-odd */
+        return !lsb && (half | rest);
+    }
+}
+
+/* clamp @v to the signed range of @sew bytes, and flag the saturation */
+static inline uint32_t vclamp(riscv_t *rv, int64_t v, uint32_t sew)
+{
+    const int64_t max = VMASK(sew) >> 1, min = -max - 1;
+
+    if (v > max || v < min) {
+        rv->csr_vxsat = 1;
+        return v > max ? max : min;
+    }
+    return v;
+}
+
+/* the result of @op on the elements @x of vs2, @y of vs1 or the scalar, and
+ * @d of vd, along with the carry @v0, all of @sew bytes
+ */
+static uint32_t vint(riscv_t *rv,
+                     uint32_t op,
+                     uint32_t x,
+                     uint32_t y,
+                     uint32_t d,
+                     uint32_t v0,
+                     uint32_t sew)
+{
+    const uint32_t mask = VMASK(sew), bits = sew * 8;
+    const int32_t sx = vsext(x, sew), sy = vsext(y, sew);
+    const uint32_t shift = y & (bits - 1);
+
+    switch (op) {
+    case VOP_ADD:
+        return x + y;
+    case VOP_SUB:
+        return x - y;
+    case VOP_RSUB:
+        return y - x;
+    case VOP_AND:
+        return x & y;
+    case VOP_OR:
+        return x | y;
+    case VOP_XOR:
+        return x ^ y;
+    case VOP_MINU:
+        return x < y ? x : y;
+    case VOP_MIN:
+        return sx < sy ? x : y;
+    case VOP_MAXU:
+        return x > y ? x : y;
+    case VOP_MAX:
+        return sx > sy ? x : y;
+    case VOP_SLL:
+        return x << shift;
+    case VOP_SRL:
+        return x >> shift;
+    case VOP_SRA:
+        return sx >> shift;
+    case VOP_MUL:
+        return x * y;
+    case VOP_MACC:
+        return d + x * y;
+    case VOP_NMSAC:
+        return d - x * y;
+    case VOP_MADD:
+        return d * y + x;
+    case VOP_NMSUB:
+        return x - d * y;
+    case VOP_MV:
+        return y;
+    case VOP_ADC:
+        return x + y + v0;
+    case VOP_SBC:
+        return x - y - v0;
+    case VOP_MERGE:
+        return v0 ? y : x;
+    case VOP_SADDU: {
+        const uint64_t r = (uint64_t) x + y;
+        if (r > mask) {
+            rv->csr_vxsat = 1;
+            return mask;
+        }
+        return r;
+    }
+    case VOP_SADD:
+        return vclamp(rv, (int64_t) sx + sy, sew);
+    case VOP_SSUBU:
+        if (x < y) {
+            rv->csr_vxsat = 1;
+            return 0;
+        }
+        return x - y;
+    case VOP_SSUB:
+        return vclamp(rv, (int64_t) sx - sy, sew);
+    case VOP_AADDU: {
+        const uint64_t r = (uint64_t) x + y;
+        return (r >> 1) + vround(rv, r, 1);
+    }
+    case VOP_AADD: {
+        const int64_t r = (int64_t) sx + sy;
+        return (r >> 1) + vround(rv, r, 1);
+    }
+    case VOP_ASUBU: {
+        const int64_t r = (int64_t) x - y;
+        return (r >> 1) + vround(rv, r, 1);
+    }
+    case VOP_ASUB: {
+        const int64_t r = (int64_t) sx - sy;
+        return (r >> 1) + vround(rv, r, 1);
+    }
+    case VOP_SMUL: {
+        const int64_t r = (int64_t) sx * sy;
+        return vclamp(rv, (r >> (bits - 1)) + vround(rv, r, bits - 1), sew);
+    }
+    case VOP_SSRL:
+        return (x >> shift) + vround(rv, x, shift);
+    case VOP_SSRA:
+        return (sx >> shift) + vround(rv, (uint32_t) sx, shift);
+    case VOP_DIVU:
+        return y ? x / y : mask;
+    case VOP_DIV:
+        if (!y)
+            return mask;
+        if (sy == -1 && x == (1U << (bits - 1)))
+            return x;
+        return sx / sy;
+    case VOP_REMU:
+        return y ? x % y : x;
+    case VOP_REM:
+        if (!y)
+            return x;
+        if (sy == -1)
+            return 0;
+        return sx % sy;
+    case VOP_MULHU:
+        return ((uint64_t) x * y) >> bits;
+    case VOP_MULH:
+        return ((int64_t) sx * sy) >> bits;
+    case VOP_MULHSU:
+        return ((int64_t) sx * (int64_t) y) >> bits;
+    default:
+        __UNREACHABLE;
+        return 0;
+    }
+}
+
+/* the mask bit of @op on the elements @x of vs2 and @y of vs1 or the scalar,
+ * with the carry or borrow @v0
+ */
+static bool vint_mask(uint32_t op,
+                      uint32_t x,
+                      uint32_t y,
+                      bool v0,
+                      uint32_t sew)
+{
+    const int32_t sx = vsext(x, sew), sy = vsext(y, sew);
+
+    switch (op) {
+    case VOP_MADC:
+        return (uint64_t) x + y + v0 > VMASK(sew);
+    case VOP_MSBC:
+        return (uint64_t) x < (uint64_t) y + v0;
+    case VOP_MSEQ:
+        return x == y;
+    case VOP_MSNE:
+        return x != y;
+    case VOP_MSLTU:
+        return x < y;
+    case VOP_MSLT:
+        return sx < sy;
+    case VOP_MSLEU:
+        return x <= y;
+    case VOP_MSLE:
+        return sx <= sy;
+    case VOP_MSGTU:
+        return x > y;
+    case VOP_MSGT:
+        return sx > sy;
+    default:
+        __UNREACHABLE;
+        return false;
+    }
+}
+
+/* the vector types of the compiler, which map to the 128-bit SIMD registers
+ * of the host, e.g., SSE2 or NEON
+ */
+typedef uint8_t vu8_t __attribute__((vector_size(16)));
+typedef int8_t vi8_t __attribute__((vector_size(16)));
+typedef uint16_t vu16_t __attribute__((vector_size(16)));
+typedef int16_t vi16_t __attribute__((vector_size(16)));
+typedef uint32_t vu32_t __attribute__((vector_size(16)));
+typedef int32_t vi32_t __attribute__((vector_size(16)));
+
+/* run @expr on x of vs2, y of vs1 or the scalar, and d of vd, 16 bytes at a
+ * time, as far as whole chunks go
+ */
+#define SIMD_LOOP(VT, expr)                          \
+    for (; i + sizeof(VT) / sizeof(x[0]) <= vl;      \
+         i += sizeof(VT) / sizeof(x[0])) {           \
+        memcpy(&x, vs2 + i * sizeof(x[0]), 16);      \
+        if (vs1)                                     \
+            memcpy(&y, vs1 + i * sizeof(x[0]), 16);  \
+        memcpy(&d, vd + i * sizeof(x[0]), 16);       \
+        d = (expr);                                  \
+        memcpy(vd + i * sizeof(x[0]), &d, 16);       \
+    }
+
+/* select the lanes of @a where @m is set, and those of @b elsewhere */
+#define SIMD_SELECT(VT, m, a, b) (((a) & (VT) (m)) | ((b) & ~(VT) (m)))
+
+#define SIMD_ARITH(T, VT, VS)                                                \
+    static uint32_t simd_arith_##T(uint32_t op, uint8_t *vd,                 \
+                                   const uint8_t *vs2, const uint8_t *vs1,   \
+                                   uint32_t scalar, uint32_t vl)             \
+    {                                                                        \
+        const VT bits = (VT) {0} + (T) (sizeof(T) * 8 - 1);                  \
+        VT x, y = (VT) {0} + (T) scalar, d;                                  \
+        uint32_t i = 0;                                                      \
+                                                                             \
+        switch (op) {                                                        \
+        case VOP_ADD:                                                        \
+            SIMD_LOOP(VT, x + y);                                            \
+            break;                                                           \
+        case VOP_SUB:                                                        \
+            SIMD_LOOP(VT, x - y);                                            \
+            break;                                                           \
+        case VOP_RSUB:                                                       \
+            SIMD_LOOP(VT, y - x);                                            \
+            break;                                                           \
+        case VOP_AND:                                                        \
+            SIMD_LOOP(VT, x & y);                                            \
+            break;                                                           \
+        case VOP_OR:                                                         \
+            SIMD_LOOP(VT, x | y);                                            \
+            break;                                                           \
+        case VOP_XOR:                                                        \
+            SIMD_LOOP(VT, x ^ y);                                            \
+            break;                                                           \
+        case VOP_MINU:                                                       \
+            SIMD_LOOP(VT, SIMD_SELECT(VT, x < y, x, y));                     \
+            break;                                                           \
+        case VOP_MIN:                                                        \
+            SIMD_LOOP(VT, SIMD_SELECT(VT, (VS) x < (VS) y, x, y));           \
+            break;                                                           \
+        case VOP_MAXU:                                                       \
+            SIMD_LOOP(VT, SIMD_SELECT(VT, x > y, x, y));                     \
+            break;                                                           \
+        case VOP_MAX:                                                        \
+            SIMD_LOOP(VT, SIMD_SELECT(VT, (VS) x > (VS) y, x, y));           \
+            break;                                                           \
+        case VOP_SLL:                                                        \
+            SIMD_LOOP(VT, x << (y & bits));                                  \
+            break;                                                           \
+        case VOP_SRL:                                                        \
+            SIMD_LOOP(VT, x >> (y & bits));                                  \
+            break;                                                           \
+        case VOP_SRA:                                                        \
+            SIMD_LOOP(VT, (VT) ((VS) x >> (VS) (y & bits)));                 \
+            break;                                                           \
+        case VOP_MUL:                                                        \
+            SIMD_LOOP(VT, x * y);                                            \
+            break;                                                           \
+        case VOP_MACC:                                                       \
+            SIMD_LOOP(VT, d + x * y);                                        \
+            break;                                                           \
+        case VOP_NMSAC:                                                      \
+            SIMD_LOOP(VT, d - x * y);                                        \
+            break;                                                           \
+        case VOP_MADD:                                                       \
+            SIMD_LOOP(VT, d * y + x);                                        \
+            break;                                                           \
+        case VOP_NMSUB:                                                      \
+            SIMD_LOOP(VT, x - d * y);                                        \
+            break;                                                           \
+        case VOP_MV:                                                         \
+            SIMD_LOOP(VT, y);                                                \
+            break;                                                           \
+        default:                                                             \
+            break;                                                           \
+        }                                                                    \
+        return i;                                                            \
+    }
+
+SIMD_ARITH(uint8_t, vu8_t, vi8_t)
+SIMD_ARITH(uint16_t, vu16_t, vi16_t)
+SIMD_ARITH(uint32_t, vu32_t, vi32_t)
+
+/* elementwise operations of SEW, where vd, vs2 and vs1 have LMUL */
+static bool varith(riscv_t *rv,
+                   const rv_insn_t *ir,
+                   const vconf_t *c,
+                   uint32_t op,
+                   uint32_t scalar)
+{
+    const bool vv = VV(ir);
+    /* v0 carries the carry, the borrow or the selection of these */
+    const bool carry = op == VOP_ADC || op == VOP_SBC || op == VOP_MERGE;
+
+    if (!vgroup(ir->rd, c->lmul) || !vgroup(ir->rs2, c->lmul) ||
+        (vv && !vgroup(ir->rs1, c->lmul)))
+        return false;
+    if ((!ir->vm && !ir->rd) || (carry && ir->vm))
+        return false;
+
+    const uint32_t sew = c->sew, vl = c->vl, b = scalar & VMASK(sew);
+    uint32_t i = rv->csr_vstart;
+    if (!i && ir->vm) {
+        uint8_t *vd = VREG(rv, ir->rd);
+        const uint8_t *vs2 = VREG(rv, ir->rs2);
+        const uint8_t *vs1 = vv ? VREG(rv, ir->rs1) : NULL;
+        switch (sew) {
+        case 1:
+            i = simd_arith_uint8_t(op, vd, vs2, vs1, b, vl);
+            break;
+        case 2:
+            i = simd_arith_uint16_t(op, vd, vs2, vs1, b, vl);
+            break;
+        default:
+            i = simd_arith_uint32_t(op, vd, vs2, vs1, b, vl);
+            break;
+        }
+    }
+    for (; i < vl; i++) {
+        if (!carry && !VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, sew);
+        const uint32_t y = vv ? vget(rv, ir->rs1, i, sew) : b;
+        const uint32_t d = vget(rv, ir->rd, i, sew);
+        vset(rv, ir->rd, i, sew,
+             vint(rv, op, x, y, d, carry && vmask_get(rv, 0, i), sew));
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* comparisons, and the carry and borrow out, into the mask register vd */
+static bool vcompare(riscv_t *rv,
+                     const rv_insn_t *ir,
+                     const vconf_t *c,
+                     uint32_t op,
+                     uint32_t scalar)
+{
+    const bool vv = VV(ir);
+    /* vmadc and vmsbc take the carry or borrow in from v0 when masked */
+    const bool carry = op == VOP_MADC || op == VOP_MSBC;
+
+    if (!vgroup(ir->rs2, c->lmul) || (vv && !vgroup(ir->rs1, c->lmul)))
+        return false;
+    if (!carry && !ir->vm && !ir->rd)
+        return false;
+
+    const uint32_t sew = c->sew, b = scalar & VMASK(sew);
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!carry && !VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, sew);
+        const uint32_t y = vv ? vget(rv, ir->rs1, i, sew) : b;
+        const bool v0 = carry && !ir->vm && vmask_get(rv, 0, i);
+        vmask_set(rv, ir->rd, i, vint_mask(op, x, y, v0, sew));
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* widening operations, where vd has 2*SEW, vs2 has 2*SEW for the .w forms and
+ * SEW otherwise, and vs1 has SEW
+ */
+static bool vwiden(riscv_t *rv,
+                   const rv_insn_t *ir,
+                   const vconf_t *c,
+                   uint32_t scalar)
+{
+    const uint32_t funct6 = ir->vfunct;
+    const bool vv = VV(ir);
+    /* vwaddu.w, vwadd.w, vwsubu.w and vwsub.w */
+    const bool wide = (funct6 & 0x3c) == 0x34;
+
+    if (c->sew * 2 > ELEN / 8 || c->lmul > 2)
+        return false;
+    if (!vgroup(ir->rd, c->lmul + 1) ||
+        !vgroup(ir->rs2, wide ? c->lmul + 1 : c->lmul) ||
+        (vv && !vgroup(ir->rs1, c->lmul)) || (!ir->vm && !ir->rd))
+        return false;
+
+    /* the signedness of the operands from vs2 and from vs1 or the scalar */
+    bool sa, sb;
+    switch (funct6) {
+    case 0x3a: /* vwmulsu */
+    case 0x3e: /* vwmaccus */
+        sa = true;
+        sb = false;
+        break;
+    case 0x3f: /* vwmaccsu */
+        sa = false;
+        sb = true;
+        break;
+    default:
+        sa = sb = funct6 & 1;
+        break;
+    }
+
+    const uint32_t sew = c->sew, wsew = sew * 2;
+    const uint32_t b = scalar & VMASK(sew);
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, wide ? wsew : sew);
+        const uint32_t y = vv ? vget(rv, ir->rs1, i, sew) : b;
+        const uint32_t wx = wide ? x : sa ? (uint32_t) vsext(x, sew) : x;
+        const uint32_t wy = sb ? (uint32_t) vsext(y, sew) : y;
+        uint32_t r;
+        if (funct6 < 0x38)
+            r = funct6 & 2 ? wx - wy : wx + wy;
+        else if (funct6 < 0x3c)
+            r = wx * wy;
+        else
+            r = vget(rv, ir->rd, i, wsew) + wx * wy;
+        vset(rv, ir->rd, i, wsew, r);
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* narrowing shifts and clips, where vs2 has 2*SEW, and vd has SEW */
+static bool vnarrow(riscv_t *rv,
+                    const rv_insn_t *ir,
+                    const vconf_t *c,
+                    uint32_t scalar)
+{
+    const bool vv = VV(ir);
+
+    if (c->sew * 2 > ELEN / 8 || c->lmul > 2)
+        return false;
+    if (!vgroup(ir->rd, c->lmul) || !vgroup(ir->rs2, c->lmul + 1) ||
+        (vv && !vgroup(ir->rs1, c->lmul)) || (!ir->vm && !ir->rd))
+        return false;
+
+    const uint32_t sew = c->sew, wsew = sew * 2, mask = VMASK(sew);
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, wsew);
+        const uint32_t sx = vsext(x, wsew);
+        const uint32_t s =
+            (vv ? vget(rv, ir->rs1, i, sew) : scalar) & (wsew * 8 - 1);
+        uint32_t r;
+        switch (ir->vfunct) {
+        case 0x2c: /* vnsrl */
+            r = x >> s;
+            break;
+        case 0x2d: /* vnsra */
+            r = (int32_t) sx >> s;
+            break;
+        case 0x2e: { /* vnclipu */
+            const uint64_t v = (x >> s) + vround(rv, x, s);
+            r = v > mask ? mask : v;
+            if (v > mask)
+                rv->csr_vxsat = 1;
+            break;
+        }
+        default: /* vnclip */
+            r = vclamp(rv, ((int32_t) sx >> s) + (int64_t) vround(rv, sx, s),
+                       sew);
+            break;
+        }
+        vset(rv, ir->rd, i, sew, r);
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* single-width integer reductions into element 0 of vd */
+static bool vreduce(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    if (rv->csr_vstart || !vgroup(ir->rs2, c->lmul))
+        return false;
+    if (!c->vl)
+        return true;
+
+    static const uint8_t ops[] = {
+        VOP_ADD, VOP_AND, VOP_OR,   VOP_XOR,
+        VOP_MINU, VOP_MIN, VOP_MAXU, VOP_MAX,
+    };
+    const uint32_t sew = c->sew, op = ops[ir->vfunct & 7];
+    uint32_t acc = vget(rv, ir->rs1, 0, sew);
+    for (uint32_t i = 0; i < c->vl; i++) {
+        if (VACTIVE(rv, ir, i))
+            acc = vint(rv, op, vget(rv, ir->rs2, i, sew), acc, 0, 0, sew) &
+                  VMASK(sew);
+    }
+    vset(rv, ir->rd, 0, sew, acc);
+    return true;
+}
+
+/* vwredsumu and vwredsum, which sum SEW elements into 2*SEW */
+static bool vwreduce(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    if (rv->csr_vstart || c->sew * 2 > ELEN / 8 || !vgroup(ir->rs2, c->lmul))
+        return false;
+    if (!c->vl)
+        return true;
+
+    const uint32_t sew = c->sew;
+    const bool sign = ir->vfunct & 1;
+    uint32_t acc = vget(rv, ir->rs1, 0, sew * 2);
+    for (uint32_t i = 0; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, sew);
+        acc += sign ? (uint32_t) vsext(x, sew) : x;
+    }
+    vset(rv, ir->rd, 0, sew * 2, acc);
+    return true;
+}
+
+/* vrgather and vrgatherei16, where vs1 holds indices of @iew bytes, or
+ * vrgather.vx and .vi with the index @scalar
+ */
+static bool vgather(riscv_t *rv,
+                    const rv_insn_t *ir,
+                    const vconf_t *c,
+                    uint32_t iew,
+                    uint32_t scalar)
+{
+    const bool vv = VV(ir);
+    const int32_t iemul = c->lmul + rv_ctz(iew) - rv_ctz(c->sew);
+    const uint32_t regs = VREGS(c->lmul);
+
+    if (!vgroup(ir->rd, c->lmul) || !vgroup(ir->rs2, c->lmul) ||
+        (vv && !vgroup(ir->rs1, iemul)) || (!ir->vm && !ir->rd))
+        return false;
+    if (voverlap(ir->rd, regs, ir->rs2, regs) ||
+        (vv && voverlap(ir->rd, regs, ir->rs1, VREGS(iemul))))
+        return false;
+
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t idx = vv ? vget(rv, ir->rs1, i, iew) : scalar;
+        vset(rv, ir->rd, i, c->sew,
+             idx < c->vlmax ? vget(rv, ir->rs2, idx, c->sew) : 0);
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* vslideup and vslidedown by @offset elements */
+static bool vslide(riscv_t *rv,
+                   const rv_insn_t *ir,
+                   const vconf_t *c,
+                   bool up,
+                   uint32_t offset)
+{
+    const uint32_t regs = VREGS(c->lmul);
+
+    if (!vgroup(ir->rd, c->lmul) || !vgroup(ir->rs2, c->lmul) ||
+        (!ir->vm && !ir->rd) || (up && voverlap(ir->rd, regs, ir->rs2, regs)))
+        return false;
+
+    const uint32_t sew = c->sew;
+    uint32_t i = rv->csr_vstart;
+    if (up && i < offset)
+        i = offset;
+    for (; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        if (up) {
+            vset(rv, ir->rd, i, sew, vget(rv, ir->rs2, i - offset, sew));
+        } else {
+            const uint64_t src = (uint64_t) i + offset;
+            vset(rv, ir->rd, i, sew,
+                 src < c->vlmax ? vget(rv, ir->rs2, src, sew) : 0);
+        }
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* vslide1up and vslide1down, which slide @scalar in */
+static bool vslide1(riscv_t *rv,
+                    const rv_insn_t *ir,
+                    const vconf_t *c,
+                    bool up,
+                    uint32_t scalar)
+{
+    const uint32_t regs = VREGS(c->lmul);
+
+    if (!vgroup(ir->rd, c->lmul) || !vgroup(ir->rs2, c->lmul) ||
+        (!ir->vm && !ir->rd) || (up && voverlap(ir->rd, regs, ir->rs2, regs)))
+        return false;
+
+    const uint32_t sew = c->sew, vl = c->vl;
+    for (uint32_t i = rv->csr_vstart; i < vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        uint32_t v;
+        if (up)
+            v = i ? vget(rv, ir->rs2, i - 1, sew) : scalar;
+        else
+            v = i + 1 < vl ? vget(rv, ir->rs2, i + 1, sew) : scalar;
+        vset(rv, ir->rd, i, sew, v);
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* vmv<nr>r.v, which copies whole registers regardless of vl */
+static bool vmove_whole(riscv_t *rv, const rv_insn_t *ir)
+{
+    const uint32_t nr = ir->rs1 + 1;
+
+    if ((nr & (nr - 1)) || (ir->rd & (nr - 1)) || (ir->rs2 & (nr - 1)))
+        return false;
+
+    /* vstart counts elements of SEW, which defaults to bytes */
+    const uint32_t sew = rv->csr_vtype & VTYPE_VILL
+                             ? 1
+                             : 1U << ((rv->csr_vtype >> 3) & 0x7);
+    const uint32_t start = rv->csr_vstart * sew;
+    if (start < nr * VLENB && ir->rd != ir->rs2)
+        memmove(VREG(rv, ir->rd) + start, VREG(rv, ir->rs2) + start,
+                nr * VLENB - start);
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* vcompress, which packs the elements of vs2 which vs1 selects */
+static bool vcompress(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    const uint32_t regs = VREGS(c->lmul);
+
+    if (rv->csr_vstart || !ir->vm || !vgroup(ir->rd, c->lmul) ||
+        !vgroup(ir->rs2, c->lmul) ||
+        voverlap(ir->rd, regs, ir->rs2, regs) ||
+        voverlap(ir->rd, regs, ir->rs1, 1))
+        return false;
+
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < c->vl; i++) {
+        if (vmask_get(rv, ir->rs1, i))
+            vset(rv, ir->rd, k++, c->sew, vget(rv, ir->rs2, i, c->sew));
+    }
+    return true;
+}
+
+/* vzext and vsext, which extend from SEW divided by 2, 4 or 8 */
+static bool vextend(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    /* vs1 encodes the fraction, and the signedness in its least bit */
+    const uint32_t shift = 4 - ((ir->rs1 >> 1) & 3);
+    const uint32_t sew = c->sew, esew = sew >> shift;
+
+    if (ir->rs1 < 2 || ir->rs1 > 7 || !esew)
+        return false;
+    const int32_t emul = c->lmul - (int32_t) shift;
+    if (!vgroup(ir->rd, c->lmul) || !vgroup(ir->rs2, emul) ||
+        (!ir->vm && !ir->rd) ||
+        voverlap(ir->rd, VREGS(c->lmul), ir->rs2, VREGS(emul)))
+        return false;
+
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, esew);
+        vset(rv, ir->rd, i, sew, ir->rs1 & 1 ? (uint32_t) vsext(x, esew) : x);
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* logical operations on the masks of vs2 and vs1 */
+static bool vmask_logic(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    if (!ir->vm)
+        return false;
+
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        const bool x = vmask_get(rv, ir->rs2, i);
+        const bool y = vmask_get(rv, ir->rs1, i);
+        bool r;
+        switch (ir->vfunct & 7) {
+        case 0: /* vmandn */
+            r = x & !y;
+            break;
+        case 1: /* vmand */
+            r = x & y;
+            break;
+        case 2: /* vmor */
+            r = x | y;
+            break;
+        case 3: /* vmxor */
+            r = x ^ y;
+            break;
+        case 4: /* vmorn */
+            r = x | !y;
+            break;
+        case 5: /* vmnand */
+            r = !(x & y);
+            break;
+        case 6: /* vmnor */
+            r = !(x | y);
+            break;
+        default: /* vmxnor */
+            r = !(x ^ y);
+            break;
+        }
+        vmask_set(rv, ir->rd, i, r);
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* VWXUNARY0: vmv.x.s, vcpop.m and vfirst.m, which write x[rd] */
+static bool vwxunary0(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    uint32_t r;
+
+    switch (ir->rs1) {
+    case 0x00: /* vmv.x.s */
+        if (!ir->vm)
+            return false;
+        r = vsext(vget(rv, ir->rs2, 0, c->sew), c->sew);
+        break;
+    case 0x10: /* vcpop.m */
+    case 0x11: /* vfirst.m */
+        if (rv->csr_vstart)
+            return false;
+        r = ir->rs1 == 0x10 ? 0 : UINT32_MAX;
+        for (uint32_t i = 0; i < c->vl; i++) {
+            if (!VACTIVE(rv, ir, i) || !vmask_get(rv, ir->rs2, i))
+                continue;
+            if (ir->rs1 == 0x11) {
+                r = i;
+                break;
+            }
+            r++;
+        }
+        break;
+    default:
+        return false;
+    }
+    if (ir->rd)
+        rv->X[ir->rd] = r;
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* vmv.s.x and vfmv.s.f, which write @scalar to element 0 of vd */
+static bool vmove_scalar(riscv_t *rv,
+                         const rv_insn_t *ir,
+                         const vconf_t *c,
+                         uint32_t scalar)
+{
+    if (!ir->vm || ir->rs2)
+        return false;
+    if (rv->csr_vstart < c->vl)
+        vset(rv, ir->rd, 0, c->sew, scalar);
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* VMUNARY0: vmsbf.m, vmsof.m, vmsif.m, viota.m and vid.v */
+static bool vmunary0(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    if (!ir->vm && !ir->rd)
+        return false;
+
+    switch (ir->rs1) {
+    case 0x01: /* vmsbf */
+    case 0x02: /* vmsof */
+    case 0x03: { /* vmsif */
+        if (rv->csr_vstart || ir->rd == ir->rs2)
+            return false;
+        bool found = false;
+        for (uint32_t i = 0; i < c->vl; i++) {
+            if (!VACTIVE(rv, ir, i))
+                continue;
+            const bool first = !found && vmask_get(rv, ir->rs2, i);
+            bool r;
+            if (ir->rs1 == 0x01)
+                r = !found && !first;
+            else if (ir->rs1 == 0x02)
+                r = first;
+            else
+                r = !found;
+            found |= first;
+            vmask_set(rv, ir->rd, i, r);
+        }
+        return true;
+    }
+    case 0x10: { /* viota */
+        if (rv->csr_vstart || !vgroup(ir->rd, c->lmul) ||
+            voverlap(ir->rd, VREGS(c->lmul), ir->rs2, 1))
+            return false;
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < c->vl; i++) {
+            if (!VACTIVE(rv, ir, i))
+                continue;
+            vset(rv, ir->rd, i, c->sew, count);
+            count += vmask_get(rv, ir->rs2, i);
+        }
+        return true;
+    }
+    case 0x11: /* vid */
+        if (ir->rs2 || !vgroup(ir->rd, c->lmul))
+            return false;
+        for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+            if (VACTIVE(rv, ir, i))
+                vset(rv, ir->rd, i, c->sew, i);
+        }
+        rv->csr_vstart = 0;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool vector_opi(riscv_t *rv, const rv_insn_t *ir)
+{
+    const bool vv = ir->opcode == rv_insn_vopivv;
+    const bool vi = ir->opcode == rv_insn_vopivi;
+    /* vi takes the immediate sign-extended, or unsigned from rs1 */
+    const uint32_t b = vi ? (uint32_t) ir->imm : rv->X[ir->rs1];
+    const uint32_t ub = vi ? ir->rs1 : b;
+    vconf_t c;
+
+    /* vmv<nr>r.v does not depend on vtype */
+    if (ir->vfunct == 0x27 && vi)
+        return ir->vm && vmove_whole(rv, ir);
+    if (!vconf(rv, &c))
+        return false;
+
+    switch (ir->vfunct) {
+    case 0x00:
+        return varith(rv, ir, &c, VOP_ADD, b);
+    case 0x02:
+        return !vi && varith(rv, ir, &c, VOP_SUB, b);
+    case 0x03:
+        return !vv && varith(rv, ir, &c, VOP_RSUB, b);
+    case 0x04:
+        return !vi && varith(rv, ir, &c, VOP_MINU, b);
+    case 0x05:
+        return !vi && varith(rv, ir, &c, VOP_MIN, b);
+    case 0x06:
+        return !vi && varith(rv, ir, &c, VOP_MAXU, b);
+    case 0x07:
+        return !vi && varith(rv, ir, &c, VOP_MAX, b);
+    case 0x09:
+        return varith(rv, ir, &c, VOP_AND, b);
+    case 0x0a:
+        return varith(rv, ir, &c, VOP_OR, b);
+    case 0x0b:
+        return varith(rv, ir, &c, VOP_XOR, b);
+    case 0x0c:
+        return vgather(rv, ir, &c, c.sew, ub);
+    case 0x0e:
+        if (vv) /* vrgatherei16 */
+            return vgather(rv, ir, &c, 2, 0);
+        return vslide(rv, ir, &c, true, ub);
+    case 0x0f:
+        return !vv && vslide(rv, ir, &c, false, ub);
+    case 0x10:
+        return varith(rv, ir, &c, VOP_ADC, b);
+    case 0x11:
+        return vcompare(rv, ir, &c, VOP_MADC, b);
+    case 0x12:
+        return !vi && varith(rv, ir, &c, VOP_SBC, b);
+    case 0x13:
+        return !vi && vcompare(rv, ir, &c, VOP_MSBC, b);
+    case 0x17:
+        if (ir->vm) /* vmv.v */
+            return !ir->rs2 && varith(rv, ir, &c, VOP_MV, b);
+        return varith(rv, ir, &c, VOP_MERGE, b);
+    case 0x18:
+        return vcompare(rv, ir, &c, VOP_MSEQ, b);
+    case 0x19:
+        return vcompare(rv, ir, &c, VOP_MSNE, b);
+    case 0x1a:
+        return !vi && vcompare(rv, ir, &c, VOP_MSLTU, b);
+    case 0x1b:
+        return !vi && vcompare(rv, ir, &c, VOP_MSLT, b);
+    case 0x1c:
+        return vcompare(rv, ir, &c, VOP_MSLEU, b);
+    case 0x1d:
+        return vcompare(rv, ir, &c, VOP_MSLE, b);
+    case 0x1e:
+        return !vv && vcompare(rv, ir, &c, VOP_MSGTU, b);
+    case 0x1f:
+        return !vv && vcompare(rv, ir, &c, VOP_MSGT, b);
+    case 0x20:
+        return varith(rv, ir, &c, VOP_SADDU, b);
+    case 0x21:
+        return varith(rv, ir, &c, VOP_SADD, b);
+    case 0x22:
+        return !vi && varith(rv, ir, &c, VOP_SSUBU, b);
+    case 0x23:
+        return !vi && varith(rv, ir, &c, VOP_SSUB, b);
+    case 0x25:
+        return varith(rv, ir, &c, VOP_SLL, ub);
+    case 0x27:
+        return varith(rv, ir, &c, VOP_SMUL, b);
+    case 0x28:
+        return varith(rv, ir, &c, VOP_SRL, ub);
+    case 0x29:
+        return varith(rv, ir, &c, VOP_SRA, ub);
+    case 0x2a:
+        return varith(rv, ir, &c, VOP_SSRL, ub);
+    case 0x2b:
+        return varith(rv, ir, &c, VOP_SSRA, ub);
+    case 0x2c:
+    case 0x2d:
+    case 0x2e:
+    case 0x2f:
+        return vnarrow(rv, ir, &c, ub);
+    case 0x30:
+    case 0x31:
+        return vv && vwreduce(rv, ir, &c);
+    default:
+        return false;
+    }
+}
+
+bool vector_opm(riscv_t *rv, const rv_insn_t *ir)
+{
+    const bool vv = ir->opcode == rv_insn_vopmvv;
+    const uint32_t b = vv ? 0 : rv->X[ir->rs1];
+    vconf_t c;
+
+    if (!vconf(rv, &c))
+        return false;
+
+    switch (ir->vfunct) {
+    case 0x00:
+    case 0x01:
+    case 0x02:
+    case 0x03:
+    case 0x04:
+    case 0x05:
+    case 0x06:
+    case 0x07:
+        return vv && vreduce(rv, ir, &c);
+    case 0x08:
+        return varith(rv, ir, &c, VOP_AADDU, b);
+    case 0x09:
+        return varith(rv, ir, &c, VOP_AADD, b);
+    case 0x0a:
+        return varith(rv, ir, &c, VOP_ASUBU, b);
+    case 0x0b:
+        return varith(rv, ir, &c, VOP_ASUB, b);
+    case 0x0e:
+        return !vv && vslide1(rv, ir, &c, true, b);
+    case 0x0f:
+        return !vv && vslide1(rv, ir, &c, false, b);
+    case 0x10:
+        if (vv)
+            return vwxunary0(rv, ir, &c);
+        return vmove_scalar(rv, ir, &c, b);
+    case 0x12:
+        return vv && vextend(rv, ir, &c);
+    case 0x14:
+        return vv && vmunary0(rv, ir, &c);
+    case 0x17:
+        return vv && vcompress(rv, ir, &c);
+    case 0x18:
+    case 0x19:
+    case 0x1a:
+    case 0x1b:
+    case 0x1c:
+    case 0x1d:
+    case 0x1e:
+    case 0x1f:
+        return vv && vmask_logic(rv, ir, &c);
+    case 0x20:
+        return varith(rv, ir, &c, VOP_DIVU, b);
+    case 0x21:
+        return varith(rv, ir, &c, VOP_DIV, b);
+    case 0x22:
+        return varith(rv, ir, &c, VOP_REMU, b);
+    case 0x23:
+        return varith(rv, ir, &c, VOP_REM, b);
+    case 0x24:
+        return varith(rv, ir, &c, VOP_MULHU, b);
+    case 0x25:
+        return varith(rv, ir, &c, VOP_MUL, b);
+    case 0x26:
+        return varith(rv, ir, &c, VOP_MULHSU, b);
+    case 0x27:
+        return varith(rv, ir, &c, VOP_MULH, b);
+    case 0x29:
+        return varith(rv, ir, &c, VOP_MADD, b);
+    case 0x2b:
+        return varith(rv, ir, &c, VOP_NMSUB, b);
+    case 0x2d:
+        return varith(rv, ir, &c, VOP_MACC, b);
+    case 0x2f:
+        return varith(rv, ir, &c, VOP_NMSAC, b);
+    case 0x30:
+    case 0x31:
+    case 0x32:
+    case 0x33:
+    case 0x34:
+    case 0x35:
+    case 0x36:
+    case 0x37:
+    case 0x38:
+    case 0x3a:
+    case 0x3b:
+    case 0x3c:
+    case 0x3d:
+    case 0x3f:
+        return vwiden(rv, ir, &c, b);
+    case 0x3e: /* vwmaccus */
+        return !vv && vwiden(rv, ir, &c, b);
+    default:
+        return false;
+    }
+}
+
+#if RV32_HAS(Zve32f)
+/*
+ * Single-precision floating-point operations
+ *
+ * The operations which round run on the floating-point unit of the host, in
+ * the rounding mode of frm, and take the exceptions it raises. Hosts without
+ * the rounding modes and exceptions of <fenv.h>, and round-to-nearest-max-
+ * magnitude, which hosts lack, run on SoftFloat instead.
+ */
+
+#if defined(FE_INVALID) && defined(FE_DIVBYZERO) && defined(FE_OVERFLOW) && \
+    defined(FE_UNDERFLOW) && defined(FE_INEXACT) &&                         \
+    defined(FE_TOWARDZERO) && defined(FE_DOWNWARD) && defined(FE_UPWARD)
+#define HOST_FENV 1
+#else
+#define HOST_FENV 0
+#endif
+
+enum {
+    /* rounding, with SIMD paths */
+    VF_ADD,
+    VF_SUB,
+    VF_RSUB,
+    VF_MUL,
+    VF_DIV,
+    VF_RDIV,
+    /* rounding */
+    VF_MACC,
+    VF_NMACC,
+    VF_MSAC,
+    VF_NMSAC,
+    VF_MADD,
+    VF_NMADD,
+    VF_MSUB,
+    VF_NMSUB,
+    VF_FMA,
+    VF_SQRT,
+    VF_CVT_F_XU,
+    VF_CVT_F_X,
+    /* exact */
+    VF_MIN,
+    VF_MAX,
+    VF_SGNJ,
+    VF_SGNJN,
+    VF_SGNJX,
+    VF_EQ,
+    VF_NE,
+    VF_LT,
+    VF_LE,
+    VF_GT,
+    VF_GE,
+};
+
+/* the rounding of an instruction */
+typedef struct {
+    uint32_t frm;
+    bool soft; /**< round with SoftFloat, as the host can not */
+} vfenv_t;
+
+/* round as frm selects, or fail as frm is reserved */
+static bool vfenv_begin(riscv_t *rv, vfenv_t *env)
+{
+    env->frm = (rv->csr_fcsr >> 5) & 0x7;
+    if (env->frm > 4)
+        return false;
+#if HOST_FENV
+    env->soft = env->frm == 4;
+    if (!env->soft) {
+        static const int modes[] = {
+            FE_TONEAREST,
+            FE_TOWARDZERO,
+            FE_DOWNWARD,
+            FE_UPWARD,
+        };
+        feclearexcept(FE_ALL_EXCEPT);
+        fesetround(modes[env->frm]);
+        return true;
+    }
+#else
+    env->soft = true;
+#endif
+    set_rounding_mode(rv, env->frm);
+    return true;
+}
+
+/* accrue the exceptions raised, and restore the rounding of the host */
+static void vfenv_end(riscv_t *rv, const vfenv_t *env)
+{
+#if HOST_FENV
+    if (!env->soft) {
+        const int e = fetestexcept(FE_ALL_EXCEPT);
+        if (e & FE_INVALID)
+            rv->csr_fcsr |= FFLAG_INVALID_OP;
+        if (e & FE_DIVBYZERO)
+            rv->csr_fcsr |= FFLAG_DIV_BY_ZERO;
+        if (e & FE_OVERFLOW)
+            rv->csr_fcsr |= FFLAG_OVERFLOW;
+        if (e & FE_UNDERFLOW)
+            rv->csr_fcsr |= FFLAG_UNDERFLOW;
+        if (e & FE_INEXACT)
+            rv->csr_fcsr |= FFLAG_INEXACT;
+        fesetround(FE_TONEAREST);
+        return;
+    }
+#endif
+    set_fflag(rv);
+}
+
+static inline float vf32(uint32_t v)
+{
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static inline uint32_t vu32(float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static inline bool is_snan(uint32_t f)
+{
+    return is_nan(f) && !(f & FMASK_QNAN);
+}
+
+/* the result of the rounding @op on the elements @a of vs2, @b of vs1 or the
+ * scalar, and @d of vd, with NaNs canonical
+ */
+static uint32_t vfround(uint32_t op,
+                        uint32_t a,
+                        uint32_t b,
+                        uint32_t d,
+                        bool soft)
+{
+    /* the fused multiply-adds as fma(a, b, d) */
+    if (op >= VF_MACC && op <= VF_NMSUB) {
+        const uint32_t x = a, y = b, z = d;
+        switch (op) {
+        case VF_MACC: /* vd = vs1 * vs2 + vd */
+            a = y, b = x, d = z;
+            break;
+        case VF_NMACC: /* vd = -(vs1 * vs2) - vd */
+            a = y ^ FMASK_SIGN, b = x, d = z ^ FMASK_SIGN;
+            break;
+        case VF_MSAC: /* vd = vs1 * vs2 - vd */
+            a = y, b = x, d = z ^ FMASK_SIGN;
+            break;
+        case VF_NMSAC: /* vd = -(vs1 * vs2) + vd */
+            a = y ^ FMASK_SIGN, b = x, d = z;
+            break;
+        case VF_MADD: /* vd = vs1 * vd + vs2 */
+            a = y, b = z, d = x;
+            break;
+        case VF_NMADD: /* vd = -(vs1 * vd) - vs2 */
+            a = y ^ FMASK_SIGN, b = z, d = x ^ FMASK_SIGN;
+            break;
+        case VF_MSUB: /* vd = vs1 * vd - vs2 */
+            a = y, b = z, d = x ^ FMASK_SIGN;
+            break;
+        default: /* vd = -(vs1 * vd) + vs2 */
+            a = y ^ FMASK_SIGN, b = z, d = x;
+            break;
+        }
+        op = VF_FMA;
+    }
+
+    uint32_t r;
+    if (soft) {
+        const riscv_float_t x = {a}, y = {b}, z = {d};
+        switch (op) {
+        case VF_ADD:
+            r = f32_add(x, y).v;
+            break;
+        case VF_SUB:
+            r = f32_sub(x, y).v;
+            break;
+        case VF_RSUB:
+            r = f32_sub(y, x).v;
+            break;
+        case VF_MUL:
+            r = f32_mul(x, y).v;
+            break;
+        case VF_DIV:
+            r = f32_div(x, y).v;
+            break;
+        case VF_RDIV:
+            r = f32_div(y, x).v;
+            break;
+        case VF_FMA:
+            r = f32_mulAdd(x, y, z).v;
+            break;
+        case VF_SQRT:
+            r = f32_sqrt(x).v;
+            break;
+        case VF_CVT_F_XU:
+            r = ui32_to_f32(a).v;
+            break;
+        default:
+            r = i32_to_f32((int32_t) a).v;
+            break;
+        }
+    } else {
+        const float x = vf32(a), y = vf32(b), z = vf32(d);
+        switch (op) {
+        case VF_ADD:
+            r = vu32(x + y);
+            break;
+        case VF_SUB:
+            r = vu32(x - y);
+            break;
+        case VF_RSUB:
+            r = vu32(y - x);
+            break;
+        case VF_MUL:
+            r = vu32(x * y);
+            break;
+        case VF_DIV:
+            r = vu32(x / y);
+            break;
+        case VF_RDIV:
+            r = vu32(y / x);
+            break;
+        case VF_FMA:
+            r = vu32(fmaf(x, y, z));
+            break;
+        case VF_SQRT:
+            r = vu32(sqrtf(x));
+            break;
+        case VF_CVT_F_XU:
+            r = vu32((float) a);
+            break;
+        default:
+            r = vu32((float) (int32_t) a);
+            break;
+        }
+    }
+    return is_nan(r) ? RV_NAN : r;
+}
+
+/* the result of the exact @op on @a of vs2 and @b of vs1 or the scalar */
+static uint32_t vfexact(riscv_t *rv, uint32_t op, uint32_t a, uint32_t b)
+{
+    switch (op) {
+    case VF_MIN:
+    case VF_MAX: {
+        if (is_snan(a) || is_snan(b))
+            rv->csr_fcsr |= FFLAG_INVALID_OP;
+        if (is_nan(a) && is_nan(b))
+            return RV_NAN;
+        if (is_nan(a))
+            return b;
+        if (is_nan(b))
+            return a;
+        const float x = vf32(a), y = vf32(b);
+        if (x == y) /* -0 is less than +0 */
+            return op == VF_MIN ? a | b : a & b;
+        return (op == VF_MIN) == (x < y) ? a : b;
+    }
+    case VF_SGNJ:
+        return (a & ~FMASK_SIGN) | (b & FMASK_SIGN);
+    case VF_SGNJN:
+        return (a & ~FMASK_SIGN) | (~b & FMASK_SIGN);
+    default: /* VF_SGNJX */
+        return a ^ (b & FMASK_SIGN);
+    }
+}
+
+/* the comparison @op of @a of vs2 with @b of vs1 or the scalar */
+static bool vfcompare(riscv_t *rv, uint32_t op, uint32_t a, uint32_t b)
+{
+    if (is_nan(a) || is_nan(b)) {
+        /* equality is quiet, ordering signals on any NaN */
+        if (op > VF_NE || is_snan(a) || is_snan(b))
+            rv->csr_fcsr |= FFLAG_INVALID_OP;
+        return op == VF_NE;
+    }
+
+    const float x = vf32(a), y = vf32(b);
+    switch (op) {
+    case VF_EQ:
+        return x == y;
+    case VF_NE:
+        return x != y;
+    case VF_LT:
+        return x < y;
+    case VF_LE:
+        return x <= y;
+    case VF_GT:
+        return x > y;
+    default: /* VF_GE */
+        return x >= y;
+    }
+}
+
+typedef float vf32_t __attribute__((vector_size(16)));
+
+/* arithmetic on whole chunks, in the rounding mode of the host */
+static uint32_t simd_farith(uint32_t op,
+                            uint8_t *vd,
+                            const uint8_t *vs2,
+                            const uint8_t *vs1,
+                            uint32_t scalar,
+                            uint32_t vl)
+{
+    vf32_t x, y = (vf32_t) {0} + vf32(scalar), d;
+    uint32_t i = 0;
+
+    switch (op) {
+    case VF_ADD:
+        SIMD_LOOP(vf32_t, x + y);
+        break;
+    case VF_SUB:
+        SIMD_LOOP(vf32_t, x - y);
+        break;
+    case VF_RSUB:
+        SIMD_LOOP(vf32_t, y - x);
+        break;
+    case VF_MUL:
+        SIMD_LOOP(vf32_t, x * y);
+        break;
+    case VF_DIV:
+        SIMD_LOOP(vf32_t, x / y);
+        break;
+    case VF_RDIV:
+        SIMD_LOOP(vf32_t, y / x);
+        break;
+    default:
+        return 0;
+    }
+
+    /* make the NaNs canonical */
+    for (uint32_t j = 0; j < i * 4; j += 16) {
+        vu32_t r;
+        memcpy(&r, vd + j, 16);
+        const vu32_t nan = (vu32_t) ((r & FMASK_EXPN) == FMASK_EXPN) &
+                           (vu32_t) ((r & FMASK_FRAC) != 0);
+        r = SIMD_SELECT(vu32_t, nan, (vu32_t) {0} + RV_NAN, r);
+        memcpy(vd + j, &r, 16);
+    }
+    return i;
+}
+
+/* elementwise operations of SEW 32, where vd, vs2 and vs1 have LMUL */
+static bool vfarith(riscv_t *rv,
+                    const rv_insn_t *ir,
+                    const vconf_t *c,
+                    uint32_t op,
+                    uint32_t scalar)
+{
+    const bool vv = VV(ir);
+    vfenv_t env;
+
+    if (c->sew != 4 || !vgroup(ir->rd, c->lmul) ||
+        !vgroup(ir->rs2, c->lmul) || (vv && !vgroup(ir->rs1, c->lmul)) ||
+        (!ir->vm && !ir->rd))
+        return false;
+
+    const bool rounds = op < VF_MIN;
+    if (rounds && !vfenv_begin(rv, &env))
+        return false;
+
+    uint32_t i = rv->csr_vstart;
+    if (!i && ir->vm && rounds && !env.soft)
+        i = simd_farith(op, VREG(rv, ir->rd), VREG(rv, ir->rs2),
+                        vv ? VREG(rv, ir->rs1) : NULL, scalar, c->vl);
+    for (; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t a = vget(rv, ir->rs2, i, 4);
+        const uint32_t b = vv ? vget(rv, ir->rs1, i, 4) : scalar;
+        const uint32_t r = rounds ? vfround(op, a, b, vget(rv, ir->rd, i, 4),
+                                            env.soft)
+                                  : vfexact(rv, op, a, b);
+        vset(rv, ir->rd, i, 4, r);
+    }
+    if (rounds)
+        vfenv_end(rv, &env);
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* comparisons into the mask register vd */
+static bool vfcompare_mask(riscv_t *rv,
+                           const rv_insn_t *ir,
+                           const vconf_t *c,
+                           uint32_t op,
+                           uint32_t scalar)
+{
+    const bool vv = VV(ir);
+
+    if (c->sew != 4 || !vgroup(ir->rs2, c->lmul) ||
+        (vv && !vgroup(ir->rs1, c->lmul)) || (!ir->vm && !ir->rd))
+        return false;
+
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t a = vget(rv, ir->rs2, i, 4);
+        const uint32_t b = vv ? vget(rv, ir->rs1, i, 4) : scalar;
+        vmask_set(rv, ir->rd, i, vfcompare(rv, op, a, b));
+    }
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* vfredusum, vfredosum, vfredmin and vfredmax into element 0 of vd, which sum
+ * in the order of the elements
+ */
+static bool vfreduce(riscv_t *rv,
+                     const rv_insn_t *ir,
+                     const vconf_t *c,
+                     uint32_t op)
+{
+    vfenv_t env;
+
+    if (c->sew != 4 || rv->csr_vstart || !vgroup(ir->rs2, c->lmul))
+        return false;
+    if (op == VF_ADD && !vfenv_begin(rv, &env))
+        return false;
+
+    uint32_t acc = vget(rv, ir->rs1, 0, 4);
+    for (uint32_t i = 0; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, 4);
+        acc = op == VF_ADD ? vfround(op, acc, x, 0, env.soft)
+                           : vfexact(rv, op, acc, x);
+    }
+    if (op == VF_ADD)
+        vfenv_end(rv, &env);
+    if (c->vl)
+        vset(rv, ir->rd, 0, 4, acc);
+    return true;
+}
+
+/* the integer in @bits bits, signed or not, which @f rounds to as @frm
+ * selects, saturated and flagged as invalid where out of range
+ */
+static uint32_t vfcvt_int(riscv_t *rv,
+                          uint32_t f,
+                          uint32_t frm,
+                          bool sign,
+                          uint32_t bits)
+{
+    const double hi = sign ? ldexp(1, bits - 1) - 1 : ldexp(1, bits) - 1;
+    const double lo = sign ? -ldexp(1, bits - 1) : 0;
+    const double x = vf32(f);
+
+    if (is_nan(f)) {
+        rv->csr_fcsr |= FFLAG_INVALID_OP;
+        return (int64_t) hi;
+    }
+
+    double r;
+    switch (frm) {
+    case 0: /* round to nearest, ties to even */
+        r = floor(x);
+        if (x - r > 0.5 || (x - r == 0.5 && fmod(r, 2)))
+            r += 1;
+        break;
+    case 1:
+        r = trunc(x);
+        break;
+    case 2:
+        r = floor(x);
+        break;
+    case 3:
+        r = ceil(x);
+        break;
+    default: /* round to nearest, ties to max magnitude */
+        r = round(x);
+        break;
+    }
+
+    if (r > hi || r < lo) {
+        rv->csr_fcsr |= FFLAG_INVALID_OP;
+        return (int64_t) (r > hi ? hi : lo);
+    }
+    if (r != x)
+        rv->csr_fcsr |= FFLAG_INEXACT;
+    return (int64_t) r;
+}
+
+/* VFUNARY0: the conversions between integers and single-precision numbers,
+ * i.e., those of SEW 32, the widening ones from 16-bit integers, and the
+ * narrowing ones to 16-bit integers
+ */
+static bool vfconvert(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    const uint32_t funct = ir->rs1;
+    const bool to_int = !(funct & 2), rtz = funct & 4, sign = funct & 1;
+    const uint32_t sew = c->sew;
+    int32_t demul = c->lmul, semul = c->lmul;
+    uint32_t dsew = sew, ssew = sew;
+
+    switch (funct) {
+    case 0x00: /* vfcvt.xu.f.v */
+    case 0x01: /* vfcvt.x.f.v */
+    case 0x02: /* vfcvt.f.xu.v */
+    case 0x03: /* vfcvt.f.x.v */
+    case 0x06: /* vfcvt.rtz.xu.f.v */
+    case 0x07: /* vfcvt.rtz.x.f.v */
+        if (sew != 4)
+            return false;
+        break;
+    case 0x0a: /* vfwcvt.f.xu.v */
+    case 0x0b: /* vfwcvt.f.x.v */
+        if (sew != 2)
+            return false;
+        dsew = 4;
+        demul++;
+        break;
+    case 0x10: /* vfncvt.xu.f.w */
+    case 0x11: /* vfncvt.x.f.w */
+    case 0x16: /* vfncvt.rtz.xu.f.w */
+    case 0x17: /* vfncvt.rtz.x.f.w */
+        if (sew != 2)
+            return false;
+        ssew = 4;
+        semul++;
+        break;
+    default:
+        return false;
+    }
+    if (!vgroup(ir->rd, demul) || !vgroup(ir->rs2, semul) ||
+        (!ir->vm && !ir->rd))
+        return false;
+    /* a narrowing may only overwrite the lowest part of its source */
+    if (dsew != ssew &&
+        voverlap(ir->rd, VREGS(demul), ir->rs2, VREGS(semul)) &&
+        (dsew > ssew || ir->rd != ir->rs2))
+        return false;
+
+    const uint32_t frm = rtz ? 1 : (rv->csr_fcsr >> 5) & 0x7;
+    vfenv_t env;
+    if (frm > 4)
+        return false;
+    if (!to_int && !vfenv_begin(rv, &env))
+        return false;
+
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, ssew);
+        uint32_t r;
+        if (to_int)
+            r = vfcvt_int(rv, x, frm, sign, dsew * 8);
+        else if (ssew == 2) /* exact */
+            r = vu32(sign ? (float) (int16_t) x : (float) x);
+        else
+            r = vfround(sign ? VF_CVT_F_X : VF_CVT_F_XU, x, 0, 0, env.soft);
+        vset(rv, ir->rd, i, dsew, r);
+    }
+    if (!to_int)
+        vfenv_end(rv, &env);
+    rv->csr_vstart = 0;
+    return true;
+}
+
+/* the 7-bit estimates of the reciprocal, and of the reciprocal square root by
+ * the least bit of the exponent, of the significands in 128 steps
+ */
+static const uint8_t rec7_table[128] = {
+    127, 125, 123, 121, 119, 117, 116, 114, 112, 110, 109, 107, 105,
+    104, 102, 100, 99,  97,  96,  94,  93,  91,  90,  88,  87,  85,
+    84,  83,  81,  80,  79,  77,  76,  75,  74,  72,  71,  70,  69,
+    68,  66,  65,  64,  63,  62,  61,  60,  59,  58,  57,  56,  55,
+    54,  53,  52,  51,  50,  49,  48,  47,  46,  45,  44,  43,  42,
+    41,  40,  40,  39,  38,  37,  36,  35,  35,  34,  33,  32,  31,
+    31,  30,  29,  28,  28,  27,  26,  25,  25,  24,  23,  23,  22,
+    21,  21,  20,  19,  19,  18,  17,  17,  16,  15,  15,  14,  14,
+    13,  12,  12,  11,  11,  10,  9,   9,   8,   8,   7,   7,   6,
+    5,   5,   4,   4,   3,   3,   2,   2,   1,   1,   0,
+};
+
+static const uint8_t rsqrt7_table[128] = {
+    52,  51,  50,  48,  47,  46,  44,  43,  42,  41,  40,  39,  38,
+    36,  35,  34,  33,  32,  31,  30,  30,  29,  28,  27,  26,  25,
+    24,  23,  23,  22,  21,  20,  19,  19,  18,  17,  16,  16,  15,
+    14,  14,  13,  12,  12,  11,  10,  10,  9,   9,   8,   7,   7,
+    6,   6,   5,   4,   4,   3,   3,   2,   2,   1,   1,   0,   127,
+    125, 123, 121, 119, 118, 116, 114, 113, 111, 109, 108, 106, 105,
+    103, 102, 100, 99,  97,  96,  95,  93,  92,  91,  90,  88,  87,
+    86,  85,  84,  83,  82,  80,  79,  78,  77,  76,  75,  74,  73,
+    72,  71,  70,  70,  69,  68,  67,  66,  65,  64,  63,  63,  62,
+    61,  60,  59,  59,  58,  57,  56,  56,  55,  54,  53,
+};
+
+/* the exponent and the significand of the nonzero finite @f, normalized */
+static inline int32_t vfnormalize(uint32_t f, uint32_t *sig)
+{
+    int32_t exp = (f & FMASK_EXPN) >> 23;
+
+    *sig = f & FMASK_FRAC;
+    if (!exp) {
+        while (!(*sig & (1U << 22))) {
+            *sig <<= 1;
+            exp--;
+        }
+        *sig = (*sig << 1) & FMASK_FRAC;
+    }
+    return exp;
+}
+
+static uint32_t vfrec7(riscv_t *rv, uint32_t f, uint32_t frm)
+{
+    const uint32_t sign = f & FMASK_SIGN;
+
+    switch (calc_fclass(f)) {
+    case 0x001: /* -inf */
+    case 0x080: /* +inf */
+        return sign;
+    case 0x008: /* -0 */
+    case 0x010: /* +0 */
+        rv->csr_fcsr |= FFLAG_DIV_BY_ZERO;
+        return sign | FMASK_EXPN;
+    case 0x100: /* signaling NaN */
+        rv->csr_fcsr |= FFLAG_INVALID_OP;
+        return RV_NAN;
+    case 0x200: /* quiet NaN */
+        return RV_NAN;
+    default:
+        break;
+    }
+
+    uint32_t sig;
+    const int32_t exp = vfnormalize(f, &sig);
+    const int32_t out_exp = 2 * 127 - 1 - exp;
+    if (out_exp > 254) {
+        /* the reciprocal of a tiny subnormal overflows */
+        rv->csr_fcsr |= FFLAG_OVERFLOW | FFLAG_INEXACT;
+        const bool to_max = frm == 1 || (frm == 2 && !sign) ||
+                            (frm == 3 && sign);
+        return sign | (to_max ? 0x7f7fffff : FMASK_EXPN);
+    }
+
+    uint32_t out_sig = rec7_table[sig >> 16] << 16;
+    if (out_exp < 1) {
+        /* subnormal, as the input is large */
+        out_sig = ((1U << 23) | out_sig) >> (1 - out_exp);
+        return sign | out_sig;
+    }
+    return sign | (uint32_t) out_exp << 23 | out_sig;
+}
+
+static uint32_t vfrsqrt7(riscv_t *rv, uint32_t f)
+{
+    switch (calc_fclass(f)) {
+    case 0x001: /* -inf */
+    case 0x002: /* negative normal */
+    case 0x004: /* negative subnormal */
+    case 0x100: /* signaling NaN */
+        rv->csr_fcsr |= FFLAG_INVALID_OP;
+        return RV_NAN;
+    case 0x200: /* quiet NaN */
+        return RV_NAN;
+    case 0x008: /* -0 */
+    case 0x010: /* +0 */
+        rv->csr_fcsr |= FFLAG_DIV_BY_ZERO;
+        return (f & FMASK_SIGN) | FMASK_EXPN;
+    case 0x080: /* +inf */
+        return 0;
+    default:
+        break;
+    }
+
+    uint32_t sig;
+    const int32_t exp = vfnormalize(f, &sig);
+    const uint32_t idx = (exp & 1) << 6 | sig >> 17;
+    const uint32_t out_exp = (3 * 127 - 1 - exp) / 2;
+    return out_exp << 23 | rsqrt7_table[idx] << 16;
+}
+
+/* VFUNARY1: vfsqrt, vfrsqrt7, vfrec7 and vfclass */
+static bool vfunary1(riscv_t *rv, const rv_insn_t *ir, const vconf_t *c)
+{
+    vfenv_t env;
+
+    if (c->sew != 4 || !vgroup(ir->rd, c->lmul) ||
+        !vgroup(ir->rs2, c->lmul) || (!ir->vm && !ir->rd))
+        return false;
+
+    switch (ir->rs1) {
+    case 0x00: /* vfsqrt */
+    case 0x05: /* vfrec7 */
+        if (!vfenv_begin(rv, &env))
+            return false;
+        break;
+    case 0x04: /* vfrsqrt7 */
+    case 0x10: /* vfclass */
+        break;
+    default:
+        return false;
+    }
+
+    for (uint32_t i = rv->csr_vstart; i < c->vl; i++) {
+        if (!VACTIVE(rv, ir, i))
+            continue;
+        const uint32_t x = vget(rv, ir->rs2, i, 4);
+        uint32_t r;
+        switch (ir->rs1) {
+        case 0x00:
+            r = vfround(VF_SQRT, x, 0, 0, env.soft);
+            break;
+        case 0x04:
+            r = vfrsqrt7(rv, x);
+            break;
+        case 0x05:
+            r = vfrec7(rv, x, env.frm);
+            break;
+        default:
+            r = calc_fclass(x);
+            break;
+        }
+        vset(rv, ir->rd, i, 4, r);
+    }
+    if (ir->rs1 == 0x00 || ir->rs1 == 0x05)
+        vfenv_end(rv, &env);
+    rv->csr_vstart = 0;
+    return true;
+}
+
+bool vector_opf(riscv_t *rv, const rv_insn_t *ir)
+{
+    const bool vv = ir->opcode == rv_insn_vopfvv;
+    const uint32_t f = vv ? 0 : rv->F[ir->rs1].v;
+    vconf_t c;
+
+    if (!vconf(rv, &c))
+        return false;
+
+    switch (ir->vfunct) {
+    case 0x00:
+        return vfarith(rv, ir, &c, VF_ADD, f);
+    case 0x01: /* vfredusum */
+    case 0x03: /* vfredosum */
+        return vv && vfreduce(rv, ir, &c, VF_ADD);
+    case 0x02:
+        return vfarith(rv, ir, &c, VF_SUB, f);
+    case 0x04:
+        return vfarith(rv, ir, &c, VF_MIN, f);
+    case 0x05:
+        return vv && vfreduce(rv, ir, &c, VF_MIN);
+    case 0x06:
+        return vfarith(rv, ir, &c, VF_MAX, f);
+    case 0x07:
+        return vv && vfreduce(rv, ir, &c, VF_MAX);
+    case 0x08:
+        return vfarith(rv, ir, &c, VF_SGNJ, f);
+    case 0x09:
+        return vfarith(rv, ir, &c, VF_SGNJN, f);
+    case 0x0a:
+        return vfarith(rv, ir, &c, VF_SGNJX, f);
+    case 0x0e:
+        return !vv && c.sew == 4 && vslide1(rv, ir, &c, true, f);
+    case 0x0f:
+        return !vv && c.sew == 4 && vslide1(rv, ir, &c, false, f);
+    case 0x10:
+        if (c.sew != 4)
+            return false;
+        if (!vv)
+            return vmove_scalar(rv, ir, &c, f);
+        /* vfmv.f.s */
+        if (!ir->vm || ir->rs1)
+            return false;
+        rv->F[ir->rd].v = vget(rv, ir->rs2, 0, 4);
+        rv->csr_vstart = 0;
+        return true;
+    case 0x12:
+        return vv && vfconvert(rv, ir, &c);
+    case 0x13:
+        return vv && vfunary1(rv, ir, &c);
+    case 0x17:
+        if (vv || c.sew != 4)
+            return false;
+        if (ir->vm) /* vfmv.v.f */
+            return !ir->rs2 && varith(rv, ir, &c, VOP_MV, f);
+        return varith(rv, ir, &c, VOP_MERGE, f);
+    case 0x18:
+        return vfcompare_mask(rv, ir, &c, VF_EQ, f);
+    case 0x19:
+        return vfcompare_mask(rv, ir, &c, VF_LE, f);
+    case 0x1b:
+        return vfcompare_mask(rv, ir, &c, VF_LT, f);
+    case 0x1c:
+        return vfcompare_mask(rv, ir, &c, VF_NE, f);
+    case 0x1d:
+        return !vv && vfcompare_mask(rv, ir, &c, VF_GT, f);
+    case 0x1f:
+        return !vv && vfcompare_mask(rv, ir, &c, VF_GE, f);
+    case 0x20:
+        return vfarith(rv, ir, &c, VF_DIV, f);
+    case 0x21:
+        return !vv && vfarith(rv, ir, &c, VF_RDIV, f);
+    case 0x24:
+        return vfarith(rv, ir, &c, VF_MUL, f);
+    case 0x27:
+        return !vv && vfarith(rv, ir, &c, VF_RSUB, f);
+    case 0x28:
+        return vfarith(rv, ir, &c, VF_MADD, f);
+    case 0x29:
+        return vfarith(rv, ir, &c, VF_NMADD, f);
+    case 0x2a:
+        return vfarith(rv, ir, &c, VF_MSUB, f);
+    case 0x2b:
+        return vfarith(rv, ir, &c, VF_NMSUB, f);
+    case 0x2c:
+        return vfarith(rv, ir, &c, VF_MACC, f);
+    case 0x2d:
+        return vfarith(rv, ir, &c, VF_NMACC, f);
+    case 0x2e:
+        return vfarith(rv, ir, &c, VF_MSAC, f);
+    case 0x2f:
+        return vfarith(rv, ir, &c, VF_NMSAC, f);
+    default:
+        /* the widening operations produce double precision, beyond ELEN */
+        return false;
+    }
+}
+#else
+bool vector_opf(riscv_t *rv UNUSED, const rv_insn_t *ir UNUSED)
+{
+    return false;
+}
+#endif /* RV32_HAS(Zve32f) */
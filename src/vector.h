@@ -0,0 +1,71 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "riscv.h"
+
+/* Vector unit of the Zve32x and Zve32f extensions.
+ *
+ * Elements are at most 32 bits wide, i.e., ELEN is 32, and VLEN is fixed at
+ * build time. The unit keeps every tail and masked-off element undisturbed,
+ * which both the agnostic and the undisturbed policies allow. Operations on
+ * whole registers with no mask and from the first element run on 16 bytes at
+ * a time with the SIMD instructions of the host, through the vector types of
+ * the compiler, and element by element otherwise.
+ */
+
+#ifndef VLEN
+#define VLEN 128
+#endif
+#define VLENB (VLEN / 8)
+#define ELEN 32
+
+#if VLEN < ELEN || VLEN > 1024 || (VLEN & (VLEN - 1))
+#error "VLEN must be a power of 2 from 32 to 1024"
+#endif
+
+/* vtype, which has vill set while the vector unit is not configured */
+#define VTYPE_VILL (1U << 31)
+
+struct rv_insn;
+
+/* vsetvli, vsetivli and vsetvl */
+void vector_setvl(riscv_t *rv, const struct rv_insn *ir);
+
+/* The following return false for an instruction which is reserved under the
+ * current vtype or with its operands, which raises an illegal instruction
+ * exception.
+ */
+
+/* unit-stride, strided and indexed loads, of one or more fields */
+bool vector_load(riscv_t *rv, const struct rv_insn *ir);
+
+/* unit-stride, strided and indexed stores, of one or more fields */
+bool vector_store(riscv_t *rv, const struct rv_insn *ir);
+
+/* OPIVV, OPIVX and OPIVI integer operations */
+bool vector_opi(riscv_t *rv, const struct rv_insn *ir);
+
+/* OPMVV and OPMVX integer and mask operations */
+bool vector_opm(riscv_t *rv, const struct rv_insn *ir);
+
+/* OPFVV and OPFVF single-precision floating-point operations */
+bool vector_opf(riscv_t *rv, const struct rv_insn *ir);
+
+#if RV32_HAS(PLUGIN) || RV32_HAS(GDBSTUB)
+/* call @access for each of the ranges the load or the store @ir is about to
+ * access, as insn_mem_operand() does
+ */
+void vector_mem_operand(const riscv_t *rv,
+                        const struct rv_insn *ir,
+                        bool (*access)(void *arg,
+                                       uint32_t vaddr,
+                                       uint32_t size,
+                                       bool is_store),
+                        void *arg);
+#endif
@@ -0,0 +1,223 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "riscv_private.h"
+#include "warmup.h"
+
+/* running totals, updated with relaxed atomic additions */
+typedef struct {
+    uint64_t ns, count, insn, bytes;
+} phase_stat_t;
+
+/* retired guest instructions per tier, in the order of the CSV columns */
+enum { TIER_INTERP, TIER_T1, TIER_T2, N_TIERS };
+
+typedef struct {
+    uint64_t time_ns;
+    uint64_t insn[N_TIERS];
+    phase_stat_t phases[WARMUP_N_PHASES];
+} sample_t;
+
+struct warmup {
+    riscv_t *rv;
+    FILE *out;
+    uint64_t interval_ns;
+    uint64_t start_ns;
+    phase_stat_t phases[WARMUP_N_PHASES];
+
+    pthread_t thread;
+    bool quit;
+
+    sample_t last;
+    double peak_mips;
+    uint64_t peak_ns; /**< end of the interval with the peak throughput */
+    /* the throughput of every interval, to find when it reached the peak */
+    double *mips;
+    uint64_t *mips_ns;
+    uint32_t n_mips, cap_mips;
+};
+
+uint64_t warmup_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define LOAD(v) __atomic_load_n(&(v), __ATOMIC_RELAXED)
+
+static void take_sample(warmup_t *warmup, sample_t *s)
+{
+    riscv_t *rv = warmup->rv;
+    s->time_ns = warmup_clock() - warmup->start_ns;
+    s->insn[TIER_INTERP] = LOAD(rv->csr_cycle);
+    s->insn[TIER_T1] = LOAD(rv->hpm_events[RV_HPM_T1_INSN]);
+    s->insn[TIER_T2] = LOAD(rv->hpm_events[RV_HPM_T2_INSN]);
+    for (int i = 0; i < WARMUP_N_PHASES; i++) {
+        s->phases[i].ns = LOAD(warmup->phases[i].ns);
+        s->phases[i].count = LOAD(warmup->phases[i].count);
+        s->phases[i].insn = LOAD(warmup->phases[i].insn);
+        s->phases[i].bytes = LOAD(warmup->phases[i].bytes);
+    }
+}
+
+static void write_row(warmup_t *warmup, const sample_t *s)
+{
+    const sample_t *prev = &warmup->last;
+    const uint64_t dt = s->time_ns - prev->time_ns;
+    if (!dt)
+        return;
+
+    /* instructions per microsecond are millions of instructions per second */
+    const double us = dt / 1e3;
+    double mips[N_TIERS], total = 0;
+    for (int i = 0; i < N_TIERS; i++) {
+        mips[i] = (s->insn[i] - prev->insn[i]) / us;
+        total += mips[i];
+    }
+    double ms[WARMUP_N_PHASES];
+    for (int i = 0; i < WARMUP_N_PHASES; i++)
+        ms[i] = (s->phases[i].ns - prev->phases[i].ns) / 1e6;
+    const phase_stat_t *t1 = &s->phases[WARMUP_T1];
+    fprintf(warmup->out,
+            "%.3f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%" PRIu64 ",%" PRIu64
+            ",%" PRIu64 ",%" PRIu64 ",%.2f\n",
+            s->time_ns / 1e9, total, mips[TIER_INTERP], mips[TIER_T1],
+            mips[TIER_T2], ms[WARMUP_TRANSLATE], ms[WARMUP_T1], ms[WARMUP_T2],
+            s->phases[WARMUP_TRANSLATE].count, t1->count,
+            s->phases[WARMUP_T2].count, t1->bytes,
+            t1->insn ? (double) t1->bytes / t1->insn : 0);
+    fflush(warmup->out);
+
+    if (total > warmup->peak_mips) {
+        warmup->peak_mips = total;
+        warmup->peak_ns = s->time_ns;
+    }
+    if (warmup->n_mips == warmup->cap_mips) {
+        warmup->cap_mips = warmup->cap_mips ? 2 * warmup->cap_mips : 1024;
+        warmup->mips =
+            realloc(warmup->mips, warmup->cap_mips * sizeof(*warmup->mips));
+        warmup->mips_ns = realloc(warmup->mips_ns,
+                                  warmup->cap_mips * sizeof(*warmup->mips_ns));
+        assert(warmup->mips && warmup->mips_ns);
+    }
+    warmup->mips[warmup->n_mips] = total;
+    warmup->mips_ns[warmup->n_mips++] = s->time_ns;
+    warmup->last = *s;
+}
+
+static void *sampler(void *arg)
+{
+    warmup_t *warmup = arg;
+    uint64_t next_ns = warmup->start_ns + warmup->interval_ns;
+
+    while (!__atomic_load_n(&warmup->quit, __ATOMIC_ACQUIRE)) {
+        /* sleep in short steps to notice the end of the emulation quickly */
+        const uint64_t now = warmup_clock();
+        if (now < next_ns) {
+            uint64_t ns = next_ns - now;
+            if (ns > 10000000)
+                ns = 10000000;
+            const struct timespec ts = {.tv_nsec = ns};
+            nanosleep(&ts, NULL);
+            continue;
+        }
+        next_ns += warmup->interval_ns;
+
+        sample_t s;
+        take_sample(warmup, &s);
+        write_row(warmup, &s);
+    }
+    return NULL;
+}
+
+warmup_t *warmup_create(riscv_t *rv,
+                        const char *out_file_path,
+                        uint32_t interval_ms)
+{
+    assert(out_file_path && interval_ms);
+
+    warmup_t *warmup = calloc(1, sizeof(warmup_t));
+    assert(warmup);
+    warmup->out = fopen(out_file_path, "w");
+    if (!warmup->out) {
+        rv_log_error("Cannot open warm-up output file: %s", out_file_path);
+        free(warmup);
+        return NULL;
+    }
+    fprintf(warmup->out,
+            "time_s,mips,interp_mips,t1_mips,t2_mips,translate_ms,"
+            "t1_compile_ms,t2_compile_ms,blocks,t1_compiles,t2_compiles,"
+            "t1_bytes,t1_bytes_per_insn\n");
+
+    warmup->rv = rv;
+    warmup->interval_ns = interval_ms * 1000000ULL;
+
+    warmup->start_ns = warmup_clock();
+    take_sample(warmup, &warmup->last);
+    warmup->last.time_ns = 0;
+    pthread_create(&warmup->thread, NULL, sampler, warmup);
+    return warmup;
+}
+
+void warmup_account(warmup_t *warmup,
+                    uint32_t phase,
+                    uint64_t start_ns,
+                    uint64_t n_insn,
+                    uint64_t n_bytes)
+{
+    phase_stat_t *stat = &warmup->phases[phase];
+    __atomic_fetch_add(&stat->ns, warmup_clock() - start_ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat->insn, n_insn, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stat->bytes, n_bytes, __ATOMIC_RELAXED);
+}
+
+void warmup_delete(warmup_t *warmup)
+{
+    if (!warmup)
+        return;
+
+    __atomic_store_n(&warmup->quit, true, __ATOMIC_RELEASE);
+    pthread_join(warmup->thread, NULL);
+
+    /* the last, partial interval */
+    sample_t s;
+    take_sample(warmup, &s);
+    write_row(warmup, &s);
+
+    /* time to 90% of the peak throughput */
+    uint64_t warm_ns = warmup->peak_ns;
+    for (uint32_t i = 0; i < warmup->n_mips; i++) {
+        if (warmup->mips[i] >= 0.9 * warmup->peak_mips) {
+            warm_ns = warmup->mips_ns[i];
+            break;
+        }
+    }
+    const phase_stat_t *p = s.phases;
+    rv_log_info(
+        "Warm-up: peak %.2f MIPS at %.3f s, 90%% of it reached at %.3f s; "
+        "translation %.3f ms for %" PRIu64 " blocks, tier-1 %.3f ms for "
+        "%" PRIu64 " compilations (%.2f bytes per instruction), tier-2 %.3f ms "
+        "for %" PRIu64 " compilations",
+        warmup->peak_mips, warmup->peak_ns / 1e9, warm_ns / 1e9,
+        p[WARMUP_TRANSLATE].ns / 1e6, p[WARMUP_TRANSLATE].count,
+        p[WARMUP_T1].ns / 1e6, p[WARMUP_T1].count,
+        p[WARMUP_T1].insn ? (double) p[WARMUP_T1].bytes / p[WARMUP_T1].insn
+                          : 0,
+        p[WARMUP_T2].ns / 1e6, p[WARMUP_T2].count);
+
+    fclose(warmup->out);
+    free(warmup->mips);
+    free(warmup->mips_ns);
+    free(warmup);
+}
@@ -0,0 +1,70 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "riscv.h"
+
+/* Warm-up profiling.
+ *
+ * A sampling thread wakes up at a fixed wall-clock interval and writes one
+ * CSV row per interval with the guest instructions retired by each execution
+ * tier, as millions of instructions per second, along with the time spent in
+ * block translation and in the tier-1 and tier-2 compilers during that
+ * interval, and the code produced by the tier-1 compiler so far per guest
+ * instruction it compiled. Plotting the rows against time gives the warm-up
+ * curve of a run; its summary, written once the emulator exits, tells when
+ * the throughput first reached 90% of its peak.
+ *
+ * Sampling from another thread, rather than from the dispatch loop, keeps
+ * the intervals regular while the JIT-compiled code runs for long without
+ * returning to the dispatcher.
+ */
+
+enum {
+    WARMUP_TRANSLATE, /* IR translation of a basic block */
+    WARMUP_T1,        /* tier-1 compilation */
+    WARMUP_T2,        /* tier-2 compilation, in the background thread */
+    WARMUP_N_PHASES,
+};
+
+typedef struct warmup warmup_t;
+
+/**
+ * warmup_create - start the warm-up profiler
+ * @rv: a pointer points to the RISC-V emulator
+ * @out_file_path: path of the CSV output file
+ * @interval_ms: sampling interval in milliseconds
+ */
+warmup_t *warmup_create(riscv_t *rv,
+                        const char *out_file_path,
+                        uint32_t interval_ms);
+
+/* monotonic clock in nanoseconds, to be passed to warmup_account */
+uint64_t warmup_clock(void);
+
+/**
+ * warmup_account - charge the time elapsed since @start_ns to a phase
+ * @warmup: a pointer points to the warm-up profiler
+ * @phase: one of WARMUP_*
+ * @start_ns: value of warmup_clock() when the phase began
+ * @n_insn: guest instructions processed by the phase
+ * @n_bytes: host code produced by the phase
+ *
+ * It may be called from any thread.
+ */
+void warmup_account(warmup_t *warmup,
+                    uint32_t phase,
+                    uint64_t start_ns,
+                    uint64_t n_insn,
+                    uint64_t n_bytes);
+
+/**
+ * warmup_delete - stop sampling, write the summary and release the profiler
+ * @warmup: a pointer points to the warm-up profiler
+ */
+void warmup_delete(warmup_t *warmup);
@@ -38,6 +38,14 @@ def setup_testlist(riscv_device, hw_data_misaligned_support):
         ISA += '_Zbc' if 'Z' in ISA else 'Zbc'
     if 'Zbs' in riscv_device:
         ISA += '_Zbs' if 'Z' in ISA else 'Zbs'
+    if 'Zcb' in riscv_device:
+        ISA += '_Zcb' if 'Z' in ISA else 'Zcb'
+    if 'Zcmp' in riscv_device:
+        ISA += '_Zcmp' if 'Z' in ISA else 'Zcmp'
+    if 'Zicond' in riscv_device:
+        ISA += '_Zicond' if 'Z' in ISA else 'Zicond'
+    if 'Zfa' in riscv_device:
+        ISA += '_Zfa' if 'Z' in ISA else 'Zfa'
     if 'Zicsr' in riscv_device:
         ISA += '_Zicsr' if 'Z' in ISA else 'Zicsr'
     if 'Zifencei' in riscv_device:
@@ -0,0 +1,285 @@
+#!/usr/bin/env python3
+"""Benchmark rv32emu across engine configurations and gate on regressions.
+
+Each build a configuration needs goes to its own output directory, unless
+it is already there or --no-build is given. Configurations sharing a build
+differ in the execution engine selected with -e, so that they run the very
+same binary. Every benchmark is run several times. The median and the median
+absolute deviation (MAD) of each metric are written as JSON, which can later
+serve as the baseline of another run:
+
+    tests/bench.py --runs 5 --output base.json
+    tests/bench.py --runs 5 --baseline base.json --threshold 5
+
+A benchmark regresses when its median is worse than the baseline by more
+than the threshold, in percent, and by more than --mad-factor times the
+larger of the two MADs, so that noisy benchmarks do not fail the gate.
+
+Only ELF files already present are run; nothing is downloaded, hence the
+harness works offline once 'make artifact' has been done.
+"""
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+SCHEMA = "rv32emu-bench/1"
+
+# name: make variables, on top of the ones given with --make-arg
+BUILDS = {
+    "interp": ["ENABLE_JIT=0"],
+    "jit": ["ENABLE_JIT=1", "ENABLE_T2C=0"],
+    "jit-t2c": ["ENABLE_JIT=1", "ENABLE_T2C=1"],
+}
+
+# name: build, emulator arguments
+CONFIGS = {
+    "interp": ("interp", []),
+    "interp-nofuse": ("interp", ["-e", "interp,nofusion,nochain"]),
+    "t1": ("jit", []),
+    "t1-t2c": ("jit-t2c", []),
+    "jit-interp": ("jit", ["-e", "interp"]),
+}
+
+COREMARK_ARGS = ["0x0", "0x0", "0x66", "30000", "7", "1", "2000"]
+
+# name: arguments, metric, unit, which direction is better, regex of value
+SPECIAL_BENCHES = {
+    "dhrystone": ([], "dmips", "DMIPS", "higher", r"([0-9.]+) DMIPS"),
+    "coremark": (
+        COREMARK_ARGS,
+        "iterations",
+        "iterations/s",
+        "higher",
+        r"Iterations/Sec\s*:\s*([0-9.]+)",
+    ),
+}
+
+
+def test_benches(root):
+    """Read TEST_BENCHES from mk/artifact.mk."""
+    with open(os.path.join(root, "mk", "artifact.mk")) as f:
+        text = f.read()
+    m = re.search(r"^TEST_BENCHES\s*\+?=((?:.*\\\n)*.*)$", text, re.M)
+    if not m:
+        return []
+    return m.group(1).replace("\\", " ").split()
+
+
+def make_env():
+    """Drop the variables of an enclosing make, which would override ours."""
+    env = dict(os.environ)
+    for var in ("MAKEFLAGS", "MFLAGS", "MAKELEVEL", "MAKEOVERRIDES"):
+        env.pop(var, None)
+    return env
+
+
+def build(root, name, out, make_args, jobs):
+    cmd = ["make", "-C", root, "OUT=" + out, "-j" + str(jobs)]
+    cmd += BUILDS[name] + make_args
+    # variant builds never fetch the prebuilt ELF files
+    if not any(a.startswith("LATEST_RELEASE=") for a in make_args):
+        cmd.append("LATEST_RELEASE=" + os.environ.get("LATEST_RELEASE", "none"))
+    print("Building {} in {}".format(name, out), flush=True)
+    proc = subprocess.run(
+        cmd, env=make_env(), stdout=subprocess.DEVNULL, stderr=subprocess.PIPE
+    )
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stderr.decode(errors="replace"))
+        return False
+    return True
+
+
+def run_once(emu, elf, bench, timeout):
+    """Return the value of the metric of a single run, or None on failure."""
+    args, _, _, _, pattern = SPECIAL_BENCHES.get(bench, ([], "", "", "", None))
+    start = time.perf_counter()
+    try:
+        proc = subprocess.run(
+            emu + [elf] + args,
+            stdin=subprocess.DEVNULL,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            timeout=timeout,
+        )
+    except subprocess.TimeoutExpired:
+        return None
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        return None
+    if pattern is None:
+        return elapsed
+    m = re.search(pattern, proc.stdout.decode(errors="replace"))
+    return float(m.group(1)) if m else None
+
+
+def summarize(samples):
+    median = statistics.median(samples)
+    mad = statistics.median([abs(s - median) for s in samples])
+    return median, mad
+
+
+def run_config(emu, benches, elf_dir, runs, timeout):
+    results = {}
+    for bench, elf in benches:
+        path = elf if os.path.isabs(elf) else os.path.join(elf_dir, elf)
+        if not os.path.exists(path):
+            print("  {:<16} skipped, {} not found".format(bench, path))
+            continue
+        _, metric, unit, better, _ = SPECIAL_BENCHES.get(
+            bench, (None, "time", "s", "lower", None)
+        )
+        samples = []
+        for _ in range(runs):
+            value = run_once(emu, path, bench, timeout)
+            if value is None:
+                samples = None
+                break
+            samples.append(value)
+        if not samples:
+            print("  {:<16} FAILED".format(bench))
+            results[bench] = {"error": "run failed"}
+            continue
+        median, mad = summarize(samples)
+        print("  {:<16} {:>12.4f} {:<14} (MAD {:.4f})".format(
+            bench, median, unit, mad))
+        results[bench] = {
+            "metric": metric,
+            "unit": unit,
+            "better": better,
+            "samples": samples,
+            "median": median,
+            "mad": mad,
+        }
+    return results
+
+
+def compare(report, baseline, threshold, mad_factor):
+    """Print the differences to the baseline, return the regressions."""
+    regressions = []
+    for config, benches in report["results"].items():
+        base_benches = baseline.get("results", {}).get(config, {})
+        for bench, cur in benches.items():
+            base = base_benches.get(bench)
+            if not base or "median" not in base or "median" not in cur:
+                continue
+            if not base["median"]:
+                continue
+            sign = 1 if cur["better"] == "higher" else -1
+            diff = cur["median"] - base["median"]
+            change = sign * diff / base["median"] * 100
+            noise = mad_factor * max(cur["mad"], base["mad"])
+            regressed = change < -threshold and abs(diff) > noise
+            print("{:<14} {:<16} {:>+8.2f}%{}".format(
+                config, bench, change, "  REGRESSION" if regressed else ""))
+            if regressed:
+                regressions.append((config, bench, change))
+    return regressions
+
+
+def main():
+    root = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("--configs", default=",".join(CONFIGS),
+                        help="comma-separated configurations to run")
+    parser.add_argument("--benches", default=None,
+                        help="comma-separated benchmarks or ELF paths "
+                        "(default: TEST_BENCHES, dhrystone and coremark)")
+    parser.add_argument("--elf-dir", default=os.path.join(root, "build",
+                                                          "riscv32"),
+                        help="directory of the benchmark ELF files")
+    parser.add_argument("--build-dir", default=os.path.join(root, "build",
+                                                            "bench"),
+                        help="where the emulators are built")
+    parser.add_argument("--no-build", action="store_true",
+                        help="only use the emulators that are already built")
+    parser.add_argument("--make-arg", action="append", default=[],
+                        help="extra make variable for every build, "
+                        "e.g. ENABLE_SDL=0")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1)
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--timeout", type=float, default=600,
+                        help="seconds before a run is considered failed")
+    parser.add_argument("--output", default="bench_output.json")
+    parser.add_argument("--baseline", help="JSON report to compare against")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="tolerated slowdown in percent")
+    parser.add_argument("--mad-factor", type=float, default=3.0,
+                        help="tolerated slowdown in MADs")
+    args = parser.parse_args()
+
+    if args.benches:
+        names = args.benches.split(",")
+    else:
+        names = test_benches(root) + list(SPECIAL_BENCHES)
+    benches = [(os.path.splitext(os.path.basename(n))[0], n) for n in names]
+
+    report = {
+        "schema": SCHEMA,
+        "date": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        "host": {"machine": platform.machine(), "system": platform.system(),
+                 "node": platform.node()},
+        "runs": args.runs,
+        "results": {},
+    }
+    try:
+        report["commit"] = subprocess.check_output(
+            ["git", "-C", root, "rev-parse", "--short", "HEAD"],
+            stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        pass
+
+    built = {}
+    for config in args.configs.split(","):
+        if config not in CONFIGS:
+            parser.error("unknown configuration: " + config)
+        name, emu_args = CONFIGS[config]
+        out = os.path.join(args.build_dir, name)
+        emu = os.path.join(out, "rv32emu")
+        if name not in built:
+            built[name] = args.no_build or build(root, name, out,
+                                                 args.make_arg, args.jobs)
+        if not built[name]:
+            print("Skipping {}, build failed".format(config))
+            continue
+        if not os.path.exists(emu):
+            print("Skipping {}, {} not found".format(config, emu))
+            continue
+        print("Running {} ({} runs each)".format(config, args.runs),
+              flush=True)
+        report["results"][config] = run_config([emu] + emu_args, benches,
+                                               args.elf_dir, args.runs,
+                                               args.timeout)
+
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=4)
+    print("Results written to " + args.output)
+
+    failed = any("error" in r for c in report["results"].values()
+                 for r in c.values())
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get("schema") != SCHEMA:
+            print("Unknown baseline schema: {}".format(baseline.get("schema")))
+            return 1
+        regressions = compare(report, baseline, args.threshold,
+                              args.mad_factor)
+        if regressions:
+            print("{} regression(s) beyond {}%".format(len(regressions),
+                                                      args.threshold))
+            return 1
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
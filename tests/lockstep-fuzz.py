@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""Fuzz the execution engines against the reference interpreter.
+
+Every iteration generates a random RV32IM program, runs it with -D, which
+checks each dispatch of the emulator against the reference interpreter,
+and keeps the program if a divergence shows up or the emulator fails:
+
+    tests/lockstep-fuzz.py --emu build/rv32emu --iterations 200
+    tests/lockstep-fuzz.py --emu build/rv32emu --engine interp --seed 7
+
+A program sets up random registers, then runs a loop body of random
+arithmetic, loads and stores into a private buffer, and forward branches,
+which splits the body into blocks. Sequences matching the macro-operation
+fusion patterns are mixed in on purpose. The loop runs often enough for the
+body to get hot, so that the JIT compilers take over, and an outer loop runs
+it again for a few rounds. A round ends with an empty write system call,
+which leaves the code of the JIT compilers, so that the checker learns how far
+a dispatch goes from the first rounds and checks the later ones.
+
+The programs are plain ELF files, written without a cross compiler. A kept
+program can be run again with 'build/rv32emu -D <file>'.
+
+With --aot, every program is compiled ahead of time first, and its run takes
+the code of the shared object, kept along with the program on a failure. As
+that code runs from one system call to the next, which the checker leaves
+alone, the registers at the exit are compared with those of the interpreter
+as well.
+"""
+
+import argparse
+import os
+import random
+import struct
+import subprocess
+import sys
+
+BASE = 0x10000
+DATA = 0x40000  # private buffer, addressed from its middle in s0
+DATA_SIZE = 4096
+
+ZERO, SP, S0, S1, S2 = 0, 2, 8, 9, 18
+# registers the body may write, all but zero, sp, s0 (buffer) and the counts
+REGS = [r for r in range(32) if r not in (ZERO, SP, S0, S1, S2)]
+
+
+def r_type(f7, rs2, rs1, f3, rd, op):
+    return (f7 << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op
+
+
+def i_type(imm, rs1, f3, rd, op):
+    return ((imm & 0xFFF) << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op
+
+
+def s_type(imm, rs2, rs1, f3):
+    return (((imm >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | \
+        (f3 << 12) | ((imm & 0x1F) << 7) | 0x23
+
+
+def b_type(imm, rs2, rs1, f3):
+    return (((imm >> 12) & 1) << 31) | (((imm >> 5) & 0x3F) << 25) | \
+        (rs2 << 20) | (rs1 << 15) | (f3 << 12) | \
+        (((imm >> 1) & 0xF) << 8) | (((imm >> 11) & 1) << 7) | 0x63
+
+
+def lui(rd, imm20):
+    return ((imm20 & 0xFFFFF) << 12) | (rd << 7) | 0x37
+
+
+def addi(rd, rs1, imm):
+    return i_type(imm, rs1, 0, rd, 0x13)
+
+
+def load_imm(rd, value):
+    """lui and addi, with the carry of the sign-extended low part."""
+    value &= 0xFFFFFFFF
+    low = value & 0xFFF
+    if low >= 0x800:
+        low -= 0x1000
+    return [lui(rd, ((value - low) >> 12) & 0xFFFFF), addi(rd, rd, low)]
+
+
+# funct7, funct3 of the register-register operations of RV32I and RV32M
+ALU_RR = [(0, 0), (0x20, 0), (0, 1), (0, 2), (0, 3), (0, 4), (0, 5), (0x20, 5),
+          (0, 6), (0, 7)] + [(1, f3) for f3 in range(8)]
+# funct3 of the register-immediate operations, shifts apart
+ALU_RI = [0, 2, 3, 4, 6, 7]
+# funct3, size of the loads and the stores
+LOADS = [(0, 1), (1, 2), (2, 4), (4, 1), (5, 2)]
+STORES = [(0, 1), (1, 2), (2, 4)]
+
+
+class Generator:
+    def __init__(self, rng, length):
+        self.rng = rng
+        self.length = length
+
+    def reg(self):
+        return self.rng.choice(REGS)
+
+    def src(self):
+        return self.rng.choice(REGS + [ZERO, S1])
+
+    def offset(self, size):
+        half = DATA_SIZE // 2
+        return self.rng.randrange(-half, half, size)
+
+    def simple(self):
+        """One instruction which falls through."""
+        rng = self.rng
+        kind = rng.randrange(10)
+        if kind < 3:
+            f7, f3 = rng.choice(ALU_RR)
+            return [r_type(f7, self.src(), self.src(), f3, self.reg(), 0x33)]
+        if kind < 5:
+            f3 = rng.choice(ALU_RI)
+            imm = rng.randrange(-2048, 2048)
+            return [i_type(imm, self.src(), f3, self.reg(), 0x13)]
+        if kind == 5:
+            f7, f3 = rng.choice([(0, 1), (0, 5), (0x20, 5)])
+            return [r_type(f7, rng.randrange(32), self.src(), f3, self.reg(),
+                           0x13)]
+        if kind == 6:
+            opcode = rng.choice([0x37, 0x17])  # lui, auipc
+            return [(rng.randrange(1 << 20) << 12) | (self.reg() << 7) |
+                    opcode]
+        if kind < 9:
+            f3, size = rng.choice(LOADS)
+            return [i_type(self.offset(size), S0, f3, self.reg(), 0x03)]
+        f3, size = rng.choice(STORES)
+        return [s_type(self.offset(size), self.src(), S0, f3)]
+
+    def fusible(self):
+        """A sequence matching one of the fusion patterns."""
+        rng = self.rng
+        n = rng.randrange(2, 6)
+        kind = rng.randrange(5)
+        if kind == 0:  # lui, lui, ...
+            return [lui(self.reg(), rng.randrange(1 << 20)) for _ in range(n)]
+        if kind == 1:  # lui followed by add of its result
+            rd = self.reg()
+            return [lui(rd, rng.randrange(1 << 20)),
+                    r_type(0, rd, self.src(), 0, self.reg(), 0x33)]
+        if kind == 2:  # sw to consecutive words
+            start = self.offset(4) & ~(4 * 8 - 1)
+            return [s_type(start + 4 * i, self.src(), S0, 2) for i in range(n)]
+        if kind == 3:  # lw from consecutive words
+            start = self.offset(4) & ~(4 * 8 - 1)
+            return [i_type(start + 4 * i, S0, 2, self.reg(), 0x03)
+                    for i in range(n)]
+        # shifts by immediates
+        return [r_type(rng.choice([0, 0x20]) if f3 == 5 else 0,
+                       rng.randrange(32), self.src(), f3, self.reg(), 0x13)
+                for f3 in (rng.choice([1, 5]) for _ in range(n))]
+
+    def body(self):
+        """Random instructions, with forward branches within the body."""
+        rng = self.rng
+        chunks = []
+        while sum(len(c) if c else 1 for c in chunks) < self.length:
+            kind = rng.randrange(10)
+            if kind == 0:
+                chunks.append(None)  # branch, resolved below
+            elif kind == 1:
+                chunks.append(self.fusible())
+            else:
+                chunks.append(self.simple())
+
+        words = []
+        pending = []  # (index of the branch, chunks left to skip)
+        for chunk in chunks:
+            for j, (at, left) in enumerate(pending):
+                pending[j] = (at, left - 1)
+            for at, left in [p for p in pending if p[1] < 0]:
+                words[at] = self.branch(4 * (len(words) - at))
+            pending = [p for p in pending if p[1] >= 0]
+            if chunk is None:
+                pending.append((len(words), rng.randrange(0, 4)))
+                words.append(None)
+            else:
+                words += chunk
+        for at, _ in pending:
+            words[at] = self.branch(4 * (len(words) - at))
+        return words
+
+    def branch(self, distance):
+        f3 = self.rng.choice([0, 1, 4, 5, 6, 7])
+        return b_type(distance, self.src(), self.src(), f3)
+
+    def program(self, iterations, rounds):
+        code = load_imm(S0, DATA + DATA_SIZE // 2) + load_imm(S2, rounds)
+        for r in REGS:
+            code += load_imm(r, self.rng.randrange(1 << 32))
+        outer = len(code)
+        code += load_imm(S1, iterations)
+        body = self.body()
+        code += body
+        # count down, then back to the start of the body
+        code.append(addi(S1, S1, -1))
+        code.append(b_type(-4 * (len(body) + 1), ZERO, S1, 1))
+        # write(1, buf, 0), then the same for the rounds
+        code += [addi(10, ZERO, 1), addi(11, S0, 0), addi(12, ZERO, 0),
+                 addi(17, ZERO, 64), 0x73]
+        code.append(addi(S2, S2, -1))
+        code.append(b_type(-4 * (len(code) - outer), ZERO, S2, 1))
+        # exit(0)
+        code += [addi(10, ZERO, 0), addi(17, ZERO, 93), 0x73]
+        return code
+
+
+def write_elf(path, code):
+    text = b"".join(struct.pack("<I", w) for w in code)
+    off = 52 + 32
+    memsz = DATA + DATA_SIZE - BASE
+    ehdr = struct.pack("<16sHHIIIIIHHHHHH",
+                       b"\x7fELF\x01\x01\x01" + b"\0" * 9, 2, 243, 1,
+                       BASE + off, 52, 0, 0, 52, 32, 1, 40, 0, 0)
+    # one segment, readable, writable and executable, the buffer as .bss
+    phdr = struct.pack("<IIIIIIII", 1, 0, BASE, BASE, off + len(text), memsz,
+                       7, 0x1000)
+    with open(path, "wb") as f:
+        f.write(ehdr + phdr + text)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("--emu", default="build/rv32emu")
+    parser.add_argument("--engine", help="passed to -e, e.g. interp or t1")
+    parser.add_argument("--iterations", type=int, default=100)
+    parser.add_argument("--seed", type=int, default=1,
+                        help="seed of the first program, incremented after")
+    parser.add_argument("--length", type=int, default=64,
+                        help="instructions in a loop body")
+    parser.add_argument("--loops", type=int, default=1000,
+                        help="times the body runs a round, enough to get hot")
+    parser.add_argument("--rounds", type=int, default=6)
+    parser.add_argument("--aot", action="store_true",
+                        help="compile ahead of time (needs the t2c engine)")
+    parser.add_argument("--timeout", type=float, default=60)
+    parser.add_argument("--keep", default="lockstep-fuzz",
+                        help="directory of the programs which failed")
+    args = parser.parse_args()
+
+    os.makedirs(args.keep, exist_ok=True)
+    cmd = [args.emu, "-D"]
+    if args.engine:
+        cmd += ["-e", args.engine]
+
+    failures = 0
+    for seed in range(args.seed, args.seed + args.iterations):
+        gen = Generator(random.Random(seed), args.length)
+        path = os.path.join(args.keep, "seed-{}.elf".format(seed))
+        write_elf(path, gen.program(args.loops, args.rounds))
+        runs = [cmd + [path]]
+        if args.aot:
+            base = path[:-len(".elf")]
+            shared, regs = base + ".so", [base + ".ref.json", base + ".json"]
+            runs = [[args.emu, "-A", "compile:" + shared, path],
+                    [args.emu, "-e", "interp", "-d", regs[0], path],
+                    cmd + ["-A", "load:" + shared, "-d", regs[1], path]]
+        output, failed = "", False
+        for run in runs:
+            try:
+                proc = subprocess.run(run, stdin=subprocess.DEVNULL,
+                                      stdout=subprocess.PIPE,
+                                      stderr=subprocess.STDOUT,
+                                      timeout=args.timeout)
+                output += proc.stdout.decode(errors="replace")
+                failed = proc.returncode != 0
+            except subprocess.TimeoutExpired:
+                output, failed = output + "timeout\n", True
+            if failed:
+                break
+        if args.aot and not failed:
+            with open(regs[0]) as ref, open(regs[1]) as aot:
+                if ref.read() != aot.read():
+                    output, failed = output + "registers differ\n", True
+        if not failed:
+            os.remove(path)
+            if args.aot:
+                for f in [shared] + regs:
+                    os.remove(f)
+            continue
+        failures += 1
+        print("seed {}: FAILED, kept {}".format(seed, path))
+        sys.stdout.write(output)
+
+    print("{} of {} programs failed".format(failures, args.iterations))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
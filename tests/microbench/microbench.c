@@ -0,0 +1,454 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+/* Micro-benchmarks of the data structures on the dispatch path.
+ *
+ * The block cache, the memory pools, the red-black tree map, the PC set and
+ * the decoder are driven by a trace of block start addresses and by the
+ * instruction words of a program, either recorded from a real run with the
+ * trace plugin (see trace.c) or, by default, synthesized from the text
+ * section of an ELF file: loops of blocks picked with a Zipf distribution,
+ * as hot code usually is.
+ *
+ * Every benchmark reports the time per operation, the last-level cache
+ * misses per operation when perf_event_open() is available, and the number
+ * of heap allocations and releases when built with malloc wrapping.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "cache.h"
+#include "decode.h"
+#include "elf.h"
+#include "map.h"
+#include "mpool.h"
+#include "riscv_private.h"
+#include "utils.h"
+
+#if HAVE_MALLOC_WRAP
+/* the objects under test are linked with -Wl,--wrap=malloc and friends */
+static uint64_t n_alloc, n_free;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    n_alloc++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    n_alloc++;
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (!ptr)
+        n_alloc++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr)
+        n_free++;
+    __real_free(ptr);
+}
+#endif
+
+typedef struct {
+    uint32_t *data;
+    size_t len, capacity;
+} trace_t;
+
+static trace_t pcs, insns;
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+/* xorshift64*, reproducible across runs */
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (rng_state * 0x2545f4914f6cdd1dULL) >> 32;
+}
+
+static void trace_push(trace_t *t, uint32_t value)
+{
+    if (t->len == t->capacity) {
+        t->capacity = t->capacity ? 2 * t->capacity : 1024;
+        t->data = realloc(t->data, t->capacity * sizeof(uint32_t));
+        assert(t->data);
+    }
+    t->data[t->len++] = value;
+}
+
+static bool trace_load(trace_t *t, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    uint8_t b[4];
+    while (fread(b, sizeof(b), 1, f) == 1)
+        trace_push(t, b[0] | b[1] << 8 | b[2] << 16 | (uint32_t) b[3] << 24);
+    fclose(f);
+    return t->len;
+}
+
+/* Zipf-distributed rank in [0, n), by inverting a precomputed CDF */
+static uint32_t zipf(const double *cdf, uint32_t n)
+{
+    const double u = rng() / 4294967296.0;
+    uint32_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        const uint32_t mid = (lo + hi) / 2;
+        if (cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static bool is_control_transfer(uint32_t insn)
+{
+    if ((insn & 3) == 3) {
+        const uint32_t opcode = insn & 0x7f;
+        return opcode == 0x63 || opcode == 0x67 || opcode == 0x6f;
+    }
+    return (insn & 0x6003) == 0x2001 || /* c.jal, c.j */
+           (insn & 0xc003) == 0xc001 || /* c.beqz, c.bnez */
+           (insn & 0xe07f) == 0x8002;   /* c.jr, c.jalr */
+}
+
+/* Take the instruction words from the text section of @path, and derive a
+ * block trace of @n_pcs entries from their addresses.
+ */
+static bool synthesize(const char *path, size_t n_pcs)
+{
+    elf_t *elf = elf_new();
+    if (!elf_open(elf, path)) {
+        elf_delete(elf);
+        return false;
+    }
+    uint32_t size, base, end;
+    const uint8_t *text = elf_get_section(elf, ".text", &size);
+    if (!text || size < 4 || !elf_get_load_range(elf, &base, &end)) {
+        elf_delete(elf);
+        return false;
+    }
+
+    /* block leaders are the instructions following a control transfer */
+    trace_t leaders = {0};
+    bool leader = true;
+    for (uint32_t off = 0; off + 2 <= size;) {
+        uint32_t insn = text[off] | text[off + 1] << 8;
+        uint32_t len = 2;
+        if ((insn & 3) == 3) {
+            if (off + 4 > size)
+                break;
+            insn |= (uint32_t) (text[off + 2] | text[off + 3] << 8) << 16;
+            len = 4;
+        }
+        trace_push(&insns, insn);
+        if (leader)
+            trace_push(&leaders, off);
+        leader = is_control_transfer(insn);
+        off += len;
+    }
+    elf_delete(elf);
+
+    const uint32_t n = leaders.len;
+    double *cdf = malloc(n * sizeof(double));
+    assert(cdf);
+    double sum = 0;
+    for (uint32_t i = 0; i < n; i++)
+        cdf[i] = sum += 1.0 / pow(i + 1, 1.1);
+    for (uint32_t i = 0; i < n; i++)
+        cdf[i] /= sum;
+
+    /* shuffle the ranks so that hot blocks are spread over the text */
+    for (uint32_t i = n - 1; i > 0; i--) {
+        const uint32_t j = rng() % (i + 1), tmp = leaders.data[i];
+        leaders.data[i] = leaders.data[j];
+        leaders.data[j] = tmp;
+    }
+
+    uint32_t body[16];
+    while (pcs.len < n_pcs) {
+        const uint32_t n_body = 1 + rng() % 16, n_iter = 1 + rng() % 64;
+        for (uint32_t i = 0; i < n_body; i++)
+            body[i] = base + leaders.data[zipf(cdf, n)];
+        for (uint32_t k = 0; k < n_iter && pcs.len < n_pcs; k++) {
+            for (uint32_t i = 0; i < n_body && pcs.len < n_pcs; i++)
+                trace_push(&pcs, body[i]);
+        }
+    }
+    free(cdf);
+    free(leaders.data);
+    return true;
+}
+
+static int perf_fd = -1;
+
+static void perf_open(void)
+{
+#if defined(__linux__)
+    struct perf_event_attr attr = {
+        .type = PERF_TYPE_HARDWARE,
+        .size = sizeof(attr),
+        .config = PERF_COUNT_HW_CACHE_MISSES,
+        .disabled = 1,
+        .exclude_kernel = 1,
+        .exclude_hv = 1,
+    };
+    perf_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void perf_start(void)
+{
+#if defined(__linux__)
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+static int64_t perf_stop(void)
+{
+    int64_t count = -1;
+#if defined(__linux__)
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(perf_fd, &count, sizeof(count)) != sizeof(count))
+            count = -1;
+    }
+#endif
+    return count;
+}
+
+typedef struct {
+    uint64_t start_ns;
+#if HAVE_MALLOC_WRAP
+    uint64_t n_alloc, n_free;
+#endif
+} measure_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void measure_start(measure_t *m)
+{
+#if HAVE_MALLOC_WRAP
+    m->n_alloc = n_alloc;
+    m->n_free = n_free;
+#endif
+    perf_start();
+    m->start_ns = now_ns();
+}
+
+static void measure_stop(measure_t *m, const char *name, size_t n_ops)
+{
+    const uint64_t elapsed = now_ns() - m->start_ns;
+    const int64_t misses = perf_stop();
+
+    printf("%-14s %10zu %10.2f ", name, n_ops, (double) elapsed / n_ops);
+    if (misses >= 0)
+        printf("%12.4f ", (double) misses / n_ops);
+    else
+        printf("%12s ", "n/a");
+#if HAVE_MALLOC_WRAP
+    printf("%10" PRIu64 " %10" PRIu64 "\n", n_alloc - m->n_alloc,
+           n_free - m->n_free);
+#else
+    printf("%10s %10s\n", "n/a", "n/a");
+#endif
+}
+
+/* the values stored in the containers, as blocks are in the emulator */
+static block_t dummy_block;
+
+static void bench_cache(void)
+{
+    measure_t m;
+    measure_start(&m);
+    struct cache *cache = cache_create(BLOCK_MAP_CAPACITY_BITS);
+    assert(cache);
+    for (size_t i = 0; i < pcs.len; i++) {
+        if (!cache_get(cache, pcs.data[i], true))
+            cache_put(cache, pcs.data[i], &dummy_block);
+    }
+    cache_free(cache);
+    measure_stop(&m, "cache", pcs.len);
+}
+
+static void bench_mpool(void)
+{
+    /* blocks are released on eviction, keep as many alive as the cache */
+    enum { N_LIVE = 1 << BLOCK_MAP_CAPACITY_BITS };
+    static void *live[N_LIVE];
+
+    measure_t m;
+    measure_start(&m);
+    struct mpool *mp = mpool_create(sizeof(block_t) << BLOCK_MAP_CAPACITY_BITS,
+                                    sizeof(block_t));
+    assert(mp);
+    for (size_t i = 0; i < pcs.len; i++) {
+        void **slot = &live[pcs.data[i] % N_LIVE];
+        if (*slot)
+            mpool_free(mp, *slot);
+        *slot = mpool_alloc(mp);
+    }
+    mpool_destroy(mp);
+    memset(live, 0, sizeof(live));
+    measure_stop(&m, "mpool", pcs.len);
+}
+
+static void bench_map(void)
+{
+    measure_t m;
+    measure_start(&m);
+    map_t map = map_init(uint32_t, block_t *, map_cmp_uint);
+    assert(map);
+    block_t *value = &dummy_block;
+    for (size_t i = 0; i < pcs.len; i++) {
+        map_iter_t it;
+        map_find(map, &it, &pcs.data[i]);
+        if (map_at_end(map, &it))
+            map_insert(map, &pcs.data[i], &value);
+    }
+    map_delete(map);
+    measure_stop(&m, "map", pcs.len);
+}
+
+static void bench_set(void)
+{
+    /* the interpreter resets its set before each block, and adds the target
+     * of every taken backward branch to it: measure both separately.
+     */
+    static set_t set;
+    const size_t n_resets = pcs.len / 64 + 1;
+
+    measure_t m;
+    measure_start(&m);
+    for (size_t i = 0; i < n_resets; i++)
+        set_reset(&set);
+    measure_stop(&m, "set_reset", n_resets);
+
+    measure_start(&m);
+    for (size_t i = 0; i < pcs.len; i++) {
+        if (!set_has(&set, pcs.data[i]))
+            set_add(&set, pcs.data[i]);
+    }
+    measure_stop(&m, "set_has/add", pcs.len);
+}
+
+static void bench_decode(size_t n_ops)
+{
+    rv_insn_t ir;
+    size_t n_valid = 0;
+
+    measure_t m;
+    measure_start(&m);
+    for (size_t i = 0; i < n_ops; i++) {
+        memset(&ir, 0, sizeof(ir));
+        n_valid += rv_decode(&ir, insns.data[i % insns.len]);
+    }
+    measure_stop(&m, "decode", n_ops);
+    if (!n_valid)
+        fprintf(stderr, "warning: no valid instruction was decoded\n");
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-n <ops>] [-t <prefix>] [<elf>]\n"
+            "  -n <ops>     length of the synthesized trace (default: 1M)\n"
+            "  -t <prefix>  replay <prefix>.pc and <prefix>.insn, recorded\n"
+            "               with the trace plugin, instead of <elf>\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n_ops = 1 << 20;
+    const char *prefix = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            n_ops = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            prefix = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (prefix) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s.pc", prefix);
+        const bool ok = trace_load(&pcs, path);
+        snprintf(path, sizeof(path), "%s.insn", prefix);
+        if (!ok || !trace_load(&insns, path)) {
+            fprintf(stderr, "Unable to load the trace %s\n", prefix);
+            return 1;
+        }
+        printf("Trace %s: ", prefix);
+    } else {
+        if (optind >= argc || !n_ops) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!synthesize(argv[optind], n_ops)) {
+            fprintf(stderr, "Unable to read the text section of %s\n",
+                    argv[optind]);
+            return 1;
+        }
+        printf("Synthesized from %s: ", argv[optind]);
+    }
+    printf("%zu blocks, %zu instructions\n\n", pcs.len, insns.len);
+
+    perf_open();
+    printf("%-14s %10s %10s %12s %10s %10s\n", "benchmark", "ops", "ns/op",
+           "LLC-miss/op", "allocs", "frees");
+    bench_cache();
+    bench_mpool();
+    bench_map();
+    bench_set();
+    bench_decode(pcs.len);
+
+    free(pcs.data);
+    free(insns.data);
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+/* Instrumentation plugin recording the traces replayed by microbench.
+ *
+ *   build/rv32emu -P build/microbench/trace.so,<prefix> <program>
+ *
+ * writes the start address of every executed block to <prefix>.pc and the
+ * instruction words of every translated block to <prefix>.insn, both as
+ * 32-bit little-endian integers. Compressed instructions are stored in the
+ * low half of a word, as rv_decode() expects them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rv32emu_plugin.h"
+
+/* stop recording block addresses after 64 MiB */
+#define MAX_PC_RECORDS (16U << 20)
+
+static const rv_plugin_api_t *api;
+static FILE *pc_file, *insn_file;
+static uint32_t n_pc;
+
+static void put_word(FILE *f, uint32_t w)
+{
+    const uint8_t b[4] = {w, w >> 8, w >> 16, w >> 24};
+    fwrite(b, sizeof(b), 1, f);
+}
+
+static void trace_block_translate(void *udata UNUSED,
+                                  uint32_t pc_start,
+                                  uint32_t pc_end,
+                                  uint32_t n_insn UNUSED)
+{
+    for (uint32_t pc = pc_start; pc < pc_end;) {
+        uint32_t insn = 0;
+        if (!api->read_mem(api->vm, pc, &insn, 2))
+            return;
+        if ((insn & 3) == 3 && !api->read_mem(api->vm, pc, &insn, 4))
+            return;
+        put_word(insn_file, insn);
+        pc += (insn & 3) == 3 ? 4 : 2;
+    }
+}
+
+static void trace_block_exec(void *udata UNUSED,
+                             uint32_t pc,
+                             uint32_t n_insn UNUSED)
+{
+    if (n_pc < MAX_PC_RECORDS) {
+        put_word(pc_file, pc);
+        n_pc++;
+    }
+}
+
+static void trace_exit(void *udata UNUSED)
+{
+    fclose(pc_file);
+    fclose(insn_file);
+    fprintf(stderr, "trace: %u blocks recorded\n", n_pc);
+}
+
+const uint32_t rv_plugin_version = RV_PLUGIN_VERSION;
+
+int rv_plugin_install(const rv_plugin_api_t *plugin_api,
+                      rv_plugin_ops_t *ops,
+                      const char *args)
+{
+    if (!args || !*args) {
+        fprintf(stderr, "trace: usage: -P trace.so,<prefix>\n");
+        return 1;
+    }
+
+    char *path = malloc(strlen(args) + sizeof(".insn"));
+    if (!path)
+        return 1;
+    sprintf(path, "%s.pc", args);
+    pc_file = fopen(path, "wb");
+    sprintf(path, "%s.insn", args);
+    insn_file = fopen(path, "wb");
+    free(path);
+    if (!pc_file || !insn_file) {
+        fprintf(stderr, "trace: cannot create %s.{pc,insn}\n", args);
+        return 1;
+    }
+
+    api = plugin_api;
+    ops->block_translate = trace_block_translate;
+    ops->block_exec = trace_block_exec;
+    ops->exit = trace_exit;
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * rv32emu is freely redistributable under the MIT License. See the file
+ * "LICENSE" for information on usage and redistribution of this file.
+ */
+
+/* Instrumentation plugin halting the guest in front of its first system call.
+ *
+ *   build/rv32emu -P build/plugins/stop.so <program>
+ *
+ * The halt is requested from insn_exec, so the ecall is never executed and
+ * no system call gets emulated; the report written on exit proves it.
+ */
+
+#include <stdio.h>
+
+#include "rv32emu_plugin.h"
+
+#define INSN_ECALL 0x00000073
+#define REG_A7 17
+
+static const rv_plugin_api_t *api;
+static uint32_t stop_nr, n_syscalls;
+static bool stopped;
+
+static void stop_insn_exec(void *udata UNUSED, uint32_t pc)
+{
+    uint32_t insn = 0;
+    if (stopped || !api->read_mem(api->vm, pc, &insn, 4) || insn != INSN_ECALL)
+        return;
+    stop_nr = api->get_reg(api->vm, REG_A7);
+    stopped = true;
+    api->halt(api->vm);
+}
+
+static void stop_syscall(void *udata UNUSED,
+                         uint32_t nr UNUSED,
+                         const uint32_t args[6] UNUSED)
+{
+    n_syscalls++;
+}
+
+static void stop_exit(void *udata UNUSED)
+{
+    if (stopped)
+        printf("stopped before system call %u, %u emulated\n", stop_nr,
+               n_syscalls);
+    else
+        printf("no system call, %u emulated\n", n_syscalls);
+}
+
+const uint32_t rv_plugin_version = RV_PLUGIN_VERSION;
+
+int rv_plugin_install(const rv_plugin_api_t *plugin_api,
+                      rv_plugin_ops_t *ops,
+                      const char *args UNUSED)
+{
+    api = plugin_api;
+    ops->insn_exec = stop_insn_exec;
+    ops->syscall = stop_syscall;
+    ops->exit = stop_exit;
+    return 0;
+}
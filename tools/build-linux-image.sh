@@ -49,6 +49,8 @@ function do_linux
     ASSERT make $PARALLEL
     popd
     cp -f $SRC_DIR/linux/arch/riscv/boot/Image $OUTPUT_DIR
+    # kernel symbols for the initcall breakdown of "make boot-profile"
+    cp -f $SRC_DIR/linux/System.map $OUTPUT_DIR
 }
 
 do_buildroot && OK
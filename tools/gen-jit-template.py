@@ -11,6 +11,8 @@ import sys
 
 INSN = {
     "Zifencei": ["fencei"],
+    "Zicbom": ["cboinval", "cboclean", "cboflush"],
+    "Zicboz": ["cbozero"],
     "Zicsr": [
         "csrrw",
         "csrrs",
@@ -142,8 +144,64 @@ INSN = {
         "bclri",
         "bclr",
     ],
+    "Zcb": [
+        "clbu",
+        "clhu",
+        "clh",
+        "csb",
+        "csh",
+        "czextb",
+        "cnot",
+    ],
+    "Zcb_Zbb": [
+        "csextb",
+        "czexth",
+        "csexth",
+    ],
+    "Zcb_M": ["cmul"],
+    "Zcmp": [
+        "cmpush",
+        "cmpop",
+        "cmpopretz",
+        "cmpopret",
+        "cmmvsa01",
+        "cmmva01s",
+    ],
+    "Zicond": [
+        "czeroeqz",
+        "czeronez",
+    ],
+    "Zfa": [
+        "flis",
+        "fminms",
+        "fmaxms",
+        "frounds",
+        "froundnxs",
+        "fleqs",
+        "fltqs",
+    ],
+    "Zve32x": [
+        "vsetvli",
+        "vsetivli",
+        "vsetvl",
+        "vle",
+        "vlse",
+        "vlxe",
+        "vse",
+        "vsse",
+        "vsxe",
+        "vopivv",
+        "vopivx",
+        "vopivi",
+        "vopmvv",
+        "vopmvx",
+    ],
+    "Zve32f": [
+        "vopfvv",
+        "vopfvf",
+    ],
 }
-EXT_LIST = ["Zifencei", "Zicsr", "EXT_M", "EXT_A", "EXT_F", "EXT_C", "SYSTEM", "Zba", "Zbb", "Zbc", "Zbs"]
+EXT_LIST = ["Zifencei", "Zicsr", "EXT_M", "EXT_A", "EXT_F", "EXT_C", "SYSTEM", "Zba", "Zbb", "Zbc", "Zbs", "Zcb", "Zcmp", "Zicond", "Zfa", "Zicbom", "Zicboz", "Zve32x", "Zve32f"]
 SKIP_LIST = []
 # check enabled extension in Makefile
 
@@ -158,6 +216,12 @@ def parse_argv(EXT_LIST, SKIP_LIST):
         SKIP_LIST += INSN[ext]
     if "EXT_F" in EXT_LIST or "EXT_C" in EXT_LIST:
         SKIP_LIST += INSN["EXT_FC"]
+    if "EXT_F" in EXT_LIST and "Zfa" not in EXT_LIST:
+        SKIP_LIST += INSN["Zfa"]
+    if "Zcb" in EXT_LIST or "Zbb" in EXT_LIST:
+        SKIP_LIST += INSN["Zcb_Zbb"]
+    if "Zcb" in EXT_LIST or "EXT_M" in EXT_LIST:
+        SKIP_LIST += INSN["Zcb_M"]
 
 parse_argv(EXT_LIST, SKIP_LIST)
 # prepare PROLOGUE
@@ -314,6 +378,13 @@ for i in range(len(op)):
                 asm = "store_back(state);"
             elif items[0] == "assert":
                 asm = "assert(NULL);"
+            elif items[0] == "czero":
+                asm = "emit_czero(state, {}, {}, {}, {});".format(
+                    items[1], items[2], items[3], items[4])
+            elif items[0] == "cmpush":
+                asm = "emit_cm_push(state, rv, ir);"
+            elif items[0] == "cmpop":
+                asm = "emit_cm_pop(state, rv, ir);"
             elif items[0] == "predict":
                 asm = "parse_branch_history_table(state, ir);"
             output += asm + "\n"